@@ -0,0 +1,17 @@
+#Embeds the compiled SPIR-V into a C header, run by the compile_shaders target:
+#cmake -DOUTPUT=<header> -DSPIRV_FILES=<a.spv;b.spv> -P EmbedShaders.cmake
+set(CONTENT "//generated by EmbedShaders.cmake from the compiled shaders, do not edit\n\n")
+set(TABLE "")
+set(COUNT 0)
+foreach(SPIRV_FILE ${SPIRV_FILES})
+	get_filename_component(FILE_NAME ${SPIRV_FILE} NAME)
+	get_filename_component(SYMBOL ${SPIRV_FILE} NAME_WE)
+	file(READ ${SPIRV_FILE} HEX_CODE HEX)
+	string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," BYTES "${HEX_CODE}")
+	string(APPEND CONTENT "static const unsigned char ${SYMBOL}_spv[] = { ${BYTES} };\n")
+	string(APPEND TABLE "\t{ \"${FILE_NAME}\", ${SYMBOL}_spv, sizeof(${SYMBOL}_spv) },\n")
+	math(EXPR COUNT "${COUNT} + 1")
+endforeach()
+string(APPEND CONTENT "\nstatic const VkEmbeddedShader embeddedShaders[] = {\n${TABLE}};\n")
+string(APPEND CONTENT "static const uint32_t embeddedShaderCount = ${COUNT};\n")
+file(WRITE ${OUTPUT} "${CONTENT}")
@@ -1,73 +1,15 @@
-﻿#ifdef __cplusplus
+﻿#include "VulkanTransposition.h"
+
+#ifdef __cplusplus
 extern "C" {
 #endif
 
-#include <memory.h>
-#include <string.h>
-#include <stdio.h>
-#include <stdlib.h>
-#include <math.h>
-#include <time.h> 
-#include "vulkan/vulkan.h"
-
 #ifdef NDEBUG
 	const VkBool32 enableValidationLayers = 0;
 #else
 	const VkBool32 enableValidationLayers = 1;
 #endif
 
-typedef struct {
-	VkInstance instance;//a connection between the application and the Vulkan library 
-
-	VkPhysicalDevice                 physicalDevice;                //a handle for the graphics card used in the application
-	VkPhysicalDeviceProperties       physicalDeviceProperties;      //bastic device properties
-	VkPhysicalDeviceMemoryProperties physicalDeviceMemoryProperties;//bastic memory properties of the device
-
-	VkDevice device;//a logical device, interacting with physical device
-	VkDebugUtilsMessengerEXT debugMessenger;//extension for debugging
-	uint32_t queueFamilyIndex;//if multiple queues are available, specify the used one
-
-	VkQueue       queue;      //a place, where all operations are submitted
-	VkCommandPool commandPool;//an opaque objects that command buffer memory is allocated from
-	VkFence       fence;      //a fence used to synchronize dispatches
-
-	uint32_t device_id;//an id of a device, reported by Vulkan device list
-} VkGPU;//an example structure containing Vulkan primitives
-
-typedef struct {
-	uint32_t localSize[3];
-	uint32_t inputStride[3];
-} VkAppSpecializationConstantsLayout;//an example structure on how to set constants in the shader after first compilation but before final shader module creation
-
-typedef struct {
-	uint32_t pushID;//an example structure on how to pass small amount of data to the shader right before dispatch
-} VkAppPushConstantsLayout;
-
-typedef struct {
-	//system size for transposition
-	uint32_t size[3];
-	//how much memory is coalesced (in bytes) - 32 for Nvidia, 64 for Intel, 64 for AMD. Maximum value: 128
-	uint32_t coalescedMemory;
-	VkAppSpecializationConstantsLayout specializationConstants;
-	VkAppPushConstantsLayout pushConstants;
-	//bridging information, that allows shaders to freely access resources like buffers and images
-	VkDescriptorPool descriptorPool;
-	VkDescriptorSetLayout descriptorSetLayout;
-	VkDescriptorSet descriptorSet;
-	//pipeline used for graphics applications, we only use compute part of it in this example
-	VkPipelineLayout pipelineLayout;
-	VkPipeline pipeline;
-	//input buffer
-	VkDeviceSize inputBufferSize;//the size of buffer (in bytes)
-	VkBuffer* inputBuffer;//pointer to the buffer object
-	VkDeviceMemory* inputBufferDeviceMemory;//pointer to the memory object, corresponding to the buffer
-
-	//output buffer
-	VkDeviceSize outputBufferSize;
-	VkBuffer* outputBuffer;
-	VkDeviceMemory* outputBufferDeviceMemory;
-} VkApplication;//application specific data
-
 
 VkResult
 CreateDebugUtilsMessengerEXT(VkGPU* vkGPU,
@@ -186,7 +128,7 @@ create_Instance(VkInstance *instance)
                               (uint32_t) 1.0,
                               (const char*) "VulkanTransposition",
                               (uint32_t) 1.0,
-                              (uint32_t) VK_API_VERSION_1_0 };
+                              (uint32_t) VK_API_VERSION_1_1 };
 
         VkDebugUtilsMessengerCreateInfoEXT
         debugUtilsMessengerCreateInfo = { VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT,
@@ -241,6 +183,10 @@ find_PhysicalDevice(VkInstance instance,
 	VkPhysicalDevice* devices = (VkPhysicalDevice*) malloc(sizeof(VkPhysicalDevice) * deviceCount);
 	res = vkEnumeratePhysicalDevices(instance, &deviceCount, devices);
 	if (res != VK_SUCCESS) return res;
+	if (deviceId >= deviceCount) {
+		free(devices);
+		return VK_ERROR_DEVICE_LOST;
+	}
 	*physicalDevice = devices[deviceId];
 	free(devices);
 	return VK_SUCCESS;
@@ -273,9 +219,26 @@ get_Compute_QueueFamilyIndex(VkPhysicalDevice physicalDevice,
 	return VK_SUCCESS;
 }
 
+uint32_t
+check_DeviceExtension(VkPhysicalDevice physicalDevice, const char* extensionName)
+{
+	//1 if the device supports the extension
+	uint32_t extensionCount = 0;
+	if (vkEnumerateDeviceExtensionProperties(physicalDevice, NULL, &extensionCount, NULL) != VK_SUCCESS) return 0;
+	VkExtensionProperties* extensionProperties = (VkExtensionProperties*) malloc(sizeof(VkExtensionProperties) * (extensionCount + 1));
+	uint32_t supported = 0;
+	if (vkEnumerateDeviceExtensionProperties(physicalDevice, NULL, &extensionCount, extensionProperties) == VK_SUCCESS) {
+		for (uint32_t i = 0; i < extensionCount && !supported; i++) supported = (strcmp(extensionProperties[i].extensionName, extensionName) == 0);
+	}
+	free(extensionProperties);
+	return supported;
+}
+
 VkResult 
 create_logicalDevice(VkPhysicalDevice physicalDevice,
                      uint32_t *queueFamilyIndex, 
+                     uint32_t extensionCount,
+                     const char* const* extensions,
                      VkDevice *logicalDevice,
                      VkQueue  *queue)
 {
@@ -303,8 +266,8 @@ create_logicalDevice(VkPhysicalDevice physicalDevice,
                 (const VkDeviceQueueCreateInfo*) &deviceQueueCreateInfo,
                 (uint32_t) 0,
                 (const char* const*) NULL,
-                (uint32_t) 0,
-                (const char* const*) NULL,
+                (uint32_t) extensionCount,
+                (const char* const*) extensions,
                 (const VkPhysicalDeviceFeatures*) &physicalDeviceFeatures};
 
 	res = vkCreateDevice(physicalDevice, &deviceCreateInfo, NULL, logicalDevice);
@@ -315,30 +278,306 @@ create_logicalDevice(VkPhysicalDevice physicalDevice,
 
 
 
+double
+get_TimeMs()
+{
+	//wall clock time in ms. clock() measures the CPU time of the process, which is not a latency
+	struct timespec ts;
+#ifdef _WIN32
+	timespec_get(&ts, TIME_UTC);
+#else
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+
+typedef struct {
+	const char* name;         //file name of the compiled shader, as in SHADER_DIR
+	const unsigned char* code;//SPIR-V
+	size_t size;              //in bytes
+} VkEmbeddedShader;//SPIR-V embedded by EmbedShaders.cmake
+
+#ifdef VKT_EMBEDDED_SHADERS
+#include "VulkanTranspositionShaders.h"
+#endif
+
+
+VkResult
+load_ShaderCode(const char* shaderFilename, uint32_t** code, size_t* codeSize, uint32_t* embedded)
+{
+	//SPIR-V of the shader, padded to whole words. Shaders embedded at build time are looked up by the file name,
+	//the file is read otherwise. code is freed by the caller
+	embedded[0] = 0;
+#ifdef VKT_EMBEDDED_SHADERS
+	const char* name = strrchr(shaderFilename, '/');
+	name = (name != NULL) ? name + 1 : shaderFilename;
+	for (uint32_t i = 0; i < embeddedShaderCount; i++) {
+		if (strcmp(embeddedShaders[i].name, name) != 0) continue;
+		codeSize[0] = (embeddedShaders[i].size + 3) / 4 * 4;
+		code[0] = (uint32_t*) calloc(codeSize[0] / 4, sizeof(uint32_t));
+		memcpy(code[0], embeddedShaders[i].code, embeddedShaders[i].size);
+		embedded[0] = 1;
+		return VK_SUCCESS;
+	}
+#endif
+	FILE* fp = fopen(shaderFilename, "rb");
+	if (fp == NULL) {
+		printf("Could not find or open file: %s\n", shaderFilename);
+		return VK_ERROR_INITIALIZATION_FAILED;
+	}
+	fseek(fp, 0, SEEK_END);
+	long filesize = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	codeSize[0] = ((size_t) filesize + 3) / 4 * 4;
+	code[0] = (uint32_t*) calloc(codeSize[0] / 4, sizeof(uint32_t));
+	size_t readSize = fread(code[0], 1, filesize, fp);
+	fclose(fp);
+	if (readSize != (size_t) filesize) {
+		printf("Could not read file: %s\n", shaderFilename);
+		free(code[0]);
+		return VK_ERROR_INITIALIZATION_FAILED;
+	}
+	return VK_SUCCESS;
+}
+
+
+//Pipeline batches: while a batch is open, create_ComputeApp creates the descriptor set, layouts and shader module as usual,
+//but only queues the pipeline. build_PipelineBatch creates all queued pipelines in one vkCreateComputePipelines call, or
+//splits them over worker threads. launch_PipelineBatch builds on a background thread, so the pipelines that are not needed
+//for the first dispatch are created lazily while it runs; wait_PipelineBatch before their first use. The open batch is
+//per thread: it only captures the pipelines of the thread that began it, create_ComputeApp calls of the async, service
+//and worker threads create their pipelines at once and never touch another thread's batch
+#define VKT_PIPELINE_BATCH_MAX         32
+#define VKT_PIPELINE_BATCH_MAX_THREADS 8
+
+typedef struct {
+	VkComputePipelineCreateInfo createInfo;
+	//copy of the specialization info, the caller's one lives on its stack
+	VkSpecializationInfo specializationInfo;
+	VkSpecializationMapEntry specializationMapEntries[16];
+	uint32_t specializationData[16];
+	VkPipeline* pipeline;//filled by the build
+} VkPipelineRequest;
+
+typedef struct {
+	VkDevice device;
+	VkPipelineRequest request[VKT_PIPELINE_BATCH_MAX];
+	uint32_t count;
+	uint32_t threads;//worker threads of the build, 0 or 1 - one batched call
+	VkResult result;
+	uint32_t embeddedShaders;//statistics: shaders found in the binary and read from files
+	uint32_t fileShaders;
+	double shaderTime;       //ms spent loading SPIR-V and creating shader modules
+	double buildTime;        //ms spent creating the pipelines
+#ifndef _WIN32
+	pthread_t thread;
+	uint32_t launched;
+#endif
+} VkPipelineBatch;
+
+#ifdef _MSC_VER
+#define VKT_THREAD_LOCAL __declspec(thread)
+#else
+#define VKT_THREAD_LOCAL __thread
+#endif
+
+static VKT_THREAD_LOCAL VkPipelineBatch* openPipelineBatch = NULL;//batch of this thread that create_ComputeApp queues the pipelines to, NULL - create them at once
+
+
+void
+begin_PipelineBatch(VkPipelineBatch* batch, VkDevice device, uint32_t threads)
+{
+	memset(batch, 0, sizeof(VkPipelineBatch));
+	batch->device = device;
+	batch->threads = threads;
+	openPipelineBatch = batch;
+}
+
+
+void
+end_PipelineBatch(VkPipelineBatch* batch)
+{
+	//stop queueing, the pipelines are still to be built
+	if (openPipelineBatch == batch) openPipelineBatch = NULL;
+}
+
+
+uint32_t
+queue_PipelineBatch(VkPipelineBatch* batch, const VkComputePipelineCreateInfo* createInfo, VkPipeline* pipeline)
+{
+	//returns 0 if the request does not fit the batch, the pipeline is created at once then
+	const VkSpecializationInfo* specializationInfo = createInfo->stage.pSpecializationInfo;
+	if (batch->count == VKT_PIPELINE_BATCH_MAX) return 0;
+	if (specializationInfo != NULL && (specializationInfo->mapEntryCount > 16 || specializationInfo->dataSize > sizeof(uint32_t) * 16)) return 0;
+	VkPipelineRequest* request = &batch->request[batch->count];
+	request->createInfo = createInfo[0];
+	if (specializationInfo != NULL) {
+		request->specializationInfo = specializationInfo[0];
+		memcpy(request->specializationMapEntries, specializationInfo->pMapEntries, sizeof(VkSpecializationMapEntry) * specializationInfo->mapEntryCount);
+		memcpy(request->specializationData, specializationInfo->pData, specializationInfo->dataSize);
+		request->specializationInfo.pMapEntries = request->specializationMapEntries;
+		request->specializationInfo.pData = request->specializationData;
+		request->createInfo.stage.pSpecializationInfo = &request->specializationInfo;
+	}
+	request->pipeline = pipeline;
+	pipeline[0] = VK_NULL_HANDLE;
+	batch->count++;
+	return 1;
+}
+
+
+typedef struct {
+	VkDevice device;
+	const VkComputePipelineCreateInfo* createInfo;
+	VkPipeline* pipeline;
+	uint32_t count;
+	VkResult result;
+} VkPipelineBuildSlice;
+
+#ifndef _WIN32
+void*
+run_PipelineBuildSlice(void* arg)
+{
+	VkPipelineBuildSlice* slice = (VkPipelineBuildSlice*) arg;
+	slice->result = vkCreateComputePipelines(slice->device, VK_NULL_HANDLE, slice->count, slice->createInfo, NULL, slice->pipeline);
+	return NULL;
+}
+#endif
+
+
+VkResult
+create_BatchPipelines(VkPipelineBatch* batch)
+{
+	//create the queued pipelines and destroy their shader modules
+	double t = get_TimeMs();
+	VkResult res = VK_SUCCESS;
+	uint32_t count = batch->count;
+	if (count > 0) {
+		VkComputePipelineCreateInfo* createInfo = (VkComputePipelineCreateInfo*) malloc(sizeof(VkComputePipelineCreateInfo) * count);
+		VkPipeline* pipeline = (VkPipeline*) calloc(count, sizeof(VkPipeline));
+		for (uint32_t i = 0; i < count; i++) createInfo[i] = batch->request[i].createInfo;
+		uint32_t threads = batch->threads;
+		if (threads > VKT_PIPELINE_BATCH_MAX_THREADS) threads = VKT_PIPELINE_BATCH_MAX_THREADS;
+		if (threads > count) threads = count;
+#ifndef _WIN32
+		if (threads > 1) {
+			//vkCreateComputePipelines may be called from several threads, only a shared pipeline cache needs care
+			VkPipelineBuildSlice slice[VKT_PIPELINE_BATCH_MAX_THREADS];
+			pthread_t thread[VKT_PIPELINE_BATCH_MAX_THREADS];
+			uint32_t started[VKT_PIPELINE_BATCH_MAX_THREADS] = { 0 };
+			for (uint32_t k = 0; k < threads; k++) {
+				uint32_t begin = count * k / threads;
+				slice[k].device = batch->device;
+				slice[k].createInfo = &createInfo[begin];
+				slice[k].pipeline = &pipeline[begin];
+				slice[k].count = count * (k + 1) / threads - begin;
+				slice[k].result = VK_SUCCESS;
+				started[k] = (pthread_create(&thread[k], NULL, run_PipelineBuildSlice, &slice[k]) == 0);
+				if (!started[k]) run_PipelineBuildSlice(&slice[k]);
+			}
+			for (uint32_t k = 0; k < threads; k++) {
+				if (started[k]) pthread_join(thread[k], NULL);
+				if (slice[k].result != VK_SUCCESS) res = slice[k].result;
+			}
+		}
+		else
+#endif
+		res = vkCreateComputePipelines(batch->device, VK_NULL_HANDLE, count, createInfo, NULL, pipeline);
+		for (uint32_t i = 0; i < count; i++) {
+			batch->request[i].pipeline[0] = pipeline[i];
+			vkDestroyShaderModule(batch->device, createInfo[i].stage.module, NULL);
+		}
+		free(createInfo);
+		free(pipeline);
+		batch->count = 0;
+	}
+	batch->buildTime += get_TimeMs() - t;
+	batch->result = res;
+	return res;
+}
+
+
+VkResult
+build_PipelineBatch(VkPipelineBatch* batch)
+{
+	end_PipelineBatch(batch);
+	return create_BatchPipelines(batch);
+}
+
+
+#ifndef _WIN32
+void*
+run_PipelineBatch(void* arg)
+{
+	create_BatchPipelines((VkPipelineBatch*) arg);
+	return NULL;
+}
+#endif
+
+
+VkResult
+launch_PipelineBatch(VkPipelineBatch* batch)
+{
+	//build on a background thread, synchronously if threads are not available
+	end_PipelineBatch(batch);
+#ifndef _WIN32
+	if (pthread_create(&batch->thread, NULL, run_PipelineBatch, batch) == 0) {
+		batch->launched = 1;
+		return VK_SUCCESS;
+	}
+#endif
+	return create_BatchPipelines(batch);
+}
+
+
+VkResult
+wait_PipelineBatch(VkPipelineBatch* batch)
+{
+	//pipelines of a launched batch are valid after this call
+#ifndef _WIN32
+	if (batch->launched) {
+		pthread_join(batch->thread, NULL);
+		batch->launched = 0;
+	}
+#endif
+	return batch->result;
+}
+
+
+void
+discard_PipelineBatch(VkPipelineBatch* batch)
+{
+	//error paths: stop queueing, wait for a launched build and destroy the shader modules of pipelines that were never built
+	end_PipelineBatch(batch);
+	wait_PipelineBatch(batch);
+	for (uint32_t i = 0; i < batch->count; i++) vkDestroyShaderModule(batch->device, batch->request[i].createInfo.stage.module, NULL);
+	batch->count = 0;
+}
+
+
+
 VkResult 
-create_App(VkDevice device,
-           void*    appSpecializationConstantsLayout,
-           uint32_t coalescedMemory,
+create_ComputeApp(VkDevice device,
+           uint32_t     bufferCount,
            VkBuffer**   buffer,
            VkDeviceSize *bufferSize,
-           uint32_t*    size,
+           const VkSpecializationInfo* specializationInfo,
            VkDescriptorPool      *descriptorPool,
            VkDescriptorSetLayout *descriptorSetLayout,
            VkDescriptorSet       *descriptorSet,
            const char* shaderFilename, 
            VkPipelineLayout *pipelineLayout,
            VkPipeline       *pipeline)
-{//create an application interface to Vulkan. This function binds the shader to the compute pipeline, so it can be used as a part of the command buffer later
+{//create an application interface to Vulkan. This function binds the shader with bufferCount storage buffers (bindings 0..bufferCount-1)
+ //to the compute pipeline, so it can be used as a part of the command buffer later
 
         VkResult res = VK_SUCCESS;
-        uint32_t descriptorPoolSize_descriptorCount = 2;
-	//we have two storage buffer objects in one set in one pool
+        uint32_t descriptorPoolSize_descriptorCount = bufferCount;
+	//we have bufferCount storage buffer objects in one set in one pool
 	VkDescriptorPoolSize descriptorPoolSize = {(VkDescriptorType) VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
                                                    (uint32_t) descriptorPoolSize_descriptorCount };
 
-	const VkDescriptorType descriptorTypes[2] = { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
-                                                      VK_DESCRIPTOR_TYPE_STORAGE_BUFFER };
-
 	VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
                                        (const void*) NULL,
                                        (VkDescriptorPoolCreateFlags) 0,
@@ -354,7 +593,7 @@ create_App(VkDevice device,
                                       (VkDescriptorSetLayoutBinding*) malloc(descriptorPoolSize_descriptorCount * sizeof(VkDescriptorSetLayoutBinding));
 	for (uint32_t ii = 0; ii < descriptorPoolSize_descriptorCount; ++ii) {
 		descriptorSetLayoutBindings[ii].binding            = (uint32_t) ii;
-		descriptorSetLayoutBindings[ii].descriptorType     = (VkDescriptorType) descriptorTypes[ii];
+		descriptorSetLayoutBindings[ii].descriptorType     = (VkDescriptorType) VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
 		descriptorSetLayoutBindings[ii].descriptorCount    = (uint32_t) 1;
 		descriptorSetLayoutBindings[ii].stageFlags         = (VkShaderStageFlags) VK_SHADER_STAGE_COMPUTE_BIT;
                 descriptorSetLayoutBindings[ii].pImmutableSamplers = (const VkSampler*) NULL; 
@@ -382,16 +621,9 @@ create_App(VkDevice device,
 	for (uint32_t jj = 0; jj < descriptorPoolSize_descriptorCount; ++jj) {
 
 		VkDescriptorBufferInfo descriptorBufferInfo = { 0 };
-		if (jj == 0) {
-			descriptorBufferInfo.buffer = buffer[0][0];
-			descriptorBufferInfo.range  = bufferSize[0];
-			descriptorBufferInfo.offset = 0;
-		}
-		if (jj == 1) {
-			descriptorBufferInfo.buffer = buffer[1][0];
-			descriptorBufferInfo.range  = bufferSize[1];
-			descriptorBufferInfo.offset = 0;
-		}
+		descriptorBufferInfo.buffer = buffer[jj][0];
+		descriptorBufferInfo.range  = bufferSize[jj];
+		descriptorBufferInfo.offset = 0;
 
 		VkWriteDescriptorSet writeDescriptorSet = { VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
                                          (const void*) NULL,
@@ -399,7 +631,7 @@ create_App(VkDevice device,
                                          (uint32_t) jj,
                                          (uint32_t) 0,
                                          (uint32_t) 1,
-                                         (VkDescriptorType) descriptorTypes[jj],
+                                         (VkDescriptorType) VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
                                          (const VkDescriptorImageInfo*) NULL,
                                          (const VkDescriptorBufferInfo*) &descriptorBufferInfo,
                                          (const VkBufferView*) NULL };
@@ -426,67 +658,23 @@ create_App(VkDevice device,
 	res = vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, NULL, pipelineLayout);
 	if (res != VK_SUCCESS) return res;
 
-        {
-	        //specify specialization constants
-                //- structure that sets constants in the shader after first compilation (done by glslangvalidator, for example)
-                //  but before final shader module creation
-	        //  first three values - workgroup dimensions 
-	        ((VkAppSpecializationConstantsLayout*) appSpecializationConstantsLayout)->localSize[0] = coalescedMemory / sizeof(float);
-	        ((VkAppSpecializationConstantsLayout*) appSpecializationConstantsLayout)->localSize[1] = coalescedMemory / sizeof(float);
-	        ((VkAppSpecializationConstantsLayout*) appSpecializationConstantsLayout)->localSize[2] = 1;
-
-	        //next three - buffer strides for multidimensional data
-	        ((VkAppSpecializationConstantsLayout*) appSpecializationConstantsLayout)->inputStride[0] = 1;
-	        ((VkAppSpecializationConstantsLayout*) appSpecializationConstantsLayout)->inputStride[1] = size[0];
-	        ((VkAppSpecializationConstantsLayout*) appSpecializationConstantsLayout)->inputStride[2] = size[0] * size[1];
-        }
-
-
-	VkSpecializationMapEntry specializationMapEntries[6] = { 0 };
-	for (uint32_t kk = 0; kk < 6; kk++) {
-		specializationMapEntries[kk].constantID = kk + 1;
-		specializationMapEntries[kk].size = sizeof(uint32_t);
-		specializationMapEntries[kk].offset = kk * sizeof(uint32_t);
-	}
-
-	VkSpecializationInfo specializationInfo = { (uint32_t) 6,
-                                                    (const VkSpecializationMapEntry*) specializationMapEntries,
-                                                    (size_t) 6 * sizeof(uint32_t),
-                                                    (const void*) appSpecializationConstantsLayout };
-
 	VkPipelineShaderStageCreateInfo pipelineShaderStageCreateInfo = { VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
                                             (const void*) NULL,
                                             (VkPipelineShaderStageCreateFlags) 0,
                                             (VkShaderStageFlagBits) VK_SHADER_STAGE_COMPUTE_BIT,
                                             (VkShaderModule) NULL,
                                             (const char*)    "main",
-                                            (const VkSpecializationInfo*) &specializationInfo };
+                                            (const VkSpecializationInfo*) specializationInfo };
 	{
-	    //function that reads shader's SPIR - V bytecode
-	    FILE* fp = fopen( shaderFilename, "rb");
-	    if (fp == NULL) {
-	    	printf("Could not find or open file: %s\n", shaderFilename);
-	    }
-
-	    // get file size.
-	    fseek(fp, 0, SEEK_END);
-	    long filesize = ftell(fp);
-	    fseek(fp, 0, SEEK_SET);
-
-	    long filesizepadded = ((long)ceil(filesize / 4.0)) * 4;
-
-	    char* str = (char*)  malloc(sizeof(char) * filesizepadded);
-	    fread(str, filesize, sizeof(char), fp);
-	    fclose(fp);
-
-	    for (long i = filesize; i < filesizepadded; i++) {
-	    	str[i] = 0;
-	    }
+	    //shader's SPIR - V bytecode, embedded into the binary or read from the file
+	    uint32_t* shaderModuleCode = NULL;
+	    size_t    shaderFilelength = 0;
+	    uint32_t  embedded = 0;
+	    double    t = get_TimeMs();
+	    res = load_ShaderCode(shaderFilename, &shaderModuleCode, &shaderFilelength, &embedded);
+	    if (res != VK_SUCCESS) return res;
 
             //create a shader module from the byte code
-	    uint32_t  shaderFilelength = filesizepadded;
-            //read bytecode
-	    uint32_t* shaderModuleCode = (uint32_t*)str;
 	    VkShaderModuleCreateInfo shaderModuleCreateInfo = { VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
                                          (const void*) NULL,
                                          (VkShaderModuleCreateFlags) 0,
@@ -495,6 +683,11 @@ create_App(VkDevice device,
        	    res = vkCreateShaderModule(device, &shaderModuleCreateInfo, NULL, &pipelineShaderStageCreateInfo.module);
        	    free( shaderModuleCode );
 	    if (res != VK_SUCCESS) return res;
+	    if (openPipelineBatch != NULL) {
+	    	openPipelineBatch->shaderTime += get_TimeMs() - t;
+	    	if (embedded) openPipelineBatch->embeddedShaders++;
+	    	else openPipelineBatch->fileShaders++;
+	    }
 	}
 	VkComputePipelineCreateInfo computePipelineCreateInfo = { VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
                                         (const void*) NULL,
@@ -503,6 +696,8 @@ create_App(VkDevice device,
                                         (VkPipelineLayout) *pipelineLayout,
                                         (VkPipeline) NULL,
                                         (int32_t)    0 };
+        //queue the pipeline to the open batch, build_PipelineBatch creates it and destroys the shader module
+	if (openPipelineBatch != NULL && openPipelineBatch->device == device && queue_PipelineBatch(openPipelineBatch, &computePipelineCreateInfo, pipeline)) return res;
         //create pipeline
 	res = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &computePipelineCreateInfo, NULL, pipeline);
 	if (res != VK_SUCCESS) return res;
@@ -512,17 +707,119 @@ create_App(VkDevice device,
 }
 
 VkResult
-run_App(VkDevice device,
-        VkCommandPool commandPool,
-        VkPipeline       pipeline,
-        VkPipelineLayout pipelineLayout,
-        VkDescriptorSet* descriptorSet,
-        uint32_t *groupCount,
-        VkQueue  queue,
-        VkFence  *fence,
-        uint32_t batch,
-        double* time )
-{
+create_StridedApp(VkDevice device,
+                  VkAppSpecializationConstantsLayout* constants,
+                  uint32_t coalescedMemory,
+                  VkBuffer**   buffer,
+                  VkDeviceSize *bufferSize,
+                  VkDescriptorPool      *descriptorPool,
+                  VkDescriptorSetLayout *descriptorSetLayout,
+                  VkDescriptorSet       *descriptorSet,
+                  const char* shaderFilename,
+                  VkPipelineLayout *pipelineLayout,
+                  VkPipeline       *pipeline)
+{//create a transposition application with the strides set by the caller, input (binding 0) and output (binding 1) buffers
+
+	//specify specialization constants
+	//- structure that sets constants in the shader after first compilation (done by glslangvalidator, for example)
+	//  but before final shader module creation
+	//  first three values - workgroup dimensions
+	constants->localSize[0] = coalescedMemory / sizeof(float);
+	constants->localSize[1] = coalescedMemory / sizeof(float);
+	constants->localSize[2] = 1;
+
+	//next three - input strides, two of workgroup rasterization set by the caller (zero keeps the linear order), last three - output strides
+	VkSpecializationMapEntry specializationMapEntries[11] = { 0 };
+	for (uint32_t kk = 0; kk < 11; kk++) {
+		specializationMapEntries[kk].constantID = kk + 1;
+		specializationMapEntries[kk].size = sizeof(uint32_t);
+		specializationMapEntries[kk].offset = kk * sizeof(uint32_t);
+	}
+
+	VkSpecializationInfo specializationInfo = { (uint32_t) 11,
+                                                    (const VkSpecializationMapEntry*) specializationMapEntries,
+                                                    (size_t) 11 * sizeof(uint32_t),
+                                                    (const void*) constants };
+
+	return create_ComputeApp(device,
+                                 2,
+                                 buffer,
+                                 bufferSize,
+                                 &specializationInfo,
+                                 descriptorPool,
+                                 descriptorSetLayout,
+                                 descriptorSet,
+                                 shaderFilename,
+                                 pipelineLayout,
+                                 pipeline);
+}
+
+VkResult 
+create_App(VkDevice device,
+           void*    appSpecializationConstantsLayout,
+           uint32_t coalescedMemory,
+           VkBuffer**   buffer,
+           VkDeviceSize *bufferSize,
+           uint32_t*    size,
+           VkDescriptorPool      *descriptorPool,
+           VkDescriptorSetLayout *descriptorSetLayout,
+           VkDescriptorSet       *descriptorSet,
+           const char* shaderFilename, 
+           VkPipelineLayout *pipelineLayout,
+           VkPipeline       *pipeline)
+{//create a transposition application with the input (binding 0) and output (binding 1) buffers
+	VkAppSpecializationConstantsLayout* constants = (VkAppSpecializationConstantsLayout*) appSpecializationConstantsLayout;
+	//buffer strides for multidimensional data, tightly packed from offset 0. Output uses the same strides
+	constants->inputStride[0] = 1;
+	constants->inputStride[1] = size[0];
+	constants->inputStride[2] = size[0] * size[1];
+	constants->outputStride[0] = 0;
+	constants->outputStride[1] = 0;
+	constants->outputStride[2] = 0;
+	return create_StridedApp(device, constants, coalescedMemory, buffer, bufferSize, descriptorPool, descriptorSetLayout, descriptorSet,
+	                         shaderFilename, pipelineLayout, pipeline);
+}
+
+VkResult
+create_SubmatrixApp(VkDevice device,
+                    VkAppSpecializationConstantsLayout* constants,
+                    uint32_t coalescedMemory,
+                    VkBuffer**   buffer,
+                    VkDeviceSize *bufferSize,
+                    uint32_t*    size,
+                    uint32_t     lda,
+                    uint32_t     ldb,
+                    VkDescriptorPool      *descriptorPool,
+                    VkDescriptorSetLayout *descriptorSetLayout,
+                    VkDescriptorSet       *descriptorSet,
+                    const char* shaderFilename,
+                    VkPipelineLayout *pipelineLayout,
+                    VkPipeline       *pipeline)
+{//transposition of size[1] rows of size[0] elements, lda elements apart in the input, into size[0] rows of size[1] elements, ldb
+ //elements apart in the output (BLAS leading dimensions). The first elements are the offsets in the push constants of every dispatch
+	constants->inputStride[0] = 1;
+	constants->inputStride[1] = lda;
+	constants->inputStride[2] = lda * size[1];
+	constants->outputStride[0] = 1;
+	constants->outputStride[1] = ldb;
+	constants->outputStride[2] = ldb * size[0];
+	return create_StridedApp(device, constants, coalescedMemory, buffer, bufferSize, descriptorPool, descriptorSetLayout, descriptorSet,
+	                         shaderFilename, pipelineLayout, pipeline);
+}
+
+VkResult
+run_AppPushConstants(VkDevice device,
+                     VkCommandPool commandPool,
+                     VkPipeline       pipeline,
+                     VkPipelineLayout pipelineLayout,
+                     VkDescriptorSet* descriptorSet,
+                     uint32_t *groupCount,
+                     VkQueue  queue,
+                     VkFence  *fence,
+                     uint32_t batch,
+                     const VkAppPushConstantsLayout* pushConstants,
+                     double* time )
+{//same as run_App, with the push constants set by the caller
 	VkResult res = VK_SUCCESS;
         VkCommandBuffer commandBuffer = {0};
 
@@ -550,9 +847,8 @@ run_App(VkDevice device,
 	                            (const void*) NULL,
 	                            (VkAccessFlags) VK_ACCESS_SHADER_WRITE_BIT,
 	       	                    (VkAccessFlags) VK_ACCESS_SHADER_READ_BIT };
-	        uint32_t pushConstants_pushID = 0;
 	        //specify push constants - small amount of constant data in the shader
-	        vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uint32_t), &pushConstants_pushID);
+	        vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(VkAppPushConstantsLayout), pushConstants);
 	        //bind compute pipeline to the command buffer
 	        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
 	        //bind descriptors to the command buffer
@@ -587,14 +883,13 @@ run_App(VkDevice device,
                          (const VkCommandBuffer*) &commandBuffer,
                          (uint32_t) 0,                          
                          (const VkSemaphore*) NULL };
-	clock_t t;
-	t = clock();
+	//wall clock time, the CPU time of clock() does not advance while the host waits for the fence
+	double t = get_TimeMs();
 	res = vkQueueSubmit(queue, 1, &submitInfo, *fence);
 	if (res != VK_SUCCESS) return res;
 	res = vkWaitForFences(device, 1, fence, VK_TRUE, 100000000000);
 	if (res != VK_SUCCESS) return res;
-	t = clock() - t;
-	time[0] = ((double)t) / CLOCKS_PER_SEC * 1000/batch; //in ms
+	time[0] = (get_TimeMs() - t) / batch; //in ms
 	res = vkResetFences(device, 1, fence);
 	if (res != VK_SUCCESS) return res;
 	//free the command buffer
@@ -603,6 +898,23 @@ run_App(VkDevice device,
 }
 
 
+VkResult
+run_App(VkDevice device,
+        VkCommandPool commandPool,
+        VkPipeline       pipeline,
+        VkPipelineLayout pipelineLayout,
+        VkDescriptorSet* descriptorSet,
+        uint32_t *groupCount,
+        VkQueue  queue,
+        VkFence  *fence,
+        uint32_t batch,
+        double* time )
+{
+	VkAppPushConstantsLayout pushConstants = { 0 };
+	return run_AppPushConstants(device, commandPool, pipeline, pipelineLayout, descriptorSet, groupCount, queue, fence, batch, &pushConstants, time);
+}
+
+
 void deleteApp(VkGPU* vkGPU, VkApplication* app) {
 	//destroy previously allocated resources of the application
 	vkDestroyDescriptorPool(vkGPU->device, app->descriptorPool, NULL);
@@ -895,39 +1207,42 @@ list_PhysicalDevice() {
 
 
 VkResult
-Example_VulkanTransposition(uint32_t deviceID,
-           uint32_t coalescedMemory,
-           uint32_t size)
+create_VkGPU(VkGPU* vkGPU)
 {
-	VkGPU vkGPU = { 0 };
-	vkGPU.device_id = deviceID;
+	//create all Vulkan primitives of the VkGPU structure for the device vkGPU->device_id
 	VkResult res = VK_SUCCESS;
 
-
 	//create instance - a connection between the application and the Vulkan library 
-	res = create_Instance( &vkGPU.instance );
+	res = create_Instance( &vkGPU->instance );
 	if (res != VK_SUCCESS) {
 		printf("Instance creation failed, error code: %d\n", res);
 		return res;
 	}
 
 	//set up the debugging messenger 
-	res = setup_DebugUtilsMessenger(vkGPU.instance, &vkGPU.debugMessenger);
+	res = setup_DebugUtilsMessenger(vkGPU->instance, &vkGPU->debugMessenger);
 	if (res != VK_SUCCESS) {
 		printf("Debug utils messenger creation failed, error code: %d\n", res);
 		return res;
 	}
 
 	//check if there are GPUs that support Vulkan and select one
-	res = find_PhysicalDevice(vkGPU.instance, deviceID, &vkGPU.physicalDevice);
+	res = find_PhysicalDevice(vkGPU->instance, vkGPU->device_id, &vkGPU->physicalDevice);
 	if (res != VK_SUCCESS) {
 		printf("Physical device not found, error code: %d\n", res);
 		return res;
 	}
         printf("\nPhysical device is found, return code: %d\n", res);
 
-	//create logical device representation
-	res = create_logicalDevice(vkGPU.physicalDevice, &vkGPU.queueFamilyIndex, &vkGPU.device, &vkGPU.queue);
+	//create logical device representation, with the memory budget queries and host memory import if available
+	const char* extensions[2];
+	uint32_t extensionCount = 0;
+	vkGPU->memoryBudgetSupported = check_DeviceExtension(vkGPU->physicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+	if (vkGPU->memoryBudgetSupported) extensions[extensionCount++] = VK_EXT_MEMORY_BUDGET_EXTENSION_NAME;
+	vkGPU->externalMemoryHostSupported = check_DeviceExtension(vkGPU->physicalDevice, VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME);
+	if (vkGPU->externalMemoryHostSupported) extensions[extensionCount++] = VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME;
+	vkGPU->pciBusInfoSupported = check_DeviceExtension(vkGPU->physicalDevice, VK_EXT_PCI_BUS_INFO_EXTENSION_NAME);
+	res = create_logicalDevice(vkGPU->physicalDevice, &vkGPU->queueFamilyIndex, extensionCount, extensions, &vkGPU->device, &vkGPU->queue);
 	if (res != VK_SUCCESS) {
 		printf("logical Device creation failed, error code: %d\n", res);
 		return res;
@@ -938,7 +1253,7 @@ Example_VulkanTransposition(uint32_t deviceID,
 	VkFenceCreateInfo fenceCreateInfo = {VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
                               (const void*) NULL,
                               (VkFenceCreateFlags) 0 };
-	res = vkCreateFence(vkGPU.device, &fenceCreateInfo, NULL, &vkGPU.fence);
+	res = vkCreateFence(vkGPU->device, &fenceCreateInfo, NULL, &vkGPU->fence);
 	if (res != VK_SUCCESS) {
 		printf("Fence creation failed, error code: %d\n", res);
 		return res;
@@ -950,8 +1265,8 @@ Example_VulkanTransposition(uint32_t deviceID,
 	VkCommandPoolCreateInfo commandPoolCreateInfo = { VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
                                     (const void*) NULL,
                                     (VkCommandPoolCreateFlags) VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
-                                    (uint32_t) vkGPU.queueFamilyIndex };
-	res = vkCreateCommandPool(vkGPU.device, &commandPoolCreateInfo, NULL, &vkGPU.commandPool);
+                                    (uint32_t) vkGPU->queueFamilyIndex };
+	res = vkCreateCommandPool(vkGPU->device, &commandPoolCreateInfo, NULL, &vkGPU->commandPool);
 	if (res != VK_SUCCESS) {
 		printf("Command Pool Creation failed, error code: %d\n", res);
 		return res;
@@ -960,36 +1275,96 @@ Example_VulkanTransposition(uint32_t deviceID,
 
 
 	//get device properties and memory properties, if needed
-	vkGetPhysicalDeviceProperties(vkGPU.physicalDevice, &vkGPU.physicalDeviceProperties);
-	vkGetPhysicalDeviceMemoryProperties(vkGPU.physicalDevice, &vkGPU.physicalDeviceMemoryProperties);
+	vkGetPhysicalDeviceProperties(vkGPU->physicalDevice, &vkGPU->physicalDeviceProperties);
+	vkGetPhysicalDeviceMemoryProperties(vkGPU->physicalDevice, &vkGPU->physicalDeviceMemoryProperties);
+	//subgroup properties are available since Vulkan 1.1, host import and PCI properties with their extensions
+	if (vkGPU->physicalDeviceProperties.apiVersion >= VK_API_VERSION_1_1) {
+		vkGPU->physicalDeviceSubgroupProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_PROPERTIES;
+		if (vkGPU->externalMemoryHostSupported) {
+			vkGPU->physicalDeviceExternalMemoryHostProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTERNAL_MEMORY_HOST_PROPERTIES_EXT;
+			vkGPU->physicalDeviceExternalMemoryHostProperties.pNext = vkGPU->physicalDeviceSubgroupProperties.pNext;
+			vkGPU->physicalDeviceSubgroupProperties.pNext = &vkGPU->physicalDeviceExternalMemoryHostProperties;
+		}
+		if (vkGPU->pciBusInfoSupported) {
+			vkGPU->physicalDevicePCIBusInfo.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PCI_BUS_INFO_PROPERTIES_EXT;
+			vkGPU->physicalDevicePCIBusInfo.pNext = vkGPU->physicalDeviceSubgroupProperties.pNext;
+			vkGPU->physicalDeviceSubgroupProperties.pNext = &vkGPU->physicalDevicePCIBusInfo;
+		}
+		VkPhysicalDeviceProperties2 physicalDeviceProperties2 = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+                                                  (void*) &vkGPU->physicalDeviceSubgroupProperties };
+		vkGetPhysicalDeviceProperties2(vkGPU->physicalDevice, &physicalDeviceProperties2);
+		//the chain points into vkGPU, which may be copied
+		vkGPU->physicalDeviceSubgroupProperties.pNext = NULL;
+		vkGPU->physicalDeviceExternalMemoryHostProperties.pNext = NULL;
+		vkGPU->physicalDevicePCIBusInfo.pNext = NULL;
+	}
+	return res;
+}
+
+
+void delete_VkGPU(VkGPU* vkGPU) {
+	//destroy Vulkan primitives previously created by create_VkGPU
+	vkDestroyFence(vkGPU->device, vkGPU->fence, NULL);
+	vkDestroyCommandPool(vkGPU->device, vkGPU->commandPool, NULL);
+	vkDestroyDevice(vkGPU->device, NULL);
+	DestroyDebugUtilsMessengerEXT(vkGPU, NULL);
+	vkDestroyInstance(vkGPU->instance, NULL);
+}
+
+
+
+uint32_t
+get_CoalescedMemory(VkGPU* vkGPU, uint32_t coalescedMemory)
+{
+	//how much memory is coalesced (in bytes), use default values for the vendor if coalescedMemory = 0
+	if (coalescedMemory != 0) return coalescedMemory;
+	switch (vkGPU->physicalDeviceProperties.vendorID) {
+	case 0x10DE://NVIDIA - change to 128 before Pascal
+		return 32;
+	case 0x8086://INTEL
+		return 64;
+	case 0x13B5://AMD
+		return 64;
+	default:
+		return 64;
+	}
+}
+
+
+VkResult
+Example_VulkanTransposition(uint32_t deviceID,
+           uint32_t coalescedMemory,
+           uint32_t size,
+           uint32_t startupProfile)
+{
+	VkGPU vkGPU = { 0 };
+	vkGPU.device_id = deviceID;
+	VkResult res = VK_SUCCESS;
+	//startup profile: time points in ms from the start of the example
+	double startTime = get_TimeMs();
+	double time_device = 0, time_data = 0, time_first_pipeline = 0, time_first_dispatch = 0, time_lazy_pipelines = 0;
+
+
+	//create instance, logical device, fence and command pool
+	res = create_VkGPU(&vkGPU);
+	if (res != VK_SUCCESS) return res;
+	time_device = get_TimeMs() - startTime;
 
 
 
 	//create app template and set the system size, the amount of memory to coalesce
 	VkApplication app = { 0 };
+	VkApplication app_bank_conflicts = { 0 }, app_bandwidth = { 0 };
+	//pipelines are created in batches: the one of the first dispatch at once, the other two on a background thread,
+	//while the first one runs. Each batch is one vkCreateComputePipelines call per thread
+	VkPipelineBatch firstBatch = { 0 }, lazyBatch = { 0 };
+	float* buffer_input = NULL;
+	float* buffer_output = NULL;
 	app.size[0] = size;
 	app.size[1] = size;
 	app.size[2] = 1;
 	//use default values if coalescedMemory = 0
-	if (coalescedMemory == 0) {
-		switch (vkGPU.physicalDeviceProperties.vendorID) {
-		case 0x10DE://NVIDIA - change to 128 before Pascal
-			app.coalescedMemory = 32;
-			break;
-		case 0x8086://INTEL
-			app.coalescedMemory = 64;
-			break;
-		case 0x13B5://AMD
-			app.coalescedMemory = 64;
-			break;
-		default:
-			app.coalescedMemory = 64;
-			break;
-		}
-	}
-	else{
-		app.coalescedMemory = coalescedMemory;
-        }
+	app.coalescedMemory = get_CoalescedMemory(&vkGPU, coalescedMemory);
 
 
 
@@ -1018,7 +1393,7 @@ Example_VulkanTransposition(uint32_t deviceID,
                                            &inputBufferDeviceMemory );
 	if (res != VK_SUCCESS) {
 		printf("Input buffer allocation failed, error code: %d\n", res);
-		return res;
+		goto cleanup;
 	}
         printf("\nInput buffer allocation succeeds, return code: %d\n", res);
 
@@ -1033,12 +1408,16 @@ Example_VulkanTransposition(uint32_t deviceID,
                                            &outputBufferDeviceMemory );
 	if (res != VK_SUCCESS) {
 		printf("Output buffer allocation failed, error code: %d\n", res);
-		return res;
+		goto cleanup;
 	}
         printf("\nOutput buffer allocation succeeds, return code: %d\n", res);
 
 	//allocate input data on the CPU
-	float* buffer_input = (float*)malloc(inputBufferSize);
+	buffer_input = (float*)malloc(inputBufferSize);
+	if (buffer_input == NULL) {
+		res = VK_ERROR_OUT_OF_HOST_MEMORY;
+		goto cleanup;
+	}
 	for (uint32_t k = 0; k < app.size[2]; k++) {
 		for (uint32_t j = 0; j < app.size[1]; j++) {
 			for (uint32_t i = 0; i < app.size[0]; i++) {
@@ -1049,7 +1428,7 @@ Example_VulkanTransposition(uint32_t deviceID,
 
 	//transfer data to GPU staging buffer and thereafter
         //sync the staging buffer with GPU local memory
-	upload_Data(vkGPU.physicalDevice,
+	res = upload_Data(vkGPU.physicalDevice,
                     vkGPU.device,
                     buffer_input,
                     &vkGPU.physicalDeviceMemoryProperties,
@@ -1059,7 +1438,13 @@ Example_VulkanTransposition(uint32_t deviceID,
                     &inputBuffer,
                     inputBufferSize);
 	free(buffer_input);
+	buffer_input = NULL;
+	if (res != VK_SUCCESS) {
+		printf("Upload Data failed, error code: %d\n", res);
+		goto cleanup;
+	}
         printf("\nUpload Data succeeds, return code: %d\n", res);
+	time_data = get_TimeMs() - startTime;
 
 
 	//specify pointers in the app with the previously allocated buffers data
@@ -1071,7 +1456,8 @@ Example_VulkanTransposition(uint32_t deviceID,
 	app.outputBuffer            = &outputBuffer;
 	app.outputBufferDeviceMemory= &outputBufferDeviceMemory;
 
-	VkApplication app_bank_conflicts = app, app_bandwidth      = app;
+	app_bank_conflicts = app;
+	app_bandwidth      = app;
 
         VkBuffer*    buffer[2]     = {app.inputBuffer, app.outputBuffer };
         VkDeviceSize bufferSize[2] = {app.inputBufferSize, app.outputBufferSize };
@@ -1079,6 +1465,7 @@ Example_VulkanTransposition(uint32_t deviceID,
 
 
 	//create transposition app with no bank conflicts from transposition shader
+	begin_PipelineBatch(&firstBatch, vkGPU.device, 1);
         printf("\n%stransposition_no_bank_conflicts.spv\n", SHADER_DIR);
         sprintf(shaderPath, "%stransposition_no_bank_conflicts.spv", SHADER_DIR);
         res = create_App(vkGPU.device,
@@ -1095,9 +1482,32 @@ Example_VulkanTransposition(uint32_t deviceID,
                          &app.pipeline );
 	if (res != VK_SUCCESS) {
 		printf("Application creation failed, error code: %d\n", res);
-		return res;
+		goto cleanup;
+	}
+	res = build_PipelineBatch(&firstBatch);
+	if (res != VK_SUCCESS) {
+		printf("Pipeline creation failed, error code: %d\n", res);
+		goto cleanup;
 	}
 	printf("\nApplication with no bank conflicts from transposition shader creation succeeds, return code: %d\n", res);
+	time_first_pipeline = get_TimeMs() - startTime;
+
+	//first dispatch, the cold start of a worker ends here
+	uint32_t groupCount[3] = { app.size[0] / app.specializationConstants.localSize[0],
+                                   app.size[1] / app.specializationConstants.localSize[1],
+                                   app.size[2] / app.specializationConstants.localSize[2] };
+	if (startupProfile) {
+		double time_single = 0;
+		res = run_App(vkGPU.device, vkGPU.commandPool, app.pipeline, app.pipelineLayout, &app.descriptorSet, groupCount, vkGPU.queue, &vkGPU.fence, 1, &time_single);
+		if (res != VK_SUCCESS) {
+			printf("Application 0 run failed, error code: %d\n", res);
+			return res;
+		}
+		time_first_dispatch = get_TimeMs() - startTime;
+	}
+
+
+	begin_PipelineBatch(&lazyBatch, vkGPU.device, 2);
 
 
 	//create transposition app with bank conflicts from transposition shader
@@ -1117,7 +1527,7 @@ Example_VulkanTransposition(uint32_t deviceID,
                          &app_bank_conflicts.pipeline );
 	if (res != VK_SUCCESS) {
 		printf("Application creation failed, error code: %d\n", res);
-		return res;
+		goto cleanup;
 	}
 	printf("\nApplication with bank conflicts from transposition shader creation succeeds, return code: %d\n", res);
 
@@ -1139,9 +1549,14 @@ Example_VulkanTransposition(uint32_t deviceID,
                          &app_bandwidth.pipeline );
 	if (res != VK_SUCCESS) {
 		printf("Application creation failed, error code: %d\n", res);
-		return res;
+		goto cleanup;
 	}
 	printf("\nBandwidth Application with no transposition succeeds, return code: %d\n", res);
+	res = launch_PipelineBatch(&lazyBatch);
+	if (res != VK_SUCCESS) {
+		printf("Pipeline creation failed, error code: %d\n", res);
+		goto cleanup;
+	}
 
 
 	double time_no_bank_conflicts = 0;
@@ -1149,9 +1564,6 @@ Example_VulkanTransposition(uint32_t deviceID,
 	double time_bandwidth = 0;
 
 	//perform transposition with no bank conflicts on the input buffer and store it in the output 1000 times
-	uint32_t groupCount[3] = { app.size[0] / app.specializationConstants.localSize[0],
-                                   app.size[1] / app.specializationConstants.localSize[1],
-                                   app.size[2] / app.specializationConstants.localSize[2] };
 	res = run_App(vkGPU.device,
                       vkGPU.commandPool,
                       app.pipeline,
@@ -1164,14 +1576,18 @@ Example_VulkanTransposition(uint32_t deviceID,
                       &time_no_bank_conflicts);
 	if (res != VK_SUCCESS) {
 		printf("Application 0 run failed, error code: %d\n", res);
-		return res;
+		goto cleanup;
 	}
 	printf("\nRun application with no bank conflicts from transposition successfully, return code: %d\n", res);
 
-        float* buffer_output = (float*)malloc(outputBufferSize);
+        buffer_output = (float*)malloc(outputBufferSize);
+	if (buffer_output == NULL) {
+		res = VK_ERROR_OUT_OF_HOST_MEMORY;
+		goto cleanup;
+	}
 
 	//Transfer data from GPU using staging buffer, if needed
-	download_Data(vkGPU.physicalDevice,
+	res = download_Data(vkGPU.physicalDevice,
                       vkGPU.device,
                       vkGPU.commandPool,
                       &vkGPU.physicalDeviceMemoryProperties,
@@ -1180,6 +1596,10 @@ Example_VulkanTransposition(uint32_t deviceID,
                       buffer_output,
                       &outputBuffer,
                       outputBufferSize);
+	if (res != VK_SUCCESS) {
+		printf("Download Data failed, error code: %d\n", res);
+		goto cleanup;
+	}
 	//Print data, if needed.
 	/*for (uint32_t k = 0; k < app.size[2]; k++) {
 		for (uint32_t j = 0; j < app.size[1]; j++) {
@@ -1190,6 +1610,13 @@ Example_VulkanTransposition(uint32_t deviceID,
 		}
 		printf("\n");
 	}*/
+	//pipelines of the other two apps are needed from here on
+	res = wait_PipelineBatch(&lazyBatch);
+	if (res != VK_SUCCESS) {
+		printf("Pipeline creation failed, error code: %d\n", res);
+		goto cleanup;
+	}
+	time_lazy_pipelines = get_TimeMs() - startTime;
 	//perform transposition with bank conflicts on the input buffer and store it in the output 1000 times
 	uint32_t groupCount_bank_conflicts[3] = { app_bank_conflicts.size[0] / app_bank_conflicts.specializationConstants.localSize[0],
                                                   app_bank_conflicts.size[1] / app_bank_conflicts.specializationConstants.localSize[1],
@@ -1206,7 +1633,7 @@ Example_VulkanTransposition(uint32_t deviceID,
                       &time_bank_conflicts);
         if (res != VK_SUCCESS) {
 		printf("Application 1 run failed, error code: %d\n", res);
-		return res;
+		goto cleanup;
 	}
 
 	//transfer data from the input buffer to the output buffer 1000 times
@@ -1225,7 +1652,7 @@ Example_VulkanTransposition(uint32_t deviceID,
                       &time_bandwidth);
 	if (res != VK_SUCCESS) {
 		printf("Application 2 run failed, error code: %d\n", res);
-		return res;
+		goto cleanup;
 	}
 	//print results
 	printf("Transpose time with no bank conflicts: %.3f ms\nTranspose time with bank conflicts: %.3f ms\nTransfer time: %.3f ms\nCoalesced Memory: %d bytes\nSystem size: %dx%d\nBuffer size: %d KB\nBandwidth: %d GB/s\nTranfer time/total transpose time: %0.3f%%\n",
@@ -1238,48 +1665,308 @@ Example_VulkanTransposition(uint32_t deviceID,
             (int) inputBufferSize / 1024,
             (int)(2*1000*inputBufferSize / 1024.0 / 1024.0 / 1024.0 /time_bandwidth),
             time_bandwidth/ time_no_bank_conflicts *100);
+	if (startupProfile) {
+		printf("\nStartup profile (ms from the start):\n");
+		printf("  instance, device, queue and command pool: %8.3f\n", time_device);
+		printf("  buffers allocated and data uploaded:      %8.3f (+%.3f)\n", time_data, time_data - time_device);
+		printf("  first pipeline created:                   %8.3f (+%.3f: %.3f SPIR-V and shader modules, %.3f pipeline)\n",
+		       time_first_pipeline, time_first_pipeline - time_data, firstBatch.shaderTime, firstBatch.buildTime);
+		printf("  time to first dispatch:                   %8.3f (+%.3f)\n", time_first_dispatch, time_first_dispatch - time_first_pipeline);
+		printf("  lazy pipelines ready:                     %8.3f (%d pipelines, %.3f SPIR-V and shader modules, %.3f built in the background)\n",
+		       time_lazy_pipelines, 2, lazyBatch.shaderTime, lazyBatch.buildTime);
+		printf("  shaders embedded in the binary: %d, read from %s: %d\n",
+		       firstBatch.embeddedShaders + lazyBatch.embeddedShaders, SHADER_DIR, firstBatch.fileShaders + lazyBatch.fileShaders);
+	}
 
 
-	
-	//free resources
+cleanup:
+	//the lazy batch may still be building the pipelines of the apps below
+	discard_PipelineBatch(&firstBatch);
+	discard_PipelineBatch(&lazyBatch);
+	free(buffer_input);
 	free(buffer_output);
 	vkDestroyBuffer(vkGPU.device, inputBuffer, NULL);
 	vkFreeMemory(vkGPU.device, inputBufferDeviceMemory, NULL);
 	vkDestroyBuffer(vkGPU.device, outputBuffer, NULL);
 	vkFreeMemory(vkGPU.device, outputBufferDeviceMemory, NULL);
-
-	vkDestroyDescriptorPool(vkGPU.device,      app.descriptorPool,      NULL);
-	vkDestroyDescriptorSetLayout(vkGPU.device, app.descriptorSetLayout, NULL);
-	vkDestroyPipelineLayout(vkGPU.device,      app.pipelineLayout,      NULL);
-	vkDestroyPipeline(vkGPU.device,            app.pipeline,            NULL);
-
-	vkDestroyDescriptorPool(vkGPU.device,      app_bank_conflicts.descriptorPool,      NULL);
-	vkDestroyDescriptorSetLayout(vkGPU.device, app_bank_conflicts.descriptorSetLayout, NULL);
-	vkDestroyPipelineLayout(vkGPU.device,      app_bank_conflicts.pipelineLayout,      NULL);
-	vkDestroyPipeline(vkGPU.device,            app_bank_conflicts.pipeline,            NULL);
-
-	vkDestroyDescriptorPool(vkGPU.device,      app_bandwidth.descriptorPool,      NULL);
-	vkDestroyDescriptorSetLayout(vkGPU.device, app_bandwidth.descriptorSetLayout, NULL);
-	vkDestroyPipelineLayout(vkGPU.device,      app_bandwidth.pipelineLayout,      NULL);
-	vkDestroyPipeline(vkGPU.device,            app_bandwidth.pipeline,            NULL);
-
-	vkDestroyFence(vkGPU.device, vkGPU.fence, NULL);
-	vkDestroyCommandPool(vkGPU.device, vkGPU.commandPool, NULL);
-	vkDestroyDevice(vkGPU.device, NULL);
-	DestroyDebugUtilsMessengerEXT(&vkGPU, NULL);
-	vkDestroyInstance(vkGPU.instance, NULL);
+	deleteApp(&vkGPU, &app);
+	deleteApp(&vkGPU, &app_bank_conflicts);
+	deleteApp(&vkGPU, &app_bandwidth);
+	delete_VkGPU(&vkGPU);
 	return res;
 }
 
+VkResult
+create_SpecializedApp(VkGPU* vkGPU,
+                      VkApplication* app,
+                      const void* specializationConstants,
+                      uint32_t constantCount,
+                      VkBuffer* inputBuffer,
+                      VkBuffer* outputBuffer,
+                      VkDeviceSize bufferSize,
+                      const char* shaderName)
+{
+	//create an application reading from inputBuffer (binding 0) and writing to outputBuffer (binding 1). specializationConstants
+	//holds constantCount uint32_t values for constant_id 1..constantCount, the first three are the workgroup size
+	VkSpecializationMapEntry specializationMapEntries[16] = { 0 };
+	if (constantCount > 16) return VK_ERROR_INITIALIZATION_FAILED;
+	for (uint32_t kk = 0; kk < constantCount; kk++) {
+		specializationMapEntries[kk].constantID = kk + 1;
+		specializationMapEntries[kk].size = sizeof(uint32_t);
+		specializationMapEntries[kk].offset = kk * sizeof(uint32_t);
+	}
+	VkSpecializationInfo specializationInfo = { (uint32_t) constantCount,
+                                                    (const VkSpecializationMapEntry*) specializationMapEntries,
+                                                    (size_t) constantCount * sizeof(uint32_t),
+                                                    (const void*) specializationConstants };
+	VkBuffer*    buffer[2]     = { inputBuffer, outputBuffer };
+	VkDeviceSize bufferSizes[2] = { bufferSize, bufferSize };
+	char shaderPath[256];
+	sprintf(shaderPath, "%s%s", SHADER_DIR, shaderName);
+	return create_ComputeApp(vkGPU->device,
+                                 2,
+                                 buffer,
+                                 bufferSizes,
+                                 &specializationInfo,
+                                 &app->descriptorPool,
+                                 &app->descriptorSetLayout,
+                                 &app->descriptorSet,
+                                 (const char*) shaderPath,
+                                 &app->pipelineLayout,
+                                 &app->pipeline);
+}
+
+
+int
+compare_Double(const void* a, const void* b)
+{
+	double x = *(const double*) a;
+	double y = *(const double*) b;
+	return (x > y) - (x < y);
+}
+
+
+uint32_t
+select_Mode(const char** mode, const char* flag)
+{
+	//every mode flag runs a different example, so two of them on one command line are an error. Repeating one is fine
+	if (mode[0] != NULL && strcmp(mode[0], flag) != 0) {
+		printf("%s and %s select different modes, pass only one of them\n", mode[0], flag);
+		return 0;
+	}
+	mode[0] = flag;
+	return 1;
+}
+
+
+uint32_t
+check_ModeOptions(int argc, char* argv[], const char* mode)
+{
+	//options that only apply to some modes, listed between spaces. "default" is the transposition benchmark without a mode flag
+	static const char* modeOptions[][2] = {
+		{ "--threads",         " --async --budget --staging --shard " },//host threads: submitters, workers or copy threads
+		{ "--depth",           " --async " },
+		{ "--workgroups",      " --jobqueue " },
+		{ "--persistent",      " --jobqueue " },
+		{ "--value-size",      " --sparse " },
+		{ "--raster-key",      " --raster " },
+		{ "--frames",          " --stream " },
+		{ "--period",          " --stream " },
+		{ "--deadline",        " --stream " },
+		{ "--batch",           " --daemon " },
+		{ "--capture",         " --daemon " },
+		{ "--verbose",         " --daemon --dispatch " },
+		{ "--budget-limit",    " --budget " },
+		{ "--perf-trials",     " --perf-check --perf-update " },
+		{ "--perf-threshold",  " --perf-check --perf-update " },
+		{ "--startup-profile", " default " } };
+	char name[64];
+	snprintf(name, sizeof(name), " %s ", (mode != NULL) ? mode : "default");
+	for (int i = 1; i < argc; i++) {
+		for (uint32_t k = 0; k < sizeof(modeOptions) / sizeof(modeOptions[0]); k++) {
+			if (strcmp(argv[i], modeOptions[k][0]) == 0 && strstr(modeOptions[k][1], name) == NULL) {
+				printf("%s does not apply to %s, only to:%s\n", argv[i], (mode != NULL) ? mode : "the default benchmark", modeOptions[k][1]);
+				return 0;
+			}
+		}
+	}
+	return 1;
+}
+
+
 int main(int argc, char* argv[])
 {
 	uint32_t device_id = 0;      //device id used in application
 	uint32_t coalescedMemory = 0;//how much memory is coalesced
 	uint32_t size = 2048;
+	const char* socketPath = NULL;//run as a transposition daemon listening on this socket
+	const char* tracePath = NULL; //daemon: capture every request into this workload trace
+	uint32_t maxBatch = 0;       //maximal number of daemon requests in one submit, 0 - default
+	uint32_t verbose = 0;
+	uint32_t shuffleElementSize = 0;//run byte and bit shuffle benchmark for elements of this size
+	uint32_t sparseNnzPerRow = 0;   //run CSR -> CSC conversion of a sparse matrix with this average number of nonzeros per row
+	uint32_t valueSize = 4;         //bytes per value of the sparse matrix
+	uint32_t layoutBlockSize = 0;   //run layout conversion benchmark with blocks of this size
+	uint32_t aosFieldSize = 0;      //run AoS <-> SoA benchmark for fields of this size
+	uint32_t swizzleElementSize = 0;//run shared memory layout benchmark for elements of this size
+	uint32_t rasterMaxSize = 0;     //run workgroup rasterization sweep up to this system size
+	uint32_t rasterKey = 0x2545F491;//key of the XOR hash rasterization
+	uint32_t rotateWidth = 0;       //run image rotation benchmark for images of this width and --size height
+	uint32_t streamSlots = 0;       //run frame stream through a ring of this many slots
+	uint32_t streamFrames = 1000;
+	double streamPeriod = 0;        //ms between frames of the stream, 0 - as fast as possible
+	double streamDeadline = 0;      //end-to-end latency after which a frame is late, ms
+	uint32_t asyncJobs = 0;         //run asynchronous submission benchmark with this many jobs
+	uint32_t asyncThreads = 4;
+	uint32_t asyncDepth = 64;       //jobs in flight per thread
+	uint32_t dispatchRequests = 0;  //run adaptive CPU/GPU dispatcher on a mixed workload of this many requests
+	uint32_t graphChains = 0;       //run dependency graph benchmark with this many independent chains
+	uint32_t startupProfile = 0;    //report the time to first dispatch of the default example
+	uint32_t budgetJobs = 0;        //run this many jobs under the memory budget admission controller
+	uint32_t budgetLimit = 0;       //cap of the memory budget in MB, 0 - none
+	uint32_t stagingSize = 0;       //run host staging benchmark with this many MB
+	uint32_t generate = 0;          //run the synthetic data generators and validators
+	uint32_t kernels = 0;           //run the generated kernels
+	const char* perfDir = NULL;     //run the performance regression gate with the baselines in this directory
+	uint32_t perfUpdate = 0;        //write the baseline instead of checking it
+	uint32_t perfTrials = 15;
+	double perfThreshold = 5;       //allowed drop of the median throughput, percent
+	uint32_t shardDevices = 0;      //run sharded transposition over this many logical devices
+	uint32_t shardDeviceIDs[VKT_SHARD_MAX_DEVICES];
+	uint32_t shardDeviceCount = 0;  //physical devices listed by --shard-devices
+	uint32_t roofline = 0;          //measure the bandwidth roofline and the efficiency of the transpositions against it
+	uint32_t queueJobs = 0;         //run this many jobs through the job queue
+	uint32_t queueWorkgroups = 4;   //persistent workgroups of the job queue
+	uint32_t queuePersistent = 0;   //persistent kernel instead of the indirect chain, it relies on behavior Vulkan does not guarantee
+	uint32_t submatrix = 0;         //transpose a block of a larger matrix through the lda/ldb views of every kernel
+	uint32_t packed = 0;            //convert between packed triangular, packed symmetric and full matrices
+	uint32_t reduce = 0;            //transpose and reduce the rows and columns in the same pass
+	const char* mode = NULL;        //mode flag of the command line, NULL - default benchmark
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--device") == 0 && i + 1 < argc) device_id = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--coalesced") == 0 && i + 1 < argc) coalescedMemory = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) size = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--daemon") == 0 && i + 1 < argc && select_Mode(&mode, "--daemon")) socketPath = argv[++i];
+		else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc) tracePath = argv[++i];
+		else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) maxBatch = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--verbose") == 0) verbose = 1;
+		else if (strcmp(argv[i], "--shuffle") == 0 && i + 1 < argc && select_Mode(&mode, "--shuffle")) shuffleElementSize = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--sparse") == 0 && i + 1 < argc && select_Mode(&mode, "--sparse")) sparseNnzPerRow = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--value-size") == 0 && i + 1 < argc) valueSize = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--layout") == 0 && i + 1 < argc && select_Mode(&mode, "--layout")) layoutBlockSize = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--aos") == 0 && i + 1 < argc && select_Mode(&mode, "--aos")) aosFieldSize = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--swizzle") == 0 && i + 1 < argc && select_Mode(&mode, "--swizzle")) swizzleElementSize = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--raster") == 0 && i + 1 < argc && select_Mode(&mode, "--raster")) rasterMaxSize = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--rotate") == 0 && i + 1 < argc && select_Mode(&mode, "--rotate")) rotateWidth = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--stream") == 0 && i + 1 < argc && select_Mode(&mode, "--stream")) streamSlots = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) streamFrames = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--period") == 0 && i + 1 < argc) streamPeriod = atof(argv[++i]);
+		else if (strcmp(argv[i], "--deadline") == 0 && i + 1 < argc) streamDeadline = atof(argv[++i]);
+		else if (strcmp(argv[i], "--async") == 0 && i + 1 < argc && select_Mode(&mode, "--async")) asyncJobs = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) asyncThreads = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--depth") == 0 && i + 1 < argc) asyncDepth = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--dispatch") == 0 && i + 1 < argc && select_Mode(&mode, "--dispatch")) dispatchRequests = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--graph") == 0 && i + 1 < argc && select_Mode(&mode, "--graph")) graphChains = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--startup-profile") == 0) startupProfile = 1;
+		else if (strcmp(argv[i], "--budget") == 0 && i + 1 < argc && select_Mode(&mode, "--budget")) budgetJobs = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--shard") == 0 && i + 1 < argc && select_Mode(&mode, "--shard")) shardDevices = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--shard-devices") == 0 && i + 1 < argc && select_Mode(&mode, "--shard")) {
+			//comma separated physical device ids, one per logical device
+			char* id = strtok(argv[++i], ",");
+			for (shardDeviceCount = 0; id != NULL && shardDeviceCount < VKT_SHARD_MAX_DEVICES; id = strtok(NULL, ",")) shardDeviceIDs[shardDeviceCount++] = atoi(id);
+		}
+		else if (strcmp(argv[i], "--generate") == 0 && select_Mode(&mode, "--generate")) generate = 1;
+		else if (strcmp(argv[i], "--kernels") == 0 && select_Mode(&mode, "--kernels")) kernels = 1;
+		else if (strcmp(argv[i], "--roofline") == 0 && select_Mode(&mode, "--roofline")) roofline = 1;
+		else if (strcmp(argv[i], "--jobqueue") == 0 && i + 1 < argc && select_Mode(&mode, "--jobqueue")) queueJobs = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--workgroups") == 0 && i + 1 < argc) queueWorkgroups = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--persistent") == 0) queuePersistent = 1;
+		else if (strcmp(argv[i], "--submatrix") == 0 && select_Mode(&mode, "--submatrix")) submatrix = 1;
+		else if (strcmp(argv[i], "--packed") == 0 && select_Mode(&mode, "--packed")) packed = 1;
+		else if (strcmp(argv[i], "--reduce") == 0 && select_Mode(&mode, "--reduce")) reduce = 1;
+		else if (strcmp(argv[i], "--perf-check") == 0 && i + 1 < argc && select_Mode(&mode, "--perf-check")) perfDir = argv[++i];
+		else if (strcmp(argv[i], "--perf-update") == 0 && i + 1 < argc && select_Mode(&mode, "--perf-update")) {
+			perfDir = argv[++i];
+			perfUpdate = 1;
+		}
+		else if (strcmp(argv[i], "--perf-trials") == 0 && i + 1 < argc) perfTrials = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--perf-threshold") == 0 && i + 1 < argc) perfThreshold = atof(argv[++i]);
+		else if (strcmp(argv[i], "--staging") == 0 && i + 1 < argc && select_Mode(&mode, "--staging")) stagingSize = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--budget-limit") == 0 && i + 1 < argc) budgetLimit = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--raster-key") == 0 && i + 1 < argc) rasterKey = (uint32_t) strtoul(argv[++i], NULL, 0);
+		else {
+			printf("Usage: %s [--device id] [--coalesced bytes] [--size n] [--startup-profile] [--shuffle elementSize] [--sparse nnzPerRow [--value-size 4|8]] [--layout blockSize] [--aos fieldSize] [--swizzle elementSize] [--raster maxSize [--raster-key key]] [--rotate width] [--stream slots [--frames n] [--period ms] [--deadline ms]] [--async jobs [--threads n] [--depth n]] [--dispatch requests [--verbose]] [--graph chains] [--budget jobs [--threads n] [--budget-limit MB]] [--staging MB [--threads n]] [--generate] [--kernels] [--perf-check dir | --perf-update dir [--perf-trials n] [--perf-threshold %%]] [--shard devices [--shard-devices id,...] [--threads n]] [--roofline] [--jobqueue jobs [--persistent [--workgroups n]]] [--submatrix] [--packed] [--reduce] [--daemon socket [--batch n] [--verbose] [--capture trace]]\n", argv[0]);
+			printf("Pass at most one mode flag. --threads n is the number of host threads of --async, --budget, --staging and --shard\n");
+			printf("--jobqueue --persistent polls host coherent memory from a running kernel, which Vulkan does not guarantee to see host writes; a first job not done in 2 s falls back to vkQueueSubmit per job\n");
+			return 1;
+		}
+	}
+	if (!check_ModeOptions(argc, argv, mode)) return 1;
 
         list_PhysicalDevice();
 
-	VkResult res = Example_VulkanTransposition(device_id, coalescedMemory, size);
+	VkResult res = VK_SUCCESS;
+	if (socketPath != NULL) {
+#ifndef _WIN32
+		res = run_TranspositionService(device_id, coalescedMemory, socketPath, maxBatch, verbose, tracePath);
+#else
+		printf("Daemon mode is not supported on this platform\n");
+		res = VK_ERROR_FEATURE_NOT_PRESENT;
+#endif
+		return res;
+	}
+	if (shuffleElementSize != 0) return Example_VulkanShuffle(device_id, shuffleElementSize, size);
+	if (sparseNnzPerRow != 0) return Example_VulkanSparseTransposition(device_id, size, sparseNnzPerRow, valueSize);
+	if (layoutBlockSize != 0) return Example_VulkanLayoutConversion(device_id, coalescedMemory, size, layoutBlockSize);
+	if (aosFieldSize != 0) return Example_VulkanAoS(device_id, coalescedMemory, size, aosFieldSize);
+	if (swizzleElementSize != 0) return Example_VulkanSwizzle(device_id, size, swizzleElementSize);
+	if (shardDevices != 0 || shardDeviceCount != 0) {
+		if (shardDevices == 0) shardDevices = shardDeviceCount;
+		if (shardDeviceCount != 0 && shardDeviceCount != shardDevices) {
+			printf("--shard-devices lists %d devices, --shard asks for %d\n", shardDeviceCount, shardDevices);
+			return VK_ERROR_INITIALIZATION_FAILED;
+		}
+		return Example_VulkanShard(device_id, coalescedMemory, size, shardDevices, shardDeviceCount ? shardDeviceIDs : NULL, asyncThreads);
+	}
+	if (queueJobs != 0) {
+#ifndef _WIN32
+		//spinning workgroups have no forward progress guarantee either, the device may hang until the driver resets it
+		if (queuePersistent) printf("Warning: the persistent kernel relies on host writes reaching a running dispatch and on forward progress of spinning workgroups, neither of which Vulkan guarantees. It may hang the device until the driver resets it\n");
+		return Example_VulkanJobQueue(device_id, coalescedMemory, size, queueJobs, queueWorkgroups, queuePersistent);
+#else
+		printf("Job queue is not supported on this platform\n");
+		return VK_ERROR_FEATURE_NOT_PRESENT;
+#endif
+	}
+	if (submatrix) return Example_VulkanSubmatrix(device_id, coalescedMemory, size);
+	if (packed) return Example_VulkanPacked(device_id, coalescedMemory, size);
+	if (reduce) return Example_VulkanReduce(device_id, coalescedMemory, size);
+	if (roofline) return Example_VulkanRoofline(device_id, coalescedMemory, size);
+	if (perfDir != NULL) return Example_VulkanPerf(device_id, coalescedMemory, perfDir, perfUpdate, perfTrials, perfThreshold);
+	if (kernels) return Example_VulkanKernel(device_id, coalescedMemory, size);
+	if (generate) return Example_VulkanGenerate(device_id, coalescedMemory, size);
+	if (stagingSize != 0) return Example_VulkanStaging(device_id, stagingSize, asyncThreads);
+	if (budgetJobs != 0) return Example_VulkanBudget(device_id, coalescedMemory, size, budgetJobs, asyncThreads, budgetLimit);
+	if (graphChains != 0) return Example_VulkanGraph(device_id, coalescedMemory, size, graphChains);
+	if (dispatchRequests != 0) return Example_VulkanDispatch(device_id, dispatchRequests, verbose);
+	if (asyncJobs != 0) {
+#ifndef _WIN32
+		return Example_VulkanAsync(device_id, coalescedMemory, size, asyncJobs, asyncThreads, asyncDepth);
+#else
+		printf("Asynchronous submission is not supported on this platform\n");
+		return VK_ERROR_FEATURE_NOT_PRESENT;
+#endif
+	}
+	if (streamSlots != 0) return Example_VulkanStream(device_id, coalescedMemory, size, streamSlots, streamFrames, streamPeriod, streamDeadline);
+	if (rotateWidth != 0) return Example_VulkanRotation(device_id, rotateWidth, size);
+	if (rasterMaxSize != 0) return Example_VulkanRasterization(device_id, coalescedMemory, rasterMaxSize, rasterKey);
+	if (mode != NULL) {
+		//a mode flag with a zero count selects nothing, do not run the default benchmark instead
+		printf("%s needs a positive value\n", mode);
+		return 1;
+	}
+	res = Example_VulkanTransposition(device_id, coalescedMemory, size, startupProfile);
 	return res;
 }
 
@@ -0,0 +1,367 @@
+#ifndef VULKAN_TRANSPOSITION_H
+#define VULKAN_TRANSPOSITION_H
+
+//types and helpers of VulkanTransposition.c shared with the subsystems in VulkanTransposition*.c
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE//pthread_setaffinity_np and MAP_HUGETLB
+#endif
+
+#include <memory.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <float.h>
+#include <time.h> 
+#include <stdarg.h>
+#include "vulkan/vulkan.h"
+#ifdef VKT_SHADERC
+#include <shaderc/shaderc.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define VKT_SSE2
+#endif
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "VulkanTranspositionService.h"
+#ifdef __linux__
+#include <sched.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#endif
+#else
+#include <direct.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+	VkInstance instance;//a connection between the application and the Vulkan library 
+
+	VkPhysicalDevice                 physicalDevice;                //a handle for the graphics card used in the application
+	VkPhysicalDeviceProperties       physicalDeviceProperties;      //bastic device properties
+	VkPhysicalDeviceMemoryProperties physicalDeviceMemoryProperties;//bastic memory properties of the device
+	VkPhysicalDeviceSubgroupProperties physicalDeviceSubgroupProperties;//subgroup size and operations, zero if the device is Vulkan 1.0
+	VkPhysicalDeviceExternalMemoryHostPropertiesEXT physicalDeviceExternalMemoryHostProperties;//host pointer import alignment, zero without VK_EXT_external_memory_host
+	VkPhysicalDevicePCIBusInfoPropertiesEXT physicalDevicePCIBusInfo;//PCI address of the device, zero without VK_EXT_pci_bus_info
+
+	VkDevice device;//a logical device, interacting with physical device
+	VkDebugUtilsMessengerEXT debugMessenger;//extension for debugging
+	uint32_t queueFamilyIndex;//if multiple queues are available, specify the used one
+
+	VkQueue       queue;      //a place, where all operations are submitted
+	VkCommandPool commandPool;//an opaque objects that command buffer memory is allocated from
+	VkFence       fence;      //a fence used to synchronize dispatches
+
+	uint32_t device_id;//an id of a device, reported by Vulkan device list
+	uint32_t memoryBudgetSupported;//VK_EXT_memory_budget is enabled, get_MemoryBudget falls back to the heap sizes otherwise
+	uint32_t externalMemoryHostSupported;//VK_EXT_external_memory_host is enabled, host memory can be imported as staging
+	uint32_t pciBusInfoSupported;        //VK_EXT_pci_bus_info is supported, physicalDevicePCIBusInfo is valid
+} VkGPU;//an example structure containing Vulkan primitives
+
+typedef struct {
+	uint32_t localSize[3];
+	uint32_t inputStride[3];
+	uint32_t rasterMode;   //order in which workgroups visit the tiles, VKT_RASTER_*
+	uint32_t supertileSize;//tiles per side of a supertile in VKT_RASTER_MORTON mode, power of two
+	uint32_t outputStride[3];//output strides, outputStride[1] is the leading dimension (ldb). 0 - same as inputStride
+} VkAppSpecializationConstantsLayout;//an example structure on how to set constants in the shader after first compilation but before final shader module creation
+
+typedef struct {
+	uint32_t pushID;//an example structure on how to pass small amount of data to the shader right before dispatch
+	uint32_t inputOffset; //first element of the input sub-matrix, in elements
+	uint32_t outputOffset;//first element of the output sub-matrix
+} VkAppPushConstantsLayout;
+
+typedef struct {
+	//system size for transposition
+	uint32_t size[3];
+	//how much memory is coalesced (in bytes) - 32 for Nvidia, 64 for Intel, 64 for AMD. Maximum value: 128
+	uint32_t coalescedMemory;
+	VkAppSpecializationConstantsLayout specializationConstants;
+	VkAppPushConstantsLayout pushConstants;
+	//bridging information, that allows shaders to freely access resources like buffers and images
+	VkDescriptorPool descriptorPool;
+	VkDescriptorSetLayout descriptorSetLayout;
+	VkDescriptorSet descriptorSet;
+	//pipeline used for graphics applications, we only use compute part of it in this example
+	VkPipelineLayout pipelineLayout;
+	VkPipeline pipeline;
+	//input buffer
+	VkDeviceSize inputBufferSize;//the size of buffer (in bytes)
+	VkBuffer* inputBuffer;//pointer to the buffer object
+	VkDeviceMemory* inputBufferDeviceMemory;//pointer to the memory object, corresponding to the buffer
+
+	//output buffer
+	VkDeviceSize outputBufferSize;
+	VkBuffer* outputBuffer;
+	VkDeviceMemory* outputBufferDeviceMemory;
+} VkApplication;//application specific data
+
+typedef struct {
+	uint32_t localSize[3];
+	uint32_t size;        //square matrix of size x size elements
+	uint32_t tile;
+	uint32_t elementWords;//element width in 32-bit words
+	uint32_t mode;        //0 - conflicted, 1 - padded, 2 - XOR swizzled
+	uint32_t swizzleMask;
+	uint32_t inputLd;     //elements between the input rows, 0 - size
+	uint32_t outputLd;    //elements between the output rows, 0 - size
+} VkSwizzleSpecializationConstantsLayout;//specialization constants of transposition_swizzle.comp
+
+//number of 4-byte shared memory banks. Vulkan does not report it, 32 holds for current NVIDIA, AMD and Intel GPUs
+#define VKT_SHARED_MEMORY_BANKS 32
+
+//Helpers of VulkanTransposition.c shared with the subsystems
+double get_TimeMs(void);
+VkResult create_VkGPU(VkGPU* vkGPU);
+void delete_VkGPU(VkGPU* vkGPU);
+uint32_t get_CoalescedMemory(VkGPU* vkGPU, uint32_t coalescedMemory);
+VkResult find_MemoryType(VkPhysicalDevice physicalDevice, uint32_t memoryTypeBits, VkMemoryPropertyFlags memoryPropertyFlags, uint32_t* memoryTypeIndex);
+VkResult allocate_Buffer_DeviceMemory(VkPhysicalDevice physicalDevice, VkDevice logicalDevice, VkBufferUsageFlags bufferUsageFlags, VkPhysicalDeviceMemoryProperties* physicalDeviceMemoryProperties,
+                                      VkMemoryPropertyFlags memoryPropertyFlags, VkDeviceSize size, VkBuffer* buffer, VkDeviceMemory* deviceMemory);
+VkResult upload_Data(VkPhysicalDevice physicalDevice, VkDevice logicalDevice, void* data, VkPhysicalDeviceMemoryProperties* physicalDeviceMemoryProperties,
+                     VkCommandPool commandPool, VkQueue queue, VkFence* fence, VkBuffer* computeBuffer, VkDeviceSize bufferSize);
+VkResult download_Data(VkPhysicalDevice physicalDevice, VkDevice device, VkCommandPool commandPool, VkPhysicalDeviceMemoryProperties* physicalDeviceMemoryProperties,
+                       VkQueue queue, VkFence* fence, void* data, VkBuffer* buffer, VkDeviceSize bufferSize);
+VkResult create_ComputeApp(VkDevice device, uint32_t bufferCount, VkBuffer** buffer, VkDeviceSize* bufferSize, const VkSpecializationInfo* specializationInfo,
+                           VkDescriptorPool* descriptorPool, VkDescriptorSetLayout* descriptorSetLayout, VkDescriptorSet* descriptorSet, const char* shaderFilename,
+                           VkPipelineLayout* pipelineLayout, VkPipeline* pipeline);
+VkResult create_App(VkDevice device, void* appSpecializationConstantsLayout, uint32_t coalescedMemory, VkBuffer** buffer, VkDeviceSize* bufferSize, uint32_t* size,
+                    VkDescriptorPool* descriptorPool, VkDescriptorSetLayout* descriptorSetLayout, VkDescriptorSet* descriptorSet, const char* shaderFilename,
+                    VkPipelineLayout* pipelineLayout, VkPipeline* pipeline);
+VkResult create_SubmatrixApp(VkDevice device, VkAppSpecializationConstantsLayout* constants, uint32_t coalescedMemory, VkBuffer** buffer, VkDeviceSize* bufferSize,
+                             uint32_t* size, uint32_t lda, uint32_t ldb, VkDescriptorPool* descriptorPool, VkDescriptorSetLayout* descriptorSetLayout,
+                             VkDescriptorSet* descriptorSet, const char* shaderFilename, VkPipelineLayout* pipelineLayout, VkPipeline* pipeline);
+VkResult create_SpecializedApp(VkGPU* vkGPU, VkApplication* app, const void* specializationConstants, uint32_t constantCount, VkBuffer* inputBuffer, VkBuffer* outputBuffer,
+                               VkDeviceSize bufferSize, const char* shaderName);
+VkResult run_AppPushConstants(VkDevice device, VkCommandPool commandPool, VkPipeline pipeline, VkPipelineLayout pipelineLayout, VkDescriptorSet* descriptorSet, uint32_t* groupCount,
+                              VkQueue queue, VkFence* fence, uint32_t batch, const VkAppPushConstantsLayout* pushConstants, double* time);
+VkResult run_App(VkDevice device, VkCommandPool commandPool, VkPipeline pipeline, VkPipelineLayout pipelineLayout, VkDescriptorSet* descriptorSet, uint32_t* groupCount,
+                 VkQueue queue, VkFence* fence, uint32_t batch, double* time);
+void deleteApp(VkGPU* vkGPU, VkApplication* app);
+int compare_Double(const void* a, const void* b);
+
+//Byte and bit shuffle, VulkanTranspositionShuffle.c
+VkResult Example_VulkanShuffle(uint32_t deviceID, uint32_t elementSize, uint32_t size);
+
+//Sparse transposition, VulkanTranspositionSparse.c
+void append_SparseBarrier(VkCommandBuffer commandBuffer);
+VkResult Example_VulkanSparseTransposition(uint32_t deviceID, uint32_t size, uint32_t nnzPerRow, uint32_t valueSize);
+
+//Layout conversion, VulkanTranspositionLayout.c
+VkResult Example_VulkanLayoutConversion(uint32_t deviceID, uint32_t coalescedMemory, uint32_t size, uint32_t blockSize);
+
+//AoS <-> SoA deinterleaving, VulkanTranspositionAoS.c
+VkResult Example_VulkanAoS(uint32_t deviceID, uint32_t coalescedMemory, uint32_t size, uint32_t fieldSize);
+
+//XOR-swizzled shared memory, VulkanTranspositionSwizzle.c
+uint32_t get_SwizzleMask(uint32_t tile, uint32_t elementWords);
+VkResult Example_VulkanSwizzle(uint32_t deviceID, uint32_t size, uint32_t elementSize);
+
+//Workgroup rasterization, VulkanTranspositionRaster.c
+VkResult Example_VulkanRasterization(uint32_t deviceID, uint32_t coalescedMemory, uint32_t maxSize, uint32_t key);
+
+//Image rotation, VulkanTranspositionRotation.c
+VkResult Example_VulkanRotation(uint32_t deviceID, uint32_t width, uint32_t height);
+
+//Frame stream, VulkanTranspositionStream.c
+VkResult Example_VulkanStream(uint32_t deviceID, uint32_t coalescedMemory, uint32_t size, uint32_t slotCount, uint32_t frames, double period, double deadline);
+
+//Dependency graph executor, VulkanTranspositionGraph.c
+#define VKT_GRAPH_MAX_OPS    256
+#define VKT_GRAPH_MAX_RANGES 4
+
+#define VKT_GRAPH_OP_DISPATCH 0
+#define VKT_GRAPH_OP_COPY     1
+
+typedef struct {
+	VkBuffer buffer;
+	VkDeviceSize offset;
+	VkDeviceSize size;//VK_WHOLE_SIZE - up to the end of the buffer
+} VkBufferRange;
+
+typedef struct {
+	uint32_t type;//VKT_GRAPH_OP_*
+	//dispatch
+	VkApplication* app;
+	uint32_t groupCount[3];
+	//copy
+	VkBuffer srcBuffer;
+	VkBuffer dstBuffer;
+	VkBufferCopy region;
+	VkBufferRange reads[VKT_GRAPH_MAX_RANGES];
+	uint32_t readCount;
+	VkBufferRange writes[VKT_GRAPH_MAX_RANGES];
+	uint32_t writeCount;
+	uint32_t level;//set by record_Graph
+} VkGraphOp;
+
+typedef struct {
+	VkGraphOp op[VKT_GRAPH_MAX_OPS];
+	uint32_t count;
+	//statistics of the last recording
+	uint32_t levels;
+	uint32_t barriers;
+} VkGraph;
+
+int32_t add_GraphDispatch(VkGraph* graph, VkApplication* app, const uint32_t* groupCount, const VkBufferRange* reads, uint32_t readCount, const VkBufferRange* writes, uint32_t writeCount);
+int32_t add_GraphCopy(VkGraph* graph, VkBuffer srcBuffer, VkDeviceSize srcOffset, VkBuffer dstBuffer, VkDeviceSize dstOffset, VkDeviceSize size);
+void record_Graph(VkGraph* graph, VkCommandBuffer commandBuffer);
+void record_GraphSerial(VkGraph* graph, VkCommandBuffer commandBuffer);
+VkResult run_Graph(VkGPU* vkGPU, VkGraph* graph, uint32_t serial, uint32_t batch, double* time);
+VkResult Example_VulkanGraph(uint32_t deviceID, uint32_t coalescedMemory, uint32_t size, uint32_t chains);
+
+//Adaptive CPU/GPU dispatcher, VulkanTranspositionDispatch.c
+VkResult Example_VulkanDispatch(uint32_t deviceID, uint32_t requests, uint32_t verbose);
+
+//Memory budget admission control, VulkanTranspositionBudget.c
+VkResult Example_VulkanBudget(uint32_t deviceID, uint32_t coalescedMemory, uint32_t size, uint32_t jobs, uint32_t threads, uint32_t limitMB);
+
+//Host staging and the host copy pool, VulkanTranspositionStaging.c
+#define VKT_COPY_POOL_MAX_THREADS 64
+
+typedef void (*VkCopyPoolTask)(void* arg, uint32_t worker, uint32_t workers);
+
+typedef struct {
+	void* pool;
+	uint32_t index;
+} VkCopyPoolWorker;
+
+typedef struct {
+	uint32_t threads;
+	int32_t numaNode;    //node the workers are pinned to, -1 - not pinned
+	uint32_t pinned;     //workers whose affinity was set
+	VkCopyPoolTask task; //task of the current run, called by every worker with its index
+	void* arg;
+	uint64_t generation; //incremented for every run
+	uint32_t pending;    //workers still running the task
+	uint32_t stop;
+#ifndef _WIN32
+	pthread_mutex_t mutex;
+	pthread_cond_t start;
+	pthread_cond_t done;
+	pthread_t thread[VKT_COPY_POOL_MAX_THREADS];
+#endif
+	VkCopyPoolWorker worker[VKT_COPY_POOL_MAX_THREADS];
+	uint32_t started;
+} VkCopyPool;
+
+typedef struct {
+	void* data;          //host memory of the staging, the device accesses it directly if imported
+	VkDeviceSize size;
+	uint32_t hugepages;  //as reported by allocate_HostMemory
+	int32_t numaNode;    //node the memory was placed on, -1 - unknown
+	uint32_t imported;   //1 - host memory imported with VK_EXT_external_memory_host, 0 - mapped device memory
+	VkBuffer buffer;     //transfer source and destination
+	VkDeviceMemory memory;
+} VkHostStaging;
+
+int32_t get_DeviceNumaNode(VkGPU* vkGPU);
+void copy_NonTemporal(void* dst, const void* src, size_t size);
+VkResult create_CopyPool(VkCopyPool* pool, uint32_t threads, int32_t numaNode);
+void run_CopyPool(VkCopyPool* pool, VkCopyPoolTask task, void* arg);
+void delete_CopyPool(VkCopyPool* pool);
+VkResult import_HostStaging(VkGPU* vkGPU, VkHostStaging* staging);
+VkResult create_HostStaging(VkGPU* vkGPU, VkDeviceSize size, VkHostStaging* staging);
+void delete_HostStaging(VkGPU* vkGPU, VkHostStaging* staging);
+VkResult Example_VulkanStaging(uint32_t deviceID, uint32_t sizeMB, uint32_t threads);
+
+//Synthetic data generators, VulkanTranspositionGenerator.c
+#define VKT_DTYPE_UINT  0
+#define VKT_DTYPE_FLOAT 1
+
+#define VKT_PATTERN_INDEX      0
+#define VKT_PATTERN_RANDOM     1
+#define VKT_PATTERN_STRUCTURED 2
+
+VkResult generate_Data(VkGPU* vkGPU, VkBuffer* buffer, VkDeviceSize bufferSize, uint32_t elementSize, uint32_t dtype, uint32_t pattern,
+                       uint32_t width, uint32_t height, uint32_t seed, double* time);
+VkResult validate_Data(VkGPU* vkGPU, VkBuffer* buffer, VkDeviceSize bufferSize, uint32_t elementSize, uint32_t dtype, uint32_t pattern,
+                       uint32_t width, uint32_t height, uint32_t transposed, uint32_t seed, uint32_t* mismatches, uint32_t* firstMismatch, double* time);
+VkResult Example_VulkanGenerate(uint32_t deviceID, uint32_t coalescedMemory, uint32_t size);
+
+//Sharded transposition over several logical devices, VulkanTranspositionShard.c
+#define VKT_SHARD_MAX_DEVICES 16
+
+VkResult Example_VulkanShard(uint32_t deviceID, uint32_t coalescedMemory, uint32_t size, uint32_t devices, const uint32_t* deviceIDs, uint32_t threads);
+
+//Runtime kernel generator, VulkanTranspositionKernel.c
+#define VKT_KERNEL_MAX_RANK      4
+
+#define VKT_EPILOGUE_NONE  0
+#define VKT_EPILOGUE_SCALE 1//out = alpha * in, 4-byte types only
+
+typedef struct {
+	uint32_t rank;                      //1..VKT_KERNEL_MAX_RANK
+	uint32_t size[VKT_KERNEL_MAX_RANK]; //input dimensions, size[0] is the fastest
+	uint32_t perm[VKT_KERNEL_MAX_RANK]; //output dimension k is input dimension perm[k]
+	uint32_t elementSize;               //4 or 8 bytes
+	uint32_t dtype;                     //VKT_DTYPE_*
+	uint32_t tile;                      //tile side of the shared memory transposition, power of two
+	uint32_t rows;                      //threads per tile column, each thread moves tile / rows elements
+	uint32_t epilogue;                  //VKT_EPILOGUE_*
+	float alpha;                        //factor of VKT_EPILOGUE_SCALE, integer types use its integer part
+	uint32_t inputStride[VKT_KERNEL_MAX_RANK]; //elements between the input indices of every dimension, 0 - packed. Dimension 0 is contiguous
+	uint32_t outputStride[VKT_KERNEL_MAX_RANK];//the same for the output dimensions. Offsets are push constants of the dispatch
+} VkKernelConfig;//operation of a generated kernel
+
+VkResult create_KernelApp(VkGPU* vkGPU, VkKernelConfig* config, VkBuffer* input, VkBuffer* output, VkDeviceSize bufferSize,
+                          VkApplication* app, uint32_t groupCount[3], uint32_t* cacheHit, double* time);
+VkResult Example_VulkanKernel(uint32_t deviceID, uint32_t coalescedMemory, uint32_t size);
+
+//Performance regression gate, VulkanTranspositionPerf.c
+#define VKT_PERF_MAX_TRIALS  64
+
+typedef struct {
+	char kernel[32];
+	char dtype[16];
+	uint32_t size;
+	uint32_t trials;
+	double sample[VKT_PERF_MAX_TRIALS];//GB/s of every trial
+} VkPerfEntry;
+
+int compare_PerfSample(const void* a, const void* b);
+VkResult run_PerfEntry(VkGPU* vkGPU, uint32_t coalescedMemory, VkPerfEntry* entry, uint32_t trials, uint32_t batch);
+VkResult Example_VulkanPerf(uint32_t deviceID, uint32_t coalescedMemory, const char* baselineDir, uint32_t update, uint32_t trials, double threshold);
+
+//Bandwidth roofline, VulkanTranspositionRoofline.c
+VkResult Example_VulkanRoofline(uint32_t deviceID, uint32_t coalescedMemory, uint32_t size);
+
+//Sub-matrix views, VulkanTranspositionSubmatrix.c
+VkResult Example_VulkanSubmatrix(uint32_t deviceID, uint32_t coalescedMemory, uint32_t size);
+
+//Packed triangular and symmetric matrices, VulkanTranspositionPacked.c
+VkResult Example_VulkanPacked(uint32_t deviceID, uint32_t coalescedMemory, uint32_t size);
+
+//Fused transposition with reduction, VulkanTranspositionReduce.c
+VkResult Example_VulkanReduce(uint32_t deviceID, uint32_t coalescedMemory, uint32_t size);
+
+#ifndef _WIN32
+//Job queue, vkCmdDispatchIndirect chain or persistent kernel, VulkanTranspositionJobQueue.c
+VkResult Example_VulkanJobQueue(uint32_t deviceID, uint32_t coalescedMemory, uint32_t size, uint32_t jobs, uint32_t workgroups, uint32_t persistent);
+
+//Asynchronous submission, VulkanTranspositionAsync.c
+VkResult Example_VulkanAsync(uint32_t deviceID, uint32_t coalescedMemory, uint32_t size, uint32_t jobs, uint32_t threads, uint32_t depth);
+
+//Transposition daemon, VulkanTranspositionService.c
+VkResult run_TranspositionService(uint32_t deviceID, uint32_t coalescedMemory, const char* socketPath, uint32_t maxBatch, uint32_t verbose, const char* tracePath);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
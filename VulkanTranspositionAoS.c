@@ -0,0 +1,185 @@
+#include "VulkanTransposition.h"
+
+
+//AoS <-> SoA deinterleaving (aos_soa.comp): records of 2..16 fields are split into one array per field and back
+typedef struct {
+	uint32_t localSize[3];
+	uint32_t fields;      //fields per record, 2..16
+	uint32_t fieldSize;   //bytes per field: 1, 2, 4 or 8
+	uint32_t numRecords;
+	uint32_t inverse;     //0 - AoS -> SoA, 1 - SoA -> AoS
+	uint32_t groupRecords;//records staged in shared memory by one workgroup
+} VkAosSpecializationConstantsLayout;//specialization constants of aos_soa.comp
+
+
+void
+convert_AoS_CPU(const uint8_t* input,
+                uint8_t* output,
+                uint64_t numRecords,
+                uint32_t fields,
+                uint32_t fieldSize,
+                uint32_t inverse)
+{
+	//reference deinterleaving: field j of record i goes to position j*numRecords+i of the planar data, inverse goes back
+	for (uint64_t i = 0; i < numRecords; i++) {
+		for (uint32_t j = 0; j < fields; j++) {
+			uint64_t record = (i * fields + j) * fieldSize;
+			uint64_t plane = (j * numRecords + i) * fieldSize;
+			if (inverse == 0) memcpy(output + plane, input + record, fieldSize);
+			else memcpy(output + record, input + plane, fieldSize);
+		}
+	}
+}
+
+
+VkResult
+Example_VulkanAoS(uint32_t deviceID,
+                  uint32_t coalescedMemory,
+                  uint32_t size,
+                  uint32_t fieldSize)
+{
+	//AoS <-> SoA conversion of 4*size*size bytes for 2..16 fields of fieldSize bytes, compared with the general
+	//square transposition of the same amount of data (transposition_no_bank_conflicts.comp on size x size floats)
+	VkGPU vkGPU = { 0 };
+	vkGPU.device_id = deviceID;
+	VkResult res = VK_SUCCESS;
+	if (fieldSize != 1 && fieldSize != 2 && fieldSize != 4 && fieldSize != 8) {
+		printf("Unsupported field size %d, use 1, 2, 4 or 8 bytes\n", fieldSize);
+		return VK_ERROR_FORMAT_NOT_SUPPORTED;
+	}
+	res = create_VkGPU(&vkGPU);
+	if (res != VK_SUCCESS) return res;
+	coalescedMemory = get_CoalescedMemory(&vkGPU, coalescedMemory);
+	uint32_t tile = coalescedMemory / sizeof(float);
+	if (size % tile != 0) {
+		printf("System size %d is not a multiple of the tile size %d\n", size, tile);
+		delete_VkGPU(&vkGPU);
+		return VK_ERROR_FORMAT_NOT_SUPPORTED;
+	}
+
+	VkDeviceSize bufferSize = sizeof(float) * (VkDeviceSize) size * size;
+	VkBuffer inputBuffer = { 0 }, outputBuffer = { 0 };
+	VkDeviceMemory inputBufferDeviceMemory = { 0 }, outputBufferDeviceMemory = { 0 };
+	uint8_t* buffer_input  = NULL;
+	uint8_t* buffer_output = NULL;
+	uint8_t* buffer_ref    = NULL;
+	uint32_t failed = 0;
+	res = allocate_Buffer_DeviceMemory(vkGPU.physicalDevice, vkGPU.device,
+                                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                           &vkGPU.physicalDeviceMemoryProperties, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                           bufferSize, &inputBuffer, &inputBufferDeviceMemory);
+	if (res != VK_SUCCESS) {
+		printf("Input buffer allocation failed, error code: %d\n", res);
+		goto cleanup;
+	}
+	res = allocate_Buffer_DeviceMemory(vkGPU.physicalDevice, vkGPU.device,
+                                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                           &vkGPU.physicalDeviceMemoryProperties, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                           bufferSize, &outputBuffer, &outputBufferDeviceMemory);
+	if (res != VK_SUCCESS) {
+		printf("Output buffer allocation failed, error code: %d\n", res);
+		goto cleanup;
+	}
+	buffer_input  = (uint8_t*) malloc(bufferSize);
+	buffer_output = (uint8_t*) malloc(bufferSize);
+	buffer_ref    = (uint8_t*) malloc(bufferSize);
+	if (buffer_input == NULL || buffer_output == NULL || buffer_ref == NULL) {
+		res = VK_ERROR_OUT_OF_HOST_MEMORY;
+		goto cleanup;
+	}
+	for (VkDeviceSize i = 0; i < bufferSize; i++) buffer_input[i] = (uint8_t) (i * 7 + i / 251);
+	res = upload_Data(vkGPU.physicalDevice, vkGPU.device, buffer_input, &vkGPU.physicalDeviceMemoryProperties,
+                          vkGPU.commandPool, vkGPU.queue, &vkGPU.fence, &inputBuffer, bufferSize);
+	if (res != VK_SUCCESS) goto cleanup;
+
+	//baseline: general transposition of the same number of bytes
+	VkApplication app_transposition = { 0 };
+	VkBuffer*    buffer[2]      = { &inputBuffer, &outputBuffer };
+	VkDeviceSize bufferSizes[2] = { bufferSize, bufferSize };
+	uint32_t systemSize[3] = { size, size, 1 };
+	char shaderPath[256];
+	sprintf(shaderPath, "%stransposition_no_bank_conflicts.spv", SHADER_DIR);
+	res = create_App(vkGPU.device, &app_transposition.specializationConstants, coalescedMemory, buffer, bufferSizes, systemSize,
+	                 &app_transposition.descriptorPool, &app_transposition.descriptorSetLayout, &app_transposition.descriptorSet,
+	                 (const char*) shaderPath, &app_transposition.pipelineLayout, &app_transposition.pipeline);
+	if (res != VK_SUCCESS) {
+		printf("Transposition application creation failed, error code: %d\n", res);
+		goto cleanup;
+	}
+	double time_transposition = 0;
+	uint32_t groupCount_transposition[3] = { size / tile, size / tile, 1 };
+	res = run_App(vkGPU.device, vkGPU.commandPool, app_transposition.pipeline, app_transposition.pipelineLayout, &app_transposition.descriptorSet,
+	              groupCount_transposition, vkGPU.queue, &vkGPU.fence, 100, &time_transposition);
+	deleteApp(&vkGPU, &app_transposition);
+	if (res != VK_SUCCESS) {
+		printf("Transposition application run failed, error code: %d\n", res);
+		goto cleanup;
+	}
+	printf("Buffer size: %d KB\nField size: %d bytes\nGeneral transposition %dx%d: %.3f ms (%.1f GB/s)\n",
+	       (int) (bufferSize / 1024), fieldSize, size, size, time_transposition, 2 * bufferSize / 1024.0 / 1024.0 / 1024.0 / (time_transposition / 1000));
+
+	uint32_t localSize = 256;
+	if (localSize > vkGPU.physicalDeviceProperties.limits.maxComputeWorkGroupInvocations) localSize = vkGPU.physicalDeviceProperties.limits.maxComputeWorkGroupInvocations;
+	for (uint32_t fields = 2; fields <= 16; fields++) {
+		uint32_t recordSize = fields * fieldSize;
+		uint64_t numRecords = bufferSize / recordSize / 4 * 4;
+		VkDeviceSize dataSize = numRecords * recordSize;
+		//every thread moves about 4 words, shared memory holds the records with one padding word per 32 words
+		uint32_t groupRecords = 16 * localSize / recordSize / 4 * 4;
+		if (groupRecords < 4) groupRecords = 4;
+		while (groupRecords > 4 && (groupRecords * recordSize / 4 + groupRecords * recordSize / 128 + 1) * 4 > vkGPU.physicalDeviceProperties.limits.maxComputeSharedMemorySize) groupRecords -= 4;
+		uint32_t groupCount[3] = { (uint32_t) ((numRecords + groupRecords - 1) / groupRecords), 1, 1 };
+		if (numRecords > 0xFFFFFFFF || groupCount[0] > vkGPU.physicalDeviceProperties.limits.maxComputeWorkGroupCount[0]) {
+			printf("%2d fields: skipped, too many records\n", fields);
+			continue;
+		}
+
+		double time[2] = { 0 };
+		uint32_t passed[2] = { 0 };
+		for (uint32_t inverse = 0; inverse < 2; inverse++) {
+			//SoA -> AoS reads the planar result of AoS -> SoA and writes the records back
+			VkApplication app = { 0 };
+			VkAosSpecializationConstantsLayout specializationConstants = { { localSize, 1, 1 }, fields, fieldSize, (uint32_t) numRecords, inverse, groupRecords };
+			res = create_SpecializedApp(&vkGPU, &app, &specializationConstants, 8,
+			                            inverse ? &outputBuffer : &inputBuffer, inverse ? &inputBuffer : &outputBuffer, bufferSize, "aos_soa.spv");
+			if (res != VK_SUCCESS) {
+				printf("AoS application creation failed, error code: %d\n", res);
+				break;
+			}
+			res = run_App(vkGPU.device, vkGPU.commandPool, app.pipeline, app.pipelineLayout, &app.descriptorSet,
+			              groupCount, vkGPU.queue, &vkGPU.fence, 100, &time[inverse]);
+			deleteApp(&vkGPU, &app);
+			if (res != VK_SUCCESS) {
+				printf("AoS application run failed, error code: %d\n", res);
+				break;
+			}
+			res = download_Data(vkGPU.physicalDevice, vkGPU.device, vkGPU.commandPool, &vkGPU.physicalDeviceMemoryProperties,
+			                    vkGPU.queue, &vkGPU.fence, buffer_output, inverse ? &inputBuffer : &outputBuffer, bufferSize);
+			if (res != VK_SUCCESS) break;
+			if (inverse == 0) {
+				convert_AoS_CPU(buffer_input, buffer_ref, numRecords, fields, fieldSize, 0);
+				passed[0] = (memcmp(buffer_output, buffer_ref, dataSize) == 0);
+			}
+			else passed[1] = (memcmp(buffer_output, buffer_input, dataSize) == 0);
+		}
+		if (res != VK_SUCCESS) break;
+		printf("%2d fields: AoS -> SoA %.3f ms (%.1f GB/s), SoA -> AoS %.3f ms (%.1f GB/s), %.2fx of general transposition, verification %s\n",
+		       fields, time[0], 2 * dataSize / 1024.0 / 1024.0 / 1024.0 / (time[0] / 1000),
+		       time[1], 2 * dataSize / 1024.0 / 1024.0 / 1024.0 / (time[1] / 1000),
+		       (dataSize / time[0]) / (bufferSize / time_transposition),
+		       (passed[0] && passed[1]) ? "passed" : "FAILED");
+		if (!passed[0] || !passed[1]) failed = 1;
+	}
+	if (res == VK_SUCCESS && failed) res = VK_ERROR_FORMAT_NOT_SUPPORTED;
+
+cleanup:
+	free(buffer_input);
+	free(buffer_output);
+	free(buffer_ref);
+	vkDestroyBuffer(vkGPU.device, inputBuffer, NULL);
+	vkFreeMemory(vkGPU.device, inputBufferDeviceMemory, NULL);
+	vkDestroyBuffer(vkGPU.device, outputBuffer, NULL);
+	vkFreeMemory(vkGPU.device, outputBufferDeviceMemory, NULL);
+	delete_VkGPU(&vkGPU);
+	return res;
+}
@@ -0,0 +1,517 @@
+#include "VulkanTransposition.h"
+
+
+#ifndef _WIN32
+//Asynchronous submission: submit_Async* records the work into a command buffer, submits it with a fence from the pool of the
+//executor and returns at once. One reaper thread waits for the fences in submission order, completes the futures, calls
+//their callbacks and signals notifyFd, so event loops can poll one descriptor instead of parking a thread per operation
+typedef struct VkTranspositionFuture VkTranspositionFuture;
+typedef void (*VkTranspositionCallback)(VkTranspositionFuture* future, void* userData);
+
+struct VkTranspositionFuture {
+	uint32_t done;     //set by the reaper thread under the mutex of the executor
+	VkResult result;
+	double submitTime; //ms
+	double completeTime;
+	VkTranspositionCallback callback;//called by the reaper thread before the future is marked done, may be NULL
+	void* userData;
+	//owned by the executor while the future is in flight
+	VkCommandBuffer commandBuffer;
+	VkFence fence;
+	VkTranspositionFuture* next;
+};
+
+#define VKT_ASYNC_MAX_IN_FLIGHT 4096
+
+typedef struct {
+	VkGPU* vkGPU;
+	VkCommandPool commandPool;//pool of the job command buffers, guarded by mutex together with the queue
+	pthread_mutex_t mutex;
+	pthread_cond_t submitted; //signalled when the reaper has work
+	pthread_cond_t completed; //broadcast on every completion
+	pthread_t reaper;
+	uint32_t reaperStarted;
+	VkFence freeFences[VKT_ASYNC_MAX_IN_FLIGHT];
+	uint32_t freeFenceCount;
+	uint32_t fenceCount;      //fences created so far
+	VkTranspositionFuture* head;//in flight, in submission order
+	VkTranspositionFuture* tail;
+	uint32_t inFlight;
+	uint32_t maxInFlight;
+	uint64_t completedCount;
+	uint32_t stop;
+	int notifyFd[2];          //read and write end. Linux uses one eventfd for both, other systems a non-blocking pipe
+} VkAsyncExecutor;
+
+
+void*
+run_AsyncReaper(void* arg)
+{
+	VkAsyncExecutor* executor = (VkAsyncExecutor*) arg;
+	VkDevice device = executor->vkGPU->device;
+	pthread_mutex_lock(&executor->mutex);
+	while (1) {
+		while (executor->head == NULL && !executor->stop) pthread_cond_wait(&executor->submitted, &executor->mutex);
+		if (executor->head == NULL) break;
+		VkTranspositionFuture* future = executor->head;
+		//submitters only append to the list, so the head stays valid without the lock
+		pthread_mutex_unlock(&executor->mutex);
+		VkResult res = vkWaitForFences(device, 1, &future->fence, VK_TRUE, 100000000000);
+		future->result = res;
+		future->completeTime = get_TimeMs();
+		if (future->callback != NULL) future->callback(future, future->userData);
+
+		pthread_mutex_lock(&executor->mutex);
+		executor->head = future->next;
+		if (executor->head == NULL) executor->tail = NULL;
+		executor->inFlight--;
+		if (res == VK_SUCCESS && vkResetFences(device, 1, &future->fence) == VK_SUCCESS)
+			executor->freeFences[executor->freeFenceCount++] = future->fence;
+		else
+			vkDestroyFence(device, future->fence, NULL);
+		vkFreeCommandBuffers(device, executor->commandPool, 1, &future->commandBuffer);
+		future->done = 1;
+		executor->completedCount++;
+		pthread_cond_broadcast(&executor->completed);
+		uint64_t one = 1;
+		if (write(executor->notifyFd[1], &one, sizeof(one)) < 0 && errno != EAGAIN) perror("write");
+	}
+	pthread_mutex_unlock(&executor->mutex);
+	return NULL;
+}
+
+
+VkResult
+create_AsyncExecutor(VkGPU* vkGPU, VkAsyncExecutor* executor)
+{
+	memset(executor, 0, sizeof(VkAsyncExecutor));
+	executor->vkGPU = vkGPU;
+	executor->notifyFd[0] = executor->notifyFd[1] = -1;
+	pthread_mutex_init(&executor->mutex, NULL);
+	pthread_cond_init(&executor->submitted, NULL);
+	pthread_cond_init(&executor->completed, NULL);
+	VkCommandPoolCreateInfo commandPoolCreateInfo = { VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+                                          (const void*) NULL,
+                                          (VkCommandPoolCreateFlags) VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+                                          (uint32_t) vkGPU->queueFamilyIndex };
+	VkResult res = vkCreateCommandPool(vkGPU->device, &commandPoolCreateInfo, NULL, &executor->commandPool);
+	if (res != VK_SUCCESS) return res;
+#ifdef __linux__
+	executor->notifyFd[0] = executor->notifyFd[1] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (executor->notifyFd[0] < 0) return VK_ERROR_INITIALIZATION_FAILED;
+#else
+	if (pipe(executor->notifyFd) != 0) return VK_ERROR_INITIALIZATION_FAILED;
+	fcntl(executor->notifyFd[0], F_SETFL, O_NONBLOCK);
+	fcntl(executor->notifyFd[1], F_SETFL, O_NONBLOCK);
+#endif
+	if (pthread_create(&executor->reaper, NULL, run_AsyncReaper, executor) != 0) return VK_ERROR_INITIALIZATION_FAILED;
+	executor->reaperStarted = 1;
+	return res;
+}
+
+
+VkResult
+begin_AsyncJob(VkAsyncExecutor* executor, VkTranspositionFuture* future)
+{
+	//called with the mutex locked: take a fence, waiting for completions if VKT_ASYNC_MAX_IN_FLIGHT jobs are in flight,
+	//and begin the command buffer of the job
+	VkGPU* vkGPU = executor->vkGPU;
+	VkResult res = VK_SUCCESS;
+	while (executor->freeFenceCount == 0 && executor->fenceCount == VKT_ASYNC_MAX_IN_FLIGHT) pthread_cond_wait(&executor->completed, &executor->mutex);
+	if (executor->freeFenceCount > 0) {
+		future->fence = executor->freeFences[--executor->freeFenceCount];
+	}
+	else {
+		VkFenceCreateInfo fenceCreateInfo = { VK_STRUCTURE_TYPE_FENCE_CREATE_INFO, (const void*) NULL, (VkFenceCreateFlags) 0 };
+		res = vkCreateFence(vkGPU->device, &fenceCreateInfo, NULL, &future->fence);
+		if (res != VK_SUCCESS) return res;
+		executor->fenceCount++;
+	}
+	future->done = 0;
+	future->result = VK_NOT_READY;
+	future->next = NULL;
+	future->submitTime = get_TimeMs();
+
+	VkCommandBufferAllocateInfo commandBufferAllocateInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+                                        (const void*) NULL,
+                                        (VkCommandPool) executor->commandPool,
+                                        (VkCommandBufferLevel) VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+                                        (uint32_t) 1 };
+	res = vkAllocateCommandBuffers(vkGPU->device, &commandBufferAllocateInfo, &future->commandBuffer);
+	if (res != VK_SUCCESS) {
+		executor->freeFences[executor->freeFenceCount++] = future->fence;
+		return res;
+	}
+	VkCommandBufferBeginInfo commandBufferBeginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+                                     (const void*) NULL,
+                                     (VkCommandBufferUsageFlags) VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+                                     (const VkCommandBufferInheritanceInfo*) NULL };
+	return vkBeginCommandBuffer(future->commandBuffer, &commandBufferBeginInfo);
+}
+
+
+VkResult
+end_AsyncJob(VkAsyncExecutor* executor, VkTranspositionFuture* future)
+{
+	//called with the mutex locked: end the command buffer, submit it and hand the future to the reaper
+	VkGPU* vkGPU = executor->vkGPU;
+	//order the job before the jobs submitted after it
+	VkMemoryBarrier memoryBarrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                                    (const void*) NULL,
+                                    (VkAccessFlags) (VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT),
+                                    (VkAccessFlags) (VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_HOST_READ_BIT) };
+	vkCmdPipelineBarrier(future->commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+	                     VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &memoryBarrier, 0, NULL, 0, NULL);
+	VkResult res = vkEndCommandBuffer(future->commandBuffer);
+	if (res == VK_SUCCESS) {
+		VkSubmitInfo submitInfo = { VK_STRUCTURE_TYPE_SUBMIT_INFO,
+                                 (const void*) NULL,
+                                 (uint32_t) 0,
+                                 (const VkSemaphore*) NULL,
+                                 (const VkPipelineStageFlags*) NULL,
+                                 (uint32_t) 1,
+                                 (const VkCommandBuffer*) &future->commandBuffer,
+                                 (uint32_t) 0,
+                                 (const VkSemaphore*) NULL };
+		res = vkQueueSubmit(vkGPU->queue, 1, &submitInfo, future->fence);
+	}
+	if (res != VK_SUCCESS) {
+		vkFreeCommandBuffers(vkGPU->device, executor->commandPool, 1, &future->commandBuffer);
+		executor->freeFences[executor->freeFenceCount++] = future->fence;
+		return res;
+	}
+	if (executor->tail != NULL) executor->tail->next = future;
+	else executor->head = future;
+	executor->tail = future;
+	executor->inFlight++;
+	if (executor->inFlight > executor->maxInFlight) executor->maxInFlight = executor->inFlight;
+	pthread_cond_signal(&executor->submitted);
+	return res;
+}
+
+
+VkResult
+submit_AsyncApp(VkAsyncExecutor* executor,
+                VkApplication* app,
+                uint32_t* groupCount,
+                VkTranspositionCallback callback,
+                void* userData,
+                VkTranspositionFuture* future)
+{
+	//asynchronous run_App with batch 1. future must stay valid until it is done
+	pthread_mutex_lock(&executor->mutex);
+	future->callback = callback;
+	future->userData = userData;
+	VkResult res = begin_AsyncJob(executor, future);
+	if (res == VK_SUCCESS) {
+		vkCmdPushConstants(future->commandBuffer, app->pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(VkAppPushConstantsLayout), &app->pushConstants);
+		vkCmdBindPipeline(future->commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, app->pipeline);
+		vkCmdBindDescriptorSets(future->commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, app->pipelineLayout, 0, 1, &app->descriptorSet, 0, NULL);
+		vkCmdDispatch(future->commandBuffer, groupCount[0], groupCount[1], groupCount[2]);
+		res = end_AsyncJob(executor, future);
+	}
+	pthread_mutex_unlock(&executor->mutex);
+	return res;
+}
+
+
+VkResult
+submit_AsyncCopy(VkAsyncExecutor* executor,
+                 VkBuffer srcBuffer,
+                 VkBuffer dstBuffer,
+                 VkDeviceSize size,
+                 VkTranspositionCallback callback,
+                 void* userData,
+                 VkTranspositionFuture* future)
+{
+	//asynchronous buffer copy, the upload or download half of upload_Data and download_Data with a persistent staging buffer
+	pthread_mutex_lock(&executor->mutex);
+	future->callback = callback;
+	future->userData = userData;
+	VkResult res = begin_AsyncJob(executor, future);
+	if (res == VK_SUCCESS) {
+		VkBufferCopy copyRegion = { 0, 0, size };
+		vkCmdCopyBuffer(future->commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
+		res = end_AsyncJob(executor, future);
+	}
+	pthread_mutex_unlock(&executor->mutex);
+	return res;
+}
+
+
+VkResult
+wait_TranspositionFuture(VkAsyncExecutor* executor, VkTranspositionFuture* future, double timeoutMs)
+{
+	//returns the result of the job or VK_TIMEOUT
+	struct timespec deadline;
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += (time_t) (timeoutMs / 1000);
+	deadline.tv_nsec += (long) (fmod(timeoutMs, 1000) * 1000000);
+	if (deadline.tv_nsec >= 1000000000) {
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000;
+	}
+	pthread_mutex_lock(&executor->mutex);
+	while (!future->done) {
+		if (pthread_cond_timedwait(&executor->completed, &executor->mutex, &deadline) == ETIMEDOUT) break;
+	}
+	VkResult res = future->done ? future->result : VK_TIMEOUT;
+	pthread_mutex_unlock(&executor->mutex);
+	return res;
+}
+
+
+uint64_t
+read_AsyncNotifyFd(VkAsyncExecutor* executor)
+{
+	//drain the notification descriptor after poll() reported it readable, returns the number of completions signalled
+	uint64_t count = 0;
+#ifdef __linux__
+	if (read(executor->notifyFd[0], &count, sizeof(count)) != sizeof(count)) count = 0;
+#else
+	uint64_t value[64];
+	ssize_t bytes;
+	while ((bytes = read(executor->notifyFd[0], value, sizeof(value))) > 0) count += bytes / sizeof(uint64_t);
+#endif
+	return count;
+}
+
+
+void
+delete_AsyncExecutor(VkAsyncExecutor* executor)
+{
+	//completes the jobs in flight before returning
+	VkGPU* vkGPU = executor->vkGPU;
+	if (executor->reaperStarted) {
+		pthread_mutex_lock(&executor->mutex);
+		executor->stop = 1;
+		pthread_cond_signal(&executor->submitted);
+		pthread_mutex_unlock(&executor->mutex);
+		pthread_join(executor->reaper, NULL);
+	}
+	pthread_mutex_destroy(&executor->mutex);
+	pthread_cond_destroy(&executor->submitted);
+	pthread_cond_destroy(&executor->completed);
+	for (uint32_t i = 0; i < executor->freeFenceCount; i++) vkDestroyFence(vkGPU->device, executor->freeFences[i], NULL);
+	if (executor->commandPool != VK_NULL_HANDLE) vkDestroyCommandPool(vkGPU->device, executor->commandPool, NULL);
+	if (executor->notifyFd[0] >= 0) close(executor->notifyFd[0]);
+	if (executor->notifyFd[1] >= 0 && executor->notifyFd[1] != executor->notifyFd[0]) close(executor->notifyFd[1]);
+	memset(executor, 0, sizeof(VkAsyncExecutor));
+}
+
+
+typedef struct {
+	VkAsyncExecutor* executor;
+	VkApplication* app;
+	uint32_t* groupCount;
+	uint32_t jobs;
+	uint32_t depth;  //futures kept in flight by the thread
+	double* latency; //submit to completion of every job, ms
+	uint32_t completed;
+	uint32_t failed;
+	uint32_t finished;//set under the mutex of the executor when the thread has no jobs left
+} VkAsyncThread;
+
+
+void*
+run_AsyncThread(void* arg)
+{
+	//keeps depth jobs in flight and only waits for the oldest one when all of its futures are taken
+	VkAsyncThread* thread = (VkAsyncThread*) arg;
+	VkTranspositionFuture* future = (VkTranspositionFuture*) calloc(thread->depth, sizeof(VkTranspositionFuture));
+	uint32_t submitted = 0;
+	for (uint32_t job = 0; job < thread->jobs + thread->depth; job++) {
+		VkTranspositionFuture* slot = &future[job % thread->depth];
+		if (job >= thread->depth && job - thread->depth < submitted) {
+			VkResult res = wait_TranspositionFuture(thread->executor, slot, 100000);
+			if (res == VK_SUCCESS) thread->latency[thread->completed++] = slot->completeTime - slot->submitTime;
+			else thread->failed++;
+		}
+		if (job < thread->jobs) {
+			if (submit_AsyncApp(thread->executor, thread->app, thread->groupCount, NULL, NULL, slot) != VK_SUCCESS) {
+				thread->failed += thread->jobs - job;
+				thread->jobs = job;
+			}
+			else submitted++;
+		}
+	}
+	free(future);
+	pthread_mutex_lock(&thread->executor->mutex);
+	thread->finished = 1;
+	pthread_mutex_unlock(&thread->executor->mutex);
+	return NULL;
+}
+
+
+VkResult
+Example_VulkanAsync(uint32_t deviceID,
+                    uint32_t coalescedMemory,
+                    uint32_t size,
+                    uint32_t jobs,
+                    uint32_t threads,
+                    uint32_t depth)
+{
+	//jobs transpositions of size x size submitted from threads threads with depth jobs in flight each, compared with
+	//blocking run_App calls. The main thread only polls the notification descriptor of the executor
+	VkGPU vkGPU = { 0 };
+	vkGPU.device_id = deviceID;
+	VkResult res = VK_SUCCESS;
+	if (threads == 0 || depth == 0 || (uint64_t) threads * depth > VKT_ASYNC_MAX_IN_FLIGHT) {
+		printf("Unsupported number of jobs in flight: %d threads x %d, maximum %d\n", threads, depth, VKT_ASYNC_MAX_IN_FLIGHT);
+		return VK_ERROR_TOO_MANY_OBJECTS;
+	}
+	res = create_VkGPU(&vkGPU);
+	if (res != VK_SUCCESS) return res;
+	coalescedMemory = get_CoalescedMemory(&vkGPU, coalescedMemory);
+	uint32_t tile = coalescedMemory / sizeof(float);
+	if (size % tile != 0) {
+		printf("System size %d is not a multiple of the tile size %d\n", size, tile);
+		delete_VkGPU(&vkGPU);
+		return VK_ERROR_FORMAT_NOT_SUPPORTED;
+	}
+
+	VkDeviceSize bufferSize = sizeof(float) * (VkDeviceSize) size * size;
+	VkBuffer inputBuffer = { 0 }, outputBuffer = { 0 };
+	VkDeviceMemory inputBufferDeviceMemory = { 0 }, outputBufferDeviceMemory = { 0 };
+	res = allocate_Buffer_DeviceMemory(vkGPU.physicalDevice, vkGPU.device,
+                                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                           &vkGPU.physicalDeviceMemoryProperties, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                           bufferSize, &inputBuffer, &inputBufferDeviceMemory);
+	if (res != VK_SUCCESS) {
+		printf("Input buffer allocation failed, error code: %d\n", res);
+		return res;
+	}
+	res = allocate_Buffer_DeviceMemory(vkGPU.physicalDevice, vkGPU.device,
+                                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                           &vkGPU.physicalDeviceMemoryProperties, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                           bufferSize, &outputBuffer, &outputBufferDeviceMemory);
+	if (res != VK_SUCCESS) {
+		printf("Output buffer allocation failed, error code: %d\n", res);
+		return res;
+	}
+	float* buffer_input  = (float*) malloc(bufferSize);
+	float* buffer_output = (float*) malloc(bufferSize);
+	for (uint64_t i = 0; i < (uint64_t) size * size; i++) buffer_input[i] = (float) i;
+	res = upload_Data(vkGPU.physicalDevice, vkGPU.device, buffer_input, &vkGPU.physicalDeviceMemoryProperties,
+                          vkGPU.commandPool, vkGPU.queue, &vkGPU.fence, &inputBuffer, bufferSize);
+	if (res != VK_SUCCESS) return res;
+
+	VkApplication app = { 0 };
+	VkBuffer*    buffer[2]      = { &inputBuffer, &outputBuffer };
+	VkDeviceSize bufferSizes[2] = { bufferSize, bufferSize };
+	uint32_t systemSize[3] = { size, size, 1 };
+	char shaderPath[256];
+	sprintf(shaderPath, "%stransposition_no_bank_conflicts.spv", SHADER_DIR);
+	res = create_App(vkGPU.device, &app.specializationConstants, coalescedMemory, buffer, bufferSizes, systemSize,
+	                 &app.descriptorPool, &app.descriptorSetLayout, &app.descriptorSet,
+	                 (const char*) shaderPath, &app.pipelineLayout, &app.pipeline);
+	if (res != VK_SUCCESS) {
+		printf("Application creation failed, error code: %d\n", res);
+		return res;
+	}
+	uint32_t groupCount[3] = { size / tile, size / tile, 1 };
+
+	//blocking baseline: one submit and one fence wait per job
+	uint32_t blockingJobs = (jobs < 100) ? jobs : 100;
+	double time_blocking = get_TimeMs();
+	for (uint32_t i = 0; i < blockingJobs && res == VK_SUCCESS; i++) {
+		double time = 0;
+		res = run_App(vkGPU.device, vkGPU.commandPool, app.pipeline, app.pipelineLayout, &app.descriptorSet,
+		              groupCount, vkGPU.queue, &vkGPU.fence, 1, &time);
+	}
+	time_blocking = (get_TimeMs() - time_blocking) / blockingJobs;
+	if (res != VK_SUCCESS) {
+		printf("Application run failed, error code: %d\n", res);
+		return res;
+	}
+
+	VkAsyncExecutor executor;
+	res = create_AsyncExecutor(&vkGPU, &executor);
+	if (res != VK_SUCCESS) {
+		printf("Executor creation failed, error code: %d\n", res);
+		delete_AsyncExecutor(&executor);
+		return res;
+	}
+	VkAsyncThread* thread = (VkAsyncThread*) calloc(threads, sizeof(VkAsyncThread));
+	pthread_t* handle = (pthread_t*) malloc(sizeof(pthread_t) * threads);
+	double t = get_TimeMs();
+	for (uint32_t i = 0; i < threads; i++) {
+		thread[i].executor   = &executor;
+		thread[i].app        = &app;
+		thread[i].groupCount = groupCount;
+		thread[i].jobs       = jobs / threads + (i < jobs % threads);
+		thread[i].depth      = depth;
+		thread[i].latency    = (double*) malloc(sizeof(double) * (thread[i].jobs + 1));
+		pthread_create(&handle[i], NULL, run_AsyncThread, &thread[i]);
+	}
+	//event loop side: wake up on the notification descriptor only
+	uint64_t wakeups = 0, notified = 0;
+	while (notified < jobs) {
+		struct pollfd pfd = { executor.notifyFd[0], POLLIN, 0 };
+		if (poll(&pfd, 1, 100) <= 0) {
+			//threads stop early after a failed submit, so not every job is signalled
+			pthread_mutex_lock(&executor.mutex);
+			uint32_t finished = 1;
+			for (uint32_t i = 0; i < threads; i++) finished &= thread[i].finished;
+			uint64_t completedCount = executor.completedCount;
+			pthread_mutex_unlock(&executor.mutex);
+			if (finished && notified == completedCount) break;
+			continue;
+		}
+		wakeups++;
+		notified += read_AsyncNotifyFd(&executor);
+	}
+	for (uint32_t i = 0; i < threads; i++) pthread_join(handle[i], NULL);
+	t = get_TimeMs() - t;
+	uint32_t maxInFlight = executor.maxInFlight;
+	delete_AsyncExecutor(&executor);
+
+	uint32_t completed = 0, failed = 0;
+	for (uint32_t i = 0; i < threads; i++) {
+		completed += thread[i].completed;
+		failed += thread[i].failed;
+	}
+	double* latency = (double*) malloc(sizeof(double) * (completed + 1));
+	uint32_t pos = 0;
+	for (uint32_t i = 0; i < threads; i++) {
+		memcpy(latency + pos, thread[i].latency, sizeof(double) * thread[i].completed);
+		pos += thread[i].completed;
+		free(thread[i].latency);
+	}
+
+	res = download_Data(vkGPU.physicalDevice, vkGPU.device, vkGPU.commandPool, &vkGPU.physicalDeviceMemoryProperties,
+	                    vkGPU.queue, &vkGPU.fence, buffer_output, &outputBuffer, bufferSize);
+	uint32_t passed = (res == VK_SUCCESS);
+	for (uint64_t j = 0; j < size && passed; j++) {
+		for (uint64_t i = 0; i < size && passed; i++) {
+			passed = (buffer_output[i + j * size] == buffer_input[j + i * size]);
+		}
+	}
+
+	printf("System size: %dx%d\nThreads: %d, depth: %d, maximal jobs in flight: %d\n", size, size, threads, depth, maxInFlight);
+	printf("Blocking run_App: %.3f ms per job\nAsynchronous: %d completed, %d failed, %.3f ms per job, %llu wakeups of the event loop\nVerification %s\n",
+	       time_blocking, completed, failed, t / (completed ? completed : 1), (unsigned long long) wakeups, passed ? "passed" : "FAILED");
+	if (completed > 0) {
+		qsort(latency, completed, sizeof(double), compare_Double);
+		printf("Job latency: p50 %.3f ms, p90 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+		       latency[(uint32_t) (0.50 * (completed - 1))],
+		       latency[(uint32_t) (0.90 * (completed - 1))],
+		       latency[(uint32_t) (0.99 * (completed - 1))],
+		       latency[completed - 1]);
+	}
+	if (res == VK_SUCCESS && (!passed || failed != 0)) res = VK_ERROR_FORMAT_NOT_SUPPORTED;
+
+	free(latency);
+	free(thread);
+	free(handle);
+	deleteApp(&vkGPU, &app);
+	free(buffer_input);
+	free(buffer_output);
+	vkDestroyBuffer(vkGPU.device, inputBuffer, NULL);
+	vkFreeMemory(vkGPU.device, inputBufferDeviceMemory, NULL);
+	vkDestroyBuffer(vkGPU.device, outputBuffer, NULL);
+	vkFreeMemory(vkGPU.device, outputBufferDeviceMemory, NULL);
+	delete_VkGPU(&vkGPU);
+	return res;
+}
+#endif
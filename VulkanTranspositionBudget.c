@@ -0,0 +1,445 @@
+#include "VulkanTransposition.h"
+
+
+//Memory budget: VK_EXT_memory_budget reports per heap how much memory the process can use without the driver paging and how
+//much it uses. Without the extension the budget is the heap size and the usage is what the admission controller has reserved
+uint32_t
+get_MemoryBudget(VkGPU* vkGPU, VkDeviceSize* budget, VkDeviceSize* usage)
+{
+	//budget and usage of every heap, returns 1 if they come from VK_EXT_memory_budget
+	VkPhysicalDeviceMemoryBudgetPropertiesEXT memoryBudgetProperties = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT };
+	VkPhysicalDeviceMemoryProperties2 memoryProperties2 = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2,
+                                                  (void*) &memoryBudgetProperties };
+	if (vkGPU->memoryBudgetSupported) vkGetPhysicalDeviceMemoryProperties2(vkGPU->physicalDevice, &memoryProperties2);
+	for (uint32_t i = 0; i < vkGPU->physicalDeviceMemoryProperties.memoryHeapCount; i++) {
+		budget[i] = vkGPU->memoryBudgetSupported ? memoryBudgetProperties.heapBudget[i] : vkGPU->physicalDeviceMemoryProperties.memoryHeaps[i].size;
+		usage[i]  = vkGPU->memoryBudgetSupported ? memoryBudgetProperties.heapUsage[i] : 0;
+	}
+	return vkGPU->memoryBudgetSupported;
+}
+
+
+uint32_t
+find_MemoryHeap(VkGPU* vkGPU, VkMemoryPropertyFlags memoryPropertyFlags)
+{
+	//heap of the first memory type with the properties, the one allocate_Buffer_DeviceMemory picks
+	for (uint32_t i = 0; i < vkGPU->physicalDeviceMemoryProperties.memoryTypeCount; i++) {
+		if ((vkGPU->physicalDeviceMemoryProperties.memoryTypes[i].propertyFlags & memoryPropertyFlags) == memoryPropertyFlags)
+			return vkGPU->physicalDeviceMemoryProperties.memoryTypes[i].heapIndex;
+	}
+	return 0;
+}
+
+
+//Admission controller: jobs reserve device local memory before they allocate it. A job that fits is admitted whole, a job
+//that only fits with its minimum reservation is admitted with what is available and runs chunked, a job that does not fit
+//waits until running jobs release their memory. Available memory is the budget minus the headroom minus the larger of the
+//reported usage and the reservations, as admitted jobs may not have allocated yet
+typedef struct {
+	VkGPU* vkGPU;
+	uint32_t heapIndex;       //heap of the device local memory
+	VkDeviceSize limit;       //cap of the budget, 0 - none
+	VkDeviceSize headroom;    //bytes of the budget kept free
+	VkDeviceSize usageBase;   //heap usage before the first job
+	VkDeviceSize reserved;    //bytes admitted and not released
+	VkDeviceSize reservedPeak;
+	uint32_t active;          //jobs admitted and not finished
+	uint32_t activePeak;
+	uint32_t admitted;        //statistics: jobs admitted whole, chunked, after waiting and rejected
+	uint32_t chunked;
+	uint32_t queued;
+	uint32_t rejected;
+#ifndef _WIN32
+	pthread_mutex_t mutex;
+	pthread_cond_t released;
+#endif
+} VkAdmissionController;
+
+
+void
+create_AdmissionController(VkAdmissionController* controller, VkGPU* vkGPU, VkDeviceSize limit, double headroomFraction)
+{
+	VkDeviceSize budget[VK_MAX_MEMORY_HEAPS] = { 0 }, usage[VK_MAX_MEMORY_HEAPS] = { 0 };
+	memset(controller, 0, sizeof(VkAdmissionController));
+	controller->vkGPU = vkGPU;
+	controller->heapIndex = find_MemoryHeap(vkGPU, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	controller->limit = limit;
+	get_MemoryBudget(vkGPU, budget, usage);
+	if (limit != 0 && limit < budget[controller->heapIndex]) budget[controller->heapIndex] = limit;
+	controller->headroom = (VkDeviceSize) (budget[controller->heapIndex] * headroomFraction);
+	controller->usageBase = usage[controller->heapIndex];
+#ifndef _WIN32
+	pthread_mutex_init(&controller->mutex, NULL);
+	pthread_cond_init(&controller->released, NULL);
+#endif
+}
+
+
+void
+get_AdmissionState(VkAdmissionController* controller, VkDeviceSize* budget, VkDeviceSize* usage, VkDeviceSize* available)
+{
+	//live budget, usage and available memory of the admitted heap, call with the mutex held
+	VkDeviceSize heapBudget[VK_MAX_MEMORY_HEAPS] = { 0 }, heapUsage[VK_MAX_MEMORY_HEAPS] = { 0 };
+	get_MemoryBudget(controller->vkGPU, heapBudget, heapUsage);
+	budget[0] = heapBudget[controller->heapIndex];
+	if (controller->limit != 0 && controller->limit < budget[0]) budget[0] = controller->limit;
+	//memory used by the jobs is counted against the limit, not the memory of other processes
+	usage[0] = heapUsage[controller->heapIndex];
+	if (controller->limit != 0) usage[0] = (usage[0] > controller->usageBase) ? usage[0] - controller->usageBase : 0;
+	VkDeviceSize reservedUsage = controller->reserved + ((controller->limit == 0) ? controller->usageBase : 0);
+	VkDeviceSize used = (usage[0] > reservedUsage) ? usage[0] : reservedUsage;
+	available[0] = (budget[0] > controller->headroom + used) ? budget[0] - controller->headroom - used : 0;
+}
+
+
+VkResult
+admit_Job(VkAdmissionController* controller, VkDeviceSize bytes, VkDeviceSize minBytes, VkDeviceSize* granted)
+{
+	//reserves bytes, or at least minBytes for a chunked run, waiting for running jobs if needed. Fails if the job
+	//can not run even on an idle device
+	VkDeviceSize budget, usage, available;
+	VkResult res = VK_SUCCESS;
+	uint32_t waited = 0;
+#ifndef _WIN32
+	pthread_mutex_lock(&controller->mutex);
+#endif
+	while (1) {
+		get_AdmissionState(controller, &budget, &usage, &available);
+		if (bytes <= available || minBytes <= available) {
+			granted[0] = (bytes <= available) ? bytes : available;
+			break;
+		}
+#ifndef _WIN32
+		if (controller->active > 0) {
+			waited = 1;
+			pthread_cond_wait(&controller->released, &controller->mutex);
+			continue;
+		}
+#endif
+		controller->rejected++;
+		res = VK_ERROR_OUT_OF_DEVICE_MEMORY;
+		break;
+	}
+	if (res == VK_SUCCESS) {
+		controller->reserved += granted[0];
+		if (controller->reserved > controller->reservedPeak) controller->reservedPeak = controller->reserved;
+		controller->active++;
+		if (controller->active > controller->activePeak) controller->activePeak = controller->active;
+		controller->admitted += (granted[0] == bytes);
+		controller->chunked += (granted[0] < bytes);
+		controller->queued += waited;
+	}
+#ifndef _WIN32
+	pthread_mutex_unlock(&controller->mutex);
+#endif
+	return res;
+}
+
+
+void
+release_Job(VkAdmissionController* controller, VkDeviceSize bytes, uint32_t finished)
+{
+	//return bytes of the reservation, finished - the job is done
+#ifndef _WIN32
+	pthread_mutex_lock(&controller->mutex);
+#endif
+	controller->reserved -= bytes;
+	controller->active -= finished;
+#ifndef _WIN32
+	pthread_cond_broadcast(&controller->released);
+	pthread_mutex_unlock(&controller->mutex);
+#endif
+}
+
+
+void
+delete_AdmissionController(VkAdmissionController* controller)
+{
+#ifndef _WIN32
+	pthread_cond_destroy(&controller->released);
+	pthread_mutex_destroy(&controller->mutex);
+#endif
+}
+
+
+uint32_t
+get_ChunkSize(uint32_t size, uint32_t tile, VkDeviceSize deviceBytes, VkDeviceSize stagingBytes, uint32_t sharedHeap)
+{
+	//largest block size size / 2^k that is a multiple of the tile and whose input, output and staging buffers fit.
+	//Staging comes from the device heap too if the host visible memory shares it. 0 if nothing fits
+	for (uint32_t block = size; block >= tile && block % tile == 0; block /= 2) {
+		VkDeviceSize blockBytes = sizeof(float) * (VkDeviceSize) block * block;
+		VkDeviceSize deviceNeed = 2 * blockBytes + (sharedHeap ? blockBytes : 0);
+		if (deviceNeed <= deviceBytes && (sharedHeap || blockBytes <= stagingBytes)) return block;
+		if (block % 2 != 0) break;
+	}
+	return 0;
+}
+
+
+#define VKT_BUDGET_MAX_THREADS 16
+
+typedef struct {
+	VkGPU* vkGPU;
+	VkAdmissionController* controller;
+	uint32_t coalescedMemory;
+	const uint32_t* jobSize;    //size x size matrix of every job
+	uint32_t jobs;
+	uint32_t* nextJob;          //shared job counter
+	uint32_t* failed;           //shared count of failed or wrong jobs
+	double* jobTime;            //ms of every job
+	uint32_t* jobBlock;         //block size every job ran with, 0 - rejected
+#ifndef _WIN32
+	pthread_mutex_t* queueMutex;//the queue and the job counter are shared by the workers
+#endif
+	VkCommandPool commandPool;  //own command pool and fence of the worker
+	VkFence fence;
+} VkBudgetWorker;
+
+
+VkResult
+run_BudgetedJob(VkBudgetWorker* worker, uint32_t job)
+{
+	//transposition of a size x size matrix in blocks of block x block: block (i, j) of the input is transposed on the device
+	//into block (j, i) of the output. block = size is the single-pass path
+	VkGPU* vkGPU = worker->vkGPU;
+	VkAdmissionController* controller = worker->controller;
+	uint32_t size = worker->jobSize[job];
+	uint32_t tile = worker->coalescedMemory / sizeof(float);
+	uint32_t sharedHeap = (controller->heapIndex == find_MemoryHeap(vkGPU, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT));
+	VkDeviceSize matrixBytes = sizeof(float) * (VkDeviceSize) size * size;
+	VkDeviceSize granted = 0;
+	double t = get_TimeMs();
+
+	//smallest block of the chunked path
+	uint32_t minBlock = size;
+	while (minBlock % 2 == 0 && (minBlock / 2) % tile == 0) minBlock /= 2;
+	VkDeviceSize minBlockBytes = sizeof(float) * (VkDeviceSize) minBlock * minBlock;
+	VkResult res = admit_Job(controller, (2 + sharedHeap) * matrixBytes, (2 + sharedHeap) * minBlockBytes, &granted);
+	worker->jobBlock[job] = 0;
+	if (res != VK_SUCCESS) return res;
+	//staging is shrunk to the headroom of the host visible heap
+	VkDeviceSize heapBudget[VK_MAX_MEMORY_HEAPS] = { 0 }, heapUsage[VK_MAX_MEMORY_HEAPS] = { 0 };
+	get_MemoryBudget(vkGPU, heapBudget, heapUsage);
+	uint32_t stagingHeap = find_MemoryHeap(vkGPU, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	VkDeviceSize stagingBytes = (heapBudget[stagingHeap] > heapUsage[stagingHeap]) ? (heapBudget[stagingHeap] - heapUsage[stagingHeap]) / 2 : 0;
+	uint32_t block = get_ChunkSize(size, tile, granted, stagingBytes, sharedHeap);
+	if (block == 0) {
+		release_Job(controller, granted, 1);
+		return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+	}
+	//keep only the reservation the blocks use
+	VkDeviceSize blockBytes = sizeof(float) * (VkDeviceSize) block * block;
+	VkDeviceSize used = (2 + sharedHeap) * blockBytes;
+	release_Job(controller, granted - used, 0);
+
+	VkBuffer buffer[2] = { 0 };
+	VkDeviceMemory bufferDeviceMemory[2] = { 0 };
+	VkApplication app = { 0 };
+	for (uint32_t k = 0; k < 2 && res == VK_SUCCESS; k++) {
+		res = allocate_Buffer_DeviceMemory(vkGPU->physicalDevice, vkGPU->device,
+		                                   VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		                                   &vkGPU->physicalDeviceMemoryProperties, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		                                   blockBytes, &buffer[k], &bufferDeviceMemory[k]);
+	}
+	if (res == VK_SUCCESS) {
+		char shaderPath[256];
+		sprintf(shaderPath, "%stransposition_no_bank_conflicts.spv", SHADER_DIR);
+		VkBuffer*    appBuffer[2]   = { &buffer[0], &buffer[1] };
+		VkDeviceSize bufferSizes[2] = { blockBytes, blockBytes };
+		uint32_t     systemSize[3]  = { block, block, 1 };
+		res = create_App(vkGPU->device, &app.specializationConstants, worker->coalescedMemory, appBuffer, bufferSizes, systemSize,
+		                 &app.descriptorPool, &app.descriptorSetLayout, &app.descriptorSet, (const char*) shaderPath, &app.pipelineLayout, &app.pipeline);
+	}
+
+	float* input  = (float*) malloc(matrixBytes);
+	float* output = (float*) malloc(matrixBytes);
+	float* blockData = (float*) malloc(blockBytes);
+	for (uint64_t i = 0; i < (uint64_t) size * size; i++) input[i] = (float) ((i * 2654435761u + job) & 0xFFFFFF);
+	uint32_t blocks = size / block;
+	uint32_t groupCount[3] = { block / tile, block / tile, 1 };
+	for (uint32_t bj = 0; bj < blocks && res == VK_SUCCESS; bj++) {
+		for (uint32_t bi = 0; bi < blocks && res == VK_SUCCESS; bi++) {
+			//block (bi, bj) - rows bj*block.., columns bi*block..
+			for (uint32_t y = 0; y < block; y++)
+				memcpy(&blockData[(uint64_t) y * block], &input[((uint64_t) bj * block + y) * size + (uint64_t) bi * block], sizeof(float) * block);
+			double time_block = 0;
+#ifndef _WIN32
+			pthread_mutex_lock(worker->queueMutex);
+#endif
+			res = upload_Data(vkGPU->physicalDevice, vkGPU->device, blockData, &vkGPU->physicalDeviceMemoryProperties,
+			                  worker->commandPool, vkGPU->queue, &worker->fence, &buffer[0], blockBytes);
+			if (res == VK_SUCCESS)
+				res = run_App(vkGPU->device, worker->commandPool, app.pipeline, app.pipelineLayout, &app.descriptorSet, groupCount,
+				              vkGPU->queue, &worker->fence, 1, &time_block);
+			if (res == VK_SUCCESS)
+				res = download_Data(vkGPU->physicalDevice, vkGPU->device, worker->commandPool, &vkGPU->physicalDeviceMemoryProperties,
+				                    vkGPU->queue, &worker->fence, blockData, &buffer[1], blockBytes);
+#ifndef _WIN32
+			pthread_mutex_unlock(worker->queueMutex);
+#endif
+			//transposed block goes to rows bi*block.., columns bj*block..
+			for (uint32_t y = 0; y < block && res == VK_SUCCESS; y++)
+				memcpy(&output[((uint64_t) bi * block + y) * size + (uint64_t) bj * block], &blockData[(uint64_t) y * block], sizeof(float) * block);
+		}
+	}
+	uint32_t passed = (res == VK_SUCCESS);
+	for (uint64_t y = 0; y < size && passed; y++) {
+		for (uint64_t x = 0; x < size && passed; x++) passed = (output[y * size + x] == input[x * size + y]);
+	}
+	if (res == VK_SUCCESS && !passed) res = VK_ERROR_FORMAT_NOT_SUPPORTED;
+
+	free(input);
+	free(output);
+	free(blockData);
+	if (app.pipeline != VK_NULL_HANDLE) deleteApp(vkGPU, &app);
+	for (uint32_t k = 0; k < 2; k++) {
+		vkDestroyBuffer(vkGPU->device, buffer[k], NULL);
+		vkFreeMemory(vkGPU->device, bufferDeviceMemory[k], NULL);
+	}
+	release_Job(controller, used, 1);
+	worker->jobBlock[job] = block;
+	worker->jobTime[job] = get_TimeMs() - t;
+	return res;
+}
+
+
+#ifndef _WIN32
+void*
+run_BudgetWorker(void* arg)
+{
+	VkBudgetWorker* worker = (VkBudgetWorker*) arg;
+	while (1) {
+		pthread_mutex_lock(worker->queueMutex);
+		uint32_t job = worker->nextJob[0]++;
+		pthread_mutex_unlock(worker->queueMutex);
+		if (job >= worker->jobs) break;
+		VkResult res = run_BudgetedJob(worker, job);
+		if (res != VK_SUCCESS && res != VK_ERROR_OUT_OF_DEVICE_MEMORY) {
+			pthread_mutex_lock(worker->queueMutex);
+			worker->failed[0]++;
+			pthread_mutex_unlock(worker->queueMutex);
+			printf("Job %d (%dx%d) failed, error code: %d\n", job, worker->jobSize[job], worker->jobSize[job], res);
+		}
+	}
+	return NULL;
+}
+#endif
+
+
+VkResult
+Example_VulkanBudget(uint32_t deviceID,
+                     uint32_t coalescedMemory,
+                     uint32_t size,
+                     uint32_t jobs,
+                     uint32_t threads,
+                     uint32_t limitMB)
+{
+	//jobs transpositions of size x size, size/2 x size/2 and size/4 x size/4 matrices from threads workers under the
+	//admission controller, with the budget optionally capped at limitMB to see queueing and chunking on any device
+	VkGPU vkGPU = { 0 };
+	vkGPU.device_id = deviceID;
+	VkResult res = create_VkGPU(&vkGPU);
+	if (res != VK_SUCCESS) return res;
+	coalescedMemory = get_CoalescedMemory(&vkGPU, coalescedMemory);
+	uint32_t tile = coalescedMemory / sizeof(float);
+	if (size % (4 * tile) != 0) {
+		printf("System size %d is not a multiple of 4 tiles of %d\n", size, tile);
+		delete_VkGPU(&vkGPU);
+		return VK_ERROR_FORMAT_NOT_SUPPORTED;
+	}
+	if (threads == 0) threads = 1;
+	if (threads > VKT_BUDGET_MAX_THREADS) threads = VKT_BUDGET_MAX_THREADS;
+#ifdef _WIN32
+	threads = 1;
+#endif
+
+	VkAdmissionController controller;
+	create_AdmissionController(&controller, &vkGPU, (VkDeviceSize) limitMB << 20, 0.1);
+	VkDeviceSize budget = 0, usage = 0, available = 0;
+	get_AdmissionState(&controller, &budget, &usage, &available);
+	printf("Heap %d: budget %.1f MB (%s%s), usage %.1f MB, headroom %.1f MB, available %.1f MB\n", controller.heapIndex,
+	       budget / 1048576.0, vkGPU.memoryBudgetSupported ? "VK_EXT_memory_budget" : "heap size", limitMB ? ", capped" : "",
+	       usage / 1048576.0, controller.headroom / 1048576.0, available / 1048576.0);
+
+	uint32_t* jobSize = (uint32_t*) malloc(sizeof(uint32_t) * jobs);
+	double* jobTime = (double*) calloc(jobs, sizeof(double));
+	uint32_t* jobBlock = (uint32_t*) calloc(jobs, sizeof(uint32_t));
+	for (uint32_t k = 0; k < jobs; k++) jobSize[k] = size >> (k % 3);
+	uint32_t nextJob = 0, failed = 0;
+	VkBudgetWorker worker[VKT_BUDGET_MAX_THREADS];
+	memset(worker, 0, sizeof(worker));
+#ifndef _WIN32
+	pthread_mutex_t queueMutex;
+	pthread_mutex_init(&queueMutex, NULL);
+	pthread_t thread[VKT_BUDGET_MAX_THREADS];
+	uint32_t started[VKT_BUDGET_MAX_THREADS] = { 0 };
+#endif
+	for (uint32_t k = 0; k < threads && res == VK_SUCCESS; k++) {
+		worker[k].vkGPU = &vkGPU;
+		worker[k].controller = &controller;
+		worker[k].coalescedMemory = coalescedMemory;
+		worker[k].jobSize = jobSize;
+		worker[k].jobs = jobs;
+		worker[k].nextJob = &nextJob;
+		worker[k].failed = &failed;
+		worker[k].jobTime = jobTime;
+		worker[k].jobBlock = jobBlock;
+#ifndef _WIN32
+		worker[k].queueMutex = &queueMutex;
+#endif
+		VkCommandPoolCreateInfo commandPoolCreateInfo = { VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+                                        (const void*) NULL,
+                                        (VkCommandPoolCreateFlags) VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+                                        (uint32_t) vkGPU.queueFamilyIndex };
+		VkFenceCreateInfo fenceCreateInfo = { VK_STRUCTURE_TYPE_FENCE_CREATE_INFO, (const void*) NULL, (VkFenceCreateFlags) 0 };
+		res = vkCreateCommandPool(vkGPU.device, &commandPoolCreateInfo, NULL, &worker[k].commandPool);
+		if (res == VK_SUCCESS) res = vkCreateFence(vkGPU.device, &fenceCreateInfo, NULL, &worker[k].fence);
+	}
+
+	double t = get_TimeMs();
+#ifndef _WIN32
+	for (uint32_t k = 0; k < threads && res == VK_SUCCESS; k++) started[k] = (pthread_create(&thread[k], NULL, run_BudgetWorker, &worker[k]) == 0);
+	for (uint32_t k = 0; k < threads; k++) {
+		if (started[k]) pthread_join(thread[k], NULL);
+	}
+#else
+	for (uint32_t k = 0; k < jobs && res == VK_SUCCESS; k++) {
+		VkResult jobResult = run_BudgetedJob(&worker[0], k);
+		if (jobResult != VK_SUCCESS && jobResult != VK_ERROR_OUT_OF_DEVICE_MEMORY) failed++;
+	}
+#endif
+	double totalTime = get_TimeMs() - t;
+
+	if (res == VK_SUCCESS) {
+		//time includes the wait for admission
+		uint32_t rejected = 0;
+		printf("\n  job      size    block   time, ms\n");
+		for (uint32_t k = 0; k < jobs; k++) {
+			rejected += (jobBlock[k] == 0);
+			if (jobBlock[k] == 0) printf("%5d %9d %8s %10s\n", k, jobSize[k], "-", "rejected");
+			else printf("%5d %9d %8d %10.3f%s\n", k, jobSize[k], jobBlock[k], jobTime[k], (jobBlock[k] < jobSize[k]) ? " chunked" : "");
+		}
+		get_AdmissionState(&controller, &budget, &usage, &available);
+		printf("\nJobs: %d in %.3f ms by %d threads, %d admitted whole, %d chunked, %d queued, %d rejected, %d failed\n",
+		       jobs, totalTime, threads, controller.admitted, controller.chunked, controller.queued, rejected, failed);
+		printf("Peak: %d jobs running, %.1f MB reserved. Now: usage %.1f MB, available %.1f MB\n",
+		       controller.activePeak, controller.reservedPeak / 1048576.0, usage / 1048576.0, available / 1048576.0);
+		if (failed > 0) res = VK_ERROR_FORMAT_NOT_SUPPORTED;
+	}
+	else printf("Worker creation failed, error code: %d\n", res);
+
+	for (uint32_t k = 0; k < threads; k++) {
+		vkDestroyFence(vkGPU.device, worker[k].fence, NULL);
+		vkDestroyCommandPool(vkGPU.device, worker[k].commandPool, NULL);
+	}
+#ifndef _WIN32
+	pthread_mutex_destroy(&queueMutex);
+#endif
+	delete_AdmissionController(&controller);
+	free(jobSize);
+	free(jobTime);
+	free(jobBlock);
+	delete_VkGPU(&vkGPU);
+	return res;
+}
@@ -0,0 +1,213 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "VulkanTranspositionClient.h"
+
+
+static int
+create_SharedMemory(uint64_t shmSize)
+{
+	//create an anonymous shared memory file. memfd is preferred on Linux, POSIX shm (unlinked right away) elsewhere.
+	//The daemon only maps memfds sealed against shrinking and growing, so it can not be made to fault on a truncated file.
+	//Seals are only supported by memfds, a POSIX shm file is not sealed
+	int fd = -1;
+	int sealable = 0;
+#ifdef __linux__
+	fd = memfd_create("VulkanTransposition", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+	sealable = (fd >= 0);
+#endif
+	if (fd < 0) {
+		char name[64];
+		snprintf(name, sizeof(name), "/VulkanTransposition.%d", (int) getpid());
+		fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+		if (fd < 0) return -1;
+		shm_unlink(name);
+	}
+	if (ftruncate(fd, (off_t) shmSize) != 0) {
+		int error = errno;
+		close(fd);
+		errno = error;
+		return -1;
+	}
+#ifdef F_ADD_SEALS
+	if (sealable && fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW) != 0) {
+		int error = errno;
+		close(fd);
+		errno = error;
+		return -1;
+	}
+#endif
+	return fd;
+}
+
+
+static int
+send_All(int socket, const void* data, size_t size)
+{
+	const char* ptr = (const char*) data;
+	while (size > 0) {
+		ssize_t sent = send(socket, ptr, size, MSG_NOSIGNAL);
+		if (sent < 0) {
+			if (errno == EINTR) continue;
+			return -errno;
+		}
+		ptr += sent;
+		size -= (size_t) sent;
+	}
+	return 0;
+}
+
+
+static int
+recv_All(int socket, void* data, size_t size)
+{
+	char* ptr = (char*) data;
+	while (size > 0) {
+		ssize_t received = recv(socket, ptr, size, 0);
+		if (received == 0) return -ECONNRESET;
+		if (received < 0) {
+			if (errno == EINTR) continue;
+			return -errno;
+		}
+		ptr += received;
+		size -= (size_t) received;
+	}
+	return 0;
+}
+
+
+int
+connect_TranspositionService(VkTranspositionClient* client, const char* socketPath, uint64_t shmSize, int32_t* result)
+{
+	memset(client, 0, sizeof(VkTranspositionClient));
+	client->socket = -1;
+	client->shm = -1;
+	if (result != NULL) result[0] = 0;
+	int error = 0;
+
+	struct sockaddr_un address = { 0 };
+	address.sun_family = AF_UNIX;
+	if (strlen(socketPath) >= sizeof(address.sun_path)) return -ENAMETOOLONG;
+	strcpy(address.sun_path, socketPath);
+
+	client->socket = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (client->socket < 0) return -errno;
+	if (connect(client->socket, (struct sockaddr*) &address, sizeof(address)) != 0) goto fail;
+
+	client->shm = create_SharedMemory(shmSize);
+	if (client->shm < 0) goto fail;
+	client->shmData = mmap(NULL, shmSize, PROT_READ | PROT_WRITE, MAP_SHARED, client->shm, 0);
+	if (client->shmData == MAP_FAILED) {
+		client->shmData = NULL;
+		goto fail;
+	}
+	client->shmSize = shmSize;
+
+	//pass the shared memory file descriptor along with the attach message
+	VkTranspositionRequest request = { 0 };
+	request.magic   = VKT_SERVICE_MAGIC;
+	request.type    = VKT_MESSAGE_ATTACH;
+	request.shmSize = shmSize;
+
+	char control[CMSG_SPACE(sizeof(int))];
+	memset(control, 0, sizeof(control));
+	struct iovec iov = { &request, sizeof(request) };
+	struct msghdr message = { 0 };
+	message.msg_iov        = &iov;
+	message.msg_iovlen     = 1;
+	message.msg_control    = control;
+	message.msg_controllen = sizeof(control);
+	struct cmsghdr* cmsg = CMSG_FIRSTHDR(&message);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type  = SCM_RIGHTS;
+	cmsg->cmsg_len   = CMSG_LEN(sizeof(int));
+	memcpy(CMSG_DATA(cmsg), &client->shm, sizeof(int));
+	ssize_t sent = sendmsg(client->socket, &message, MSG_NOSIGNAL);
+	if (sent < 0) goto fail;
+	if (sent != (ssize_t) sizeof(request)) {
+		//the descriptor went with a partial message, the daemon drops the connection
+		errno = EIO;
+		goto fail;
+	}
+
+	VkTranspositionReply reply;
+	error = wait_TranspositionService(client, &reply);
+	if (error != 0) {
+		disconnect_TranspositionService(client);
+		return error;
+	}
+	if (result != NULL) result[0] = reply.result;
+	if (reply.result != 0) disconnect_TranspositionService(client);
+	return 0;
+
+fail:
+	error = -errno;
+	disconnect_TranspositionService(client);
+	return error;
+}
+
+
+int
+submit_TranspositionService(VkTranspositionClient* client,
+                            const uint32_t* size,
+                            uint32_t priority,
+                            uint64_t inputOffset,
+                            uint64_t outputOffset,
+                            uint32_t* requestID)
+{
+	VkTranspositionRequest request = { 0 };
+	request.magic        = VKT_SERVICE_MAGIC;
+	request.type         = VKT_MESSAGE_TRANSPOSE;
+	request.requestID    = ++client->nextRequestID;
+	request.priority     = priority;
+	request.size[0]      = size[0];
+	request.size[1]      = size[1];
+	request.size[2]      = size[2];
+	request.inputOffset  = inputOffset;
+	request.outputOffset = outputOffset;
+	if (requestID != NULL) requestID[0] = request.requestID;
+	return send_All(client->socket, &request, sizeof(request));
+}
+
+
+int
+wait_TranspositionService(VkTranspositionClient* client, VkTranspositionReply* reply)
+{
+	int error = recv_All(client->socket, reply, sizeof(VkTranspositionReply));
+	if (error != 0) return error;
+	return (reply->magic == VKT_SERVICE_MAGIC) ? 0 : -EPROTO;
+}
+
+
+int
+transpose_TranspositionService(VkTranspositionClient* client,
+                               const uint32_t* size,
+                               uint32_t priority,
+                               uint64_t inputOffset,
+                               uint64_t outputOffset,
+                               VkTranspositionReply* reply)
+{
+	//only valid when no other requests of this connection are in flight
+	int error = submit_TranspositionService(client, size, priority, inputOffset, outputOffset, NULL);
+	if (error != 0) return error;
+	return wait_TranspositionService(client, reply);
+}
+
+
+void
+disconnect_TranspositionService(VkTranspositionClient* client)
+{
+	if (client->shmData != NULL) munmap(client->shmData, client->shmSize);
+	if (client->shm >= 0) close(client->shm);
+	if (client->socket >= 0) close(client->socket);
+	client->shmData = NULL;
+	client->shm = -1;
+	client->socket = -1;
+}
@@ -0,0 +1,52 @@
+#ifndef VULKAN_TRANSPOSITION_CLIENT_H
+#define VULKAN_TRANSPOSITION_CLIENT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "VulkanTranspositionService.h"
+
+typedef struct {
+	int socket;          //connection to the daemon
+	int shm;             //shared memory file descriptor, attached to the daemon on connect
+	void* shmData;       //mapping of the shared memory in this process
+	uint64_t shmSize;
+	uint32_t nextRequestID;
+} VkTranspositionClient;//an example structure holding one client connection to the transposition daemon
+
+//all functions return 0 if the message exchange with the daemon succeeded and a negative errno on socket, shared memory
+//or protocol errors. Results of the daemon never go through the return value: the VkResult of a request is
+//VkTranspositionReply.result, the one of the attach is returned in *result
+
+//connect to the daemon listening on socketPath and share shmSize bytes of memory with it. *result (may be NULL) is the
+//VkResult of the attach, the client is disconnected if it is not 0
+int connect_TranspositionService(VkTranspositionClient* client, const char* socketPath, uint64_t shmSize, int32_t* result);
+
+//queue a transposition of the matrix at inputOffset of client->shmData into outputOffset, does not wait for completion
+int submit_TranspositionService(VkTranspositionClient* client,
+                                const uint32_t* size,
+                                uint32_t priority,
+                                uint64_t inputOffset,
+                                uint64_t outputOffset,
+                                uint32_t* requestID);
+
+//wait for the next reply. Replies of one connection may arrive out of submission order if priorities differ
+int wait_TranspositionService(VkTranspositionClient* client, VkTranspositionReply* reply);
+
+//submit and wait for one request, the VkResult of the daemon is reply->result
+int transpose_TranspositionService(VkTranspositionClient* client,
+                                   const uint32_t* size,
+                                   uint32_t priority,
+                                   uint64_t inputOffset,
+                                   uint64_t outputOffset,
+                                   VkTranspositionReply* reply);
+
+void disconnect_TranspositionService(VkTranspositionClient* client);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,481 @@
+#include "VulkanTransposition.h"
+
+
+//Adaptive CPU/GPU dispatcher: a cost model time = a + b * bytes per backend, element size and data location, fitted by weighted
+//least squares on relative error from a calibration at startup and refined with every executed request
+#define VKT_BACKEND_CPU 0
+#define VKT_BACKEND_GPU 1
+
+#define VKT_DATA_HOST   0//input and output in host memory
+#define VKT_DATA_DEVICE 1//input and output in device buffers of the dispatcher
+
+#define VKT_DISPATCH_CMD_DEVICE   0//transposition of the device input buffer
+#define VKT_DISPATCH_CMD_HOST     1//upload from staging, transposition, download to staging
+#define VKT_DISPATCH_CMD_DOWNLOAD 2//device input buffer to staging, for the CPU backend on device data
+#define VKT_DISPATCH_CMD_UPLOAD   3//staging to device output buffer, for the CPU backend on device data
+
+#define VKT_DISPATCH_CACHE_SIZE 16
+#define VKT_DISPATCH_EXPLORE    32//every 32nd request of a model runs on the backend predicted to be slower
+
+typedef struct {
+	//decayed sums of the samples (x - bytes, y - ms) with weight 1/y^2
+	double sw, swx, swy, swxx, swxy;
+	uint64_t samples;
+} VkCostModel;
+
+typedef struct {
+	uint32_t size;
+	uint32_t elementSize;
+	uint64_t lastUse;
+	VkApplication app;//transposition_swizzle.comp for this size and element size
+	uint32_t groupCount[3];
+	VkBuffer inputBuffer;
+	VkDeviceMemory inputBufferDeviceMemory;
+	VkBuffer outputBuffer;
+	VkDeviceMemory outputBufferDeviceMemory;
+	VkBuffer stagingBuffer;//host-visible, input followed by output
+	VkDeviceMemory stagingBufferDeviceMemory;
+	void* stagingData;
+	VkCommandBuffer commandBuffer[4];//VKT_DISPATCH_CMD_*, recorded once
+} VkDispatchEntry;
+
+typedef struct {
+	VkGPU* vkGPU;
+	VkCostModel model[2][2][2];//[backend][element size 4 or 8][data location]
+	double decay;              //weight of the history after every new sample
+	uint32_t verbose;          //log every decision
+	uint64_t requests;
+	uint64_t decisions[2];     //requests executed by every backend
+	uint64_t explored;
+	VkDispatchEntry cache[VKT_DISPATCH_CACHE_SIZE];
+} VkDispatcher;
+
+typedef struct {
+	uint32_t size;       //square matrix of size x size elements
+	uint32_t elementSize;//4 or 8 bytes
+	uint32_t location;   //VKT_DATA_*
+	const void* input;   //host data of VKT_DATA_HOST requests
+	void* output;
+} VkDispatchRequest;
+
+
+void
+transpose_Blocked_CPU(const void* input, void* output, uint32_t size, uint32_t elementSize)
+{
+	//cache blocked transposition of a square matrix of 4 or 8-byte elements
+	const uint32_t block = 32;
+	for (uint32_t jj = 0; jj < size; jj += block) {
+		for (uint32_t ii = 0; ii < size; ii += block) {
+			uint32_t jEnd = (jj + block < size) ? jj + block : size;
+			uint32_t iEnd = (ii + block < size) ? ii + block : size;
+			if (elementSize == 4) {
+				for (uint32_t j = jj; j < jEnd; j++)
+					for (uint32_t i = ii; i < iEnd; i++) ((uint32_t*) output)[(uint64_t) i * size + j] = ((const uint32_t*) input)[(uint64_t) j * size + i];
+			}
+			else {
+				for (uint32_t j = jj; j < jEnd; j++)
+					for (uint32_t i = ii; i < iEnd; i++) ((uint64_t*) output)[(uint64_t) i * size + j] = ((const uint64_t*) input)[(uint64_t) j * size + i];
+			}
+		}
+	}
+}
+
+
+void
+update_CostModel(VkCostModel* model, double decay, double bytes, double time)
+{
+	double w = 1.0 / (time * time + 1e-12);
+	model->sw   = decay * model->sw   + w;
+	model->swx  = decay * model->swx  + w * bytes;
+	model->swy  = decay * model->swy  + w * time;
+	model->swxx = decay * model->swxx + w * bytes * bytes;
+	model->swxy = decay * model->swxy + w * bytes * time;
+	model->samples++;
+}
+
+
+double
+predict_CostModel(const VkCostModel* model, double bytes, double* a, double* b)
+{
+	//returns the predicted time in ms, a negative value if the model has no samples
+	double intercept = 0, slope = 0;
+	if (model->samples == 0) return -1;
+	double det = model->sw * model->swxx - model->swx * model->swx;
+	if (model->samples > 1 && det > 1e-12 * model->sw * model->swxx) slope = (model->sw * model->swxy - model->swx * model->swy) / det;
+	if (slope < 0) slope = 0;
+	intercept = (model->swy - slope * model->swx) / model->sw;
+	if (intercept < 0) intercept = 0;
+	if (a != NULL) a[0] = intercept;
+	if (b != NULL) b[0] = slope;
+	return intercept + slope * bytes;
+}
+
+
+uint32_t
+get_DispatchTile(uint32_t size)
+{
+	//tile of transposition_swizzle.comp for this size, 0 if the GPU backend can not handle it
+	uint32_t tile = 32;
+	while (tile > 8 && size % tile != 0) tile /= 2;
+	return (size % tile == 0) ? tile : 0;
+}
+
+
+VkResult
+create_DispatchEntry(VkDispatcher* dispatcher, VkDispatchEntry* entry, uint32_t size, uint32_t elementSize)
+{
+	VkGPU* vkGPU = dispatcher->vkGPU;
+	VkResult res = VK_SUCCESS;
+	VkDeviceSize bufferSize = (VkDeviceSize) elementSize * size * size;
+	memset(entry, 0, sizeof(VkDispatchEntry));
+	entry->size = size;
+	entry->elementSize = elementSize;
+	res = allocate_Buffer_DeviceMemory(vkGPU->physicalDevice, vkGPU->device,
+                                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                           &vkGPU->physicalDeviceMemoryProperties, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                           bufferSize, &entry->inputBuffer, &entry->inputBufferDeviceMemory);
+	if (res != VK_SUCCESS) return res;
+	res = allocate_Buffer_DeviceMemory(vkGPU->physicalDevice, vkGPU->device,
+                                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                           &vkGPU->physicalDeviceMemoryProperties, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                           bufferSize, &entry->outputBuffer, &entry->outputBufferDeviceMemory);
+	if (res != VK_SUCCESS) return res;
+	res = allocate_Buffer_DeviceMemory(vkGPU->physicalDevice, vkGPU->device,
+                                           VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                           &vkGPU->physicalDeviceMemoryProperties, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                           2 * bufferSize, &entry->stagingBuffer, &entry->stagingBufferDeviceMemory);
+	if (res != VK_SUCCESS) return res;
+	res = vkMapMemory(vkGPU->device, entry->stagingBufferDeviceMemory, 0, 2 * bufferSize, 0, &entry->stagingData);
+	if (res != VK_SUCCESS) return res;
+
+	uint32_t tile = get_DispatchTile(size);
+	uint32_t elementWords = elementSize / 4;
+	uint32_t localSizeY = tile;
+	while (tile * localSizeY > vkGPU->physicalDeviceProperties.limits.maxComputeWorkGroupInvocations) localSizeY /= 2;
+	VkSwizzleSpecializationConstantsLayout specializationConstants = { { tile, localSizeY, 1 }, size, tile, elementWords, 2, get_SwizzleMask(tile, elementWords) };
+	res = create_SpecializedApp(vkGPU, &entry->app, &specializationConstants, 8, &entry->inputBuffer, &entry->outputBuffer, bufferSize, "transposition_swizzle.spv");
+	if (res != VK_SUCCESS) return res;
+	entry->groupCount[0] = size / tile;
+	entry->groupCount[1] = size / tile;
+	entry->groupCount[2] = 1;
+
+	VkCommandBufferAllocateInfo commandBufferAllocateInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+                                        (const void*) NULL,
+                                        (VkCommandPool) vkGPU->commandPool,
+                                        (VkCommandBufferLevel) VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+                                        (uint32_t) 4 };
+	res = vkAllocateCommandBuffers(vkGPU->device, &commandBufferAllocateInfo, entry->commandBuffer);
+	if (res != VK_SUCCESS) return res;
+	VkCommandBufferBeginInfo commandBufferBeginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+                                     (const void*) NULL,
+                                     (VkCommandBufferUsageFlags) 0,
+                                     (const VkCommandBufferInheritanceInfo*) NULL };
+	VkMemoryBarrier memoryBarrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER, (const void*) NULL, (VkAccessFlags) 0, (VkAccessFlags) 0 };
+	for (uint32_t k = 0; k < 4; k++) {
+		VkCommandBuffer commandBuffer = entry->commandBuffer[k];
+		res = vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo);
+		if (res != VK_SUCCESS) return res;
+		VkBufferCopy copyRegion = { 0, 0, bufferSize };
+		if (k == VKT_DISPATCH_CMD_HOST) {
+			vkCmdCopyBuffer(commandBuffer, entry->stagingBuffer, entry->inputBuffer, 1, &copyRegion);
+			memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &memoryBarrier, 0, NULL, 0, NULL);
+		}
+		if (k == VKT_DISPATCH_CMD_HOST || k == VKT_DISPATCH_CMD_DEVICE) {
+			vkCmdPushConstants(commandBuffer, entry->app.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(VkAppPushConstantsLayout), &entry->app.pushConstants);
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, entry->app.pipeline);
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, entry->app.pipelineLayout, 0, 1, &entry->app.descriptorSet, 0, NULL);
+			vkCmdDispatch(commandBuffer, entry->groupCount[0], entry->groupCount[1], entry->groupCount[2]);
+		}
+		if (k == VKT_DISPATCH_CMD_HOST) {
+			memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			memoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &memoryBarrier, 0, NULL, 0, NULL);
+			copyRegion.dstOffset = bufferSize;
+			vkCmdCopyBuffer(commandBuffer, entry->outputBuffer, entry->stagingBuffer, 1, &copyRegion);
+		}
+		if (k == VKT_DISPATCH_CMD_DOWNLOAD) vkCmdCopyBuffer(commandBuffer, entry->inputBuffer, entry->stagingBuffer, 1, &copyRegion);
+		if (k == VKT_DISPATCH_CMD_UPLOAD) {
+			copyRegion.srcOffset = bufferSize;
+			vkCmdCopyBuffer(commandBuffer, entry->stagingBuffer, entry->outputBuffer, 1, &copyRegion);
+		}
+		//make the results visible to the host and to the next command buffer
+		memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+		memoryBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+		                     VK_PIPELINE_STAGE_HOST_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &memoryBarrier, 0, NULL, 0, NULL);
+		res = vkEndCommandBuffer(commandBuffer);
+		if (res != VK_SUCCESS) return res;
+	}
+	return res;
+}
+
+
+void
+delete_DispatchEntry(VkDispatcher* dispatcher, VkDispatchEntry* entry)
+{
+	VkGPU* vkGPU = dispatcher->vkGPU;
+	if (entry->commandBuffer[0] != VK_NULL_HANDLE) vkFreeCommandBuffers(vkGPU->device, vkGPU->commandPool, 4, entry->commandBuffer);
+	if (entry->app.pipeline != VK_NULL_HANDLE) deleteApp(vkGPU, &entry->app);
+	if (entry->stagingData != NULL) vkUnmapMemory(vkGPU->device, entry->stagingBufferDeviceMemory);
+	vkDestroyBuffer(vkGPU->device, entry->stagingBuffer, NULL);
+	vkFreeMemory(vkGPU->device, entry->stagingBufferDeviceMemory, NULL);
+	vkDestroyBuffer(vkGPU->device, entry->inputBuffer, NULL);
+	vkFreeMemory(vkGPU->device, entry->inputBufferDeviceMemory, NULL);
+	vkDestroyBuffer(vkGPU->device, entry->outputBuffer, NULL);
+	vkFreeMemory(vkGPU->device, entry->outputBufferDeviceMemory, NULL);
+	memset(entry, 0, sizeof(VkDispatchEntry));
+}
+
+
+VkResult
+get_DispatchEntry(VkDispatcher* dispatcher, uint32_t size, uint32_t elementSize, VkDispatchEntry** entry)
+{
+	//buffers, pipeline and command buffers of a size and element size, least recently used entry is replaced
+	uint32_t victim = 0;
+	for (uint32_t i = 0; i < VKT_DISPATCH_CACHE_SIZE; i++) {
+		VkDispatchEntry* candidate = &dispatcher->cache[i];
+		if (candidate->size == size && candidate->elementSize == elementSize) {
+			candidate->lastUse = dispatcher->requests;
+			entry[0] = candidate;
+			return VK_SUCCESS;
+		}
+		if (candidate->size == 0 || (dispatcher->cache[victim].size != 0 && candidate->lastUse < dispatcher->cache[victim].lastUse)) victim = i;
+	}
+	entry[0] = &dispatcher->cache[victim];
+	delete_DispatchEntry(dispatcher, entry[0]);
+	VkResult res = create_DispatchEntry(dispatcher, entry[0], size, elementSize);
+	if (res != VK_SUCCESS) delete_DispatchEntry(dispatcher, entry[0]);
+	entry[0]->lastUse = dispatcher->requests;
+	return res;
+}
+
+
+VkResult
+submit_DispatchCommand(VkDispatcher* dispatcher, VkCommandBuffer commandBuffer)
+{
+	VkGPU* vkGPU = dispatcher->vkGPU;
+	VkSubmitInfo submitInfo = { VK_STRUCTURE_TYPE_SUBMIT_INFO,
+                         (const void*) NULL,
+                         (uint32_t) 0,
+                         (const VkSemaphore*) NULL,
+                         (const VkPipelineStageFlags*) NULL,
+                         (uint32_t) 1,
+                         (const VkCommandBuffer*) &commandBuffer,
+                         (uint32_t) 0,
+                         (const VkSemaphore*) NULL };
+	VkResult res = vkQueueSubmit(vkGPU->queue, 1, &submitInfo, vkGPU->fence);
+	if (res != VK_SUCCESS) return res;
+	res = vkWaitForFences(vkGPU->device, 1, &vkGPU->fence, VK_TRUE, 100000000000);
+	if (res != VK_SUCCESS) return res;
+	return vkResetFences(vkGPU->device, 1, &vkGPU->fence);
+}
+
+
+VkResult
+execute_Dispatch(VkDispatcher* dispatcher, const VkDispatchRequest* request, uint32_t backend, double* time)
+{
+	//run the request on the backend and return its wall time. Device data lives in the buffers of the cache entry
+	VkDispatchEntry* entry = NULL;
+	VkResult res = VK_SUCCESS;
+	VkDeviceSize bufferSize = (VkDeviceSize) request->elementSize * request->size * request->size;
+	if (backend == VKT_BACKEND_GPU || request->location == VKT_DATA_DEVICE) {
+		res = get_DispatchEntry(dispatcher, request->size, request->elementSize, &entry);
+		if (res != VK_SUCCESS) return res;
+	}
+	double t = get_TimeMs();
+	if (backend == VKT_BACKEND_CPU && request->location == VKT_DATA_HOST) {
+		transpose_Blocked_CPU(request->input, request->output, request->size, request->elementSize);
+	}
+	else if (backend == VKT_BACKEND_CPU) {
+		res = submit_DispatchCommand(dispatcher, entry->commandBuffer[VKT_DISPATCH_CMD_DOWNLOAD]);
+		if (res != VK_SUCCESS) return res;
+		transpose_Blocked_CPU(entry->stagingData, (char*) entry->stagingData + bufferSize, request->size, request->elementSize);
+		res = submit_DispatchCommand(dispatcher, entry->commandBuffer[VKT_DISPATCH_CMD_UPLOAD]);
+	}
+	else if (request->location == VKT_DATA_HOST) {
+		memcpy(entry->stagingData, request->input, bufferSize);
+		res = submit_DispatchCommand(dispatcher, entry->commandBuffer[VKT_DISPATCH_CMD_HOST]);
+		if (res != VK_SUCCESS) return res;
+		memcpy(request->output, (char*) entry->stagingData + bufferSize, bufferSize);
+	}
+	else {
+		res = submit_DispatchCommand(dispatcher, entry->commandBuffer[VKT_DISPATCH_CMD_DEVICE]);
+	}
+	time[0] = get_TimeMs() - t;
+	return res;
+}
+
+
+VkResult
+run_Dispatch(VkDispatcher* dispatcher, const VkDispatchRequest* request, uint32_t* backend)
+{
+	//route the request to the backend with the lower predicted time and refine the model of that backend with the measured time
+	double bytes = (double) request->elementSize * request->size * request->size;
+	uint32_t dtype = (request->elementSize == 8);
+	double predicted[2];
+	for (uint32_t b = 0; b < 2; b++) predicted[b] = predict_CostModel(&dispatcher->model[b][dtype][request->location], bytes, NULL, NULL);
+	uint32_t choice = VKT_BACKEND_CPU;
+	uint32_t explore = 0;
+	if (get_DispatchTile(request->size) != 0) {
+		//a backend without samples is tried first
+		if (predicted[VKT_BACKEND_GPU] < 0) choice = VKT_BACKEND_GPU;
+		else if (predicted[VKT_BACKEND_CPU] >= 0) choice = (predicted[VKT_BACKEND_GPU] < predicted[VKT_BACKEND_CPU]) ? VKT_BACKEND_GPU : VKT_BACKEND_CPU;
+		//keep the model of the slower backend up to date
+		if (dispatcher->requests % VKT_DISPATCH_EXPLORE == VKT_DISPATCH_EXPLORE - 1) {
+			choice = 1 - choice;
+			explore = 1;
+		}
+	}
+	dispatcher->requests++;
+	double time = 0;
+	VkResult res = execute_Dispatch(dispatcher, request, choice, &time);
+	if (res != VK_SUCCESS) return res;
+	update_CostModel(&dispatcher->model[choice][dtype][request->location], dispatcher->decay, bytes, time);
+	dispatcher->decisions[choice]++;
+	dispatcher->explored += explore;
+	if (dispatcher->verbose)
+		printf("Request %llu: %dx%d, %d-byte elements, %s data, predicted CPU %.3f ms, GPU %.3f ms -> %s%s, %.3f ms\n",
+		       (unsigned long long) dispatcher->requests, request->size, request->size, request->elementSize,
+		       (request->location == VKT_DATA_HOST) ? "host" : "device", predicted[0], predicted[1],
+		       (choice == VKT_BACKEND_GPU) ? "GPU" : "CPU", explore ? " (explore)" : "", time);
+	if (backend != NULL) backend[0] = choice;
+	return res;
+}
+
+
+VkResult
+calibrate_Dispatcher(VkDispatcher* dispatcher, const uint32_t* sizes, uint32_t numSizes, void* hostInput, void* hostOutput)
+{
+	//measure both backends for every size, element size and data location. The first run of every combination is a warm-up
+	VkResult res = VK_SUCCESS;
+	for (uint32_t s = 0; s < numSizes; s++) {
+		for (uint32_t dtype = 0; dtype < 2; dtype++) {
+			for (uint32_t location = 0; location < 2; location++) {
+				VkDispatchRequest request = { sizes[s], 4u << dtype, location, hostInput, hostOutput };
+				double bytes = (double) request.elementSize * request.size * request.size;
+				for (uint32_t backend = 0; backend < 2; backend++) {
+					if (backend == VKT_BACKEND_GPU && get_DispatchTile(request.size) == 0) continue;
+					for (uint32_t run = 0; run < 4; run++) {
+						double time = 0;
+						res = execute_Dispatch(dispatcher, &request, backend, &time);
+						if (res != VK_SUCCESS) return res;
+						if (run > 0) update_CostModel(&dispatcher->model[backend][dtype][location], dispatcher->decay, bytes, time);
+					}
+				}
+			}
+		}
+	}
+	return res;
+}
+
+
+void
+delete_Dispatcher(VkDispatcher* dispatcher)
+{
+	for (uint32_t i = 0; i < VKT_DISPATCH_CACHE_SIZE; i++) delete_DispatchEntry(dispatcher, &dispatcher->cache[i]);
+}
+
+
+VkResult
+Example_VulkanDispatch(uint32_t deviceID,
+                       uint32_t requests,
+                       uint32_t verbose)
+{
+	//calibrate the dispatcher, print the fitted models and crossovers, then run a mixed-size workload with the CPU only,
+	//the GPU only and the adaptive policy
+	VkGPU vkGPU = { 0 };
+	vkGPU.device_id = deviceID;
+	VkResult res = VK_SUCCESS;
+	res = create_VkGPU(&vkGPU);
+	if (res != VK_SUCCESS) return res;
+
+	const uint32_t sizes[] = { 16, 32, 64, 128, 256, 512, 1024, 2048 };
+	const uint32_t numSizes = sizeof(sizes) / sizeof(sizes[0]);
+	uint64_t maxBytes = 8ull * sizes[numSizes - 1] * sizes[numSizes - 1];
+	uint8_t* hostInput  = (uint8_t*) malloc(maxBytes);
+	uint8_t* hostOutput = (uint8_t*) malloc(maxBytes);
+	for (uint64_t i = 0; i < maxBytes / 4; i++) ((uint32_t*) hostInput)[i] = (uint32_t) i;
+
+	VkDispatcher dispatcher;
+	memset(&dispatcher, 0, sizeof(VkDispatcher));
+	dispatcher.vkGPU = &vkGPU;
+	dispatcher.decay = 0.98;
+	double t = get_TimeMs();
+	res = calibrate_Dispatcher(&dispatcher, sizes, numSizes, hostInput, hostOutput);
+	if (res != VK_SUCCESS) {
+		printf("Dispatcher calibration failed, error code: %d\n", res);
+		free(hostInput);
+		free(hostOutput);
+		delete_Dispatcher(&dispatcher);
+		delete_VkGPU(&vkGPU);
+		return res;
+	}
+	printf("Calibration: %.3f ms\n", get_TimeMs() - t);
+	const char* locations[2] = { "host", "device" };
+	for (uint32_t dtype = 0; dtype < 2; dtype++) {
+		for (uint32_t location = 0; location < 2; location++) {
+			double a[2], b[2];
+			for (uint32_t backend = 0; backend < 2; backend++) predict_CostModel(&dispatcher.model[backend][dtype][location], 0, &a[backend], &b[backend]);
+			printf("%d-byte elements, %-6s data: CPU %.4f ms + %.3f ms/MB, GPU %.4f ms + %.3f ms/MB, ",
+			       4 << dtype, locations[location], a[0], b[0] * 1024 * 1024, a[1], b[1] * 1024 * 1024);
+			if (b[0] > b[1] && a[1] > a[0]) printf("GPU from %.1f KB\n", (a[1] - a[0]) / (b[0] - b[1]) / 1024);
+			else printf("%s for all sizes\n", (a[1] + b[1] < a[0] + b[0]) ? "GPU" : "CPU");
+		}
+	}
+
+	//mixed workload: mostly small matrices, a few large ones
+	VkDispatchRequest* workload = (VkDispatchRequest*) malloc(sizeof(VkDispatchRequest) * requests);
+	uint32_t seed = 12345;
+	for (uint32_t i = 0; i < requests; i++) {
+		seed = seed * 1664525u + 1013904223u;
+		uint32_t s = (seed >> 8) % 100;
+		workload[i].size = sizes[(s < 60) ? s % 4 : (s < 90) ? 4 + s % 2 : 6 + s % 2];
+		workload[i].elementSize = 4u << ((seed >> 20) & 1);
+		workload[i].location = (seed >> 24) & 1;
+		workload[i].input = hostInput;
+		workload[i].output = hostOutput;
+	}
+	const char* policies[3] = { "CPU only", "GPU only", "adaptive" };
+	for (uint32_t policy = 0; policy < 3 && res == VK_SUCCESS; policy++) {
+		uint32_t passed = 1;
+		t = 0;
+		for (uint32_t i = 0; i < requests && res == VK_SUCCESS; i++) {
+			uint32_t backend = policy;
+			double time = get_TimeMs();
+			if (policy == 2) res = run_Dispatch(&dispatcher, &workload[i], &backend);
+			else {
+				double executeTime = 0;
+				if (backend == VKT_BACKEND_GPU && get_DispatchTile(workload[i].size) == 0) backend = VKT_BACKEND_CPU;
+				res = execute_Dispatch(&dispatcher, &workload[i], backend, &executeTime);
+			}
+			t += get_TimeMs() - time;
+			//results of host requests are checked outside of the measured time
+			if (res == VK_SUCCESS && workload[i].location == VKT_DATA_HOST) {
+				uint64_t n = workload[i].size;
+				uint32_t elementSize = workload[i].elementSize;
+				for (uint64_t j = 0; j < n && passed; j++) {
+					for (uint64_t k = 0; k < n && passed; k++) {
+						passed = (memcmp(hostOutput + (k * n + j) * elementSize, hostInput + (j * n + k) * elementSize, elementSize) == 0);
+					}
+				}
+			}
+		}
+		if (res != VK_SUCCESS) {
+			printf("Dispatch failed, error code: %d\n", res);
+			break;
+		}
+		printf("%-8s: %d requests in %.3f ms (%.4f ms per request), verification %s\n", policies[policy], requests, t, t / requests, passed ? "passed" : "FAILED");
+		if (!passed) res = VK_ERROR_FORMAT_NOT_SUPPORTED;
+	}
+	printf("Adaptive decisions: %llu CPU, %llu GPU, %llu exploring\n",
+	       (unsigned long long) dispatcher.decisions[VKT_BACKEND_CPU], (unsigned long long) dispatcher.decisions[VKT_BACKEND_GPU], (unsigned long long) dispatcher.explored);
+
+	free(workload);
+	free(hostInput);
+	free(hostOutput);
+	delete_Dispatcher(&dispatcher);
+	delete_VkGPU(&vkGPU);
+	return res;
+}
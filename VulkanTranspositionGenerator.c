@@ -0,0 +1,222 @@
+#include "VulkanTransposition.h"
+
+
+//Synthetic data generators (generator.comp): fill device buffers in place with a closed-form pattern of the element index
+//and a seed, and validate buffers against the same pattern, directly or transposed, without any host data
+typedef struct {
+	uint32_t localSize[3];
+	uint32_t elementSize;//bytes per element: 1, 2, 4 or 8
+	uint32_t dtype;      //VKT_DTYPE_*, floats are 4 or 8 bytes
+	uint32_t pattern;    //VKT_PATTERN_*
+	uint32_t width;      //elements per row of the generated matrix
+	uint32_t height;     //rows of the generated matrix
+	uint32_t validate;   //0 - generate, 1 - validate
+	uint32_t transposed; //validate the width x height transposition of the generated matrix
+} VkGeneratorSpecializationConstantsLayout;//specialization constants of generator.comp
+
+
+VkResult
+run_Generator(VkGPU* vkGPU,
+              VkBuffer* buffer,
+              VkDeviceSize bufferSize,
+              VkGeneratorSpecializationConstantsLayout* constants,
+              uint32_t seed,
+              uint32_t* mismatches,
+              uint32_t* firstMismatch,
+              double* time)
+{
+	//one generation or validation pass over buffer. mismatches and firstMismatch (word index, 0xFFFFFFFF - none) are
+	//only written by the validation. time - ms of the pass
+	VkResult res = VK_SUCCESS;
+	uint32_t result[2] = { 0, 0xFFFFFFFF };
+	VkBuffer resultBuffer = { 0 };
+	VkDeviceMemory resultBufferDeviceMemory = { 0 };
+	VkApplication app = { 0 };
+	constants->localSize[0] = 256;
+	constants->localSize[1] = 1;
+	constants->localSize[2] = 1;
+	if (constants->validate) {
+		res = allocate_Buffer_DeviceMemory(vkGPU->physicalDevice, vkGPU->device,
+		                                   VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		                                   &vkGPU->physicalDeviceMemoryProperties, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		                                   sizeof(result), &resultBuffer, &resultBufferDeviceMemory);
+		if (res == VK_SUCCESS)
+			res = upload_Data(vkGPU->physicalDevice, vkGPU->device, result, &vkGPU->physicalDeviceMemoryProperties,
+			                  vkGPU->commandPool, vkGPU->queue, &vkGPU->fence, &resultBuffer, sizeof(result));
+	}
+	if (res == VK_SUCCESS) {
+		//generation binds the data buffer twice
+		VkBuffer*    appBuffer[2]   = { buffer, constants->validate ? &resultBuffer : buffer };
+		VkDeviceSize bufferSizes[2] = { bufferSize, constants->validate ? sizeof(result) : bufferSize };
+		VkSpecializationMapEntry specializationMapEntries[10] = { 0 };
+		for (uint32_t kk = 0; kk < 10; kk++) {
+			specializationMapEntries[kk].constantID = kk + 1;
+			specializationMapEntries[kk].size = sizeof(uint32_t);
+			specializationMapEntries[kk].offset = kk * sizeof(uint32_t);
+		}
+		VkSpecializationInfo specializationInfo = { (uint32_t) 10,
+                                                            (const VkSpecializationMapEntry*) specializationMapEntries,
+                                                            (size_t) sizeof(VkGeneratorSpecializationConstantsLayout),
+                                                            (const void*) constants };
+		char shaderPath[256];
+		sprintf(shaderPath, "%sgenerator.spv", SHADER_DIR);
+		res = create_ComputeApp(vkGPU->device, 2, appBuffer, bufferSizes, &specializationInfo, &app.descriptorPool, &app.descriptorSetLayout,
+		                        &app.descriptorSet, (const char*) shaderPath, &app.pipelineLayout, &app.pipeline);
+	}
+	if (res == VK_SUCCESS) {
+		//one word per thread, the grid wraps at 65535 workgroups per dimension
+		uint64_t elements = (uint64_t) constants->width * constants->height;
+		uint64_t words = elements * constants->elementSize / 4;
+		uint64_t groups = (words + 255) / 256;
+		uint32_t groupCount[3] = { (uint32_t) ((groups < 65535) ? groups : 65535), 1, 1 };
+		groupCount[1] = (uint32_t) ((groups + groupCount[0] - 1) / groupCount[0]);
+		VkAppPushConstantsLayout pushConstants = { seed };
+		double t = get_TimeMs(), time_dispatch = 0;
+		res = run_AppPushConstants(vkGPU->device, vkGPU->commandPool, app.pipeline, app.pipelineLayout, &app.descriptorSet, groupCount,
+		                           vkGPU->queue, &vkGPU->fence, 1, &pushConstants, &time_dispatch);
+		time[0] = get_TimeMs() - t;
+	}
+	if (res == VK_SUCCESS && constants->validate) {
+		res = download_Data(vkGPU->physicalDevice, vkGPU->device, vkGPU->commandPool, &vkGPU->physicalDeviceMemoryProperties,
+		                    vkGPU->queue, &vkGPU->fence, result, &resultBuffer, sizeof(result));
+		mismatches[0] = result[0];
+		firstMismatch[0] = result[1];
+	}
+	if (app.pipeline != VK_NULL_HANDLE) deleteApp(vkGPU, &app);
+	vkDestroyBuffer(vkGPU->device, resultBuffer, NULL);
+	vkFreeMemory(vkGPU->device, resultBufferDeviceMemory, NULL);
+	return res;
+}
+
+
+VkResult
+generate_Data(VkGPU* vkGPU, VkBuffer* buffer, VkDeviceSize bufferSize, uint32_t elementSize, uint32_t dtype, uint32_t pattern,
+              uint32_t width, uint32_t height, uint32_t seed, double* time)
+{
+	//fill the width x height matrix in buffer with the pattern
+	VkGeneratorSpecializationConstantsLayout constants = { { 0 }, elementSize, dtype, pattern, width, height, 0, 0 };
+	return run_Generator(vkGPU, buffer, bufferSize, &constants, seed, NULL, NULL, time);
+}
+
+
+VkResult
+validate_Data(VkGPU* vkGPU, VkBuffer* buffer, VkDeviceSize bufferSize, uint32_t elementSize, uint32_t dtype, uint32_t pattern,
+              uint32_t width, uint32_t height, uint32_t transposed, uint32_t seed, uint32_t* mismatches, uint32_t* firstMismatch, double* time)
+{
+	//compare buffer with the pattern of the width x height matrix, or with its transposition
+	VkGeneratorSpecializationConstantsLayout constants = { { 0 }, elementSize, dtype, pattern, width, height, 1, transposed };
+	return run_Generator(vkGPU, buffer, bufferSize, &constants, seed, mismatches, firstMismatch, time);
+}
+
+
+VkResult
+Example_VulkanGenerate(uint32_t deviceID,
+                       uint32_t coalescedMemory,
+                       uint32_t size)
+{
+	//every type and pattern of the generators on a size x size matrix: generation and validation speed, a validator
+	//self-test with one corrupted word, and a transposition of 4-byte types validated on the device
+	VkGPU vkGPU = { 0 };
+	vkGPU.device_id = deviceID;
+	VkResult res = create_VkGPU(&vkGPU);
+	if (res != VK_SUCCESS) return res;
+	coalescedMemory = get_CoalescedMemory(&vkGPU, coalescedMemory);
+	uint32_t tile = coalescedMemory / sizeof(float);
+	if (size % tile != 0) {
+		printf("System size %d is not a multiple of the tile size %d\n", size, tile);
+		delete_VkGPU(&vkGPU);
+		return VK_ERROR_FORMAT_NOT_SUPPORTED;
+	}
+	VkDeviceSize bufferSize = 8 * (VkDeviceSize) size * size;
+	VkBuffer buffer[2] = { 0 };
+	VkDeviceMemory bufferDeviceMemory[2] = { 0 };
+	for (uint32_t k = 0; k < 2 && res == VK_SUCCESS; k++) {
+		res = allocate_Buffer_DeviceMemory(vkGPU.physicalDevice, vkGPU.device,
+		                                   VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		                                   &vkGPU.physicalDeviceMemoryProperties, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		                                   bufferSize, &buffer[k], &bufferDeviceMemory[k]);
+	}
+	if (res != VK_SUCCESS) {
+		printf("Buffer allocation failed, error code: %d\n", res);
+		delete_VkGPU(&vkGPU);
+		return res;
+	}
+
+	static const uint32_t types[6][2] = { { 1, VKT_DTYPE_UINT }, { 2, VKT_DTYPE_UINT }, { 4, VKT_DTYPE_UINT }, { 4, VKT_DTYPE_FLOAT }, { 8, VKT_DTYPE_UINT }, { 8, VKT_DTYPE_FLOAT } };
+	static const char* typeNames[6] = { "uint8", "uint16", "uint32", "float32", "uint64", "float64" };
+	static const char* patternNames[3] = { "index", "random", "structured" };
+	uint32_t seed = 0x2545F491;
+	uint32_t failed = 0;
+	printf("System size: %dx%d\n\n%-8s %-11s %12s %14s %11s\n", size, size, "type", "pattern", "generate GB/s", "validate GB/s", "mismatches");
+	for (uint32_t type = 0; type < 6 && res == VK_SUCCESS; type++) {
+		for (uint32_t pattern = 0; pattern < 3 && res == VK_SUCCESS; pattern++) {
+			double time_generate = 0, time_validate = 0;
+			uint32_t mismatches = 0, firstMismatch = 0;
+			uint32_t elementSize = types[type][0];
+			res = generate_Data(&vkGPU, &buffer[0], bufferSize, elementSize, types[type][1], pattern, size, size, seed, &time_generate);
+			if (res == VK_SUCCESS)
+				res = validate_Data(&vkGPU, &buffer[0], bufferSize, elementSize, types[type][1], pattern, size, size, 0, seed, &mismatches, &firstMismatch, &time_validate);
+			if (res != VK_SUCCESS) break;
+			double gb = (double) elementSize * size * size / 1024.0 / 1024.0 / 1024.0;
+			printf("%-8s %-11s %12.2f %14.2f %11d\n", typeNames[type], patternNames[pattern], gb / time_generate * 1000, gb / time_validate * 1000, mismatches);
+			failed += (mismatches != 0);
+		}
+	}
+
+	//self-test: word 0 of the uint32 index pattern is 0, the validator has to find exactly that word after it is overwritten
+	if (res == VK_SUCCESS) {
+		double time_generate = 0, time_validate = 0;
+		uint32_t mismatches = 0, firstMismatch = 0, corrupted = 0xFFFFFFFF;
+		res = generate_Data(&vkGPU, &buffer[0], bufferSize, 4, VKT_DTYPE_UINT, VKT_PATTERN_INDEX, size, size, seed, &time_generate);
+		if (res == VK_SUCCESS)
+			res = upload_Data(vkGPU.physicalDevice, vkGPU.device, &corrupted, &vkGPU.physicalDeviceMemoryProperties, vkGPU.commandPool, vkGPU.queue, &vkGPU.fence, &buffer[0], sizeof(corrupted));
+		if (res == VK_SUCCESS)
+			res = validate_Data(&vkGPU, &buffer[0], bufferSize, 4, VKT_DTYPE_UINT, VKT_PATTERN_INDEX, size, size, 0, seed, &mismatches, &firstMismatch, &time_validate);
+		if (res == VK_SUCCESS) {
+			printf("\nValidator self-test (word 0 corrupted): %u mismatches, first at word %u - %s\n", mismatches, firstMismatch,
+			       (mismatches == 1 && firstMismatch == 0) ? "passed" : "FAILED");
+			failed += !(mismatches == 1 && firstMismatch == 0);
+		}
+	}
+
+	//transposition of generated 4-byte data, validated against the transposed pattern
+	VkApplication app = { 0 };
+	if (res == VK_SUCCESS) {
+		char shaderPath[256];
+		sprintf(shaderPath, "%stransposition_no_bank_conflicts.spv", SHADER_DIR);
+		VkBuffer*    appBuffer[2]   = { &buffer[0], &buffer[1] };
+		VkDeviceSize bufferSizes[2] = { bufferSize / 2, bufferSize / 2 };
+		uint32_t     systemSize[3]  = { size, size, 1 };
+		res = create_App(vkGPU.device, &app.specializationConstants, coalescedMemory, appBuffer, bufferSizes, systemSize,
+		                 &app.descriptorPool, &app.descriptorSetLayout, &app.descriptorSet, (const char*) shaderPath, &app.pipelineLayout, &app.pipeline);
+	}
+	printf("\n%-8s %-11s %14s %11s\n", "type", "pattern", "transpose, ms", "mismatches");
+	for (uint32_t type = 2; type < 4 && res == VK_SUCCESS; type++) {
+		for (uint32_t pattern = 0; pattern < 3 && res == VK_SUCCESS; pattern++) {
+			double time_generate = 0, time_transpose = 0, time_validate = 0;
+			uint32_t mismatches = 0, firstMismatch = 0;
+			uint32_t groupCount[3] = { size / tile, size / tile, 1 };
+			res = generate_Data(&vkGPU, &buffer[0], bufferSize, 4, types[type][1], pattern, size, size, seed, &time_generate);
+			if (res == VK_SUCCESS)
+				res = run_App(vkGPU.device, vkGPU.commandPool, app.pipeline, app.pipelineLayout, &app.descriptorSet, groupCount, vkGPU.queue, &vkGPU.fence, 1, &time_transpose);
+			if (res == VK_SUCCESS)
+				res = validate_Data(&vkGPU, &buffer[1], bufferSize, 4, types[type][1], pattern, size, size, 1, seed, &mismatches, &firstMismatch, &time_validate);
+			if (res != VK_SUCCESS) break;
+			printf("%-8s %-11s %14.3f %11d\n", typeNames[type], patternNames[pattern], time_transpose, mismatches);
+			failed += (mismatches != 0);
+		}
+	}
+	if (res == VK_SUCCESS) {
+		printf("\nValidation %s\n", failed ? "FAILED" : "passed");
+		if (failed) res = VK_ERROR_FORMAT_NOT_SUPPORTED;
+	}
+	else printf("Generator run failed, error code: %d\n", res);
+
+	if (app.pipeline != VK_NULL_HANDLE) deleteApp(&vkGPU, &app);
+	for (uint32_t k = 0; k < 2; k++) {
+		vkDestroyBuffer(vkGPU.device, buffer[k], NULL);
+		vkFreeMemory(vkGPU.device, bufferDeviceMemory[k], NULL);
+	}
+	delete_VkGPU(&vkGPU);
+	return res;
+}
@@ -0,0 +1,352 @@
+#include "VulkanTransposition.h"
+
+
+//Dependency graph executor: every op declares the buffer ranges it reads and writes. record_Graph places an op one level
+//after the latest op it conflicts with (read after write, write after read or write after write on overlapping ranges),
+//records the independent ops of a level back to back and puts one barrier between consecutive levels only
+
+
+int32_t
+add_GraphDispatch(VkGraph* graph,
+                  VkApplication* app,
+                  const uint32_t* groupCount,
+                  const VkBufferRange* reads,
+                  uint32_t readCount,
+                  const VkBufferRange* writes,
+                  uint32_t writeCount)
+{
+	//returns the index of the op, -1 if the graph is full
+	if (graph->count == VKT_GRAPH_MAX_OPS || readCount > VKT_GRAPH_MAX_RANGES || writeCount > VKT_GRAPH_MAX_RANGES) return -1;
+	VkGraphOp* op = &graph->op[graph->count];
+	memset(op, 0, sizeof(VkGraphOp));
+	op->type = VKT_GRAPH_OP_DISPATCH;
+	op->app = app;
+	memcpy(op->groupCount, groupCount, sizeof(op->groupCount));
+	memcpy(op->reads, reads, sizeof(VkBufferRange) * readCount);
+	op->readCount = readCount;
+	memcpy(op->writes, writes, sizeof(VkBufferRange) * writeCount);
+	op->writeCount = writeCount;
+	return graph->count++;
+}
+
+
+int32_t
+add_GraphCopy(VkGraph* graph,
+              VkBuffer srcBuffer,
+              VkDeviceSize srcOffset,
+              VkBuffer dstBuffer,
+              VkDeviceSize dstOffset,
+              VkDeviceSize size)
+{
+	//ranges of a copy follow from its region
+	if (graph->count == VKT_GRAPH_MAX_OPS) return -1;
+	VkGraphOp* op = &graph->op[graph->count];
+	memset(op, 0, sizeof(VkGraphOp));
+	op->type = VKT_GRAPH_OP_COPY;
+	op->srcBuffer = srcBuffer;
+	op->dstBuffer = dstBuffer;
+	op->region.srcOffset = srcOffset;
+	op->region.dstOffset = dstOffset;
+	op->region.size = size;
+	op->reads[0].buffer = srcBuffer;
+	op->reads[0].offset = srcOffset;
+	op->reads[0].size = size;
+	op->readCount = 1;
+	op->writes[0].buffer = dstBuffer;
+	op->writes[0].offset = dstOffset;
+	op->writes[0].size = size;
+	op->writeCount = 1;
+	return graph->count++;
+}
+
+
+uint32_t
+check_RangeOverlap(const VkBufferRange* a, const VkBufferRange* b)
+{
+	if (a->buffer != b->buffer) return 0;
+	uint32_t aBeforeB = (a->size != VK_WHOLE_SIZE) && (a->offset + a->size <= b->offset);
+	uint32_t bBeforeA = (b->size != VK_WHOLE_SIZE) && (b->offset + b->size <= a->offset);
+	return !aBeforeB && !bBeforeA;
+}
+
+
+uint32_t
+check_GraphDependency(const VkGraphOp* earlier, const VkGraphOp* later)
+{
+	//1 if later has to wait for earlier
+	for (uint32_t w = 0; w < earlier->writeCount; w++) {
+		for (uint32_t r = 0; r < later->readCount; r++)
+			if (check_RangeOverlap(&earlier->writes[w], &later->reads[r])) return 1;
+		for (uint32_t r = 0; r < later->writeCount; r++)
+			if (check_RangeOverlap(&earlier->writes[w], &later->writes[r])) return 1;
+	}
+	for (uint32_t r = 0; r < earlier->readCount; r++) {
+		for (uint32_t w = 0; w < later->writeCount; w++)
+			if (check_RangeOverlap(&earlier->reads[r], &later->writes[w])) return 1;
+	}
+	return 0;
+}
+
+
+void
+record_GraphOp(VkCommandBuffer commandBuffer, const VkGraphOp* op)
+{
+	if (op->type == VKT_GRAPH_OP_COPY) {
+		vkCmdCopyBuffer(commandBuffer, op->srcBuffer, op->dstBuffer, 1, &op->region);
+		return;
+	}
+	vkCmdPushConstants(commandBuffer, op->app->pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(VkAppPushConstantsLayout), &op->app->pushConstants);
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, op->app->pipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, op->app->pipelineLayout, 0, 1, &op->app->descriptorSet, 0, NULL);
+	vkCmdDispatch(commandBuffer, op->groupCount[0], op->groupCount[1], op->groupCount[2]);
+}
+
+
+void
+get_GraphOpAccess(const VkGraphOp* op, VkPipelineStageFlags* stage, VkAccessFlags* readAccess, VkAccessFlags* writeAccess)
+{
+	stage[0]       = (op->type == VKT_GRAPH_OP_COPY) ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+	readAccess[0]  = (op->type == VKT_GRAPH_OP_COPY) ? VK_ACCESS_TRANSFER_READ_BIT : VK_ACCESS_SHADER_READ_BIT;
+	writeAccess[0] = (op->type == VKT_GRAPH_OP_COPY) ? VK_ACCESS_TRANSFER_WRITE_BIT : VK_ACCESS_SHADER_WRITE_BIT;
+}
+
+
+void
+record_Graph(VkGraph* graph, VkCommandBuffer commandBuffer)
+{
+	//schedule the ops into levels and record them with one barrier between consecutive levels
+	graph->levels = 0;
+	graph->barriers = 0;
+	for (uint32_t i = 0; i < graph->count; i++) {
+		uint32_t level = 0;
+		for (uint32_t j = 0; j < i; j++) {
+			if (graph->op[j].level + 1 > level && check_GraphDependency(&graph->op[j], &graph->op[i])) level = graph->op[j].level + 1;
+		}
+		graph->op[i].level = level;
+		if (level + 1 > graph->levels) graph->levels = level + 1;
+	}
+	//the barrier before a level waits for the stages of every op recorded so far (reads included, for write after read)
+	//and makes all earlier writes visible to the accesses of the level
+	VkPipelineStageFlags recordedStages = 0;
+	VkAccessFlags writeAccesses = 0;
+	for (uint32_t level = 0; level < graph->levels; level++) {
+		VkPipelineStageFlags levelStages = 0;
+		VkAccessFlags levelAccesses = 0;
+		VkAccessFlags levelWrites = 0;
+		for (uint32_t i = 0; i < graph->count; i++) {
+			if (graph->op[i].level != level) continue;
+			VkPipelineStageFlags stage;
+			VkAccessFlags readAccess, writeAccess;
+			get_GraphOpAccess(&graph->op[i], &stage, &readAccess, &writeAccess);
+			levelStages |= stage;
+			levelAccesses |= readAccess | writeAccess;
+			if (graph->op[i].writeCount > 0) levelWrites |= writeAccess;
+		}
+		if (level > 0) {
+			VkMemoryBarrier memoryBarrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                                            (const void*) NULL,
+                                            (VkAccessFlags) writeAccesses,
+                                            (VkAccessFlags) levelAccesses };
+			vkCmdPipelineBarrier(commandBuffer, recordedStages, levelStages, 0, 1, &memoryBarrier, 0, NULL, 0, NULL);
+			graph->barriers++;
+		}
+		recordedStages |= levelStages;
+		writeAccesses |= levelWrites;
+		for (uint32_t i = 0; i < graph->count; i++) {
+			if (graph->op[i].level == level) record_GraphOp(commandBuffer, &graph->op[i]);
+		}
+	}
+}
+
+
+void
+record_GraphSerial(VkGraph* graph, VkCommandBuffer commandBuffer)
+{
+	//reference recording in program order with a full barrier after every op, as run_App does
+	graph->levels = graph->count;
+	graph->barriers = 0;
+	for (uint32_t i = 0; i < graph->count; i++) {
+		if (i > 0) {
+			VkMemoryBarrier memoryBarrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                                            (const void*) NULL,
+                                            (VkAccessFlags) (VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT),
+                                            (VkAccessFlags) (VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT) };
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+			                     VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &memoryBarrier, 0, NULL, 0, NULL);
+			graph->barriers++;
+		}
+		record_GraphOp(commandBuffer, &graph->op[i]);
+	}
+}
+
+
+VkResult
+run_Graph(VkGPU* vkGPU, VkGraph* graph, uint32_t serial, uint32_t batch, double* time)
+{
+	//record the graph batch times into one command buffer, repetitions are separated by a full barrier. time is per repetition
+	VkCommandBufferAllocateInfo commandBufferAllocateInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+                                        (const void*) NULL,
+                                        (VkCommandPool) vkGPU->commandPool,
+                                        (VkCommandBufferLevel) VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+                                        (uint32_t) 1 };
+	VkCommandBuffer commandBuffer = { 0 };
+	VkResult res = vkAllocateCommandBuffers(vkGPU->device, &commandBufferAllocateInfo, &commandBuffer);
+	if (res != VK_SUCCESS) return res;
+	VkCommandBufferBeginInfo commandBufferBeginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+                                     (const void*) NULL,
+                                     (VkCommandBufferUsageFlags) VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+                                     (const VkCommandBufferInheritanceInfo*) NULL };
+	res = vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo);
+	if (res != VK_SUCCESS) return res;
+	VkMemoryBarrier memoryBarrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                                    (const void*) NULL,
+                                    (VkAccessFlags) (VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT),
+                                    (VkAccessFlags) (VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_HOST_READ_BIT) };
+	for (uint32_t i = 0; i < batch; i++) {
+		if (serial) record_GraphSerial(graph, commandBuffer);
+		else record_Graph(graph, commandBuffer);
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+		                     VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &memoryBarrier, 0, NULL, 0, NULL);
+	}
+	res = vkEndCommandBuffer(commandBuffer);
+	if (res != VK_SUCCESS) return res;
+	VkSubmitInfo submitInfo = { VK_STRUCTURE_TYPE_SUBMIT_INFO,
+                         (const void*) NULL,
+                         (uint32_t) 0,
+                         (const VkSemaphore*) NULL,
+                         (const VkPipelineStageFlags*) NULL,
+                         (uint32_t) 1,
+                         (const VkCommandBuffer*) &commandBuffer,
+                         (uint32_t) 0,
+                         (const VkSemaphore*) NULL };
+	double t = get_TimeMs();
+	res = vkQueueSubmit(vkGPU->queue, 1, &submitInfo, vkGPU->fence);
+	if (res != VK_SUCCESS) return res;
+	res = vkWaitForFences(vkGPU->device, 1, &vkGPU->fence, VK_TRUE, 100000000000);
+	if (res != VK_SUCCESS) return res;
+	time[0] = (get_TimeMs() - t) / batch;
+	res = vkResetFences(vkGPU->device, 1, &vkGPU->fence);
+	vkFreeCommandBuffers(vkGPU->device, vkGPU->commandPool, 1, &commandBuffer);
+	return res;
+}
+
+
+#define VKT_GRAPH_MAX_CHAINS 16
+
+VkResult
+Example_VulkanGraph(uint32_t deviceID,
+                    uint32_t coalescedMemory,
+                    uint32_t size,
+                    uint32_t chains)
+{
+	//chains independent chains of transpose -> copy -> transpose on size x size matrices, recorded in program order with
+	//a barrier after every op and by record_Graph, which needs 3 levels and 2 barriers for any number of chains
+	VkGPU vkGPU = { 0 };
+	vkGPU.device_id = deviceID;
+	VkResult res = VK_SUCCESS;
+	if (chains == 0 || chains > VKT_GRAPH_MAX_CHAINS) {
+		printf("Unsupported number of chains %d, use 1..%d\n", chains, VKT_GRAPH_MAX_CHAINS);
+		return VK_ERROR_TOO_MANY_OBJECTS;
+	}
+	res = create_VkGPU(&vkGPU);
+	if (res != VK_SUCCESS) return res;
+	coalescedMemory = get_CoalescedMemory(&vkGPU, coalescedMemory);
+	uint32_t tile = coalescedMemory / sizeof(float);
+	if (size % tile != 0) {
+		printf("System size %d is not a multiple of the tile size %d\n", size, tile);
+		delete_VkGPU(&vkGPU);
+		return VK_ERROR_FORMAT_NOT_SUPPORTED;
+	}
+
+	//buffers of every chain: input, transposed, copy of the transposed, output
+	VkDeviceSize bufferSize = sizeof(float) * (VkDeviceSize) size * size;
+	VkBuffer buffer[VKT_GRAPH_MAX_CHAINS][4] = { { 0 } };
+	VkDeviceMemory bufferDeviceMemory[VKT_GRAPH_MAX_CHAINS][4] = { { 0 } };
+	VkApplication app[VKT_GRAPH_MAX_CHAINS][2];
+	memset(app, 0, sizeof(app));
+	float* buffer_input  = (float*) malloc(bufferSize);
+	float* buffer_output = (float*) malloc(bufferSize);
+	char shaderPath[256];
+	sprintf(shaderPath, "%stransposition_no_bank_conflicts.spv", SHADER_DIR);
+	uint32_t systemSize[3] = { size, size, 1 };
+	uint32_t groupCount[3] = { size / tile, size / tile, 1 };
+	VkGraph* graph = (VkGraph*) calloc(1, sizeof(VkGraph));
+	for (uint32_t c = 0; c < chains && res == VK_SUCCESS; c++) {
+		for (uint32_t k = 0; k < 4 && res == VK_SUCCESS; k++) {
+			res = allocate_Buffer_DeviceMemory(vkGPU.physicalDevice, vkGPU.device,
+			                                   VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			                                   &vkGPU.physicalDeviceMemoryProperties, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			                                   bufferSize, &buffer[c][k], &bufferDeviceMemory[c][k]);
+		}
+		if (res != VK_SUCCESS) {
+			printf("Buffer allocation failed, error code: %d\n", res);
+			break;
+		}
+		for (uint64_t i = 0; i < (uint64_t) size * size; i++) buffer_input[i] = (float) (i + c);
+		res = upload_Data(vkGPU.physicalDevice, vkGPU.device, buffer_input, &vkGPU.physicalDeviceMemoryProperties,
+		                  vkGPU.commandPool, vkGPU.queue, &vkGPU.fence, &buffer[c][0], bufferSize);
+		if (res != VK_SUCCESS) break;
+		for (uint32_t k = 0; k < 2 && res == VK_SUCCESS; k++) {
+			VkBuffer*    appBuffer[2]   = { &buffer[c][2 * k], &buffer[c][2 * k + 1] };
+			VkDeviceSize bufferSizes[2] = { bufferSize, bufferSize };
+			res = create_App(vkGPU.device, &app[c][k].specializationConstants, coalescedMemory, appBuffer, bufferSizes, systemSize,
+			                 &app[c][k].descriptorPool, &app[c][k].descriptorSetLayout, &app[c][k].descriptorSet,
+			                 (const char*) shaderPath, &app[c][k].pipelineLayout, &app[c][k].pipeline);
+		}
+		if (res != VK_SUCCESS) {
+			printf("Application creation failed, error code: %d\n", res);
+			break;
+		}
+	}
+	//ops are added chain after chain, as a program would issue them
+	for (uint32_t c = 0; c < chains && res == VK_SUCCESS; c++) {
+		VkBufferRange range[4];
+		for (uint32_t k = 0; k < 4; k++) {
+			range[k].buffer = buffer[c][k];
+			range[k].offset = 0;
+			range[k].size = bufferSize;
+		}
+		add_GraphDispatch(graph, &app[c][0], groupCount, &range[0], 1, &range[1], 1);
+		add_GraphCopy(graph, buffer[c][1], 0, buffer[c][2], 0, bufferSize);
+		add_GraphDispatch(graph, &app[c][1], groupCount, &range[2], 1, &range[3], 1);
+	}
+
+	double time[2] = { 0 };
+	uint32_t barriers[2] = { 0 }, levels[2] = { 0 };
+	for (uint32_t serial = 0; serial < 2 && res == VK_SUCCESS; serial++) {
+		res = run_Graph(&vkGPU, graph, serial, 100, &time[serial]);
+		barriers[serial] = graph->barriers;
+		levels[serial] = graph->levels;
+	}
+	if (res != VK_SUCCESS) printf("Graph run failed, error code: %d\n", res);
+
+	//every chain transposes twice, so the output equals the input
+	uint32_t passed = (res == VK_SUCCESS);
+	for (uint32_t c = 0; c < chains && passed; c++) {
+		res = download_Data(vkGPU.physicalDevice, vkGPU.device, vkGPU.commandPool, &vkGPU.physicalDeviceMemoryProperties,
+		                    vkGPU.queue, &vkGPU.fence, buffer_output, &buffer[c][3], bufferSize);
+		if (res != VK_SUCCESS) break;
+		for (uint64_t i = 0; i < (uint64_t) size * size && passed; i++) passed = (buffer_output[i] == (float) (i + c));
+	}
+	if (res == VK_SUCCESS) {
+		printf("System size: %dx%d\nChains: %d (transpose -> copy -> transpose), %d ops\n", size, size, chains, graph->count);
+		printf("Barrier after every op: %3d levels, %3d barriers, %.3f ms\nDependency graph:       %3d levels, %3d barriers, %.3f ms (%.2fx)\nVerification %s\n",
+		       levels[1], barriers[1], time[1], levels[0], barriers[0], time[0], time[1] / time[0], passed ? "passed" : "FAILED");
+		if (!passed) res = VK_ERROR_FORMAT_NOT_SUPPORTED;
+	}
+
+	for (uint32_t c = 0; c < chains; c++) {
+		for (uint32_t k = 0; k < 2; k++) {
+			if (app[c][k].pipeline != VK_NULL_HANDLE) deleteApp(&vkGPU, &app[c][k]);
+		}
+		for (uint32_t k = 0; k < 4; k++) {
+			vkDestroyBuffer(vkGPU.device, buffer[c][k], NULL);
+			vkFreeMemory(vkGPU.device, bufferDeviceMemory[c][k], NULL);
+		}
+	}
+	free(graph);
+	free(buffer_input);
+	free(buffer_output);
+	delete_VkGPU(&vkGPU);
+	return res;
+}
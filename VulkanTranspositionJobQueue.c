@@ -0,0 +1,573 @@
+#include "VulkanTransposition.h"
+
+
+#ifndef _WIN32
+//Persistent-kernel job queue: the persistent workgroups of job_queue.comp consume a ring of job descriptors in host visible
+//memory. The host publishes a job with a few stores into the mapped ring and polls its completion flag, so a stream of small
+//transpositions has one vkQueueSubmit per session instead of one per job. The kernel runs until stop_JobQueue: keep sessions
+//shorter than the watchdog of the driver (TDR on Windows, hang detection on Linux) on GPUs that also drive a display.
+//Vulkan does not guarantee that host writes to host coherent memory become visible to a dispatch that is already running,
+//only to the work of later submissions. wait_Job gives up after VKT_JOBQ_TIMEOUT_MS, and Example_VulkanJobQueue then falls
+//back to one vkQueueSubmit per job.
+//Indirect chain, the default: the ring is split into two banks, each with a command buffer recorded once that holds one
+//vkCmdDispatchIndirect per slot, reading the group count from the descriptor of the slot (0 - empty slot, nothing runs).
+//The host writes descriptors into the open bank and submits it when it is full or on flush_JobQueue, so a stream of jobs
+//takes one vkQueueSubmit per bank while the other bank is filled. Completion is the fence of the bank. This only relies on
+//host writes being visible to later submissions, which Vulkan guarantees
+#define VKT_JOBQ_RING_SIZE  64
+#define VKT_JOBQ_TIMEOUT_MS 2000.0//a published job not done by then is reported as lost
+#define VKT_JOBQ_DATA_LIMIT ((VkDeviceSize) 256 << 20)
+
+typedef struct {
+	uint32_t src;         //word offset of the input in the data of the queue
+	uint32_t dst;         //word offset of the output
+	uint32_t width;       //elements per row of the input
+	uint32_t height;      //rows of the input
+	uint32_t elementWords;//1 - 4-byte elements, 2 - 8-byte elements
+	uint32_t sequence;    //job number + 1, stored last with release semantics: the job is published
+	uint32_t done;        //job number + 1, stored by the kernel when the output is written
+	uint32_t padding;
+	uint32_t groupCount[3];//indirect chain: tiles of the job, the arguments of the dispatch of the slot. 0 - empty slot
+	uint32_t padding2;
+} VkJobDescriptor;//layout of Job in job_queue.comp
+
+typedef struct {
+	uint32_t stop;
+	uint32_t claimed;
+	uint32_t padding[2];
+} VkJobRingHeader;//layout of the ring header in job_queue.comp, followed by the descriptors
+
+typedef struct {
+	VkApplication app;               //job_queue.comp, persistent kernel or one dispatch per slot
+	VkBuffer ringBuffer;
+	VkDeviceMemory ringBufferDeviceMemory;
+	VkJobRingHeader* ring;           //mapped ring
+	VkJobDescriptor* jobs;           //ringSize descriptors after the header
+	VkBuffer dataBuffer;
+	VkDeviceMemory dataBufferDeviceMemory;
+	uint32_t* data;                  //mapped data, job offsets are in words of it
+	VkDeviceSize dataSize;
+	uint32_t deviceLocalData;        //data is device local memory mapped by the host (resizable BAR or integrated GPU)
+	uint32_t ringSize;
+	uint32_t workgroups;
+	uint32_t tile;
+	uint32_t next;                   //number of submitted jobs, the id of the next one
+	uint32_t indirect;               //1 - indirect chain, 0 - persistent kernel
+	uint32_t bankSize;               //slots per bank of the indirect chain, ringSize / 2
+	uint32_t open;                   //jobs written into the open bank and not submitted yet, the last ones before next
+	uint32_t bankFirst[2];           //id of the first job of a submitted bank
+	uint32_t bankJobs[2];            //jobs of a submitted bank, 0 - the bank is not in flight
+	uint32_t submits;                //vkQueueSubmit calls of the session
+	VkCommandBuffer commandBuffer[2];//persistent kernel: [0]. Indirect chain: one per bank
+	VkFence fence[2];                //signaled when the persistent kernel exits or when the bank is complete
+	uint32_t running;
+} VkJobQueue;
+
+
+void
+delete_JobQueue(VkGPU* vkGPU, VkJobQueue* queue)
+{
+	//destroy calls accept null handles, so a partially created queue can be deleted too
+	if (queue->app.pipeline != VK_NULL_HANDLE) deleteApp(vkGPU, &queue->app);
+	if (queue->ring != NULL) vkUnmapMemory(vkGPU->device, queue->ringBufferDeviceMemory);
+	if (queue->data != NULL) vkUnmapMemory(vkGPU->device, queue->dataBufferDeviceMemory);
+	vkDestroyBuffer(vkGPU->device, queue->ringBuffer, NULL);
+	vkFreeMemory(vkGPU->device, queue->ringBufferDeviceMemory, NULL);
+	vkDestroyBuffer(vkGPU->device, queue->dataBuffer, NULL);
+	vkFreeMemory(vkGPU->device, queue->dataBufferDeviceMemory, NULL);
+	for (uint32_t k = 0; k < 2; k++) {
+		if (queue->commandBuffer[k] != VK_NULL_HANDLE) vkFreeCommandBuffers(vkGPU->device, vkGPU->commandPool, 1, &queue->commandBuffer[k]);
+		vkDestroyFence(vkGPU->device, queue->fence[k], NULL);
+	}
+	memset(queue, 0, sizeof(VkJobQueue));
+}
+
+
+VkResult
+create_JobQueue(VkGPU* vkGPU, VkJobQueue* queue, uint32_t coalescedMemory, uint32_t ringSize, uint32_t workgroups, VkDeviceSize dataSize, uint32_t indirect)
+{
+	//ring and data are host coherent, so neither side flushes: the kernel sees the descriptors and the host the outputs and
+	//flags while the kernel runs. Data prefers device local memory mapped by the host. ringSize is even for the indirect chain
+	VkResult res = VK_SUCCESS;
+	memset(queue, 0, sizeof(VkJobQueue));
+	queue->ringSize = ringSize;
+	queue->workgroups = workgroups;
+	queue->dataSize = dataSize;
+	queue->tile = coalescedMemory / sizeof(float);
+	queue->indirect = indirect;
+	queue->bankSize = ringSize / 2;
+	uint32_t commandBuffers = indirect ? 2 : 1;
+	VkDeviceSize ringBufferSize = sizeof(VkJobRingHeader) + sizeof(VkJobDescriptor) * ringSize;
+	res = allocate_Buffer_DeviceMemory(vkGPU->physicalDevice, vkGPU->device, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+	                                   &vkGPU->physicalDeviceMemoryProperties, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+	                                   ringBufferSize, &queue->ringBuffer, &queue->ringBufferDeviceMemory);
+	if (res == VK_SUCCESS) {
+		queue->deviceLocalData = 1;
+		res = allocate_Buffer_DeviceMemory(vkGPU->physicalDevice, vkGPU->device, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		                                   &vkGPU->physicalDeviceMemoryProperties,
+		                                   VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		                                   dataSize, &queue->dataBuffer, &queue->dataBufferDeviceMemory);
+		if (res != VK_SUCCESS) {
+			//no such memory type, or its heap (256 MB without resizable BAR) is full
+			vkDestroyBuffer(vkGPU->device, queue->dataBuffer, NULL);
+			vkFreeMemory(vkGPU->device, queue->dataBufferDeviceMemory, NULL);
+			queue->dataBuffer = VK_NULL_HANDLE;
+			queue->dataBufferDeviceMemory = VK_NULL_HANDLE;
+			queue->deviceLocalData = 0;
+			res = allocate_Buffer_DeviceMemory(vkGPU->physicalDevice, vkGPU->device, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			                                   &vkGPU->physicalDeviceMemoryProperties, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			                                   dataSize, &queue->dataBuffer, &queue->dataBufferDeviceMemory);
+		}
+	}
+	if (res == VK_SUCCESS) res = vkMapMemory(vkGPU->device, queue->ringBufferDeviceMemory, 0, ringBufferSize, 0, (void**) &queue->ring);
+	if (res == VK_SUCCESS) res = vkMapMemory(vkGPU->device, queue->dataBufferDeviceMemory, 0, dataSize, 0, (void**) &queue->data);
+	if (res == VK_SUCCESS) {
+		queue->jobs = (VkJobDescriptor*) (queue->ring + 1);
+		memset(queue->ring, 0, (size_t) ringBufferSize);
+		uint32_t tile = queue->tile;
+		uint32_t specializationConstants[5] = { tile, 256 / tile, 1, ringSize, indirect ? 0 : 1 };
+		VkSpecializationMapEntry specializationMapEntries[5] = { 0 };
+		for (uint32_t kk = 0; kk < 5; kk++) {
+			specializationMapEntries[kk].constantID = kk + 1;
+			specializationMapEntries[kk].size = sizeof(uint32_t);
+			specializationMapEntries[kk].offset = kk * sizeof(uint32_t);
+		}
+		VkSpecializationInfo specializationInfo = { (uint32_t) 5,
+                                                            (const VkSpecializationMapEntry*) specializationMapEntries,
+                                                            (size_t) sizeof(specializationConstants),
+                                                            (const void*) specializationConstants };
+		VkBuffer*    appBuffer[2]   = { &queue->ringBuffer, &queue->dataBuffer };
+		VkDeviceSize bufferSizes[2] = { ringBufferSize, dataSize };
+		char shaderPath[256];
+		sprintf(shaderPath, "%sjob_queue.spv", SHADER_DIR);
+		res = create_ComputeApp(vkGPU->device, 2, appBuffer, bufferSizes, &specializationInfo, &queue->app.descriptorPool, &queue->app.descriptorSetLayout,
+		                        &queue->app.descriptorSet, (const char*) shaderPath, &queue->app.pipelineLayout, &queue->app.pipeline);
+	}
+	for (uint32_t k = 0; k < commandBuffers && res == VK_SUCCESS; k++) {
+		VkFenceCreateInfo fenceCreateInfo = { VK_STRUCTURE_TYPE_FENCE_CREATE_INFO, (const void*) NULL, (VkFenceCreateFlags) 0 };
+		res = vkCreateFence(vkGPU->device, &fenceCreateInfo, NULL, &queue->fence[k]);
+		if (res != VK_SUCCESS) break;
+		VkCommandBufferAllocateInfo commandBufferAllocateInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+                                        (const void*) NULL,
+                                        (VkCommandPool) vkGPU->commandPool,
+                                        (VkCommandBufferLevel) VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+                                        (uint32_t) 1 };
+		res = vkAllocateCommandBuffers(vkGPU->device, &commandBufferAllocateInfo, &queue->commandBuffer[k]);
+		if (res != VK_SUCCESS) break;
+		//recorded once, every session or bank submits it again
+		VkCommandBufferBeginInfo commandBufferBeginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+                                     (const void*) NULL,
+                                     (VkCommandBufferUsageFlags) 0,
+                                     (const VkCommandBufferInheritanceInfo*) NULL };
+		res = vkBeginCommandBuffer(queue->commandBuffer[k], &commandBufferBeginInfo);
+		if (res != VK_SUCCESS) break;
+		vkCmdBindPipeline(queue->commandBuffer[k], VK_PIPELINE_BIND_POINT_COMPUTE, queue->app.pipeline);
+		vkCmdBindDescriptorSets(queue->commandBuffer[k], VK_PIPELINE_BIND_POINT_COMPUTE, queue->app.pipelineLayout, 0, 1, &queue->app.descriptorSet, 0, NULL);
+		if (indirect) {
+			//jobs of a bank write disjoint outputs, the dispatches need no barriers between them
+			for (uint32_t slot = k * queue->bankSize; slot < (k + 1) * queue->bankSize; slot++) {
+				VkAppPushConstantsLayout pushConstants = { slot };
+				vkCmdPushConstants(queue->commandBuffer[k], queue->app.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(VkAppPushConstantsLayout), &pushConstants);
+				vkCmdDispatchIndirect(queue->commandBuffer[k], queue->ringBuffer,
+				                      sizeof(VkJobRingHeader) + sizeof(VkJobDescriptor) * slot + offsetof(VkJobDescriptor, groupCount));
+			}
+			//make the outputs visible to the host
+			VkMemoryBarrier memoryBarrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                                    (const void*) NULL,
+                                    (VkAccessFlags) VK_ACCESS_SHADER_WRITE_BIT,
+                                    (VkAccessFlags) VK_ACCESS_HOST_READ_BIT };
+			vkCmdPipelineBarrier(queue->commandBuffer[k], VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &memoryBarrier, 0, NULL, 0, NULL);
+		}
+		else vkCmdDispatch(queue->commandBuffer[k], workgroups, 1, 1);
+		res = vkEndCommandBuffer(queue->commandBuffer[k]);
+	}
+	if (res != VK_SUCCESS) {
+		printf("Job queue creation failed, error code: %d\n", res);
+		delete_JobQueue(vkGPU, queue);
+	}
+	return res;
+}
+
+
+VkResult
+start_JobQueue(VkGPU* vkGPU, VkJobQueue* queue)
+{
+	//start a session: clear the ring and launch the persistent kernel. Job ids start from 0 again
+	memset(queue->ring, 0, sizeof(VkJobRingHeader) + sizeof(VkJobDescriptor) * queue->ringSize);
+	queue->next = 0;
+	queue->open = 0;
+	queue->submits = 0;
+	if (queue->indirect) {
+		//banks are submitted as jobs arrive
+		queue->running = 1;
+		return VK_SUCCESS;
+	}
+	VkSubmitInfo submitInfo = { VK_STRUCTURE_TYPE_SUBMIT_INFO,
+                         (const void*) NULL,
+                         (uint32_t) 0,
+                         (const VkSemaphore*) NULL,
+                         (const VkPipelineStageFlags*) NULL,
+                         (uint32_t) 1,
+                         (const VkCommandBuffer*) &queue->commandBuffer[0],
+                         (uint32_t) 0,
+                         (const VkSemaphore*) NULL };
+	VkResult res = vkQueueSubmit(vkGPU->queue, 1, &submitInfo, queue->fence[0]);
+	if (res == VK_SUCCESS) {
+		queue->running = 1;
+		queue->submits = 1;
+	}
+	return res;
+}
+
+
+uint32_t
+retire_JobBank(VkGPU* vkGPU, VkJobQueue* queue, uint32_t bank)
+{
+	//1 - the bank is not in flight: its fence has signaled and the completion flags of its slots are set. The empty slots of
+	//a partial bank are marked done too, so the ring check of submit_Job passes for them
+	if (queue->bankJobs[bank] == 0) return 1;
+	if (vkGetFenceStatus(vkGPU->device, queue->fence[bank]) != VK_SUCCESS) return 0;
+	vkResetFences(vkGPU->device, 1, &queue->fence[bank]);
+	for (uint32_t k = 0; k < queue->bankSize; k++) {
+		uint32_t id = queue->bankFirst[bank] + k;
+		VkJobDescriptor* job = &queue->jobs[id % queue->ringSize];
+		memset(job->groupCount, 0, sizeof(job->groupCount));
+		__atomic_store_n(&job->done, id + 1, __ATOMIC_RELEASE);
+	}
+	queue->bankJobs[bank] = 0;
+	return 1;
+}
+
+
+VkResult
+flush_JobQueue(VkGPU* vkGPU, VkJobQueue* queue)
+{
+	//indirect chain: submit the open bank. The rest of its slots stay empty, the next job starts the other bank
+	if (!queue->indirect || queue->open == 0) return VK_SUCCESS;
+	uint32_t first = queue->next - queue->open;
+	uint32_t bank = (first % queue->ringSize) / queue->bankSize;
+	VkSubmitInfo submitInfo = { VK_STRUCTURE_TYPE_SUBMIT_INFO,
+                         (const void*) NULL,
+                         (uint32_t) 0,
+                         (const VkSemaphore*) NULL,
+                         (const VkPipelineStageFlags*) NULL,
+                         (uint32_t) 1,
+                         (const VkCommandBuffer*) &queue->commandBuffer[bank],
+                         (uint32_t) 0,
+                         (const VkSemaphore*) NULL };
+	VkResult res = vkQueueSubmit(vkGPU->queue, 1, &submitInfo, queue->fence[bank]);
+	if (res != VK_SUCCESS) return res;
+	queue->bankFirst[bank] = first;
+	queue->bankJobs[bank] = queue->open;
+	queue->open = 0;
+	queue->next = first + queue->bankSize;
+	queue->submits++;
+	return VK_SUCCESS;
+}
+
+
+VkResult
+submit_Job(VkGPU* vkGPU, VkJobQueue* queue, uint32_t src, uint32_t dst, uint32_t width, uint32_t height, uint32_t elementWords, uint32_t* id)
+{
+	//publish one transposition of a height x width matrix. The inputs must be written before the call.
+	//VK_NOT_READY - the slot is still taken by the job ringSize places before, retry after polling it.
+	//Indirect chain: the job joins the open bank, which is submitted once full. Ids skip the empty slots of a flushed bank
+	uint32_t j = queue->next;
+	VkJobDescriptor* job = &queue->jobs[j % queue->ringSize];
+	if (queue->indirect && !retire_JobBank(vkGPU, queue, (j % queue->ringSize) / queue->bankSize)) return VK_NOT_READY;
+	if (j >= queue->ringSize && __atomic_load_n(&job->done, __ATOMIC_ACQUIRE) != j - queue->ringSize + 1) return VK_NOT_READY;
+	job->src = src;
+	job->dst = dst;
+	job->width = width;
+	job->height = height;
+	job->elementWords = elementWords;
+	if (queue->indirect) {
+		//one workgroup per tile, visible to the chain through the submission of the bank
+		job->groupCount[0] = (width + queue->tile - 1) / queue->tile;
+		job->groupCount[1] = (height + queue->tile - 1) / queue->tile;
+		job->groupCount[2] = 1;
+		job->sequence = j + 1;
+		queue->next++;
+		queue->open++;
+		id[0] = j;
+		return (queue->next % queue->bankSize == 0) ? flush_JobQueue(vkGPU, queue) : VK_SUCCESS;
+	}
+	//release: the descriptor and the input are visible before the kernel can see the sequence
+	__atomic_store_n(&job->sequence, j + 1, __ATOMIC_RELEASE);
+	queue->next++;
+	id[0] = j;
+	return VK_SUCCESS;
+}
+
+
+uint32_t
+poll_Job(VkGPU* vkGPU, VkJobQueue* queue, uint32_t id)
+{
+	//1 - the output of job id is written. Valid until ringSize later jobs are submitted. Jobs of the open bank of the
+	//indirect chain are not done before flush_JobQueue
+	uint32_t done = __atomic_load_n(&queue->jobs[id % queue->ringSize].done, __ATOMIC_ACQUIRE);
+	if ((int32_t) (done - (id + 1)) >= 0) return 1;
+	if (!queue->indirect || !retire_JobBank(vkGPU, queue, (id % queue->ringSize) / queue->bankSize)) return 0;
+	done = __atomic_load_n(&queue->jobs[id % queue->ringSize].done, __ATOMIC_ACQUIRE);
+	return (int32_t) (done - (id + 1)) >= 0;
+}
+
+
+VkResult
+wait_Job(VkGPU* vkGPU, VkJobQueue* queue, uint32_t id)
+{
+	//spin on the completion flag. VK_TIMEOUT - the job was not done in VKT_JOBQ_TIMEOUT_MS, the kernel does not see the
+	//host writes or has exited. Indirect chain: flush the open bank if it holds the job and wait for the fence of its bank
+	if (queue->indirect) {
+		VkResult res = VK_SUCCESS;
+		if (id - (queue->next - queue->open) < queue->open) res = flush_JobQueue(vkGPU, queue);
+		uint32_t bank = (id % queue->ringSize) / queue->bankSize;
+		if (res == VK_SUCCESS && queue->bankJobs[bank] != 0) {
+			res = vkWaitForFences(vkGPU->device, 1, &queue->fence[bank], VK_TRUE, (uint64_t) (VKT_JOBQ_TIMEOUT_MS * 1000000));
+			if (res == VK_TIMEOUT) printf("Job %d not done in %.0f ms\n", id, VKT_JOBQ_TIMEOUT_MS);
+		}
+		if (res != VK_SUCCESS) return res;
+		return poll_Job(vkGPU, queue, id) ? VK_SUCCESS : VK_TIMEOUT;
+	}
+	double start = 0;
+	for (uint32_t spin = 0; !poll_Job(vkGPU, queue, id); spin++) {
+		if ((spin & 1023) != 1023) continue;
+		if (start == 0) start = get_TimeMs();
+		else if (get_TimeMs() - start > VKT_JOBQ_TIMEOUT_MS) {
+			VkResult status = vkGetFenceStatus(vkGPU->device, queue->fence[0]);
+			printf("Job %d not done in %.0f ms, persistent kernel %s\n", id, VKT_JOBQ_TIMEOUT_MS, (status == VK_SUCCESS) ? "has exited" : "does not see it");
+			return VK_TIMEOUT;
+		}
+	}
+	return VK_SUCCESS;
+}
+
+
+VkResult
+stop_JobQueue(VkGPU* vkGPU, VkJobQueue* queue)
+{
+	//end the session: workgroups finish their current job and exit instead of waiting for the next one. Indirect chain:
+	//submit the open bank and wait for both banks
+	if (!queue->running) return VK_SUCCESS;
+	if (queue->indirect) {
+		VkResult res = flush_JobQueue(vkGPU, queue);
+		for (uint32_t bank = 0; bank < 2 && res == VK_SUCCESS; bank++) {
+			if (queue->bankJobs[bank] == 0) continue;
+			res = vkWaitForFences(vkGPU->device, 1, &queue->fence[bank], VK_TRUE, 10000000000);
+			if (res == VK_SUCCESS) retire_JobBank(vkGPU, queue, bank);
+		}
+		if (res != VK_SUCCESS) {
+			printf("Job queue bank did not complete, error code: %d\n", res);
+			return res;
+		}
+		queue->running = 0;
+		return VK_SUCCESS;
+	}
+	__atomic_store_n(&queue->ring->stop, 1, __ATOMIC_RELEASE);
+	VkResult res = vkWaitForFences(vkGPU->device, 1, &queue->fence[0], VK_TRUE, 10000000000);
+	if (res != VK_SUCCESS) {
+		printf("Persistent kernel did not stop, error code: %d\n", res);
+		return res;
+	}
+	queue->running = 0;
+	return vkResetFences(vkGPU->device, 1, &queue->fence[0]);
+}
+
+
+void
+fill_JobInput(uint32_t* data, uint32_t words, uint32_t job)
+{
+	//input of every job differs, so a stale output is detected
+	for (uint32_t k = 0; k < words; k++) data[k] = k ^ (job * 0x9E3779B1u);
+}
+
+
+uint32_t
+check_JobOutput(const uint32_t* data, uint32_t width, uint32_t height, uint32_t elementWords, uint32_t job)
+{
+	//number of wrong words of the width x height transposition of fill_JobInput
+	uint32_t errors = 0;
+	for (uint32_t y = 0; y < width; y++) {
+		for (uint32_t x = 0; x < height; x++) {
+			for (uint32_t w = 0; w < elementWords; w++) {
+				uint32_t source = (x * width + y) * elementWords + w;
+				if (data[(y * height + x) * elementWords + w] != (source ^ (job * 0x9E3779B1u))) errors++;
+			}
+		}
+	}
+	return errors;
+}
+
+
+VkResult
+Example_VulkanJobQueue(uint32_t deviceID,
+                       uint32_t coalescedMemory,
+                       uint32_t size,
+                       uint32_t jobs,
+                       uint32_t workgroups,
+                       uint32_t persistent)
+{
+	//size x size transpositions, 4-byte elements for even jobs and 8-byte for odd ones. Compares one vkQueueSubmit and
+	//fence wait per job (run_App) with the job queue, the indirect chain or the persistent kernel: one job at a time for the
+	//latency, then with the ring full
+	VkGPU vkGPU = { 0 };
+	vkGPU.device_id = deviceID;
+	VkResult res = create_VkGPU(&vkGPU);
+	if (res != VK_SUCCESS) return res;
+	coalescedMemory = get_CoalescedMemory(&vkGPU, coalescedMemory);
+	uint32_t tile = coalescedMemory / sizeof(float);
+	if (size == 0 || size % tile != 0) {
+		printf("System size %d is not a multiple of the tile %d\n", size, tile);
+		delete_VkGPU(&vkGPU);
+		return VK_ERROR_INITIALIZATION_FAILED;
+	}
+	if (jobs == 0 || (persistent && workgroups == 0)) {
+		printf("Job queue needs at least one job and one workgroup, got %d jobs and %d workgroups\n", jobs, workgroups);
+		delete_VkGPU(&vkGPU);
+		return VK_ERROR_INITIALIZATION_FAILED;
+	}
+	//every slot holds the input and the output of one job with 8-byte elements
+	uint32_t slotWords = 2 * 2 * size * size;
+	uint32_t slots = (uint32_t) (VKT_JOBQ_DATA_LIMIT / (sizeof(uint32_t) * (VkDeviceSize) slotWords));
+	if (slots > VKT_JOBQ_RING_SIZE) slots = VKT_JOBQ_RING_SIZE;
+	if (slots == 0) {
+		printf("System size %d is too large for the job queue\n", size);
+		delete_VkGPU(&vkGPU);
+		return VK_ERROR_INITIALIZATION_FAILED;
+	}
+	double* latency = (double*) malloc(sizeof(double) * jobs);
+	if (latency == NULL) res = VK_ERROR_OUT_OF_HOST_MEMORY;
+
+	//baseline: transposition_no_bank_conflicts.comp, submitted and waited for one job at a time
+	double submitMedian = 0, submitP99 = 0;
+	if (res == VK_SUCCESS) {
+		VkDeviceSize bufferSize = sizeof(float) * (VkDeviceSize) size * size;
+		VkBuffer buffer[2] = { 0 };
+		VkDeviceMemory bufferDeviceMemory[2] = { 0 };
+		VkApplication app = { 0 };
+		for (uint32_t k = 0; k < 2 && res == VK_SUCCESS; k++) {
+			res = allocate_Buffer_DeviceMemory(vkGPU.physicalDevice, vkGPU.device, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			                                   &vkGPU.physicalDeviceMemoryProperties, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			                                   bufferSize, &buffer[k], &bufferDeviceMemory[k]);
+		}
+		if (res == VK_SUCCESS) {
+			char shaderPath[256];
+			sprintf(shaderPath, "%stransposition_no_bank_conflicts.spv", SHADER_DIR);
+			VkBuffer*    appBuffer[2]   = { &buffer[0], &buffer[1] };
+			VkDeviceSize bufferSizes[2] = { bufferSize, bufferSize };
+			uint32_t     systemSize[3]  = { size, size, 1 };
+			res = create_App(vkGPU.device, &app.specializationConstants, coalescedMemory, appBuffer, bufferSizes, systemSize,
+			                 &app.descriptorPool, &app.descriptorSetLayout, &app.descriptorSet, (const char*) shaderPath, &app.pipelineLayout, &app.pipeline);
+		}
+		uint32_t groupCount[3] = { 1, 1, 1 };
+		if (res == VK_SUCCESS) {
+			groupCount[0] = size / app.specializationConstants.localSize[0];
+			groupCount[1] = size / app.specializationConstants.localSize[1];
+		}
+		for (uint32_t j = 0; j <= jobs && res == VK_SUCCESS; j++) {
+			//first run is untimed, it pays for the first use of the pipeline
+			double t = get_TimeMs(), time = 0;
+			res = run_App(vkGPU.device, vkGPU.commandPool, app.pipeline, app.pipelineLayout, &app.descriptorSet, groupCount, vkGPU.queue, &vkGPU.fence, 1, &time);
+			if (j > 0) latency[j - 1] = get_TimeMs() - t;
+		}
+		if (res == VK_SUCCESS) {
+			qsort(latency, jobs, sizeof(double), compare_PerfSample);
+			submitMedian = latency[jobs / 2];
+			submitP99 = latency[(uint32_t) (0.99 * (jobs - 1))];
+		}
+		else printf("Submission baseline failed, error code: %d\n", res);
+		if (app.pipeline != VK_NULL_HANDLE) deleteApp(&vkGPU, &app);
+		for (uint32_t k = 0; k < 2; k++) {
+			vkDestroyBuffer(vkGPU.device, buffer[k], NULL);
+			vkFreeMemory(vkGPU.device, bufferDeviceMemory[k], NULL);
+		}
+	}
+
+	VkJobQueue queue = { 0 };
+	if (res == VK_SUCCESS) res = create_JobQueue(&vkGPU, &queue, coalescedMemory, VKT_JOBQ_RING_SIZE, workgroups, sizeof(uint32_t) * (VkDeviceSize) slotWords * slots, !persistent);
+	if (res == VK_SUCCESS) res = start_JobQueue(&vkGPU, &queue);
+	uint32_t errors = 0, fallback = 0;
+	double enqueueTime = 0, queueMedian = 0, queueP99 = 0, streamTime = 0, checkTime = 0, bytes = 0;
+
+	//latency: publish one job and wait until it is done. The indirect chain submits a bank with this job only
+	for (uint32_t j = 0; j < jobs && res == VK_SUCCESS; j++) {
+		uint32_t words = 1 + (j & 1);
+		uint32_t* input = queue.data + (VkDeviceSize) (j % slots) * slotWords;
+		uint32_t* output = input + 2 * size * size;
+		uint32_t id = 0;
+		fill_JobInput(input, words * size * size, j);
+		double t = get_TimeMs();
+		res = submit_Job(&vkGPU, &queue, (uint32_t) (input - queue.data), (uint32_t) (output - queue.data), size, size, words, &id);
+		enqueueTime += get_TimeMs() - t;
+		if (res == VK_SUCCESS) res = wait_Job(&vkGPU, &queue, id);
+		latency[j] = get_TimeMs() - t;
+		if (res == VK_SUCCESS) errors += check_JobOutput(output, size, size, words, j);
+		if (res == VK_TIMEOUT && j == 0 && persistent) {
+			//the running kernel does not see the host writes. If it still sees the stop flag, it exits cleanly and the
+			//device stays usable, so the submission path of the baseline is the result
+			if (stop_JobQueue(&vkGPU, &queue) == VK_SUCCESS) {
+				printf("Host writes do not reach the running persistent kernel on this device, falling back to vkQueueSubmit per job\n");
+				fallback = 1;
+			}
+		}
+	}
+	if (fallback) {
+		printf("vkQueueSubmit per job: median %.3f ms, p99 %.3f ms (4-byte elements)\n", submitMedian, submitP99);
+		delete_JobQueue(&vkGPU, &queue);
+		free(latency);
+		delete_VkGPU(&vkGPU);
+		return VK_SUCCESS;
+	}
+	if (res == VK_SUCCESS) {
+		qsort(latency, jobs, sizeof(double), compare_PerfSample);
+		queueMedian = latency[jobs / 2];
+		queueP99 = latency[(uint32_t) (0.99 * (jobs - 1))];
+	}
+
+	//throughput: keep every slot busy, check the oldest job before its slot is refilled. Waiting for it submits the open
+	//bank of the indirect chain, whose job ids skip the empty slots, so the id of every data slot is kept
+	uint32_t slotJob[VKT_JOBQ_RING_SIZE] = { 0 };
+	if (res == VK_SUCCESS) res = stop_JobQueue(&vkGPU, &queue);
+	if (res == VK_SUCCESS) res = start_JobQueue(&vkGPU, &queue);
+	double t0 = get_TimeMs();
+	for (uint32_t j = 0; j < jobs + slots && res == VK_SUCCESS; j++) {
+		uint32_t* input = queue.data + (VkDeviceSize) (j % slots) * slotWords;
+		uint32_t* output = input + 2 * size * size;
+		if (j >= slots) {
+			uint32_t old = j - slots;
+			res = wait_Job(&vkGPU, &queue, slotJob[j % slots]);
+			//reads of mapped device local memory are uncached, the check is not part of the stream
+			double t = get_TimeMs();
+			if (res == VK_SUCCESS) errors += check_JobOutput(output, size, size, 1 + (old & 1), old);
+			checkTime += get_TimeMs() - t;
+		}
+		if (j >= jobs || res != VK_SUCCESS) continue;
+		uint32_t words = 1 + (j & 1);
+		fill_JobInput(input, words * size * size, j);
+		res = submit_Job(&vkGPU, &queue, (uint32_t) (input - queue.data), (uint32_t) (output - queue.data), size, size, words, &slotJob[j % slots]);
+		bytes += 2.0 * sizeof(uint32_t) * words * size * size;
+	}
+	streamTime = get_TimeMs() - t0 - checkTime;
+	VkResult stopRes = stop_JobQueue(&vkGPU, &queue);
+	if (res == VK_SUCCESS) res = stopRes;
+
+	if (res == VK_SUCCESS) {
+		if (persistent) printf("Job queue: %d persistent workgroups, %d-slot ring, data in %s memory\n", workgroups, VKT_JOBQ_RING_SIZE,
+		                       queue.deviceLocalData ? "device local host visible" : "host");
+		else printf("Job queue: vkCmdDispatchIndirect chain, %d-slot ring in 2 banks, data in %s memory\n", VKT_JOBQ_RING_SIZE,
+		            queue.deviceLocalData ? "device local host visible" : "host");
+		printf("System size: %dx%d, %d jobs, 4 and 8-byte elements in turn\n", size, size, jobs);
+		printf("vkQueueSubmit per job: median %.3f ms, p99 %.3f ms (4-byte elements)\n", submitMedian, submitP99);
+		printf("%s median %.3f ms, p99 %.3f ms, host enqueue %.3f us per job\n", persistent ? "Persistent kernel:    " : "Indirect chain:       ",
+		       queueMedian, queueP99, 1000.0 * enqueueTime / jobs);
+		printf("Streaming with %d jobs in flight: %.3f ms, %.1f jobs/ms, %.3f GB/s, %.1f jobs per vkQueueSubmit\n", slots, streamTime, jobs / streamTime,
+		       bytes / 1024.0 / 1024.0 / 1024.0 / streamTime * 1000, (double) jobs / queue.submits);
+		printf("Verification %s: %d wrong words\n", errors ? "FAILED" : "passed", errors);
+		if (errors) res = VK_ERROR_FORMAT_NOT_SUPPORTED;
+	}
+	delete_JobQueue(&vkGPU, &queue);
+	free(latency);
+	delete_VkGPU(&vkGPU);
+	return res;
+}
+#endif
@@ -0,0 +1,501 @@
+#include "VulkanTransposition.h"
+
+
+//Runtime kernel generator: GLSL of a permutation of a tensor with up to 4 dimensions is emitted for the exact sizes,
+//element type, tile and epilogue of the request, with every loop unrolled and bounds checks only where the sizes need
+//them. It is compiled with shaderc when the build found it, with glslangValidator otherwise, and the SPIR-V is cached
+//on disk under the hash of the source, so a configuration is compiled once per machine
+#define VKT_KERNEL_SOURCE_SIZE   65536
+
+
+uint32_t
+append_KernelSource(char* source, size_t* length, const char* format, ...)
+{
+	//printf to the end of source, 0 if the source is full
+	va_list args;
+	va_start(args, format);
+	int written = vsnprintf(source + length[0], VKT_KERNEL_SOURCE_SIZE - length[0], format, args);
+	va_end(args);
+	if (written < 0 || length[0] + written >= VKT_KERNEL_SOURCE_SIZE) return 0;
+	length[0] += written;
+	return 1;
+}
+
+
+VkResult
+check_KernelConfig(VkGPU* vkGPU, VkKernelConfig* config, uint32_t groupCount[3])
+{
+	//validate the configuration and get the grid of the generated kernel
+	if (config->rank == 0 || config->rank > VKT_KERNEL_MAX_RANK) return VK_ERROR_FORMAT_NOT_SUPPORTED;
+	if (config->elementSize != 4 && config->elementSize != 8) return VK_ERROR_FORMAT_NOT_SUPPORTED;
+	if (config->epilogue == VKT_EPILOGUE_SCALE && config->elementSize != 4) return VK_ERROR_FORMAT_NOT_SUPPORTED;
+	if (config->tile == 0 || (config->tile & (config->tile - 1)) != 0 || config->rows == 0 || config->tile % config->rows != 0) return VK_ERROR_FORMAT_NOT_SUPPORTED;
+	if (config->tile * config->rows > vkGPU->physicalDeviceProperties.limits.maxComputeWorkGroupInvocations) return VK_ERROR_FORMAT_NOT_SUPPORTED;
+	if (config->tile * (config->tile + 1) * config->elementSize > vkGPU->physicalDeviceProperties.limits.maxComputeSharedMemorySize) return VK_ERROR_FORMAT_NOT_SUPPORTED;
+	uint32_t used = 0;
+	uint64_t elements = 1;
+	for (uint32_t k = 0; k < config->rank; k++) {
+		if (config->perm[k] >= config->rank || (used & (1 << config->perm[k])) || config->size[k] == 0) return VK_ERROR_FORMAT_NOT_SUPPORTED;
+		used |= 1 << config->perm[k];
+		elements *= config->size[k];
+	}
+	if (elements * config->elementSize / 4 > 0xFFFFFFFFull) return VK_ERROR_FORMAT_NOT_SUPPORTED;
+	//strided views: rows of one dimension never overlap the next one, and the last element stays addressable
+	uint64_t inExtent = 1, outExtent = 1;
+	for (uint32_t k = 0; k < config->rank; k++) {
+		uint64_t inStride = (config->inputStride[k] != 0) ? config->inputStride[k] : inExtent;
+		uint64_t outStride = (config->outputStride[k] != 0) ? config->outputStride[k] : outExtent;
+		if ((k == 0 && (inStride != 1 || outStride != 1)) || inStride < inExtent || outStride < outExtent) return VK_ERROR_FORMAT_NOT_SUPPORTED;
+		inExtent = inStride * config->size[k];
+		outExtent = outStride * config->size[config->perm[k]];
+	}
+	if (inExtent * config->elementSize / 4 > 0xFFFFFFFFull || outExtent * config->elementSize / 4 > 0xFFFFFFFFull) return VK_ERROR_FORMAT_NOT_SUPPORTED;
+	//tiled kernels: x - tiles along output dimension 0, y - tiles along input dimension 0, z - the other dimensions.
+	//Copy kernels (input dimension 0 stays the fastest): x - tile * tile elements of output dimension 0, y - the others
+	uint64_t other = 1;
+	uint32_t b = 0;
+	for (uint32_t k = 0; k < config->rank; k++) if (config->perm[k] == 0) b = k;
+	for (uint32_t k = 1; k < config->rank; k++) if (k != b) other *= config->size[config->perm[k]];
+	uint32_t outer = config->size[config->perm[0]];
+	if (other > 0xFFFFFFFFull) return VK_ERROR_FORMAT_NOT_SUPPORTED;
+	if (b == 0) {
+		uint32_t chunk = config->tile * config->tile;
+		groupCount[0] = (outer + chunk - 1) / chunk;
+		groupCount[1] = (uint32_t) other;
+		groupCount[2] = 1;
+	}
+	else {
+		groupCount[0] = (outer + config->tile - 1) / config->tile;
+		groupCount[1] = (config->size[0] + config->tile - 1) / config->tile;
+		groupCount[2] = (uint32_t) other;
+	}
+	for (uint32_t k = 0; k < 3; k++)
+		if (groupCount[k] > vkGPU->physicalDeviceProperties.limits.maxComputeWorkGroupCount[k]) return VK_ERROR_FORMAT_NOT_SUPPORTED;
+	return VK_SUCCESS;
+}
+
+
+uint32_t
+generate_KernelSource(VkKernelConfig* config, char* source)
+{
+	//GLSL of the configuration checked by check_KernelConfig, 0 if it does not fit the source
+	uint32_t rank = config->rank;
+	uint32_t outSize[VKT_KERNEL_MAX_RANK], inStride[VKT_KERNEL_MAX_RANK], outStride[VKT_KERNEL_MAX_RANK];
+	uint32_t b = 0;
+	for (uint32_t k = 0; k < rank; k++) {
+		outSize[k] = config->size[config->perm[k]];
+		inStride[k] = (k == 0) ? 1 : inStride[k - 1] * config->size[k - 1];
+		if (config->inputStride[k] != 0) inStride[k] = config->inputStride[k];
+		if (config->perm[k] == 0) b = k;
+	}
+	for (uint32_t k = 0; k < rank; k++) {
+		outStride[k] = (k == 0) ? 1 : outStride[k - 1] * outSize[k - 1];
+		if (config->outputStride[k] != 0) outStride[k] = config->outputStride[k];
+	}
+	uint32_t a = config->perm[0];
+	uint32_t tile = config->tile, rows = config->rows;
+	const char* type = (config->elementSize == 8) ? "uvec2" : "uint";
+	size_t length = 0;
+	uint32_t ok = 1;
+
+	ok &= append_KernelSource(source, &length, "#version 450\n//generated: rank %d, input", rank);
+	for (uint32_t k = 0; k < rank; k++) ok &= append_KernelSource(source, &length, " %d", config->size[k]);
+	ok &= append_KernelSource(source, &length, ", permutation");
+	for (uint32_t k = 0; k < rank; k++) ok &= append_KernelSource(source, &length, " %d", config->perm[k]);
+	ok &= append_KernelSource(source, &length, ", %d-byte %s, tile %d x %d, epilogue %d", config->elementSize,
+	                          (config->dtype == VKT_DTYPE_FLOAT) ? "float" : "uint", tile, rows, config->epilogue);
+	ok &= append_KernelSource(source, &length, ", strides");
+	for (uint32_t k = 0; k < rank; k++) ok &= append_KernelSource(source, &length, " %d", inStride[k]);
+	ok &= append_KernelSource(source, &length, " ->");
+	for (uint32_t k = 0; k < rank; k++) ok &= append_KernelSource(source, &length, " %d", outStride[k]);
+	ok &= append_KernelSource(source, &length, "\n");
+	ok &= append_KernelSource(source, &length, "layout(std430, binding = 0) readonly buffer Input { %s inputs[]; };\n", type);
+	ok &= append_KernelSource(source, &length, "layout(std430, binding = 1) writeonly buffer Output { %s outputs[]; };\n", type);
+	ok &= append_KernelSource(source, &length, "layout(push_constant) uniform PushConsts { uint pushID; uint inputOffset; uint outputOffset; } consts;\n");
+	ok &= append_KernelSource(source, &length, "layout(local_size_x = %d, local_size_y = %d, local_size_z = 1) in;\n", (b == 0) ? tile * rows : tile, (b == 0) ? 1 : rows);
+	if (b != 0) ok &= append_KernelSource(source, &length, "shared %s tile[%d];\n", type, tile * (tile + 1));
+
+	//epilogue
+	ok &= append_KernelSource(source, &length, "%s epilogue(%s v) {\n", type, type);
+	if (config->epilogue == VKT_EPILOGUE_SCALE && config->dtype == VKT_DTYPE_FLOAT)
+		ok &= append_KernelSource(source, &length, "\treturn floatBitsToUint(uintBitsToFloat(v) * %.9e);\n", config->alpha);
+	else if (config->epilogue == VKT_EPILOGUE_SCALE)
+		ok &= append_KernelSource(source, &length, "\treturn v * %uu;\n", (uint32_t) config->alpha);
+	else ok &= append_KernelSource(source, &length, "\treturn v;\n");
+	ok &= append_KernelSource(source, &length, "}\n\nvoid main()\n{\n");
+
+	//offsets of the dimensions folded into the last grid dimension
+	const char* folded = (b == 0) ? "gl_WorkGroupID.y" : "gl_WorkGroupID.z";
+	ok &= append_KernelSource(source, &length, "\tuint z = %s;\n\tuint inBase = consts.inputOffset;\n\tuint outBase = consts.outputOffset;\n", folded);
+	uint32_t last = rank - 1;
+	if (last == b) last--;
+	for (uint32_t k = 1; k < rank; k++) {
+		if (k == b) continue;
+		ok &= append_KernelSource(source, &length, "\tinBase += (z %% %uu) * %uu;\n\toutBase += (z %% %uu) * %uu;\n",
+		                          outSize[k], inStride[config->perm[k]], outSize[k], outStride[k]);
+		if (k < last) ok &= append_KernelSource(source, &length, "\tz /= %uu;\n", outSize[k]);
+	}
+
+	if (b == 0) {
+		//input dimension 0 stays the fastest: coalesced copy of tile x tile elements per workgroup
+		uint32_t threads = tile * rows, chunk = tile * tile;
+		ok &= append_KernelSource(source, &length, "\tuint x = gl_WorkGroupID.x * %uu + gl_LocalInvocationID.x;\n", chunk);
+		for (uint32_t k = 0; k < chunk && k < outSize[0]; k += threads) {
+			//the last chunk of a row is partial unless the row is a multiple of it
+			if (outSize[0] % chunk != 0) ok &= append_KernelSource(source, &length, "\tif (x + %uu < %uu)\n\t", k, outSize[0]);
+			ok &= append_KernelSource(source, &length, "\toutputs[outBase + x + %uu] = epilogue(inputs[inBase + x + %uu]);\n", k, k);
+		}
+	}
+	else {
+		//read tile rows along input dimension 0, write them along output dimension 0. Element (i, j) of the tile is
+		//input dimension a offset i and input dimension 0 offset j, rows are padded against bank conflicts
+		uint32_t checkA = (outSize[0] % tile != 0), checkB = (config->size[0] % tile != 0);
+		ok &= append_KernelSource(source, &length, "\tuint ta = gl_WorkGroupID.x * %uu;\n\tuint tb = gl_WorkGroupID.y * %uu;\n", tile, tile);
+		ok &= append_KernelSource(source, &length, "\tuint lx = gl_LocalInvocationID.x;\n\tuint ly = gl_LocalInvocationID.y;\n");
+		for (uint32_t k = 0; k < tile; k += rows) {
+			if (checkA || checkB) {
+				ok &= append_KernelSource(source, &length, "\tif (");
+				if (checkB) ok &= append_KernelSource(source, &length, "tb + lx < %uu%s", config->size[0], checkA ? " && " : "");
+				if (checkA) ok &= append_KernelSource(source, &length, "ta + ly + %uu < %uu", k, outSize[0]);
+				ok &= append_KernelSource(source, &length, ")\n\t");
+			}
+			ok &= append_KernelSource(source, &length, "\ttile[(ly + %uu) * %uu + lx] = inputs[inBase + tb + lx + (ta + ly + %uu) * %uu];\n", k, tile + 1, k, inStride[a]);
+		}
+		ok &= append_KernelSource(source, &length, "\tmemoryBarrierShared();\n\tbarrier();\n");
+		for (uint32_t k = 0; k < tile; k += rows) {
+			if (checkA || checkB) {
+				ok &= append_KernelSource(source, &length, "\tif (");
+				if (checkA) ok &= append_KernelSource(source, &length, "ta + lx < %uu%s", outSize[0], checkB ? " && " : "");
+				if (checkB) ok &= append_KernelSource(source, &length, "tb + ly + %uu < %uu", k, config->size[0]);
+				ok &= append_KernelSource(source, &length, ")\n\t");
+			}
+			ok &= append_KernelSource(source, &length, "\toutputs[outBase + ta + lx + (tb + ly + %uu) * %uu] = epilogue(tile[lx * %uu + ly + %uu]);\n", k, outStride[b], tile + 1, k);
+		}
+	}
+	ok &= append_KernelSource(source, &length, "}\n");
+	return ok;
+}
+
+
+uint64_t
+get_KernelHash(const char* data, size_t size, uint64_t hash)
+{
+	//FNV-1a, start with hash = 0xCBF29CE484222325
+	for (size_t i = 0; i < size; i++) {
+		hash ^= (uint8_t) data[i];
+		hash *= 0x100000001B3ull;
+	}
+	return hash;
+}
+
+
+VkResult
+get_KernelCacheDir(char* dir)
+{
+	//VKT_KERNEL_CACHE, the user cache directory or a private directory in /tmp, created if missing. The cached SPIR-V is
+	//loaded into the driver, so the directory has to belong to the user and must not be writable by anybody else
+	const char* env = getenv("VKT_KERNEL_CACHE");
+	if (env != NULL && env[0] != 0) sprintf(dir, "%.200s", env);
+#ifdef _WIN32
+	else if ((env = getenv("LOCALAPPDATA")) != NULL) sprintf(dir, "%.200s\\VulkanTransposition", env);
+	else sprintf(dir, ".");
+	_mkdir(dir);
+#else
+	else if ((env = getenv("XDG_CACHE_HOME")) != NULL && env[0] != 0) sprintf(dir, "%.200s/VulkanTransposition", env);
+	else if ((env = getenv("HOME")) != NULL && env[0] != 0) {
+		sprintf(dir, "%.200s/.cache", env);
+		mkdir(dir, 0700);
+		sprintf(dir, "%.200s/.cache/VulkanTransposition", env);
+	}
+	else sprintf(dir, "/tmp/VulkanTransposition-%u", (unsigned) getuid());
+	mkdir(dir, 0700);
+	struct stat st;
+	if (lstat(dir, &st) != 0 || !S_ISDIR(st.st_mode) || st.st_uid != getuid() || (st.st_mode & (S_IWGRP | S_IWOTH)) != 0) {
+		printf("Kernel cache %s is not a directory of this user that only the user can write\n", dir);
+		return VK_ERROR_INITIALIZATION_FAILED;
+	}
+#endif
+	return VK_SUCCESS;
+}
+
+
+uint32_t
+check_KernelSpirv(const char* path)
+{
+	//a cached kernel is used only if it is a complete SPIR-V module: the magic number and a size of whole words past the header
+	FILE* fp = fopen(path, "rb");
+	if (fp == NULL) return 0;
+	uint32_t magic = 0;
+	uint32_t valid = (fread(&magic, sizeof(uint32_t), 1, fp) == 1) && (magic == 0x07230203) && (fseek(fp, 0, SEEK_END) == 0);
+	long size = valid ? ftell(fp) : 0;
+	fclose(fp);
+	return valid && size >= 20 && size % 4 == 0;
+}
+
+
+VkResult
+compile_Kernel(VkKernelConfig* config, char* spirvPath, uint32_t* cacheHit, double* time)
+{
+	//SPIR-V of the configuration in the disk cache, compiled on a miss. spirvPath - 256 chars, the cached file, ready
+	//for create_ComputeApp. time - ms of the generation and compilation
+	double t = get_TimeMs();
+	char* source = (char*) malloc(VKT_KERNEL_SOURCE_SIZE);
+	if (source == NULL) return VK_ERROR_OUT_OF_HOST_MEMORY;
+	if (!generate_KernelSource(config, source)) {
+		free(source);
+		return VK_ERROR_FORMAT_NOT_SUPPORTED;
+	}
+	//the compiler is a part of the key, so the SPIR-V of one compiler is never taken for another
+#if defined(VKT_SHADERC)
+	const char* compiler = "shaderc performance vulkan1.1";
+#elif defined(VKT_GLSL_VALIDATOR)
+	const char* compiler = "glslangValidator vulkan1.1";
+#else
+	const char* compiler = "none";
+#endif
+	uint64_t hash = get_KernelHash(compiler, strlen(compiler), 0xCBF29CE484222325ull);
+	hash = get_KernelHash(source, strlen(source), hash);
+	char dir[256];
+	cacheHit[0] = 0;
+	VkResult res = get_KernelCacheDir(dir);
+	if (res != VK_SUCCESS) {
+		free(source);
+		return res;
+	}
+	sprintf(spirvPath, "%s/kernel_%016llx.spv", dir, (unsigned long long) hash);
+	if (check_KernelSpirv(spirvPath)) {
+		cacheHit[0] = 1;
+		free(source);
+		time[0] = get_TimeMs() - t;
+		return VK_SUCCESS;
+	}
+
+	//compile to a new temporary file, renamed when complete, so concurrent processes never read a partial kernel
+	char temporaryPath[300];
+#ifdef _WIN32
+	sprintf(temporaryPath, "%.200s.%llu.tmp", spirvPath, (unsigned long long) (get_TimeMs() * 1000));
+#else
+	sprintf(temporaryPath, "%.200s.XXXXXX", spirvPath);
+	int temporaryFd = mkstemp(temporaryPath);
+	if (temporaryFd < 0) {
+		printf("Could not create a temporary kernel in %s: %s\n", dir, strerror(errno));
+		free(source);
+		return VK_ERROR_INITIALIZATION_FAILED;
+	}
+	close(temporaryFd);
+#endif
+#if defined(VKT_SHADERC)
+	shaderc_compiler_t shadercCompiler = shaderc_compiler_initialize();
+	shaderc_compile_options_t options = shaderc_compile_options_initialize();
+	shaderc_compile_options_set_target_env(options, shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_1);
+	shaderc_compile_options_set_optimization_level(options, shaderc_optimization_level_performance);
+	shaderc_compilation_result_t result = shaderc_compile_into_spv(shadercCompiler, source, strlen(source), shaderc_compute_shader, "generated.comp", "main", options);
+	if (shaderc_result_get_compilation_status(result) != shaderc_compilation_status_success) {
+		printf("Kernel compilation failed: %s\n", shaderc_result_get_error_message(result));
+		res = VK_ERROR_INITIALIZATION_FAILED;
+	}
+	else {
+		FILE* fp = fopen(temporaryPath, "wb");
+		if (fp == NULL || fwrite(shaderc_result_get_bytes(result), 1, shaderc_result_get_length(result), fp) != shaderc_result_get_length(result)) res = VK_ERROR_INITIALIZATION_FAILED;
+		if (fp != NULL) fclose(fp);
+	}
+	shaderc_result_release(result);
+	shaderc_compile_options_release(options);
+	shaderc_compiler_release(shadercCompiler);
+#elif defined(VKT_GLSL_VALIDATOR)
+	char sourcePath[300];
+	char command[1024];
+	sprintf(sourcePath, "%s.comp", temporaryPath);
+	FILE* fp = fopen(sourcePath, "wbx");
+	if (fp == NULL || fwrite(source, 1, strlen(source), fp) != strlen(source)) res = VK_ERROR_INITIALIZATION_FAILED;
+	if (fp != NULL) fclose(fp);
+	if (res == VK_SUCCESS) {
+#ifdef _WIN32
+		sprintf(command, "\"\"%s\" -V --target-env vulkan1.1 \"%s\" -o \"%s\" > NUL\"", VKT_GLSL_VALIDATOR, sourcePath, temporaryPath);
+#else
+		sprintf(command, "\"%s\" -V --target-env vulkan1.1 \"%s\" -o \"%s\" > /dev/null", VKT_GLSL_VALIDATOR, sourcePath, temporaryPath);
+#endif
+		if (system(command) != 0) {
+			printf("Kernel compilation failed: %s\n", command);
+			res = VK_ERROR_INITIALIZATION_FAILED;
+		}
+	}
+	remove(sourcePath);
+#else
+	printf("No runtime shader compiler: build with shaderc or glslangValidator\n");
+	res = VK_ERROR_FEATURE_NOT_PRESENT;
+#endif
+	if (res == VK_SUCCESS && rename(temporaryPath, spirvPath) != 0) {
+		//another process may have cached the same kernel meanwhile
+		remove(temporaryPath);
+		if (!check_KernelSpirv(spirvPath)) res = VK_ERROR_INITIALIZATION_FAILED;
+	}
+	if (res != VK_SUCCESS) remove(temporaryPath);
+	free(source);
+	time[0] = get_TimeMs() - t;
+	return res;
+}
+
+
+VkResult
+create_KernelApp(VkGPU* vkGPU, VkKernelConfig* config, VkBuffer* input, VkBuffer* output, VkDeviceSize bufferSize,
+                 VkApplication* app, uint32_t groupCount[3], uint32_t* cacheHit, double* time)
+{
+	//generated kernel of the configuration with input (binding 0) and output (binding 1). time - ms to get the SPIR-V
+	VkResult res = check_KernelConfig(vkGPU, config, groupCount);
+	if (res != VK_SUCCESS) return res;
+	char spirvPath[256];
+	res = compile_Kernel(config, spirvPath, cacheHit, time);
+	if (res != VK_SUCCESS) return res;
+	//every constant is in the source
+	VkSpecializationInfo specializationInfo = { 0, NULL, 0, NULL };
+	VkBuffer*    appBuffer[2]   = { input, output };
+	VkDeviceSize bufferSizes[2] = { bufferSize, bufferSize };
+	return create_ComputeApp(vkGPU->device, 2, appBuffer, bufferSizes, &specializationInfo, &app->descriptorPool, &app->descriptorSetLayout,
+	                         &app->descriptorSet, (const char*) spirvPath, &app->pipelineLayout, &app->pipeline);
+}
+
+
+VkResult
+Example_VulkanKernel(uint32_t deviceID,
+                     uint32_t coalescedMemory,
+                     uint32_t size)
+{
+	//generated kernels for permutations of 2 to 4 dimensions, 4 and 8-byte types, several tiles and the scale epilogue.
+	//Reports compile or cache hit time, bandwidth and verification of every kernel, and compares the size x size float
+	//transposition with the generic transposition_no_bank_conflicts.comp
+	VkGPU vkGPU = { 0 };
+	vkGPU.device_id = deviceID;
+	VkResult res = create_VkGPU(&vkGPU);
+	if (res != VK_SUCCESS) return res;
+	coalescedMemory = get_CoalescedMemory(&vkGPU, coalescedMemory);
+
+	VkKernelConfig configs[] = {
+		{ 2, { size, size },         { 1, 0 },       4, VKT_DTYPE_FLOAT, 32, 8, VKT_EPILOGUE_NONE,  1.0f },
+		{ 2, { size, size },         { 1, 0 },       4, VKT_DTYPE_FLOAT, 16, 4, VKT_EPILOGUE_NONE,  1.0f },
+		{ 2, { 1000, 600 },          { 1, 0 },       4, VKT_DTYPE_UINT,  32, 8, VKT_EPILOGUE_NONE,  1.0f },
+		{ 2, { 512, 512 },           { 1, 0 },       8, VKT_DTYPE_FLOAT, 16, 4, VKT_EPILOGUE_NONE,  1.0f },
+		{ 2, { size, size },         { 1, 0 },       4, VKT_DTYPE_FLOAT, 32, 8, VKT_EPILOGUE_SCALE, 0.5f },
+		{ 3, { 64, 128, 32 },        { 2, 0, 1 },    4, VKT_DTYPE_UINT,  32, 8, VKT_EPILOGUE_NONE,  1.0f },
+		{ 3, { 128, 64, 32 },        { 1, 2, 0 },    4, VKT_DTYPE_FLOAT, 32, 8, VKT_EPILOGUE_NONE,  1.0f },
+		{ 4, { 32, 16, 8, 64 },      { 0, 2, 1, 3 }, 4, VKT_DTYPE_UINT,  32, 8, VKT_EPILOGUE_SCALE, 3.0f },
+		{ 4, { 16, 32, 8, 32 },      { 3, 2, 1, 0 }, 8, VKT_DTYPE_UINT,  16, 8, VKT_EPILOGUE_NONE,  1.0f },
+	};
+	uint32_t configCount = sizeof(configs) / sizeof(configs[0]);
+	uint32_t failed = 0, batch = 10;
+	char dir[256];
+	res = get_KernelCacheDir(dir);
+	if (res == VK_SUCCESS) printf("Kernel cache: %s\n\n%-18s %-10s %-7s %-6s %-9s %-18s %10s %10s %s\n", dir, "input", "perm", "type", "tile", "epilogue", "SPIR-V", "time, ms", "GB/s", "result");
+	for (uint32_t c = 0; c < configCount && res == VK_SUCCESS; c++) {
+		VkKernelConfig* config = &configs[c];
+		uint64_t elements = 1;
+		for (uint32_t k = 0; k < config->rank; k++) elements *= config->size[k];
+		VkDeviceSize bufferSize = elements * config->elementSize;
+		VkBuffer buffer[2] = { 0 };
+		VkDeviceMemory bufferDeviceMemory[2] = { 0 };
+		for (uint32_t k = 0; k < 2 && res == VK_SUCCESS; k++) {
+			res = allocate_Buffer_DeviceMemory(vkGPU.physicalDevice, vkGPU.device,
+			                                   VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			                                   &vkGPU.physicalDeviceMemoryProperties, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			                                   bufferSize, &buffer[k], &bufferDeviceMemory[k]);
+		}
+		uint32_t words = config->elementSize / 4;
+		uint32_t* input = (uint32_t*) malloc((size_t) bufferSize);
+		uint32_t* output = (uint32_t*) malloc((size_t) bufferSize);
+		if (res == VK_SUCCESS && (input == NULL || output == NULL)) res = VK_ERROR_OUT_OF_HOST_MEMORY;
+		VkApplication app = { 0 };
+		uint32_t groupCount[3] = { 0 };
+		uint32_t cacheHit = 0;
+		double time_compile = 0, time_kernel = 0;
+		if (res == VK_SUCCESS) {
+			for (uint64_t i = 0; i < elements; i++) {
+				float f = (float) i;
+				input[i * words] = (uint32_t) i;
+				if (config->dtype == VKT_DTYPE_FLOAT && words == 1) memcpy(&input[i * words], &f, sizeof(float));
+				if (words == 2) input[i * words + 1] = ~(uint32_t) i;
+			}
+			res = upload_Data(vkGPU.physicalDevice, vkGPU.device, input, &vkGPU.physicalDeviceMemoryProperties, vkGPU.commandPool,
+			                  vkGPU.queue, &vkGPU.fence, &buffer[0], bufferSize);
+		}
+		if (res == VK_SUCCESS) res = create_KernelApp(&vkGPU, config, &buffer[0], &buffer[1], bufferSize, &app, groupCount, &cacheHit, &time_compile);
+		if (res == VK_SUCCESS)
+			res = run_App(vkGPU.device, vkGPU.commandPool, app.pipeline, app.pipelineLayout, &app.descriptorSet, groupCount, vkGPU.queue, &vkGPU.fence, batch, &time_kernel);
+		if (res == VK_SUCCESS)
+			res = download_Data(vkGPU.physicalDevice, vkGPU.device, vkGPU.commandPool, &vkGPU.physicalDeviceMemoryProperties,
+			                    vkGPU.queue, &vkGPU.fence, output, &buffer[1], bufferSize);
+
+		if (res == VK_SUCCESS) {
+			//output element o has output coordinates c, input element sum c[k] * inStride[perm[k]]
+			uint32_t inStride[VKT_KERNEL_MAX_RANK];
+			for (uint32_t k = 0; k < config->rank; k++) inStride[k] = (k == 0) ? 1 : inStride[k - 1] * config->size[k - 1];
+			uint64_t errors = 0;
+			for (uint64_t o = 0; o < elements; o++) {
+				uint64_t rest = o, src = 0;
+				for (uint32_t k = 0; k < config->rank; k++) {
+					uint32_t outSize = config->size[config->perm[k]];
+					src += (rest % outSize) * inStride[config->perm[k]];
+					rest /= outSize;
+				}
+				for (uint32_t w = 0; w < words; w++) {
+					uint32_t expected = input[src * words + w];
+					if (config->epilogue == VKT_EPILOGUE_SCALE && config->dtype == VKT_DTYPE_FLOAT) {
+						float f;
+						memcpy(&f, &expected, sizeof(float));
+						f *= config->alpha;
+						memcpy(&expected, &f, sizeof(float));
+					}
+					else if (config->epilogue == VKT_EPILOGUE_SCALE) expected *= (uint32_t) config->alpha;
+					if (output[o * words + w] != expected) errors++;
+				}
+			}
+			char shape[64], perm[32];
+			int n = sprintf(shape, "%d", config->size[0]);
+			for (uint32_t k = 1; k < config->rank; k++) n += sprintf(shape + n, "x%d", config->size[k]);
+			n = sprintf(perm, "%d", config->perm[0]);
+			for (uint32_t k = 1; k < config->rank; k++) n += sprintf(perm + n, ",%d", config->perm[k]);
+			char tile[16], spirv[32];
+			sprintf(tile, "%dx%d", config->tile, config->rows);
+			sprintf(spirv, "%s %.1f ms", cacheHit ? "cached" : "compiled", time_compile);
+			printf("%-18s %-10s %-7s %-6s %-9s %-18s %10.3f %10.2f %s\n", shape, perm,
+			       (config->dtype == VKT_DTYPE_FLOAT) ? ((words == 2) ? "float64" : "float32") : ((words == 2) ? "uint64" : "uint32"),
+			       tile, (config->epilogue == VKT_EPILOGUE_SCALE) ? "scale" : "none", spirv, time_kernel,
+			       2.0 * bufferSize / 1024.0 / 1024.0 / 1024.0 / time_kernel * 1000, errors ? "FAILED" : "passed");
+			failed += (errors != 0);
+		}
+		else printf("Kernel %d failed, error code: %d\n", c, res);
+
+		//the generic kernel on the first configuration
+		if (res == VK_SUCCESS && c == 0 && size % (coalescedMemory / sizeof(float)) == 0) {
+			VkApplication generic = { 0 };
+			double time_generic = 0;
+			char shaderPath[256];
+			sprintf(shaderPath, "%stransposition_no_bank_conflicts.spv", SHADER_DIR);
+			VkBuffer*    appBuffer[2]   = { &buffer[0], &buffer[1] };
+			VkDeviceSize bufferSizes[2] = { bufferSize, bufferSize };
+			uint32_t     systemSize[3]  = { size, size, 1 };
+			res = create_App(vkGPU.device, &generic.specializationConstants, coalescedMemory, appBuffer, bufferSizes, systemSize,
+			                 &generic.descriptorPool, &generic.descriptorSetLayout, &generic.descriptorSet, (const char*) shaderPath, &generic.pipelineLayout, &generic.pipeline);
+			uint32_t genericGroupCount[3] = { size / generic.specializationConstants.localSize[0], size / generic.specializationConstants.localSize[1], 1 };
+			if (res == VK_SUCCESS)
+				res = run_App(vkGPU.device, vkGPU.commandPool, generic.pipeline, generic.pipelineLayout, &generic.descriptorSet, genericGroupCount, vkGPU.queue, &vkGPU.fence, batch, &time_generic);
+			if (res == VK_SUCCESS)
+				printf("%-18s %-10s %-7s %-6s %-9s %-18s %10.3f %10.2f (transposition_no_bank_conflicts.comp)\n", "", "", "", "", "", "generic",
+				       time_generic, 2.0 * bufferSize / 1024.0 / 1024.0 / 1024.0 / time_generic * 1000);
+			if (generic.pipeline != VK_NULL_HANDLE) deleteApp(&vkGPU, &generic);
+		}
+
+		if (app.pipeline != VK_NULL_HANDLE) deleteApp(&vkGPU, &app);
+		free(input);
+		free(output);
+		for (uint32_t k = 0; k < 2; k++) {
+			vkDestroyBuffer(vkGPU.device, buffer[k], NULL);
+			vkFreeMemory(vkGPU.device, bufferDeviceMemory[k], NULL);
+		}
+	}
+	if (res == VK_SUCCESS) {
+		printf("\nVerification %s\n", failed ? "FAILED" : "passed");
+		if (failed) res = VK_ERROR_FORMAT_NOT_SUPPORTED;
+	}
+	delete_VkGPU(&vkGPU);
+	return res;
+}
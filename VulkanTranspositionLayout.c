@@ -0,0 +1,259 @@
+#include "VulkanTransposition.h"
+
+
+//matrix layouts of the layout conversion engine (layout_conversion.comp)
+#define VKT_LAYOUT_ROW_MAJOR 0
+#define VKT_LAYOUT_BLOCKED   1 //blocks in row-major order, elements in row-major order inside a block
+#define VKT_LAYOUT_MORTON    2 //blocks in Z-order, 1x1 blocks give the element-wise Morton layout
+#define VKT_LAYOUT_HILBERT   3 //blocks along the Hilbert curve
+
+typedef struct {
+	uint32_t order;   //VKT_LAYOUT_*
+	uint32_t block[2];//block width and height in elements, ignored for row-major
+} VkMatrixLayout;
+
+typedef struct {
+	uint32_t localSize[3];
+	uint32_t size[2];      //logical size of the input matrix
+	VkMatrixLayout input;
+	VkMatrixLayout output;
+	uint32_t transposed;   //1 - write the transposed matrix
+} VkLayoutSpecializationConstantsLayout;//specialization constants of layout_conversion.comp
+
+
+uint64_t
+get_MortonIndex(uint32_t x, uint32_t y)
+{
+	uint64_t d = 0;
+	for (uint32_t b = 0; b < 32; b++) d |= ((uint64_t) ((x >> b) & 1) << (2 * b)) | ((uint64_t) ((y >> b) & 1) << (2 * b + 1));
+	return d;
+}
+
+
+uint64_t
+get_HilbertIndex(uint32_t n, uint32_t x, uint32_t y)
+{
+	//distance of (x, y) along the Hilbert curve filling an n x n grid, n is a power of two
+	uint64_t d = 0;
+	for (uint32_t s = n / 2; s > 0; s /= 2) {
+		uint32_t rx = (x & s) > 0;
+		uint32_t ry = (y & s) > 0;
+		d += (uint64_t) s * s * ((3 * rx) ^ ry);
+		if (ry == 0) {
+			if (rx == 1) {
+				x = n - 1 - x;
+				y = n - 1 - y;
+			}
+			uint32_t t = x;
+			x = y;
+			y = t;
+		}
+	}
+	return d;
+}
+
+
+uint64_t
+get_LayoutIndex(const VkMatrixLayout* layout, uint32_t sizeX, uint32_t x, uint32_t y)
+{
+	//address of element (x, y) in a matrix with sizeX columns, same as index() of layout_conversion.comp
+	if (layout->order == VKT_LAYOUT_ROW_MAJOR) return (uint64_t) y * sizeX + x;
+	uint32_t bx = x / layout->block[0], by = y / layout->block[1], blocksX = sizeX / layout->block[0];
+	uint64_t b = (layout->order == VKT_LAYOUT_MORTON) ? get_MortonIndex(bx, by) :
+	             (layout->order == VKT_LAYOUT_HILBERT) ? get_HilbertIndex(blocksX, bx, by) : (uint64_t) by * blocksX + bx;
+	return b * layout->block[0] * layout->block[1] + (y % layout->block[1]) * layout->block[0] + x % layout->block[0];
+}
+
+
+VkResult
+check_MatrixLayout(const VkMatrixLayout* layout, uint32_t sizeX, uint32_t sizeY, uint32_t tile)
+{
+	//the kernel converts aligned tile x tile squares: blocks either contain whole tiles or tile whole tiles,
+	//curve orders need a square power of two grid of square blocks
+	if (sizeX % tile != 0 || sizeY % tile != 0) return VK_ERROR_FORMAT_NOT_SUPPORTED;
+	if (layout->order == VKT_LAYOUT_ROW_MAJOR) return VK_SUCCESS;
+	if (layout->order > VKT_LAYOUT_HILBERT) return VK_ERROR_FORMAT_NOT_SUPPORTED;
+	for (uint32_t i = 0; i < 2; i++) {
+		uint32_t block = layout->block[i];
+		if (block == 0 || (i == 0 ? sizeX : sizeY) % block != 0) return VK_ERROR_FORMAT_NOT_SUPPORTED;
+		if (block % tile != 0 && tile % block != 0) return VK_ERROR_FORMAT_NOT_SUPPORTED;
+	}
+	if (layout->order != VKT_LAYOUT_BLOCKED) {
+		uint32_t blocks = sizeX / layout->block[0];
+		if (layout->block[0] != layout->block[1] || blocks != sizeY / layout->block[1] || (blocks & (blocks - 1)) != 0 || blocks > 65536)
+			return VK_ERROR_FORMAT_NOT_SUPPORTED;
+	}
+	return VK_SUCCESS;
+}
+
+
+void
+convert_Layout_CPU(const float* input,
+                   float* output,
+                   uint32_t width,
+                   uint32_t height,
+                   const VkMatrixLayout* inputLayout,
+                   const VkMatrixLayout* outputLayout,
+                   uint32_t transposed)
+{
+	//reference layout conversion, element by element
+	uint32_t outputSizeX = transposed ? height : width;
+	for (uint32_t y = 0; y < height; y++) {
+		for (uint32_t x = 0; x < width; x++) {
+			uint64_t dst = transposed ? get_LayoutIndex(outputLayout, outputSizeX, y, x) : get_LayoutIndex(outputLayout, outputSizeX, x, y);
+			output[dst] = input[get_LayoutIndex(inputLayout, width, x, y)];
+		}
+	}
+}
+
+
+void
+print_MatrixLayout(char* name, const VkMatrixLayout* layout)
+{
+	const char* orders[4] = { "row-major", "blocked", "Morton", "Hilbert" };
+	if (layout->order == VKT_LAYOUT_ROW_MAJOR) sprintf(name, "row-major");
+	else sprintf(name, "%s %dx%d", orders[layout->order], layout->block[0], layout->block[1]);
+}
+
+
+VkResult
+Example_VulkanLayoutConversion(uint32_t deviceID,
+                               uint32_t coalescedMemory,
+                               uint32_t size,
+                               uint32_t blockSize)
+{
+	//row-major <-> blocked, Morton and Hilbert conversions of a size x size matrix, compared with the bandwidth of transfer.comp
+	VkGPU vkGPU = { 0 };
+	vkGPU.device_id = deviceID;
+	VkResult res = VK_SUCCESS;
+	res = create_VkGPU(&vkGPU);
+	if (res != VK_SUCCESS) return res;
+	coalescedMemory = get_CoalescedMemory(&vkGPU, coalescedMemory);
+	uint32_t tile = coalescedMemory / sizeof(float);
+
+	VkDeviceSize bufferSize = sizeof(float) * (VkDeviceSize) size * size;
+	VkBuffer inputBuffer = { 0 }, outputBuffer = { 0 };
+	VkDeviceMemory inputBufferDeviceMemory = { 0 }, outputBufferDeviceMemory = { 0 };
+	//the input of every conversion is the reference conversion of a row-major ramp into its input layout
+	float* buffer_rowMajor = NULL;
+	float* buffer_input    = NULL;
+	float* buffer_ref      = NULL;
+	float* buffer_output   = NULL;
+	uint32_t failed = 0;
+	res = allocate_Buffer_DeviceMemory(vkGPU.physicalDevice, vkGPU.device,
+                                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                           &vkGPU.physicalDeviceMemoryProperties, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                           bufferSize, &inputBuffer, &inputBufferDeviceMemory);
+	if (res != VK_SUCCESS) {
+		printf("Input buffer allocation failed, error code: %d\n", res);
+		goto cleanup;
+	}
+	res = allocate_Buffer_DeviceMemory(vkGPU.physicalDevice, vkGPU.device,
+                                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                           &vkGPU.physicalDeviceMemoryProperties, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                           bufferSize, &outputBuffer, &outputBufferDeviceMemory);
+	if (res != VK_SUCCESS) {
+		printf("Output buffer allocation failed, error code: %d\n", res);
+		goto cleanup;
+	}
+
+	//reference bandwidth: plain copy with transfer.comp
+	VkApplication app_bandwidth = { 0 };
+	VkBuffer*    buffer[2]      = { &inputBuffer, &outputBuffer };
+	VkDeviceSize bufferSizes[2] = { bufferSize, bufferSize };
+	uint32_t systemSize[3] = { size, size, 1 };
+	char shaderPath[256];
+	sprintf(shaderPath, "%stransfer.spv", SHADER_DIR);
+	res = create_App(vkGPU.device, &app_bandwidth.specializationConstants, coalescedMemory, buffer, bufferSizes, systemSize,
+	                 &app_bandwidth.descriptorPool, &app_bandwidth.descriptorSetLayout, &app_bandwidth.descriptorSet,
+	                 (const char*) shaderPath, &app_bandwidth.pipelineLayout, &app_bandwidth.pipeline);
+	if (res != VK_SUCCESS) {
+		printf("Bandwidth application creation failed, error code: %d\n", res);
+		goto cleanup;
+	}
+	double time_bandwidth = 0;
+	uint32_t groupCount[3] = { size / tile, size / tile, 1 };
+	res = run_App(vkGPU.device, vkGPU.commandPool, app_bandwidth.pipeline, app_bandwidth.pipelineLayout, &app_bandwidth.descriptorSet,
+	              groupCount, vkGPU.queue, &vkGPU.fence, 100, &time_bandwidth);
+	deleteApp(&vkGPU, &app_bandwidth);
+	if (res != VK_SUCCESS) {
+		printf("Bandwidth application run failed, error code: %d\n", res);
+		goto cleanup;
+	}
+	printf("System size: %dx%d\nTile: %dx%d\nTransfer time: %.3f ms (%.1f GB/s)\n", size, size, tile, tile,
+	       time_bandwidth, 2 * bufferSize / 1024.0 / 1024.0 / 1024.0 / (time_bandwidth / 1000));
+
+	//conversions in both directions; the last two fuse the conversion with transposition
+	VkMatrixLayout rowMajor = { VKT_LAYOUT_ROW_MAJOR, { 1, 1 } };
+	VkMatrixLayout blocked  = { VKT_LAYOUT_BLOCKED, { blockSize, blockSize } };
+	VkMatrixLayout morton   = { VKT_LAYOUT_MORTON, { 1, 1 } };
+	VkMatrixLayout hilbert  = { VKT_LAYOUT_HILBERT, { blockSize, blockSize } };
+	VkMatrixLayout hilbert1 = { VKT_LAYOUT_HILBERT, { 1, 1 } };
+	const VkMatrixLayout* conversions[8][2] = { { &rowMajor, &blocked }, { &blocked, &rowMajor },
+	                                            { &rowMajor, &morton },  { &morton, &rowMajor },
+	                                            { &rowMajor, &hilbert }, { &hilbert, &rowMajor },
+	                                            { &rowMajor, &blocked }, { &morton, &hilbert1 } };
+	const uint32_t transposed[8] = { 0, 0, 0, 0, 0, 0, 1, 1 };
+
+	buffer_rowMajor = (float*) malloc(bufferSize);
+	buffer_input    = (float*) malloc(bufferSize);
+	buffer_ref      = (float*) malloc(bufferSize);
+	buffer_output   = (float*) malloc(bufferSize);
+	if (buffer_rowMajor == NULL || buffer_input == NULL || buffer_ref == NULL || buffer_output == NULL) {
+		res = VK_ERROR_OUT_OF_HOST_MEMORY;
+		goto cleanup;
+	}
+	for (uint64_t i = 0; i < (uint64_t) size * size; i++) buffer_rowMajor[i] = (float) i;
+	for (uint32_t c = 0; c < 8; c++) {
+		char inputName[64], outputName[64];
+		print_MatrixLayout(inputName, conversions[c][0]);
+		print_MatrixLayout(outputName, conversions[c][1]);
+		if (check_MatrixLayout(conversions[c][0], size, size, tile) != VK_SUCCESS || check_MatrixLayout(conversions[c][1], size, size, tile) != VK_SUCCESS) {
+			printf("%s -> %s%s: skipped, unsupported for this size and tile\n", inputName, outputName, transposed[c] ? " transposed" : "");
+			continue;
+		}
+		convert_Layout_CPU(buffer_rowMajor, buffer_input, size, size, &rowMajor, conversions[c][0], 0);
+		convert_Layout_CPU(buffer_input, buffer_ref, size, size, conversions[c][0], conversions[c][1], transposed[c]);
+		res = upload_Data(vkGPU.physicalDevice, vkGPU.device, buffer_input, &vkGPU.physicalDeviceMemoryProperties,
+		                  vkGPU.commandPool, vkGPU.queue, &vkGPU.fence, &inputBuffer, bufferSize);
+		if (res != VK_SUCCESS) break;
+
+		VkApplication app = { 0 };
+		VkLayoutSpecializationConstantsLayout specializationConstants = { { tile, tile, 1 }, { size, size }, *conversions[c][0], *conversions[c][1], transposed[c] };
+		res = create_SpecializedApp(&vkGPU, &app, &specializationConstants, 12, &inputBuffer, &outputBuffer, bufferSize, "layout_conversion.spv");
+		if (res != VK_SUCCESS) {
+			printf("Layout conversion application creation failed, error code: %d\n", res);
+			break;
+		}
+		double time = 0;
+		res = run_App(vkGPU.device, vkGPU.commandPool, app.pipeline, app.pipelineLayout, &app.descriptorSet,
+		              groupCount, vkGPU.queue, &vkGPU.fence, 100, &time);
+		deleteApp(&vkGPU, &app);
+		if (res != VK_SUCCESS) {
+			printf("Layout conversion application run failed, error code: %d\n", res);
+			break;
+		}
+		res = download_Data(vkGPU.physicalDevice, vkGPU.device, vkGPU.commandPool, &vkGPU.physicalDeviceMemoryProperties,
+		                    vkGPU.queue, &vkGPU.fence, buffer_output, &outputBuffer, bufferSize);
+		if (res != VK_SUCCESS) break;
+		uint32_t passed = (memcmp(buffer_output, buffer_ref, bufferSize) == 0);
+		printf("%s -> %s%s: %.3f ms (%.1f GB/s, %.1f%% of transfer), verification %s\n",
+		       inputName, outputName, transposed[c] ? " transposed" : "", time,
+		       2 * bufferSize / 1024.0 / 1024.0 / 1024.0 / (time / 1000), time_bandwidth / time * 100,
+		       passed ? "passed" : "FAILED");
+		if (!passed) failed = 1;
+	}
+	if (res == VK_SUCCESS && failed) res = VK_ERROR_FORMAT_NOT_SUPPORTED;
+
+cleanup:
+	free(buffer_rowMajor);
+	free(buffer_input);
+	free(buffer_ref);
+	free(buffer_output);
+	vkDestroyBuffer(vkGPU.device, inputBuffer, NULL);
+	vkFreeMemory(vkGPU.device, inputBufferDeviceMemory, NULL);
+	vkDestroyBuffer(vkGPU.device, outputBuffer, NULL);
+	vkFreeMemory(vkGPU.device, outputBufferDeviceMemory, NULL);
+	delete_VkGPU(&vkGPU);
+	return res;
+}
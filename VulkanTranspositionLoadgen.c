@@ -0,0 +1,472 @@
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "VulkanTranspositionClient.h"
+
+//load generator for the transposition daemon: every thread opens its own connection and keeps `depth` requests in flight.
+//With --replay it re-issues a trace captured by the daemon (--capture): one connection per recorded connection, with the
+//recorded shapes, priorities and buffer offsets, either at the recorded arrival times (open loop) or with a fixed number of
+//requests in flight per connection (closed loop)
+#define VKT_REPLAY_MAX_CONNECTIONS 64      //recorded connections beyond this share the replay connections
+#define VKT_REPLAY_MAX_SHM         (1ull << 32)//shared memory of one replay connection
+
+typedef struct {
+	const char* socketPath;
+	uint32_t size;
+	uint32_t requests;
+	uint32_t depth;
+	uint32_t priorities;
+	uint32_t verify;
+	double* latency;       //client side latency of every request, ms
+	double* serverLatency; //latency reported by the daemon, ms
+	uint32_t completed;
+	uint32_t failed;
+} VkLoadgenThread;
+
+
+static double
+get_TimeMs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+
+static int
+compare_Double(const void* a, const void* b)
+{
+	double x = *(const double*) a;
+	double y = *(const double*) b;
+	return (x > y) - (x < y);
+}
+
+
+typedef struct {
+	const char* socketPath;
+	VkTranspositionTraceRecord* records;//records of the connection, by arrival
+	uint32_t count;
+	uint32_t depth;        //closed loop: requests in flight, 0 - open loop
+	double speed;          //open loop: arrival times are divided by it
+	double start;          //common start of the replay, ms
+	double* latency;       //client side latency of every request, ms
+	double* serverLatency; //latency reported by the daemon, ms
+	double* lateness;      //open loop: ms from the recorded arrival to the submission, valid for the first submitted records
+	uint32_t submitted;
+	uint32_t completed;
+	uint32_t failed;
+} VkReplayThread;
+
+
+static void*
+run_LoadgenThread(void* arg)
+{
+	VkLoadgenThread* thread = (VkLoadgenThread*) arg;
+	uint64_t matrixSize = (uint64_t) sizeof(float) * thread->size * thread->size;
+	//each slot of the shared memory holds one input and one output matrix
+	VkTranspositionClient client;
+	int32_t result = 0;
+	int res = connect_TranspositionService(&client, thread->socketPath, 2 * matrixSize * thread->depth, &result);
+	if (res != 0 || result != 0) {
+		if (res != 0) printf("Connection to %s failed: %s\n", thread->socketPath, strerror(-res));
+		else printf("Attach to %s failed, error code: %d\n", thread->socketPath, result);
+		thread->failed = thread->requests;
+		return NULL;
+	}
+	for (uint32_t slot = 0; slot < thread->depth; slot++) {
+		float* input = (float*) ((char*) client.shmData + 2 * slot * matrixSize);
+		for (uint64_t i = 0; i < (uint64_t) thread->size * thread->size; i++) input[i] = (float) i;
+	}
+
+	uint32_t size[3] = { thread->size, thread->size, 1 };
+	double* submitTime = (double*) malloc(sizeof(double) * (thread->requests + 1));
+	uint32_t* slotOfRequest = (uint32_t*) malloc(sizeof(uint32_t) * (thread->requests + 1));
+	uint32_t* freeSlots = (uint32_t*) malloc(sizeof(uint32_t) * thread->depth);
+	for (uint32_t slot = 0; slot < thread->depth; slot++) freeSlots[slot] = slot;
+	uint32_t freeCount = thread->depth, submitted = 0;
+
+	while (thread->completed + thread->failed < thread->requests) {
+		while (freeCount > 0 && submitted < thread->requests) {
+			uint32_t slot = freeSlots[--freeCount];
+			uint32_t requestID = 0;
+			uint64_t offset = 2 * slot * matrixSize;
+			if (submit_TranspositionService(&client, size, submitted % thread->priorities, offset, offset + matrixSize, &requestID) != 0) {
+				thread->failed = thread->requests - thread->completed;
+				goto done;
+			}
+			//request ids of a connection start at 1 and increase by 1
+			submitTime[requestID] = get_TimeMs();
+			slotOfRequest[requestID] = slot;
+			submitted++;
+		}
+		VkTranspositionReply reply;
+		if (wait_TranspositionService(&client, &reply) != 0) {
+			thread->failed = thread->requests - thread->completed;
+			goto done;
+		}
+		uint32_t slot = slotOfRequest[reply.requestID];
+		freeSlots[freeCount++] = slot;
+		if (reply.result != 0) {
+			thread->failed++;
+			continue;
+		}
+		if (thread->verify) {
+			float* output = (float*) ((char*) client.shmData + 2 * slot * matrixSize + matrixSize);
+			for (uint32_t j = 0; j < thread->size; j++) {
+				for (uint32_t i = 0; i < thread->size; i++) {
+					if (output[i + j * thread->size] != (float) (j + i * thread->size)) {
+						printf("Verification of request %d failed at (%d, %d)\n", reply.requestID, i, j);
+						thread->verify = 0;
+						thread->failed++;
+						goto verified;
+					}
+				}
+			}
+			thread->verify = 0;//verify only the first reply to keep the generator light
+		}
+		thread->latency[thread->completed] = get_TimeMs() - submitTime[reply.requestID];
+		thread->serverLatency[thread->completed] = reply.latency;
+		thread->completed++;
+verified:
+		;
+	}
+done:
+	free(submitTime);
+	free(slotOfRequest);
+	free(freeSlots);
+	disconnect_TranspositionService(&client);
+	return NULL;
+}
+
+
+static void*
+run_ReplayThread(void* arg)
+{
+	VkReplayThread* thread = (VkReplayThread*) arg;
+	//the shared memory covers every recorded buffer, filled once with synthetic data
+	uint64_t shmSize = 0;
+	for (uint32_t i = 0; i < thread->count; i++) {
+		VkTranspositionTraceRecord* record = &thread->records[i];
+		uint64_t matrixSize = (uint64_t) sizeof(float) * record->size[0] * record->size[1] * record->size[2];
+		uint64_t end = ((record->inputOffset > record->outputOffset) ? record->inputOffset : record->outputOffset) + matrixSize;
+		if (end > shmSize) shmSize = end;
+	}
+	VkTranspositionClient client;
+	int32_t result = 0;
+	int res = (shmSize <= VKT_REPLAY_MAX_SHM) ? connect_TranspositionService(&client, thread->socketPath, shmSize, &result) : -ENOMEM;
+	if (res != 0 || result != 0) {
+		printf("Connection to %s with %llu bytes of shared memory failed: %s, error code: %d\n", thread->socketPath, (unsigned long long) shmSize,
+		       (res != 0) ? strerror(-res) : "attach refused", result);
+		thread->failed = thread->count;
+		return NULL;
+	}
+	float* data = (float*) client.shmData;
+	for (uint64_t i = 0; i < shmSize / sizeof(float); i++) data[i] = (float) (i & 0xFFFFFF);
+
+	//all connections start the schedule together
+	double wait = thread->start - get_TimeMs();
+	if (wait > 0) poll(NULL, 0, (int) wait + 1);
+	//request ids of a connection start at 1 and increase by 1
+	double* submitTime = (double*) malloc(sizeof(double) * (thread->count + 1));
+	uint32_t submitted = 0, inFlight = 0;
+	while (thread->completed + thread->failed < thread->count) {
+		int timeout = -1;
+		if (submitted < thread->count) {
+			VkTranspositionTraceRecord* record = &thread->records[submitted];
+			double now = get_TimeMs();
+			double due = thread->start + record->arrival / thread->speed;
+			//open loop keeps at most VKT_SERVICE_MAX_IN_FLIGHT requests in flight, the daemon does not read ahead any further and
+			//a blocked send would never get to the replies. Requests held back by the limit count as behind schedule
+			uint32_t limit = (thread->depth == 0) ? VKT_SERVICE_MAX_IN_FLIGHT : thread->depth;
+			if (inFlight < limit && (thread->depth != 0 || now >= due)) {
+				uint32_t requestID = 0;
+				if (submit_TranspositionService(&client, record->size, record->priority, record->inputOffset, record->outputOffset, &requestID) != 0) {
+					thread->failed = thread->count - thread->completed;
+					break;
+				}
+				if (thread->depth == 0) thread->lateness[submitted] = now - due;
+				submitTime[requestID] = now;
+				submitted++;
+				inFlight++;
+				continue;
+			}
+			if (thread->depth == 0 && inFlight < limit) timeout = (int) (due - now) + 1;
+		}
+		//replies that arrive before the next recorded arrival
+		struct pollfd fd = { client.socket, POLLIN, 0 };
+		if (poll(&fd, 1, timeout) <= 0) continue;
+		VkTranspositionReply reply;
+		if (wait_TranspositionService(&client, &reply) != 0) {
+			thread->failed = thread->count - thread->completed;
+			break;
+		}
+		inFlight--;
+		if (reply.result != 0) {
+			thread->failed++;
+			continue;
+		}
+		thread->latency[thread->completed] = get_TimeMs() - submitTime[reply.requestID];
+		thread->serverLatency[thread->completed] = reply.latency;
+		thread->completed++;
+	}
+	thread->submitted = submitted;
+	free(submitTime);
+	disconnect_TranspositionService(&client);
+	return NULL;
+}
+
+
+static void
+print_Percentiles(const char* name, double* latency, uint32_t count)
+{
+	if (count == 0) return;
+	qsort(latency, count, sizeof(double), compare_Double);
+	printf("%s: p50 %.3f ms, p90 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+	       name,
+	       latency[(uint32_t) (0.50 * (count - 1))],
+	       latency[(uint32_t) (0.90 * (count - 1))],
+	       latency[(uint32_t) (0.99 * (count - 1))],
+	       latency[count - 1]);
+}
+
+
+static int
+compare_TraceRecord(const void* a, const void* b)
+{
+	double x = ((const VkTranspositionTraceRecord*) a)->arrival;
+	double y = ((const VkTranspositionTraceRecord*) b)->arrival;
+	return (x > y) - (x < y);
+}
+
+
+static int
+run_Replay(const char* socketPath, const char* tracePath, uint32_t depth, double speed)
+{
+	//read the trace, summarize the recorded workload, replay it and compare the latencies with the recorded ones
+	FILE* fp = fopen(tracePath, "rb");
+	if (fp == NULL) {
+		printf("Could not open the trace %s\n", tracePath);
+		return 1;
+	}
+	VkTranspositionTraceHeader header;
+	if (fread(&header, sizeof(header), 1, fp) != 1 || header.magic != VKT_TRACE_MAGIC || header.version != VKT_TRACE_VERSION ||
+	    header.recordSize != sizeof(VkTranspositionTraceRecord)) {
+		printf("%s is not a version %d trace\n", tracePath, VKT_TRACE_VERSION);
+		fclose(fp);
+		return 1;
+	}
+	uint32_t count = 0, capacity = 1024, skipped = 0;
+	VkTranspositionTraceRecord* records = (VkTranspositionTraceRecord*) malloc(sizeof(VkTranspositionTraceRecord) * capacity);
+	while (records != NULL && fread(&records[count], sizeof(VkTranspositionTraceRecord), 1, fp) == 1) {
+		//requests the daemon rejected at capture time are not replayed
+		if (records[count].result != 0) {
+			skipped++;
+			continue;
+		}
+		if (++count == capacity) {
+			capacity *= 2;
+			VkTranspositionTraceRecord* grown = (VkTranspositionTraceRecord*) realloc(records, sizeof(VkTranspositionTraceRecord) * capacity);
+			if (grown == NULL) free(records);
+			records = grown;
+		}
+	}
+	fclose(fp);
+	if (records == NULL) {
+		printf("Not enough memory for the trace %s\n", tracePath);
+		return 1;
+	}
+	if (count == 0) {
+		printf("%s holds no completed requests\n", tracePath);
+		free(records);
+		return 1;
+	}
+	qsort(records, count, sizeof(VkTranspositionTraceRecord), compare_TraceRecord);
+	double first = records[0].arrival;
+	for (uint32_t i = 0; i < count; i++) records[i].arrival -= first;
+	double duration = records[count - 1].arrival;
+
+	//recorded connections in order of their first request, distinct shapes by frequency
+	uint32_t connectionID[VKT_REPLAY_MAX_CONNECTIONS], connections = 0;
+	uint32_t* threadOfRecord = (uint32_t*) malloc(sizeof(uint32_t) * count);
+	uint32_t shapes = 0, shape[16][4];
+	double* recordedLatency = (double*) malloc(sizeof(double) * count);
+	double bytes = 0;
+	for (uint32_t i = 0; i < count; i++) {
+		VkTranspositionTraceRecord* record = &records[i];
+		uint32_t t = 0;
+		while (t < connections && connectionID[t] != record->connection) t++;
+		if (t == connections && connections < VKT_REPLAY_MAX_CONNECTIONS) connectionID[connections++] = record->connection;
+		threadOfRecord[i] = (t < connections) ? t : record->connection % VKT_REPLAY_MAX_CONNECTIONS;
+		uint32_t s = 0;
+		while (s < shapes && (shape[s][0] != record->size[0] || shape[s][1] != record->size[1] || shape[s][2] != record->size[2])) s++;
+		if (s == shapes && shapes < 16) {
+			shape[shapes][0] = record->size[0];
+			shape[shapes][1] = record->size[1];
+			shape[shapes][2] = record->size[2];
+			shape[shapes][3] = 0;
+			shapes++;
+		}
+		if (s < shapes) shape[s][3]++;
+		recordedLatency[i] = record->latency;
+		bytes += 2.0 * sizeof(float) * record->size[0] * record->size[1] * record->size[2];
+	}
+	printf("Trace: %s, captured on %.256s\nRecorded: %d requests (%d rejected ones skipped), %d connections, %.3f s, %.1f requests/s\n",
+	       tracePath, header.device, count, skipped, connections, duration / 1000.0, (duration > 0) ? count / (duration / 1000.0) : 0);
+	for (uint32_t s = 0; s < shapes; s++)
+		printf("  %dx%dx%d float32: %d requests (%.1f%%)\n", shape[s][0], shape[s][1], shape[s][2], shape[s][3], 100.0 * shape[s][3] / count);
+	print_Percentiles("Recorded latency", recordedLatency, count);
+
+	VkReplayThread* thread = (VkReplayThread*) calloc(connections, sizeof(VkReplayThread));
+	pthread_t* handle = (pthread_t*) malloc(sizeof(pthread_t) * connections);
+	for (uint32_t t = 0; t < connections; t++) thread[t].records = (VkTranspositionTraceRecord*) malloc(sizeof(VkTranspositionTraceRecord) * count);
+	for (uint32_t i = 0; i < count; i++) {
+		VkReplayThread* owner = &thread[threadOfRecord[i]];
+		owner->records[owner->count++] = records[i];
+	}
+	//the threads connect and fill their buffers first, so the schedule starts once all of them are ready
+	double start = get_TimeMs() + 1000.0;
+	for (uint32_t t = 0; t < connections; t++) {
+		thread[t].socketPath    = socketPath;
+		thread[t].depth         = depth;
+		thread[t].speed         = speed;
+		thread[t].start         = start;
+		thread[t].latency       = (double*) malloc(sizeof(double) * thread[t].count);
+		thread[t].serverLatency = (double*) malloc(sizeof(double) * thread[t].count);
+		thread[t].lateness      = (double*) calloc(thread[t].count, sizeof(double));
+		pthread_create(&handle[t], NULL, run_ReplayThread, &thread[t]);
+	}
+	for (uint32_t t = 0; t < connections; t++) pthread_join(handle[t], NULL);
+	double wall = get_TimeMs() - start;
+
+	uint32_t completed = 0, failed = 0, pos = 0;
+	for (uint32_t t = 0; t < connections; t++) {
+		completed += thread[t].completed;
+		failed += thread[t].failed;
+	}
+	double* latency = (double*) malloc(sizeof(double) * (completed + 1));
+	double* serverLatency = (double*) malloc(sizeof(double) * (completed + 1));
+	double* lateness = (double*) malloc(sizeof(double) * (count + 1));
+	uint32_t submittedCount = 0;
+	for (uint32_t t = 0; t < connections; t++) {
+		memcpy(latency + pos, thread[t].latency, sizeof(double) * thread[t].completed);
+		memcpy(serverLatency + pos, thread[t].serverLatency, sizeof(double) * thread[t].completed);
+		pos += thread[t].completed;
+		//records that were never submitted have no lateness
+		memcpy(lateness + submittedCount, thread[t].lateness, sizeof(double) * thread[t].submitted);
+		submittedCount += thread[t].submitted;
+		free(thread[t].records);
+		free(thread[t].latency);
+		free(thread[t].serverLatency);
+		free(thread[t].lateness);
+	}
+	if (depth == 0) printf("\nReplay: open loop at %.2fx the recorded rate\n", speed);
+	else printf("\nReplay: closed loop, %d requests in flight per connection\n", depth);
+	printf("Requests: %d completed, %d failed\nThroughput: %.1f requests/s, %.3f GB/s\n", completed, failed,
+	       completed / (wall / 1000.0), bytes * completed / count / 1024.0 / 1024.0 / 1024.0 / (wall / 1000.0));
+	print_Percentiles("Client latency", latency, completed);
+	print_Percentiles("Daemon latency", serverLatency, completed);
+	if (depth == 0) print_Percentiles("Submission behind schedule", lateness, submittedCount);
+
+	free(latency);
+	free(serverLatency);
+	free(lateness);
+	free(recordedLatency);
+	free(threadOfRecord);
+	free(records);
+	free(thread);
+	free(handle);
+	return failed != 0;
+}
+
+
+int main(int argc, char* argv[])
+{
+	const char* socketPath = "/tmp/VulkanTransposition.sock";
+	uint32_t threads = 4;
+	uint32_t requests = 1000;//per thread
+	uint32_t size = 256;
+	uint32_t depth = 4;      //requests in flight per thread
+	uint32_t priorities = 1;
+	uint32_t verify = 1;
+	const char* tracePath = NULL;//replay this trace instead of the synthetic load
+	uint32_t closedLoop = 0;     //replay: requests in flight per connection, 0 - recorded arrival times
+	double speed = 1.0;          //replay: open loop rate relative to the recorded one
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--socket") == 0 && i + 1 < argc) socketPath = argv[++i];
+		else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) threads = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--requests") == 0 && i + 1 < argc) requests = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) size = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--depth") == 0 && i + 1 < argc) depth = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--priorities") == 0 && i + 1 < argc) priorities = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--no-verify") == 0) verify = 0;
+		else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) tracePath = argv[++i];
+		else if (strcmp(argv[i], "--closed-loop") == 0 && i + 1 < argc) closedLoop = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) speed = atof(argv[++i]);
+		else {
+			printf("Usage: %s [--socket path] [--threads n] [--requests n] [--size n] [--depth n] [--priorities n] [--no-verify] [--replay trace [--closed-loop depth | --speed x]]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (closedLoop > VKT_SERVICE_MAX_IN_FLIGHT) {
+		printf("Depth %d is above the %d requests in flight the daemon reads ahead\n", closedLoop, VKT_SERVICE_MAX_IN_FLIGHT);
+		return 1;
+	}
+	if (tracePath != NULL) return (speed > 0) ? run_Replay(socketPath, tracePath, closedLoop, speed) : 1;
+	if (threads == 0 || requests == 0 || depth == 0 || priorities == 0) return 1;
+	if (depth > VKT_SERVICE_MAX_IN_FLIGHT) {
+		printf("Depth %d is above the %d requests in flight the daemon reads ahead\n", depth, VKT_SERVICE_MAX_IN_FLIGHT);
+		return 1;
+	}
+
+	VkLoadgenThread* thread = (VkLoadgenThread*) calloc(threads, sizeof(VkLoadgenThread));
+	pthread_t* handle = (pthread_t*) malloc(sizeof(pthread_t) * threads);
+	double t = get_TimeMs();
+	for (uint32_t i = 0; i < threads; i++) {
+		thread[i].socketPath    = socketPath;
+		thread[i].size          = size;
+		thread[i].requests      = requests;
+		thread[i].depth         = depth;
+		thread[i].priorities    = priorities;
+		thread[i].verify        = verify;
+		thread[i].latency       = (double*) malloc(sizeof(double) * requests);
+		thread[i].serverLatency = (double*) malloc(sizeof(double) * requests);
+		pthread_create(&handle[i], NULL, run_LoadgenThread, &thread[i]);
+	}
+	for (uint32_t i = 0; i < threads; i++) pthread_join(handle[i], NULL);
+	t = get_TimeMs() - t;
+
+	//gather all latencies into one array
+	uint32_t completed = 0, failed = 0;
+	for (uint32_t i = 0; i < threads; i++) {
+		completed += thread[i].completed;
+		failed += thread[i].failed;
+	}
+	double* latency = (double*) malloc(sizeof(double) * (completed + 1));
+	double* serverLatency = (double*) malloc(sizeof(double) * (completed + 1));
+	uint32_t pos = 0;
+	for (uint32_t i = 0; i < threads; i++) {
+		memcpy(latency + pos, thread[i].latency, sizeof(double) * thread[i].completed);
+		memcpy(serverLatency + pos, thread[i].serverLatency, sizeof(double) * thread[i].completed);
+		pos += thread[i].completed;
+		free(thread[i].latency);
+		free(thread[i].serverLatency);
+	}
+
+	printf("Requests: %d completed, %d failed\nSystem size: %dx%d\nThreads: %d, depth: %d\nThroughput: %.1f requests/s, %.3f GB/s\n",
+	       completed, failed, size, size, threads, depth,
+	       completed / (t / 1000.0),
+	       2.0 * completed * sizeof(float) * size * size / 1024.0 / 1024.0 / 1024.0 / (t / 1000.0));
+	print_Percentiles("Client latency", latency, completed);
+	print_Percentiles("Daemon latency", serverLatency, completed);
+
+	free(latency);
+	free(serverLatency);
+	free(thread);
+	free(handle);
+	return failed != 0;
+}
@@ -0,0 +1,245 @@
+#include "VulkanTransposition.h"
+
+
+//Packed triangular and symmetric matrices (packed_triangular.comp): LAPACK packed triangles, upper or lower, row or
+//column-major, converted to each other and to full matrices. Only the tiles of one triangle are launched, so a conversion
+//moves n * (n + 1) / 2 elements with half of the workgroups of a full transposition
+#define VKT_PACKED_FULL        1//full n x n matrix, packed triangle otherwise
+#define VKT_PACKED_UPPER       2//upper triangle, lower otherwise
+#define VKT_PACKED_COLUMN_MAJOR 4//column-major, row-major otherwise
+
+#define VKT_PACKED_MIRROR_NONE      0//full output: the other triangle is untouched
+#define VKT_PACKED_MIRROR_SYMMETRIC 1//the other triangle is the transposed one
+#define VKT_PACKED_MIRROR_ZERO      2//the other triangle is zero
+
+typedef struct {
+	uint32_t localSize[3];
+	uint32_t size;        //n x n matrix
+	uint32_t inputFormat; //VKT_PACKED_* flags
+	uint32_t outputFormat;
+	uint32_t mirror;      //VKT_PACKED_MIRROR_*
+} VkPackedSpecializationConstantsLayout;//specialization constants of packed_triangular.comp
+
+
+uint64_t
+get_PackedElements(uint32_t n, uint32_t format)
+{
+	return (format & VKT_PACKED_FULL) ? (uint64_t) n * n : (uint64_t) n * (n + 1) / 2;
+}
+
+
+uint64_t
+get_PackedIndex(uint32_t n, uint32_t format, uint64_t i, uint64_t j)
+{
+	//element (i, j) of a full matrix or of the triangle of a packed one, the same as packedIndex() of the shader
+	uint32_t upper = (format & VKT_PACKED_UPPER) != 0;
+	uint32_t columnMajor = (format & VKT_PACKED_COLUMN_MAJOR) != 0;
+	if (format & VKT_PACKED_FULL) return columnMajor ? i + j * n : i * n + j;
+	if (columnMajor) return upper ? i + j * (j + 1) / 2 : j * n - j * (j - 1) / 2 + i - j;
+	return upper ? i * n - i * (i - 1) / 2 + j - i : j + i * (i + 1) / 2;
+}
+
+
+void
+convert_Packed(const uint32_t* input, uint32_t* output, uint32_t n, uint32_t inputFormat, uint32_t outputFormat, uint32_t mirror)
+{
+	//CPU reference of packed_triangular.comp: element (u, v), v <= u, of the lower triangle is (i, j) = (u, v) of a lower
+	//format and (v, u) of an upper one
+	for (uint64_t u = 0; u < n; u++) {
+		for (uint64_t v = 0; v <= u; v++) {
+			uint32_t value = input[(inputFormat & VKT_PACKED_UPPER) ? get_PackedIndex(n, inputFormat, v, u) : get_PackedIndex(n, inputFormat, u, v)];
+			uint64_t i = (outputFormat & VKT_PACKED_UPPER) ? v : u;
+			uint64_t j = (outputFormat & VKT_PACKED_UPPER) ? u : v;
+			output[get_PackedIndex(n, outputFormat, i, j)] = value;
+			if ((outputFormat & VKT_PACKED_FULL) && mirror != VKT_PACKED_MIRROR_NONE && u != v)
+				output[get_PackedIndex(n, outputFormat, j, i)] = (mirror == VKT_PACKED_MIRROR_SYMMETRIC) ? value : 0;
+		}
+	}
+}
+
+
+VkResult
+create_PackedApp(VkGPU* vkGPU,
+                 VkApplication* app,
+                 VkPackedSpecializationConstantsLayout* constants,
+                 VkBuffer* inputBuffer,
+                 VkBuffer* outputBuffer,
+                 uint32_t groupCount[3])
+{
+	//conversion of constants->size x constants->size elements between the formats of the constants. localSize[0] is the
+	//tile, localSize[1] the rows of threads walking it. groupCount - one workgroup per tile of the triangle
+	VkPhysicalDeviceLimits* limits = &vkGPU->physicalDeviceProperties.limits;
+	uint32_t n = constants->size, tile = constants->localSize[0];
+	if (n == 0 || tile == 0 || tile % constants->localSize[1] != 0 || tile * constants->localSize[1] > limits->maxComputeWorkGroupInvocations)
+		return VK_ERROR_FORMAT_NOT_SUPPORTED;
+	if (get_PackedElements(n, constants->inputFormat) > 0xFFFFFFFFull || get_PackedElements(n, constants->outputFormat) > 0xFFFFFFFFull)
+		return VK_ERROR_FORMAT_NOT_SUPPORTED;
+	uint64_t tiles = (n + tile - 1) / tile;
+	uint64_t tileCount = tiles * (tiles + 1) / 2;
+	groupCount[0] = (tileCount < limits->maxComputeWorkGroupCount[0]) ? (uint32_t) tileCount : limits->maxComputeWorkGroupCount[0];
+	groupCount[1] = (uint32_t) ((tileCount + groupCount[0] - 1) / groupCount[0]);
+	groupCount[2] = 1;
+	if (groupCount[1] > limits->maxComputeWorkGroupCount[1]) return VK_ERROR_FORMAT_NOT_SUPPORTED;
+
+	VkSpecializationMapEntry specializationMapEntries[7] = { 0 };
+	for (uint32_t kk = 0; kk < 7; kk++) {
+		specializationMapEntries[kk].constantID = kk + 1;
+		specializationMapEntries[kk].size = sizeof(uint32_t);
+		specializationMapEntries[kk].offset = kk * sizeof(uint32_t);
+	}
+	VkSpecializationInfo specializationInfo = { (uint32_t) 7,
+                                                    (const VkSpecializationMapEntry*) specializationMapEntries,
+                                                    (size_t) 7 * sizeof(uint32_t),
+                                                    (const void*) constants };
+	VkBuffer*    buffer[2]      = { inputBuffer, outputBuffer };
+	VkDeviceSize bufferSizes[2] = { get_PackedElements(n, constants->inputFormat) * sizeof(uint32_t),
+                                        get_PackedElements(n, constants->outputFormat) * sizeof(uint32_t) };
+	char shaderPath[256];
+	sprintf(shaderPath, "%spacked_triangular.spv", SHADER_DIR);
+	return create_ComputeApp(vkGPU->device, 2, buffer, bufferSizes, &specializationInfo, &app->descriptorPool, &app->descriptorSetLayout,
+	                         &app->descriptorSet, (const char*) shaderPath, &app->pipelineLayout, &app->pipeline);
+}
+
+
+void
+get_PackedFormatName(uint32_t format, char* name)
+{
+	sprintf(name, "%s %s", (format & VKT_PACKED_FULL) ? "full" : ((format & VKT_PACKED_UPPER) ? "upper" : "lower"),
+	        (format & VKT_PACKED_COLUMN_MAJOR) ? "col" : "row");
+}
+
+
+VkResult
+Example_VulkanPacked(uint32_t deviceID,
+                     uint32_t coalescedMemory,
+                     uint32_t size)
+{
+	//packed <-> full and upper <-> lower conversions of a size x size matrix of 4-byte elements, against the CPU and the
+	//full transposition (transposition_no_bank_conflicts.comp) of the same matrix. Outputs start as a sentinel, so writes
+	//outside of the expected elements are caught
+	VkGPU vkGPU = { 0 };
+	vkGPU.device_id = deviceID;
+	VkResult res = create_VkGPU(&vkGPU);
+	if (res != VK_SUCCESS) return res;
+	coalescedMemory = get_CoalescedMemory(&vkGPU, coalescedMemory);
+	uint32_t tile = coalescedMemory / sizeof(float);
+	uint32_t rows = tile;
+	while (tile * rows > vkGPU.physicalDeviceProperties.limits.maxComputeWorkGroupInvocations) rows /= 2;
+	if ((uint64_t) size * size > 0xFFFFFFFFull) {
+		printf("Size %d does not fit 32-bit indices\n", size);
+		delete_VkGPU(&vkGPU);
+		return VK_ERROR_FORMAT_NOT_SUPPORTED;
+	}
+
+	const uint32_t full = VKT_PACKED_FULL, upper = VKT_PACKED_UPPER, col = VKT_PACKED_COLUMN_MAJOR;
+	//input format, output format, mirror
+	uint32_t conversions[][3] = {
+		{ upper | col, full,        VKT_PACKED_MIRROR_SYMMETRIC },
+		{ col,         full,        VKT_PACKED_MIRROR_ZERO },
+		{ upper,       full | col,  VKT_PACKED_MIRROR_NONE },
+		{ full,        upper | col, VKT_PACKED_MIRROR_NONE },
+		{ full | col,  0,           VKT_PACKED_MIRROR_NONE },
+		{ upper | col, col,         VKT_PACKED_MIRROR_NONE },
+		{ upper,       upper | col, VKT_PACKED_MIRROR_NONE },
+		{ col,         0,           VKT_PACKED_MIRROR_NONE },
+		{ 0,           upper | col, VKT_PACKED_MIRROR_NONE },
+	};
+	uint32_t conversionCount = sizeof(conversions) / sizeof(conversions[0]);
+	uint64_t elements = (uint64_t) size * size;
+	VkDeviceSize bufferSize = elements * sizeof(uint32_t);
+	VkBuffer buffer[2] = { 0 };
+	VkDeviceMemory bufferDeviceMemory[2] = { 0 };
+	for (uint32_t k = 0; k < 2 && res == VK_SUCCESS; k++) {
+		res = allocate_Buffer_DeviceMemory(vkGPU.physicalDevice, vkGPU.device,
+		                                   VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		                                   &vkGPU.physicalDeviceMemoryProperties, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		                                   bufferSize, &buffer[k], &bufferDeviceMemory[k]);
+	}
+	uint32_t* input = (uint32_t*) malloc((size_t) bufferSize);
+	uint32_t* output = (uint32_t*) malloc((size_t) bufferSize);
+	uint32_t* reference = (uint32_t*) malloc((size_t) bufferSize);
+	if (res == VK_SUCCESS && (input == NULL || output == NULL || reference == NULL)) res = VK_ERROR_OUT_OF_HOST_MEMORY;
+	if (res == VK_SUCCESS) {
+		for (uint64_t i = 0; i < elements; i++) input[i] = (uint32_t) i + 1;
+		res = upload_Data(vkGPU.physicalDevice, vkGPU.device, input, &vkGPU.physicalDeviceMemoryProperties, vkGPU.commandPool,
+		                  vkGPU.queue, &vkGPU.fence, &buffer[0], bufferSize);
+	}
+
+	uint32_t batch = 100, failed = 0;
+	double time_full = 0;
+	if (res == VK_SUCCESS && size % tile == 0) {
+		//the full transposition launches the tiles of both triangles
+		VkApplication app = { 0 };
+		char shaderPath[256];
+		sprintf(shaderPath, "%stransposition_no_bank_conflicts.spv", SHADER_DIR);
+		VkBuffer*    appBuffer[2]   = { &buffer[0], &buffer[1] };
+		VkDeviceSize bufferSizes[2] = { bufferSize, bufferSize };
+		uint32_t     systemSize[3]  = { size, size, 1 };
+		res = create_App(vkGPU.device, &app.specializationConstants, coalescedMemory, appBuffer, bufferSizes, systemSize,
+		                 &app.descriptorPool, &app.descriptorSetLayout, &app.descriptorSet, (const char*) shaderPath, &app.pipelineLayout, &app.pipeline);
+		uint32_t groupCount[3] = { size / tile, size / tile, 1 };
+		if (res == VK_SUCCESS)
+			res = run_App(vkGPU.device, vkGPU.commandPool, app.pipeline, app.pipelineLayout, &app.descriptorSet, groupCount, vkGPU.queue, &vkGPU.fence, batch, &time_full);
+		if (app.pipeline != VK_NULL_HANDLE) deleteApp(&vkGPU, &app);
+	}
+	if (res == VK_SUCCESS) {
+		printf("System size: %dx%d, tile %dx%d, 4-byte elements\n", size, size, tile, rows);
+		if (time_full > 0) printf("Full transposition: %.3f ms, %.2f GB/s\n", time_full, 2.0 * bufferSize / 1024.0 / 1024.0 / 1024.0 / time_full * 1000);
+		printf("%-10s %-10s %-10s %10s %10s %10s %s\n", "input", "output", "other half", "GPU, ms", "GB/s", "CPU, ms", "result");
+	}
+	for (uint32_t c = 0; c < conversionCount && res == VK_SUCCESS; c++) {
+		uint32_t inputFormat = conversions[c][0], outputFormat = conversions[c][1], mirror = conversions[c][2];
+		uint64_t outputElements = get_PackedElements(size, outputFormat);
+		for (uint64_t i = 0; i < outputElements; i++) reference[i] = 0xFFFFFFFF;
+		res = upload_Data(vkGPU.physicalDevice, vkGPU.device, reference, &vkGPU.physicalDeviceMemoryProperties, vkGPU.commandPool,
+		                  vkGPU.queue, &vkGPU.fence, &buffer[1], outputElements * sizeof(uint32_t));
+		if (res != VK_SUCCESS) break;
+		double t = get_TimeMs();
+		convert_Packed(input, reference, size, inputFormat, outputFormat, mirror);
+		double time_cpu = get_TimeMs() - t;
+
+		VkApplication app = { 0 };
+		VkPackedSpecializationConstantsLayout specializationConstants = { { tile, rows, 1 }, size, inputFormat, outputFormat, mirror };
+		uint32_t groupCount[3] = { 0 };
+		double time = 0;
+		res = create_PackedApp(&vkGPU, &app, &specializationConstants, &buffer[0], &buffer[1], groupCount);
+		if (res != VK_SUCCESS) {
+			printf("Packed application creation failed, error code: %d\n", res);
+			break;
+		}
+		res = run_App(vkGPU.device, vkGPU.commandPool, app.pipeline, app.pipelineLayout, &app.descriptorSet, groupCount, vkGPU.queue, &vkGPU.fence, batch, &time);
+		deleteApp(&vkGPU, &app);
+		if (res == VK_SUCCESS)
+			res = download_Data(vkGPU.physicalDevice, vkGPU.device, vkGPU.commandPool, &vkGPU.physicalDeviceMemoryProperties,
+			                    vkGPU.queue, &vkGPU.fence, output, &buffer[1], outputElements * sizeof(uint32_t));
+		if (res != VK_SUCCESS) {
+			printf("Packed application run failed, error code: %d\n", res);
+			break;
+		}
+		uint64_t errors = 0;
+		for (uint64_t i = 0; i < outputElements; i++) errors += (output[i] != reference[i]);
+		//every element of the triangle is read and written once, a full output with a mirror writes the other half too
+		uint64_t moved = 2 * get_PackedElements(size, 0);
+		if ((outputFormat & VKT_PACKED_FULL) && mirror != VKT_PACKED_MIRROR_NONE) moved += elements - size;
+		char inputName[16], outputName[16];
+		get_PackedFormatName(inputFormat, inputName);
+		get_PackedFormatName(outputFormat, outputName);
+		const char* mirrors[3] = { "", "symmetric", "zero" };
+		printf("%-10s %-10s %-10s %10.3f %10.2f %10.3f %s\n", inputName, outputName, (outputFormat & VKT_PACKED_FULL) ? mirrors[mirror] : "", time,
+		       moved * sizeof(uint32_t) / 1024.0 / 1024.0 / 1024.0 / time * 1000, time_cpu, errors ? "FAILED" : "passed");
+		failed += (errors != 0);
+	}
+	if (res == VK_SUCCESS) {
+		printf("Verification %s\n", failed ? "FAILED" : "passed");
+		if (failed) res = VK_ERROR_FORMAT_NOT_SUPPORTED;
+	}
+	free(input);
+	free(output);
+	free(reference);
+	for (uint32_t k = 0; k < 2; k++) {
+		vkDestroyBuffer(vkGPU.device, buffer[k], NULL);
+		vkFreeMemory(vkGPU.device, bufferDeviceMemory[k], NULL);
+	}
+	delete_VkGPU(&vkGPU);
+	return res;
+}
@@ -0,0 +1,341 @@
+#include "VulkanTransposition.h"
+
+
+//Performance regression gate: a fixed matrix of kernels, element types and sizes is timed over repeated trials and
+//compared with the baseline file of the device. An entry regresses when its median throughput drops by more than the
+//threshold and a one-sided Mann-Whitney U test on the trials of both runs says the drop is not noise. Baselines are
+//plain text with every trial, written by the update mode, and only depend on the device name and ids, so software
+//drivers on machines without a GPU keep their own baselines in the same format
+#define VKT_PERF_MAX_ENTRIES 64
+#define VKT_PERF_BATCH       10
+
+typedef struct {
+	char device[VK_MAX_PHYSICAL_DEVICE_NAME_SIZE];
+	uint32_t driverVersion;
+	uint32_t count;
+	VkPerfEntry entry[VKT_PERF_MAX_ENTRIES];
+} VkPerfBaseline;
+
+
+void
+get_PerfBaselinePath(VkGPU* vkGPU, const char* dir, char* path)
+{
+	//dir/<device name>_<vendor id>_<device id>.baseline, the name reduced to letters, digits and underscores
+	char name[VK_MAX_PHYSICAL_DEVICE_NAME_SIZE];
+	uint32_t k = 0;
+	for (; vkGPU->physicalDeviceProperties.deviceName[k] != 0 && k < VK_MAX_PHYSICAL_DEVICE_NAME_SIZE - 1; k++) {
+		char c = vkGPU->physicalDeviceProperties.deviceName[k];
+		name[k] = ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')) ? c : '_';
+	}
+	name[k] = 0;
+	sprintf(path, "%.200s/%.100s_%04x_%04x.baseline", dir, name, vkGPU->physicalDeviceProperties.vendorID, vkGPU->physicalDeviceProperties.deviceID);
+}
+
+
+VkResult
+read_PerfBaseline(const char* path, VkPerfBaseline* baseline)
+{
+	memset(baseline, 0, sizeof(VkPerfBaseline));
+	FILE* fp = fopen(path, "r");
+	if (fp == NULL) return VK_ERROR_INITIALIZATION_FAILED;
+	char line[4096];
+	VkResult res = VK_SUCCESS;
+	while (fgets(line, sizeof(line), fp) != NULL && res == VK_SUCCESS) {
+		if (strncmp(line, "device ", 7) == 0) {
+			sprintf(baseline->device, "%.200s", line + 7);
+			baseline->device[strcspn(baseline->device, "\r\n")] = 0;
+		}
+		else if (strncmp(line, "driver ", 7) == 0) baseline->driverVersion = (uint32_t) strtoul(line + 7, NULL, 0);
+		else if (strncmp(line, "entry ", 6) == 0 && baseline->count < VKT_PERF_MAX_ENTRIES) {
+			//entry <kernel> <dtype> <size> <trials> <GB/s of every trial>
+			VkPerfEntry* entry = &baseline->entry[baseline->count];
+			int offset = 0;
+			if (sscanf(line + 6, "%31s %15s %u %u%n", entry->kernel, entry->dtype, &entry->size, &entry->trials, &offset) != 4 || entry->trials > VKT_PERF_MAX_TRIALS) {
+				res = VK_ERROR_FORMAT_NOT_SUPPORTED;
+				break;
+			}
+			char* p = line + 6 + offset;
+			for (uint32_t t = 0; t < entry->trials; t++) {
+				char* end = NULL;
+				entry->sample[t] = strtod(p, &end);
+				if (end == p) res = VK_ERROR_FORMAT_NOT_SUPPORTED;
+				p = end;
+			}
+			baseline->count++;
+		}
+	}
+	fclose(fp);
+	if (res != VK_SUCCESS) printf("Malformed baseline %s\n", path);
+	return res;
+}
+
+
+VkResult
+write_PerfBaseline(const char* path, VkGPU* vkGPU, VkPerfBaseline* baseline)
+{
+	//written to a temporary file and renamed, so an interrupted update keeps the old baseline
+	char temporaryPath[300];
+	sprintf(temporaryPath, "%.280s.tmp", path);
+	FILE* fp = fopen(temporaryPath, "w");
+	if (fp == NULL) {
+		printf("Could not write baseline %s\n", temporaryPath);
+		return VK_ERROR_INITIALIZATION_FAILED;
+	}
+	fprintf(fp, "# VulkanTransposition performance baseline, GB/s of every trial\n");
+	fprintf(fp, "device %s\n", vkGPU->physicalDeviceProperties.deviceName);
+	fprintf(fp, "driver 0x%08x\n", vkGPU->physicalDeviceProperties.driverVersion);
+	for (uint32_t e = 0; e < baseline->count; e++) {
+		VkPerfEntry* entry = &baseline->entry[e];
+		fprintf(fp, "entry %s %s %u %u", entry->kernel, entry->dtype, entry->size, entry->trials);
+		for (uint32_t t = 0; t < entry->trials; t++) fprintf(fp, " %.4f", entry->sample[t]);
+		fprintf(fp, "\n");
+	}
+	int failed = ferror(fp);
+	if (fclose(fp) != 0) failed = 1;
+	remove(path);
+	if (failed || rename(temporaryPath, path) != 0) {
+		printf("Could not write baseline %s\n", path);
+		remove(temporaryPath);
+		return VK_ERROR_INITIALIZATION_FAILED;
+	}
+	return VK_SUCCESS;
+}
+
+
+int
+compare_PerfSample(const void* a, const void* b)
+{
+	double x = *(const double*) a, y = *(const double*) b;
+	return (x > y) - (x < y);
+}
+
+
+double
+get_PerfMedian(const VkPerfEntry* entry)
+{
+	double sorted[VKT_PERF_MAX_TRIALS];
+	memcpy(sorted, entry->sample, sizeof(double) * entry->trials);
+	qsort(sorted, entry->trials, sizeof(double), compare_PerfSample);
+	return (entry->trials % 2) ? sorted[entry->trials / 2] : 0.5 * (sorted[entry->trials / 2 - 1] + sorted[entry->trials / 2]);
+}
+
+
+double
+get_MannWhitneyP(const VkPerfEntry* current, const VkPerfEntry* baseline)
+{
+	//one-sided p-value of current being slower than baseline: U of the current trials with midranks for ties, normal
+	//approximation with the tie correction
+	uint32_t n1 = current->trials, n2 = baseline->trials, n = n1 + n2;
+	double value[2 * VKT_PERF_MAX_TRIALS];
+	uint32_t fromCurrent[2 * VKT_PERF_MAX_TRIALS];
+	for (uint32_t i = 0; i < n; i++) {
+		value[i] = (i < n1) ? current->sample[i] : baseline->sample[i - n1];
+		fromCurrent[i] = (i < n1);
+	}
+	//insertion sort keeps the origin of every value
+	for (uint32_t i = 1; i < n; i++) {
+		for (uint32_t j = i; j > 0 && value[j - 1] > value[j]; j--) {
+			double v = value[j]; value[j] = value[j - 1]; value[j - 1] = v;
+			uint32_t f = fromCurrent[j]; fromCurrent[j] = fromCurrent[j - 1]; fromCurrent[j - 1] = f;
+		}
+	}
+	double rankSum = 0, ties = 0;
+	for (uint32_t i = 0; i < n;) {
+		uint32_t j = i;
+		while (j + 1 < n && value[j + 1] == value[i]) j++;
+		double rank = 0.5 * (i + j) + 1;
+		for (uint32_t k = i; k <= j; k++) if (fromCurrent[k]) rankSum += rank;
+		double t = j - i + 1;
+		ties += t * t * t - t;
+		i = j + 1;
+	}
+	double u = rankSum - 0.5 * n1 * (n1 + 1);
+	double variance = n1 * n2 / 12.0 * ((n + 1) - ties / ((double) n * (n - 1)));
+	if (variance <= 0) return 1.0;
+	//continuity correction towards the mean
+	double z = (u - 0.5 * n1 * n2 + 0.5) / sqrt(variance);
+	return 0.5 * erfc(-z / sqrt(2.0));
+}
+
+
+VkResult
+run_PerfEntry(VkGPU* vkGPU, uint32_t coalescedMemory, VkPerfEntry* entry, uint32_t trials, uint32_t batch)
+{
+	//GB/s (read and write) of entry->kernel over trials of batch dispatches. The output of the first run is
+	//checked on the device. VK_ERROR_FEATURE_NOT_PRESENT - the kernel is not available in this build
+	uint32_t size = entry->size;
+	uint32_t generated = (strcmp(entry->kernel, "generated") == 0);
+	uint32_t elementSize = (strcmp(entry->dtype, "float64") == 0) ? 8 : 4;
+	uint32_t dtype = (strcmp(entry->dtype, "uint32") == 0) ? VKT_DTYPE_UINT : VKT_DTYPE_FLOAT;
+	uint32_t transposed = (strcmp(entry->kernel, "bandwidth") != 0);
+	VkDeviceSize bufferSize = (VkDeviceSize) elementSize * size * size;
+	VkBuffer buffer[2] = { 0 };
+	VkDeviceMemory bufferDeviceMemory[2] = { 0 };
+	VkApplication app = { 0 };
+	uint32_t groupCount[3] = { 0 };
+	VkResult res = VK_SUCCESS;
+	entry->trials = 0;
+	for (uint32_t k = 0; k < 2 && res == VK_SUCCESS; k++) {
+		res = allocate_Buffer_DeviceMemory(vkGPU->physicalDevice, vkGPU->device,
+		                                   VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		                                   &vkGPU->physicalDeviceMemoryProperties, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		                                   bufferSize, &buffer[k], &bufferDeviceMemory[k]);
+	}
+	if (res == VK_SUCCESS) {
+		if (generated) {
+			VkKernelConfig config = { 2, { size, size }, { 1, 0 }, elementSize, dtype, 32, 8, VKT_EPILOGUE_NONE, 1.0f };
+			uint32_t cacheHit = 0;
+			double time_compile = 0;
+			res = create_KernelApp(vkGPU, &config, &buffer[0], &buffer[1], bufferSize, &app, groupCount, &cacheHit, &time_compile);
+			//no runtime compiler, or a kernel the device limits do not allow
+			if (res == VK_ERROR_INITIALIZATION_FAILED || res == VK_ERROR_FORMAT_NOT_SUPPORTED) res = VK_ERROR_FEATURE_NOT_PRESENT;
+		}
+		else {
+			char shaderPath[256];
+			sprintf(shaderPath, "%s%s.spv", SHADER_DIR, (strcmp(entry->kernel, "bandwidth") == 0) ? "transfer" :
+			        ((strcmp(entry->kernel, "bank_conflicts") == 0) ? "transposition_bank_conflicts" : "transposition_no_bank_conflicts"));
+			VkBuffer*    appBuffer[2]   = { &buffer[0], &buffer[1] };
+			VkDeviceSize bufferSizes[2] = { bufferSize, bufferSize };
+			uint32_t     systemSize[3]  = { size, size, 1 };
+			res = create_App(vkGPU->device, &app.specializationConstants, coalescedMemory, appBuffer, bufferSizes, systemSize,
+			                 &app.descriptorPool, &app.descriptorSetLayout, &app.descriptorSet, (const char*) shaderPath, &app.pipelineLayout, &app.pipeline);
+			groupCount[0] = size / app.specializationConstants.localSize[0];
+			groupCount[1] = size / app.specializationConstants.localSize[1];
+			groupCount[2] = 1;
+		}
+	}
+	double time = 0, time_validate = 0;
+	uint32_t mismatches = 0, firstMismatch = 0;
+	if (res == VK_SUCCESS)
+		res = generate_Data(vkGPU, &buffer[0], bufferSize, elementSize, dtype, VKT_PATTERN_RANDOM, size, size, size, &time);
+	if (res == VK_SUCCESS)
+		res = run_App(vkGPU->device, vkGPU->commandPool, app.pipeline, app.pipelineLayout, &app.descriptorSet, groupCount, vkGPU->queue, &vkGPU->fence, 1, &time);
+	if (res == VK_SUCCESS)
+		res = validate_Data(vkGPU, &buffer[1], bufferSize, elementSize, dtype, VKT_PATTERN_RANDOM, size, size, transposed, size, &mismatches, &firstMismatch, &time_validate);
+	if (res == VK_SUCCESS && mismatches != 0) {
+		printf("%s %s %d: %d wrong words, first at %u\n", entry->kernel, entry->dtype, size, mismatches, firstMismatch);
+		res = VK_ERROR_FORMAT_NOT_SUPPORTED;
+	}
+	//untimed batch, so the first trial does not pay for the first use of the pipeline and memory
+	if (res == VK_SUCCESS)
+		res = run_App(vkGPU->device, vkGPU->commandPool, app.pipeline, app.pipelineLayout, &app.descriptorSet, groupCount, vkGPU->queue, &vkGPU->fence, batch, &time);
+	for (uint32_t t = 0; t < trials && res == VK_SUCCESS; t++) {
+		double start = get_TimeMs();
+		res = run_App(vkGPU->device, vkGPU->commandPool, app.pipeline, app.pipelineLayout, &app.descriptorSet, groupCount, vkGPU->queue, &vkGPU->fence, batch, &time);
+		time = (get_TimeMs() - start) / batch;
+		entry->sample[entry->trials++] = 2.0 * bufferSize / 1024.0 / 1024.0 / 1024.0 / time * 1000;
+	}
+	if (app.pipeline != VK_NULL_HANDLE) deleteApp(vkGPU, &app);
+	for (uint32_t k = 0; k < 2; k++) {
+		vkDestroyBuffer(vkGPU->device, buffer[k], NULL);
+		vkFreeMemory(vkGPU->device, bufferDeviceMemory[k], NULL);
+	}
+	return res;
+}
+
+
+VkResult
+Example_VulkanPerf(uint32_t deviceID,
+                   uint32_t coalescedMemory,
+                   const char* baselineDir,
+                   uint32_t update,
+                   uint32_t trials,
+                   double threshold)
+{
+	//run the benchmark matrix. update = 1: write it as the baseline of the device. update = 0: compare it with the
+	//baseline and fail if any entry regressed by more than threshold percent
+	static const char* kernels[5][2] = { { "no_bank_conflicts", "float32" }, { "bank_conflicts", "float32" }, { "bandwidth", "float32" },
+	                                     { "generated", "uint32" }, { "generated", "float64" } };
+	static const uint32_t sizes[3] = { 256, 1024, 2048 };
+	const double alpha = 0.05;
+	if (trials < 3 || trials > VKT_PERF_MAX_TRIALS) {
+		printf("Number of trials %d is not in 3..%d\n", trials, VKT_PERF_MAX_TRIALS);
+		return VK_ERROR_INITIALIZATION_FAILED;
+	}
+	VkGPU vkGPU = { 0 };
+	vkGPU.device_id = deviceID;
+	VkResult res = create_VkGPU(&vkGPU);
+	if (res != VK_SUCCESS) return res;
+	coalescedMemory = get_CoalescedMemory(&vkGPU, coalescedMemory);
+	char path[320];
+	get_PerfBaselinePath(&vkGPU, baselineDir, path);
+	VkPerfBaseline* baseline = (VkPerfBaseline*) calloc(1, sizeof(VkPerfBaseline));
+	VkPerfBaseline* current = (VkPerfBaseline*) calloc(1, sizeof(VkPerfBaseline));
+	if (baseline == NULL || current == NULL) res = VK_ERROR_OUT_OF_HOST_MEMORY;
+	if (res == VK_SUCCESS && !update) {
+		res = read_PerfBaseline(path, baseline);
+		if (res != VK_SUCCESS) printf("No baseline for this device at %s, create it with --perf-update %s\n", path, baselineDir);
+		else if (baseline->driverVersion != vkGPU.physicalDeviceProperties.driverVersion)
+			printf("Warning: baseline recorded with driver 0x%08x, running 0x%08x\n", baseline->driverVersion, vkGPU.physicalDeviceProperties.driverVersion);
+	}
+
+	uint32_t skipped = 0;
+	for (uint32_t k = 0; k < 5 && res == VK_SUCCESS; k++) {
+		for (uint32_t s = 0; s < 3 && res == VK_SUCCESS; s++) {
+			if (sizes[s] % (coalescedMemory / sizeof(float)) != 0) continue;
+			VkPerfEntry* entry = &current->entry[current->count];
+			sprintf(entry->kernel, "%s", kernels[k][0]);
+			sprintf(entry->dtype, "%s", kernels[k][1]);
+			entry->size = sizes[s];
+			res = run_PerfEntry(&vkGPU, coalescedMemory, entry, trials, VKT_PERF_BATCH);
+			if (res == VK_ERROR_FEATURE_NOT_PRESENT) {
+				skipped++;
+				res = VK_SUCCESS;
+				continue;
+			}
+			if (res != VK_SUCCESS) printf("Benchmark %s %s %d failed, error code: %d\n", entry->kernel, entry->dtype, entry->size, res);
+			else current->count++;
+		}
+	}
+
+	if (res == VK_SUCCESS && update) {
+		res = write_PerfBaseline(path, &vkGPU, current);
+		if (res == VK_SUCCESS) {
+			printf("Baseline of %s written to %s: %d entries x %d trials, %d skipped\n", vkGPU.physicalDeviceProperties.deviceName, path, current->count, trials, skipped);
+			for (uint32_t e = 0; e < current->count; e++)
+				printf("  %-18s %-8s %5d %10.2f GB/s\n", current->entry[e].kernel, current->entry[e].dtype, current->entry[e].size, get_PerfMedian(&current->entry[e]));
+		}
+	}
+	else if (res == VK_SUCCESS) {
+		uint32_t regressed = 0, improved = 0, added = 0;
+		printf("Performance check of %s against %s (threshold %.1f%%, p < %.2f, %d trials)\n\n", vkGPU.physicalDeviceProperties.deviceName, path, threshold, alpha, trials);
+		printf("%-18s %-8s %5s %14s %14s %8s %7s  %s\n", "kernel", "dtype", "size", "baseline GB/s", "current GB/s", "change", "p", "status");
+		for (uint32_t e = 0; e < current->count; e++) {
+			VkPerfEntry* entry = &current->entry[e];
+			VkPerfEntry* base = NULL;
+			for (uint32_t b = 0; b < baseline->count; b++) {
+				if (strcmp(baseline->entry[b].kernel, entry->kernel) == 0 && strcmp(baseline->entry[b].dtype, entry->dtype) == 0 && baseline->entry[b].size == entry->size)
+					base = &baseline->entry[b];
+			}
+			double median = get_PerfMedian(entry);
+			if (base == NULL || base->trials < 3) {
+				printf("%-18s %-8s %5d %14s %14.2f %8s %7s  new\n", entry->kernel, entry->dtype, entry->size, "-", median, "-", "-");
+				added++;
+				continue;
+			}
+			double baseMedian = get_PerfMedian(base);
+			double change = 100.0 * (median - baseMedian) / baseMedian;
+			double pSlower = get_MannWhitneyP(entry, base);
+			double pFaster = get_MannWhitneyP(base, entry);
+			const char* status = "ok";
+			if (change < -threshold && pSlower < alpha) {
+				status = "REGRESSED";
+				regressed++;
+			}
+			else if (change > threshold && pFaster < alpha) {
+				status = "improved";
+				improved++;
+			}
+			printf("%-18s %-8s %5d %14.2f %14.2f %+7.1f%% %7.3f  %s\n", entry->kernel, entry->dtype, entry->size, baseMedian, median, change,
+			       (change < 0) ? pSlower : pFaster, status);
+		}
+		printf("\n%d entries: %d ok, %d regressed, %d improved, %d new, %d skipped\n", current->count,
+		       current->count - regressed - improved - added, regressed, improved, added, skipped);
+		printf("Performance check %s\n", regressed ? "FAILED" : "passed");
+		if (regressed) res = VK_ERROR_FORMAT_NOT_SUPPORTED;
+	}
+	free(baseline);
+	free(current);
+	delete_VkGPU(&vkGPU);
+	return res;
+}
@@ -0,0 +1,166 @@
+#include "VulkanTransposition.h"
+
+
+//workgroup rasterization modes of the transposition shaders, see rasterize() in transposition_no_bank_conflicts.comp
+#define VKT_RASTER_LINEAR   0
+#define VKT_RASTER_DIAGONAL 1
+#define VKT_RASTER_MORTON   2
+#define VKT_RASTER_XOR      3
+#define VKT_RASTER_MODES    4
+
+
+uint32_t
+check_RasterMode(uint32_t rasterMode, uint32_t supertileSize, uint32_t* groupCount)
+{
+	//returns 1 if the shader applies rasterMode to this grid, otherwise it falls back to the linear order
+	switch (rasterMode) {
+	case VKT_RASTER_DIAGONAL:
+		return groupCount[0] == groupCount[1];
+	case VKT_RASTER_MORTON:
+		return (groupCount[0] % supertileSize == 0) && (groupCount[1] % supertileSize == 0);
+	case VKT_RASTER_XOR:
+		return (groupCount[1] & (groupCount[1] - 1)) == 0;
+	default:
+		return 1;
+	}
+}
+
+
+VkResult
+Example_VulkanRasterization(uint32_t deviceID,
+                            uint32_t coalescedMemory,
+                            uint32_t maxSize,
+                            uint32_t key)
+{
+	//transposition of square matrices up to maxSize with all workgroup rasterization modes. Power of two sizes show
+	//partition camping of the linear order, the best mode of every size is the choice for a planner
+	VkGPU vkGPU = { 0 };
+	vkGPU.device_id = deviceID;
+	VkResult res = VK_SUCCESS;
+	res = create_VkGPU(&vkGPU);
+	if (res != VK_SUCCESS) return res;
+	coalescedMemory = get_CoalescedMemory(&vkGPU, coalescedMemory);
+	uint32_t tile = coalescedMemory / sizeof(float);
+	uint32_t supertileSize = 4;
+
+	uint32_t sizes[] = { 512, 768, 1024, 1536, 2048, 3072, 4096, 6144, 8192, 12288, 16384 };
+	uint32_t numSizes = 0;
+	while (numSizes < sizeof(sizes) / sizeof(sizes[0]) && sizes[numSizes] <= maxSize) numSizes++;
+	if (numSizes == 0) {
+		printf("Maximal system size %d is below the smallest size of the sweep %d\n", maxSize, sizes[0]);
+		delete_VkGPU(&vkGPU);
+		return VK_ERROR_FORMAT_NOT_SUPPORTED;
+	}
+	maxSize = sizes[numSizes - 1];
+
+	VkDeviceSize maxBufferSize = sizeof(float) * (VkDeviceSize) maxSize * maxSize;
+	VkBuffer inputBuffer = { 0 }, outputBuffer = { 0 };
+	VkDeviceMemory inputBufferDeviceMemory = { 0 }, outputBufferDeviceMemory = { 0 };
+	float* buffer_input  = NULL;
+	float* buffer_output = NULL;
+	uint32_t failed = 0;
+	res = allocate_Buffer_DeviceMemory(vkGPU.physicalDevice, vkGPU.device,
+                                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                           &vkGPU.physicalDeviceMemoryProperties, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                           maxBufferSize, &inputBuffer, &inputBufferDeviceMemory);
+	if (res != VK_SUCCESS) {
+		printf("Input buffer allocation failed, error code: %d\n", res);
+		goto cleanup;
+	}
+	res = allocate_Buffer_DeviceMemory(vkGPU.physicalDevice, vkGPU.device,
+                                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                           &vkGPU.physicalDeviceMemoryProperties, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                           maxBufferSize, &outputBuffer, &outputBufferDeviceMemory);
+	if (res != VK_SUCCESS) {
+		printf("Output buffer allocation failed, error code: %d\n", res);
+		goto cleanup;
+	}
+	buffer_input  = (float*) malloc(maxBufferSize);
+	buffer_output = (float*) malloc(maxBufferSize);
+	if (buffer_input == NULL || buffer_output == NULL) {
+		res = VK_ERROR_OUT_OF_HOST_MEMORY;
+		goto cleanup;
+	}
+	char shaderPath[256];
+	sprintf(shaderPath, "%stransposition_no_bank_conflicts.spv", SHADER_DIR);
+
+	const char* modes[VKT_RASTER_MODES] = { "linear", "diagonal", "morton", "xor" };
+	printf("Tile: %dx%d\nSupertile: %dx%d tiles\nXOR key: 0x%08x\n%-6s", tile, tile, supertileSize, supertileSize, key, "size");
+	for (uint32_t mode = 0; mode < VKT_RASTER_MODES; mode++) printf(" %14s", modes[mode]);
+	printf("  best\n");
+	for (uint32_t s = 0; s < numSizes; s++) {
+		uint32_t size = sizes[s];
+		if (size % tile != 0) continue;
+		VkDeviceSize bufferSize = sizeof(float) * (VkDeviceSize) size * size;
+		for (uint64_t i = 0; i < (uint64_t) size * size; i++) buffer_input[i] = (float) i;
+		res = upload_Data(vkGPU.physicalDevice, vkGPU.device, buffer_input, &vkGPU.physicalDeviceMemoryProperties,
+		                  vkGPU.commandPool, vkGPU.queue, &vkGPU.fence, &inputBuffer, bufferSize);
+		if (res != VK_SUCCESS) break;
+
+		uint32_t groupCount[3] = { size / tile, size / tile, 1 };
+		uint32_t best = VKT_RASTER_LINEAR;
+		double bestTime = 0;
+		printf("%-6d", size);
+		for (uint32_t mode = 0; mode < VKT_RASTER_MODES; mode++) {
+			if (!check_RasterMode(mode, supertileSize, groupCount)) {
+				printf(" %14s", "n/a");
+				continue;
+			}
+			VkApplication app = { 0 };
+			VkBuffer*    buffer[2]      = { &inputBuffer, &outputBuffer };
+			VkDeviceSize bufferSizes[2] = { bufferSize, bufferSize };
+			uint32_t systemSize[3] = { size, size, 1 };
+			app.specializationConstants.rasterMode = mode;
+			app.specializationConstants.supertileSize = supertileSize;
+			res = create_App(vkGPU.device, &app.specializationConstants, coalescedMemory, buffer, bufferSizes, systemSize,
+			                 &app.descriptorPool, &app.descriptorSetLayout, &app.descriptorSet,
+			                 (const char*) shaderPath, &app.pipelineLayout, &app.pipeline);
+			if (res != VK_SUCCESS) {
+				printf("\nRasterization application creation failed, error code: %d\n", res);
+				break;
+			}
+			//the key only affects the XOR mode, other modes ignore the push constant
+			app.pushConstants.pushID = key;
+			double time = 0;
+			res = run_AppPushConstants(vkGPU.device, vkGPU.commandPool, app.pipeline, app.pipelineLayout, &app.descriptorSet,
+			                           groupCount, vkGPU.queue, &vkGPU.fence, 100, &app.pushConstants, &time);
+			deleteApp(&vkGPU, &app);
+			if (res != VK_SUCCESS) {
+				printf("\nRasterization application run failed, error code: %d\n", res);
+				break;
+			}
+			res = download_Data(vkGPU.physicalDevice, vkGPU.device, vkGPU.commandPool, &vkGPU.physicalDeviceMemoryProperties,
+			                    vkGPU.queue, &vkGPU.fence, buffer_output, &outputBuffer, bufferSize);
+			if (res != VK_SUCCESS) break;
+			uint32_t passed = 1;
+			for (uint64_t j = 0; j < size && passed; j++) {
+				for (uint64_t i = 0; i < size && passed; i++) {
+					passed = (buffer_output[i + j * size] == buffer_input[j + i * size]);
+				}
+			}
+			if (!passed) {
+				printf(" %14s", "FAILED");
+				failed = 1;
+				continue;
+			}
+			printf(" %9.1f GB/s", 2 * bufferSize / 1024.0 / 1024.0 / 1024.0 / (time / 1000));
+			if (bestTime == 0 || time < bestTime) {
+				bestTime = time;
+				best = mode;
+			}
+		}
+		if (res != VK_SUCCESS) break;
+		printf("  %s\n", modes[best]);
+	}
+	if (res == VK_SUCCESS && failed) res = VK_ERROR_FORMAT_NOT_SUPPORTED;
+
+cleanup:
+	free(buffer_input);
+	free(buffer_output);
+	vkDestroyBuffer(vkGPU.device, inputBuffer, NULL);
+	vkFreeMemory(vkGPU.device, inputBufferDeviceMemory, NULL);
+	vkDestroyBuffer(vkGPU.device, outputBuffer, NULL);
+	vkFreeMemory(vkGPU.device, outputBufferDeviceMemory, NULL);
+	delete_VkGPU(&vkGPU);
+	return res;
+}
@@ -0,0 +1,295 @@
+#include "VulkanTransposition.h"
+
+
+//Fused transposition with reduction: transposition_reduce.comp writes the transposed matrix and the statistics of every row
+//and column of the input in one read of it. Tiles write partials, a combine pass of the same shader merges them, so there
+//are no float atomics and the result does not depend on the order of the workgroups
+#define VKT_REDUCE_PASS_TRANSPOSE 0//transposition and partials
+#define VKT_REDUCE_PASS_PARTIALS  1//partials only, the separate statistics pass
+#define VKT_REDUCE_PASS_COMBINE   2//merge of the partials
+
+typedef struct {
+	uint32_t localSize[3];
+	uint32_t size;//size x size matrix, multiple of the tile
+	uint32_t pass;//VKT_REDUCE_PASS_*
+} VkReduceSpecializationConstantsLayout;//specialization constants of transposition_reduce.comp and transposition_reduce_subgroup.comp
+
+typedef struct {
+	float sum;
+	float sumSquares;
+	float minimum;
+	float maximum;
+	uint32_t argmax;//column of the maximum of a row, row of the maximum of a column, the first one on ties
+} VkStatistics;//std430 layout of Statistics in transposition_reduce.comp
+
+
+VkDeviceSize
+get_ReduceStatisticsCount(uint32_t size, uint32_t tile)
+{
+	//row partials, column partials (size / tile per row or column), then size row and size column statistics
+	return 2 * (VkDeviceSize) size * (size / tile) + 2 * (VkDeviceSize) size;
+}
+
+
+void
+reduce_Statistics(const float* input, VkStatistics* stats, uint32_t size)
+{
+	//CPU reference: statistics of the size rows, then of the size columns of the input
+	for (uint64_t i = 0; i < 2 * (uint64_t) size; i++) {
+		stats[i].sum = 0;
+		stats[i].sumSquares = 0;
+		stats[i].minimum = FLT_MAX;
+		stats[i].maximum = -FLT_MAX;
+		stats[i].argmax = 0;
+	}
+	double* sums = (double*) calloc(4 * (size_t) size, sizeof(double));
+	if (sums == NULL) return;
+	for (uint64_t i = 0; i < size; i++) {
+		for (uint64_t j = 0; j < size; j++) {
+			float v = input[i * size + j];
+			VkStatistics* row = &stats[i];
+			VkStatistics* column = &stats[size + j];
+			sums[2 * i] += v;
+			sums[2 * i + 1] += (double) v * v;
+			sums[2 * (size + j)] += v;
+			sums[2 * (size + j) + 1] += (double) v * v;
+			if (v < row->minimum) row->minimum = v;
+			if (v < column->minimum) column->minimum = v;
+			if (v > row->maximum) {
+				row->maximum = v;
+				row->argmax = (uint32_t) j;
+			}
+			if (v > column->maximum) {
+				column->maximum = v;
+				column->argmax = (uint32_t) i;
+			}
+		}
+	}
+	for (uint64_t i = 0; i < 2 * (uint64_t) size; i++) {
+		stats[i].sum = (float) sums[2 * i];
+		stats[i].sumSquares = (float) sums[2 * i + 1];
+	}
+	free(sums);
+}
+
+
+VkResult
+create_ReduceApp(VkGPU* vkGPU,
+                 VkApplication* app,
+                 VkReduceSpecializationConstantsLayout* constants,
+                 uint32_t subgroup,
+                 VkBuffer* inputBuffer,
+                 VkBuffer* outputBuffer,
+                 VkBuffer* statsBuffer,
+                 uint32_t groupCount[3])
+{
+	//one pass of transposition_reduce.comp, or of transposition_reduce_subgroup.comp if subgroup is set. localSize is tile x tile.
+	//groupCount - one workgroup per tile, or one thread per row and column for the combine pass
+	uint32_t size = constants->size, tile = constants->localSize[0];
+	if (tile == 0 || (tile & (tile - 1)) != 0 || constants->localSize[1] != tile || size == 0 || size % tile != 0 ||
+	    tile * tile > vkGPU->physicalDeviceProperties.limits.maxComputeWorkGroupInvocations || (uint64_t) size * size > 0xFFFFFFFFull)
+		return VK_ERROR_FORMAT_NOT_SUPPORTED;
+	if (constants->pass == VKT_REDUCE_PASS_COMBINE) {
+		groupCount[0] = (2 * size + tile * tile - 1) / (tile * tile);
+		groupCount[1] = 1;
+	}
+	else {
+		groupCount[0] = size / tile;
+		groupCount[1] = size / tile;
+	}
+	groupCount[2] = 1;
+
+	VkSpecializationMapEntry specializationMapEntries[5] = { 0 };
+	for (uint32_t kk = 0; kk < 5; kk++) {
+		specializationMapEntries[kk].constantID = kk + 1;
+		specializationMapEntries[kk].size = sizeof(uint32_t);
+		specializationMapEntries[kk].offset = kk * sizeof(uint32_t);
+	}
+	VkSpecializationInfo specializationInfo = { (uint32_t) 5,
+                                                    (const VkSpecializationMapEntry*) specializationMapEntries,
+                                                    (size_t) 5 * sizeof(uint32_t),
+                                                    (const void*) constants };
+	VkBuffer*    buffer[3]      = { inputBuffer, outputBuffer, statsBuffer };
+	VkDeviceSize bufferSizes[3] = { sizeof(float) * (VkDeviceSize) size * size, sizeof(float) * (VkDeviceSize) size * size,
+                                        sizeof(VkStatistics) * get_ReduceStatisticsCount(size, tile) };
+	char shaderPath[256];
+	sprintf(shaderPath, "%s%s", SHADER_DIR, subgroup ? "transposition_reduce_subgroup.spv" : "transposition_reduce.spv");
+	return create_ComputeApp(vkGPU->device, 3, buffer, bufferSizes, &specializationInfo, &app->descriptorPool, &app->descriptorSetLayout,
+	                         &app->descriptorSet, (const char*) shaderPath, &app->pipelineLayout, &app->pipeline);
+}
+
+
+uint32_t
+check_Statistics(const VkStatistics* result, const VkStatistics* reference, const float* absoluteSums, uint32_t count, uint32_t depth)
+{
+	//minimum, maximum and argmax are exact. A float sum of depth rounding steps is within depth * FLT_EPSILON of the sum
+	//of the magnitudes of its terms
+	uint32_t errors = 0;
+	for (uint32_t i = 0; i < count; i++) {
+		float tolerance = depth * FLT_EPSILON;
+		if (result[i].minimum != reference[i].minimum || result[i].maximum != reference[i].maximum || result[i].argmax != reference[i].argmax ||
+		    fabsf(result[i].sum - reference[i].sum) > tolerance * (absoluteSums[i] + 1.0f) ||
+		    fabsf(result[i].sumSquares - reference[i].sumSquares) > tolerance * (reference[i].sumSquares + 1.0f))
+			errors++;
+	}
+	return errors;
+}
+
+
+VkResult
+Example_VulkanReduce(uint32_t deviceID,
+                     uint32_t coalescedMemory,
+                     uint32_t size)
+{
+	//sum, sum of squares, minimum, maximum and argmax of every row and column of a size x size matrix, computed while it is
+	//transposed, against the transposition followed by a separate statistics pass over the input. Both chains run as graphs
+	VkGPU vkGPU = { 0 };
+	vkGPU.device_id = deviceID;
+	VkResult res = create_VkGPU(&vkGPU);
+	if (res != VK_SUCCESS) return res;
+	coalescedMemory = get_CoalescedMemory(&vkGPU, coalescedMemory);
+	uint32_t tile = coalescedMemory / sizeof(float);
+	while (tile * tile > vkGPU.physicalDeviceProperties.limits.maxComputeWorkGroupInvocations) tile /= 2;
+	if (size == 0 || size % tile != 0 || (uint64_t) size * size > 0xFFFFFFFFull) {
+		printf("System size %d is not a multiple of the tile size %d or does not fit 32-bit indices\n", size, tile);
+		delete_VkGPU(&vkGPU);
+		return VK_ERROR_FORMAT_NOT_SUPPORTED;
+	}
+	//a tile row is reduced with shuffles if it is a group of lanes of one subgroup and workgroups have whole subgroups.
+	//The reported size is only a hint, a dispatch may get smaller subgroups without VK_EXT_subgroup_size_control:
+	//transposition_reduce_subgroup.comp checks gl_SubgroupSize and falls back to the shared memory trees
+	VkPhysicalDeviceSubgroupProperties* subgroupProperties = &vkGPU.physicalDeviceSubgroupProperties;
+	uint32_t subgroup = (subgroupProperties->subgroupSize >= tile) && (subgroupProperties->subgroupSize % tile == 0) &&
+	                    ((tile * tile) % subgroupProperties->subgroupSize == 0) && (subgroupProperties->supportedStages & VK_SHADER_STAGE_COMPUTE_BIT) &&
+	                    (subgroupProperties->supportedOperations & VK_SUBGROUP_FEATURE_SHUFFLE_BIT);
+
+	VkDeviceSize bufferSize = sizeof(float) * (VkDeviceSize) size * size;
+	VkDeviceSize statsCount = get_ReduceStatisticsCount(size, tile);
+	VkDeviceSize partialsSize = sizeof(VkStatistics) * (statsCount - 2 * size);
+	VkDeviceSize statsSize = sizeof(VkStatistics) * statsCount;
+	//input, output, statistics of the fused chain, statistics of the separate pass
+	VkBuffer buffer[4] = { 0 };
+	VkDeviceMemory bufferDeviceMemory[4] = { 0 };
+	for (uint32_t k = 0; k < 4 && res == VK_SUCCESS; k++) {
+		res = allocate_Buffer_DeviceMemory(vkGPU.physicalDevice, vkGPU.device,
+		                                   VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		                                   &vkGPU.physicalDeviceMemoryProperties, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		                                   (k < 2) ? bufferSize : statsSize, &buffer[k], &bufferDeviceMemory[k]);
+	}
+	if (res != VK_SUCCESS) printf("Buffer allocation failed, error code: %d\n", res);
+	float* input = (float*) malloc((size_t) bufferSize);
+	float* output = (float*) malloc((size_t) bufferSize);
+	VkStatistics* stats = (VkStatistics*) malloc((size_t) statsSize);
+	VkStatistics* reference = (VkStatistics*) malloc(2 * (size_t) size * sizeof(VkStatistics));
+	float* absoluteSums = (float*) calloc(2 * (size_t) size, sizeof(float));
+	if (res == VK_SUCCESS && (input == NULL || output == NULL || stats == NULL || reference == NULL || absoluteSums == NULL)) res = VK_ERROR_OUT_OF_HOST_MEMORY;
+	double time_cpu = 0;
+	if (res == VK_SUCCESS) {
+		//61 values in [-1, 1], so rows and columns repeat their maxima and the first-index rule of argmax is checked
+		for (uint64_t i = 0; i < (uint64_t) size * size; i++) input[i] = (float) ((i * 7919) % 2003 % 61) / 30.0f - 1.0f;
+		for (uint64_t i = 0; i < size; i++) {
+			for (uint64_t j = 0; j < size; j++) {
+				absoluteSums[i] += fabsf(input[i * size + j]);
+				absoluteSums[size + j] += fabsf(input[i * size + j]);
+			}
+		}
+		double t = get_TimeMs();
+		reduce_Statistics(input, reference, size);
+		time_cpu = get_TimeMs() - t;
+		res = upload_Data(vkGPU.physicalDevice, vkGPU.device, input, &vkGPU.physicalDeviceMemoryProperties, vkGPU.commandPool,
+		                  vkGPU.queue, &vkGPU.fence, &buffer[0], bufferSize);
+	}
+
+	//fused: transposition with partials, combine. Separate: transposition, partials of the input, combine
+	VkApplication app[5];
+	memset(app, 0, sizeof(app));
+	uint32_t groupCount[5][3] = { { 0 } };
+	uint32_t passes[5] = { VKT_REDUCE_PASS_TRANSPOSE, VKT_REDUCE_PASS_COMBINE, 0, VKT_REDUCE_PASS_PARTIALS, VKT_REDUCE_PASS_COMBINE };
+	for (uint32_t k = 0; k < 5 && res == VK_SUCCESS; k++) {
+		VkBuffer* statsBuffer = (k < 2) ? &buffer[2] : &buffer[3];
+		if (k == 2) {
+			char shaderPath[256];
+			sprintf(shaderPath, "%stransposition_no_bank_conflicts.spv", SHADER_DIR);
+			VkBuffer*    appBuffer[2]   = { &buffer[0], &buffer[1] };
+			VkDeviceSize bufferSizes[2] = { bufferSize, bufferSize };
+			uint32_t     systemSize[3]  = { size, size, 1 };
+			res = create_App(vkGPU.device, &app[k].specializationConstants, tile * sizeof(float), appBuffer, bufferSizes, systemSize,
+			                 &app[k].descriptorPool, &app[k].descriptorSetLayout, &app[k].descriptorSet, (const char*) shaderPath, &app[k].pipelineLayout, &app[k].pipeline);
+			groupCount[k][0] = size / tile;
+			groupCount[k][1] = size / tile;
+			groupCount[k][2] = 1;
+		}
+		else {
+			VkReduceSpecializationConstantsLayout specializationConstants = { { tile, tile, 1 }, size, passes[k] };
+			res = create_ReduceApp(&vkGPU, &app[k], &specializationConstants, subgroup, &buffer[0], &buffer[1], statsBuffer, groupCount[k]);
+		}
+		if (res != VK_SUCCESS) printf("Application creation failed, error code: %d\n", res);
+	}
+
+	VkGraph* graph = (VkGraph*) calloc(2, sizeof(VkGraph));
+	if (res == VK_SUCCESS && graph == NULL) res = VK_ERROR_OUT_OF_HOST_MEMORY;
+	if (res == VK_SUCCESS) {
+		VkBufferRange input_range = { buffer[0], 0, bufferSize };
+		VkBufferRange output_range = { buffer[1], 0, bufferSize };
+		VkBufferRange partials[2] = { { buffer[2], 0, partialsSize }, { buffer[3], 0, partialsSize } };
+		VkBufferRange combined[2] = { { buffer[2], partialsSize, statsSize - partialsSize }, { buffer[3], partialsSize, statsSize - partialsSize } };
+		VkBufferRange fusedWrites[2] = { output_range, partials[0] };
+		add_GraphDispatch(&graph[0], &app[0], groupCount[0], &input_range, 1, fusedWrites, 2);
+		add_GraphDispatch(&graph[0], &app[1], groupCount[1], &partials[0], 1, &combined[0], 1);
+		add_GraphDispatch(&graph[1], &app[2], groupCount[2], &input_range, 1, &output_range, 1);
+		add_GraphDispatch(&graph[1], &app[3], groupCount[3], &input_range, 1, &partials[1], 1);
+		add_GraphDispatch(&graph[1], &app[4], groupCount[4], &partials[1], 1, &combined[1], 1);
+	}
+
+	uint32_t batch = 100, failed = 0;
+	double time[2] = { 0 };
+	const char* names[2] = { "fused", "separate" };
+	if (res == VK_SUCCESS) {
+		printf("System size: %dx%d, tile %dx%d, %s reductions\n", size, size, tile, tile, subgroup ? "subgroup shuffle" : "shared memory");
+		printf("Partials: %.2f MB, CPU statistics: %.3f ms\n", partialsSize / 1024.0 / 1024.0, time_cpu);
+		printf("%-10s %10s %10s %s\n", "chain", "GPU, ms", "GB/s", "result");
+	}
+	for (uint32_t g = 0; g < 2 && res == VK_SUCCESS; g++) {
+		res = run_Graph(&vkGPU, &graph[g], 0, batch, &time[g]);
+		if (res == VK_SUCCESS)
+			res = download_Data(vkGPU.physicalDevice, vkGPU.device, vkGPU.commandPool, &vkGPU.physicalDeviceMemoryProperties,
+			                    vkGPU.queue, &vkGPU.fence, output, &buffer[1], bufferSize);
+		if (res == VK_SUCCESS)
+			res = download_Data(vkGPU.physicalDevice, vkGPU.device, vkGPU.commandPool, &vkGPU.physicalDeviceMemoryProperties,
+			                    vkGPU.queue, &vkGPU.fence, stats, &buffer[2 + g], statsSize);
+		if (res != VK_SUCCESS) {
+			printf("Graph run failed, error code: %d\n", res);
+			break;
+		}
+		uint64_t errors = 0;
+		for (uint64_t i = 0; i < size; i++) {
+			for (uint64_t j = 0; j < size; j++) errors += (output[j * size + i] != input[i * size + j]);
+		}
+		//tree of the tile, then the sequential combine of the tiles
+		errors += check_Statistics(stats + statsCount - 2 * size, reference, absoluteSums, 2 * size, tile + size / tile);
+		//the fused chain reads the input once, the separate one twice. Both write the output and the partials and read the partials back
+		VkDeviceSize moved = (2 + g) * bufferSize + 2 * partialsSize + 2 * size * sizeof(VkStatistics);
+		printf("%-10s %10.3f %10.2f %s\n", names[g], time[g], moved / 1024.0 / 1024.0 / 1024.0 / time[g] * 1000, errors ? "FAILED" : "passed");
+		failed += (errors != 0);
+	}
+	if (res == VK_SUCCESS) {
+		printf("Fused speedup: %.2fx\nVerification %s\n", time[1] / time[0], failed ? "FAILED" : "passed");
+		if (failed) res = VK_ERROR_FORMAT_NOT_SUPPORTED;
+	}
+
+	for (uint32_t k = 0; k < 5; k++) {
+		if (app[k].pipeline != VK_NULL_HANDLE) deleteApp(&vkGPU, &app[k]);
+	}
+	for (uint32_t k = 0; k < 4; k++) {
+		vkDestroyBuffer(vkGPU.device, buffer[k], NULL);
+		vkFreeMemory(vkGPU.device, bufferDeviceMemory[k], NULL);
+	}
+	free(graph);
+	free(input);
+	free(output);
+	free(stats);
+	free(reference);
+	free(absoluteSums);
+	delete_VkGPU(&vkGPU);
+	return res;
+}
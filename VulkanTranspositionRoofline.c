@@ -0,0 +1,253 @@
+#include "VulkanTransposition.h"
+
+
+//Bandwidth roofline (bandwidth_probe.comp and vkCmdCopyBuffer): copy, read-only, write-only, strided and shared memory
+//probes measure what a transposition can reach on the device, and the transposition kernels are reported against its peak
+#define VKT_ROOFLINE_STRIDES           6   //strided reads at 1, 2, 4 ... 32 floats
+#define VKT_ROOFLINE_BATCH             20
+#define VKT_ROOFLINE_TRIALS            5
+#define VKT_ROOFLINE_SHARED_GROUPS     1024
+#define VKT_ROOFLINE_SHARED_ITERATIONS 1024
+
+#define VKT_PROBE_COPY        0
+#define VKT_PROBE_READ        1
+#define VKT_PROBE_WRITE       2
+#define VKT_PROBE_STRIDE      3
+#define VKT_PROBE_SHARED      4
+#define VKT_PROBE_COPY_ENGINE 5//vkCmdCopyBuffer, no shader
+
+typedef struct {
+	uint32_t localSize[3];
+	uint32_t mode;      //VKT_PROBE_*
+	uint32_t count;     //vec4 elements of the buffers
+	uint32_t stride;    //floats between the strided reads, words between the shared memory reads
+	uint32_t iterations;//shared memory reads per thread
+} VkProbeSpecializationConstantsLayout;//specialization constants of bandwidth_probe.comp
+
+typedef struct {
+	VkDeviceSize bufferSize;
+	double copyEngine;                    //vkCmdCopyBuffer, GB/s of the reads and the writes
+	double copy;                          //vec4 copy kernel, GB/s of the reads and the writes
+	double readOnly;
+	double writeOnly;
+	double strided[VKT_ROOFLINE_STRIDES]; //GB/s of the 4 bytes used of every read
+	double sharedNoConflicts;             //shared memory, GB/s of the reads
+	double sharedConflicts;
+	double peak;                          //ceiling of a transposition, which reads and writes every element once: the faster copy
+} VkRoofline;//bandwidth roofline of a device, measured on buffers of bufferSize
+
+
+VkResult
+run_CopyProbe(VkGPU* vkGPU, VkBuffer* buffer, VkDeviceSize bufferSize, uint32_t batch, double* time)
+{
+	//record batch copies of buffer[0] to buffer[1] into one command buffer and measure the average wall time of one, in ms
+	VkResult res = VK_SUCCESS;
+	VkCommandBuffer commandBuffer = { 0 };
+	VkCommandBufferAllocateInfo commandBufferAllocateInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+                                        (const void*) NULL,
+                                        (VkCommandPool) vkGPU->commandPool,
+                                        (VkCommandBufferLevel) VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+                                        (uint32_t) 1 };
+	res = vkAllocateCommandBuffers(vkGPU->device, &commandBufferAllocateInfo, &commandBuffer);
+	if (res != VK_SUCCESS) return res;
+	VkCommandBufferBeginInfo commandBufferBeginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+                                     (const void*) NULL,
+                                     (VkCommandBufferUsageFlags) VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+                                     (const VkCommandBufferInheritanceInfo*) NULL };
+	res = vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo);
+	if (res != VK_SUCCESS) return res;
+	VkBufferCopy copyRegion = { 0, 0, bufferSize };
+	//copies write the same buffer, so each one waits for the previous one like the dispatches of run_App
+	VkMemoryBarrier memoryBarrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+	                            (const void*) NULL,
+	                            (VkAccessFlags) VK_ACCESS_TRANSFER_WRITE_BIT,
+	                            (VkAccessFlags) VK_ACCESS_TRANSFER_WRITE_BIT };
+	for (uint32_t i = 0; i < batch; i++) {
+		vkCmdCopyBuffer(commandBuffer, buffer[0], buffer[1], 1, &copyRegion);
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &memoryBarrier, 0, NULL, 0, NULL);
+	}
+	res = vkEndCommandBuffer(commandBuffer);
+	if (res != VK_SUCCESS) return res;
+
+	VkSubmitInfo submitInfo = { VK_STRUCTURE_TYPE_SUBMIT_INFO,
+                         (const void*) NULL,
+                         (uint32_t) 0,
+                         (const VkSemaphore*) NULL,
+                         (const VkPipelineStageFlags*) NULL,
+                         (uint32_t) 1,
+                         (const VkCommandBuffer*) &commandBuffer,
+                         (uint32_t) 0,
+                         (const VkSemaphore*) NULL };
+	double t = get_TimeMs();
+	res = vkQueueSubmit(vkGPU->queue, 1, &submitInfo, vkGPU->fence);
+	if (res != VK_SUCCESS) return res;
+	res = vkWaitForFences(vkGPU->device, 1, &vkGPU->fence, VK_TRUE, 100000000000);
+	if (res != VK_SUCCESS) return res;
+	time[0] = (get_TimeMs() - t) / batch;
+	res = vkResetFences(vkGPU->device, 1, &vkGPU->fence);
+	if (res != VK_SUCCESS) return res;
+	vkFreeCommandBuffers(vkGPU->device, vkGPU->commandPool, 1, &commandBuffer);
+	return res;
+}
+
+
+VkResult
+run_BandwidthProbe(VkGPU* vkGPU, VkBuffer* buffer, VkDeviceSize bufferSize, uint32_t mode, uint32_t stride, double* bandwidth)
+{
+	//best GB/s of VKT_ROOFLINE_TRIALS batches of one probe. The best trial is the ceiling the device can reach, the
+	//transpositions are compared with it. Probes of bandwidth_probe.comp read buffer[0] and write buffer[1]
+	VkResult res = VK_SUCCESS;
+	VkApplication app = { 0 };
+	uint32_t groupCount[3] = { 1, 1, 1 };
+	double bytes = 2.0 * bufferSize;
+	if (mode != VKT_PROBE_SHARED && (bufferSize % 16 != 0 || bufferSize / 16 > 0xFFFFFFFF / 4)) {
+		printf("Buffer of %llu bytes does not fit the probes\n", (unsigned long long) bufferSize);
+		return VK_ERROR_INITIALIZATION_FAILED;
+	}
+	if (mode != VKT_PROBE_COPY_ENGINE) {
+		VkProbeSpecializationConstantsLayout constants = { { 256, 1, 1 }, mode, (uint32_t) (bufferSize / 16), stride, VKT_ROOFLINE_SHARED_ITERATIONS };
+		VkSpecializationMapEntry specializationMapEntries[7] = { 0 };
+		for (uint32_t kk = 0; kk < 7; kk++) {
+			specializationMapEntries[kk].constantID = kk + 1;
+			specializationMapEntries[kk].size = sizeof(uint32_t);
+			specializationMapEntries[kk].offset = kk * sizeof(uint32_t);
+		}
+		VkSpecializationInfo specializationInfo = { (uint32_t) 7,
+                                                            (const VkSpecializationMapEntry*) specializationMapEntries,
+                                                            (size_t) sizeof(VkProbeSpecializationConstantsLayout),
+                                                            (const void*) &constants };
+		VkBuffer*    appBuffer[2]   = { &buffer[0], &buffer[1] };
+		VkDeviceSize bufferSizes[2] = { bufferSize, bufferSize };
+		char shaderPath[256];
+		sprintf(shaderPath, "%sbandwidth_probe.spv", SHADER_DIR);
+		res = create_ComputeApp(vkGPU->device, 2, appBuffer, bufferSizes, &specializationInfo, &app.descriptorPool, &app.descriptorSetLayout,
+		                        &app.descriptorSet, (const char*) shaderPath, &app.pipelineLayout, &app.pipeline);
+		if (res != VK_SUCCESS) return res;
+		//one vec4 per thread, the grid wraps at 65535 workgroups per dimension
+		uint64_t groups = (mode == VKT_PROBE_SHARED) ? VKT_ROOFLINE_SHARED_GROUPS : ((uint64_t) constants.count + 255) / 256;
+		groupCount[0] = (uint32_t) ((groups < 65535) ? groups : 65535);
+		groupCount[1] = (uint32_t) ((groups + groupCount[0] - 1) / groupCount[0]);
+		if (mode == VKT_PROBE_READ || mode == VKT_PROBE_WRITE) bytes = (double) bufferSize;
+		else if (mode == VKT_PROBE_STRIDE) bytes = 4.0 * constants.count;
+		else if (mode == VKT_PROBE_SHARED) bytes = 4.0 * groups * 256 * VKT_ROOFLINE_SHARED_ITERATIONS;
+	}
+	bandwidth[0] = 0;
+	//first batch is untimed, so no trial pays for the first use of the pipeline and memory
+	for (uint32_t t = 0; t <= VKT_ROOFLINE_TRIALS && res == VK_SUCCESS; t++) {
+		double time = 0;
+		if (mode == VKT_PROBE_COPY_ENGINE) {
+			res = run_CopyProbe(vkGPU, buffer, bufferSize, VKT_ROOFLINE_BATCH, &time);
+		}
+		else {
+			double start = get_TimeMs(), time_dispatch = 0;
+			res = run_App(vkGPU->device, vkGPU->commandPool, app.pipeline, app.pipelineLayout, &app.descriptorSet, groupCount,
+			              vkGPU->queue, &vkGPU->fence, VKT_ROOFLINE_BATCH, &time_dispatch);
+			time = (get_TimeMs() - start) / VKT_ROOFLINE_BATCH;
+		}
+		double gbs = (time > 0) ? bytes / 1024.0 / 1024.0 / 1024.0 / time * 1000 : 0;
+		if (t > 0 && gbs > bandwidth[0]) bandwidth[0] = gbs;
+	}
+	if (app.pipeline != VK_NULL_HANDLE) deleteApp(vkGPU, &app);
+	return res;
+}
+
+
+VkResult
+run_Roofline(VkGPU* vkGPU, VkBuffer* buffer, VkDeviceSize bufferSize, VkRoofline* roofline)
+{
+	//measure all probes on buffer[0] (read) and buffer[1] (written, its content is lost)
+	VkResult res = VK_SUCCESS;
+	memset(roofline, 0, sizeof(VkRoofline));
+	roofline->bufferSize = bufferSize;
+	res = run_BandwidthProbe(vkGPU, buffer, bufferSize, VKT_PROBE_COPY_ENGINE, 1, &roofline->copyEngine);
+	if (res == VK_SUCCESS) res = run_BandwidthProbe(vkGPU, buffer, bufferSize, VKT_PROBE_COPY, 1, &roofline->copy);
+	if (res == VK_SUCCESS) res = run_BandwidthProbe(vkGPU, buffer, bufferSize, VKT_PROBE_READ, 1, &roofline->readOnly);
+	if (res == VK_SUCCESS) res = run_BandwidthProbe(vkGPU, buffer, bufferSize, VKT_PROBE_WRITE, 1, &roofline->writeOnly);
+	for (uint32_t s = 0; s < VKT_ROOFLINE_STRIDES && res == VK_SUCCESS; s++)
+		res = run_BandwidthProbe(vkGPU, buffer, bufferSize, VKT_PROBE_STRIDE, 1u << s, &roofline->strided[s]);
+	//stride 1 gives every thread of a subgroup its own bank, a stride of the bank count puts them all on one
+	if (res == VK_SUCCESS) res = run_BandwidthProbe(vkGPU, buffer, bufferSize, VKT_PROBE_SHARED, 1, &roofline->sharedNoConflicts);
+	if (res == VK_SUCCESS) res = run_BandwidthProbe(vkGPU, buffer, bufferSize, VKT_PROBE_SHARED, VKT_SHARED_MEMORY_BANKS, &roofline->sharedConflicts);
+	roofline->peak = (roofline->copyEngine > roofline->copy) ? roofline->copyEngine : roofline->copy;
+	if (res != VK_SUCCESS) printf("Roofline probes failed, error code: %d\n", res);
+	return res;
+}
+
+
+void
+print_Roofline(VkGPU* vkGPU, const VkRoofline* roofline)
+{
+	printf("Bandwidth roofline of %s, buffers of %llu KB (GB/s)\n", vkGPU->physicalDeviceProperties.deviceName, (unsigned long long) roofline->bufferSize / 1024);
+	printf("  vkCmdCopyBuffer:                     %10.2f\n", roofline->copyEngine);
+	printf("  vec4 copy kernel:                    %10.2f\n", roofline->copy);
+	printf("  read only:                           %10.2f\n", roofline->readOnly);
+	printf("  write only:                          %10.2f\n", roofline->writeOnly);
+	for (uint32_t s = 0; s < VKT_ROOFLINE_STRIDES; s++)
+		printf("  strided read, stride %2d floats:      %10.2f\n", 1 << s, roofline->strided[s]);
+	printf("  shared memory, no bank conflicts:    %10.2f\n", roofline->sharedNoConflicts);
+	printf("  shared memory, %2d-way bank conflicts:%10.2f\n", VKT_SHARED_MEMORY_BANKS, roofline->sharedConflicts);
+	printf("  peak of the transpositions:          %10.2f (%s)\n", roofline->peak, (roofline->copyEngine > roofline->copy) ? "vkCmdCopyBuffer" : "vec4 copy kernel");
+}
+
+
+VkResult
+Example_VulkanRoofline(uint32_t deviceID,
+                       uint32_t coalescedMemory,
+                       uint32_t size)
+{
+	//measure the roofline on size x size float buffers, then the efficiency of every transposition kernel against it
+	static const char* kernels[5][2] = { { "no_bank_conflicts", "float32" }, { "bank_conflicts", "float32" }, { "bandwidth", "float32" },
+	                                     { "generated", "uint32" }, { "generated", "float64" } };
+	VkGPU vkGPU = { 0 };
+	vkGPU.device_id = deviceID;
+	VkResult res = create_VkGPU(&vkGPU);
+	if (res != VK_SUCCESS) return res;
+	coalescedMemory = get_CoalescedMemory(&vkGPU, coalescedMemory);
+	if (size == 0 || size % (coalescedMemory / sizeof(float)) != 0) {
+		printf("System size %d is not a multiple of the tile %d\n", size, (uint32_t) (coalescedMemory / sizeof(float)));
+		delete_VkGPU(&vkGPU);
+		return VK_ERROR_INITIALIZATION_FAILED;
+	}
+	VkDeviceSize bufferSize = (VkDeviceSize) sizeof(float) * size * size;
+	VkBuffer buffer[2] = { 0 };
+	VkDeviceMemory bufferDeviceMemory[2] = { 0 };
+	for (uint32_t k = 0; k < 2 && res == VK_SUCCESS; k++) {
+		res = allocate_Buffer_DeviceMemory(vkGPU.physicalDevice, vkGPU.device,
+		                                   VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		                                   &vkGPU.physicalDeviceMemoryProperties, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		                                   bufferSize, &buffer[k], &bufferDeviceMemory[k]);
+	}
+	VkRoofline roofline = { 0 };
+	if (res == VK_SUCCESS) res = run_Roofline(&vkGPU, buffer, bufferSize, &roofline);
+	//the kernels allocate their own buffers
+	for (uint32_t k = 0; k < 2; k++) {
+		vkDestroyBuffer(vkGPU.device, buffer[k], NULL);
+		vkFreeMemory(vkGPU.device, bufferDeviceMemory[k], NULL);
+	}
+	if (res == VK_SUCCESS) {
+		print_Roofline(&vkGPU, &roofline);
+		printf("\n%-18s %-8s %5s %10s %11s\n", "kernel", "dtype", "size", "GB/s", "of the peak");
+	}
+	for (uint32_t k = 0; k < 5 && res == VK_SUCCESS; k++) {
+		//validated like the entries of the performance gate, timed like the probes: the best of VKT_ROOFLINE_TRIALS batches
+		VkPerfEntry entry = { 0 };
+		sprintf(entry.kernel, "%s", kernels[k][0]);
+		sprintf(entry.dtype, "%s", kernels[k][1]);
+		entry.size = size;
+		res = run_PerfEntry(&vkGPU, coalescedMemory, &entry, VKT_ROOFLINE_TRIALS, VKT_ROOFLINE_BATCH);
+		if (res == VK_ERROR_FEATURE_NOT_PRESENT) {
+			printf("%-18s %-8s %5d %10s %11s\n", entry.kernel, entry.dtype, size, "-", "-");
+			res = VK_SUCCESS;
+			continue;
+		}
+		if (res != VK_SUCCESS) {
+			printf("Kernel %s %s failed, error code: %d\n", entry.kernel, entry.dtype, res);
+			break;
+		}
+		double best = 0;
+		for (uint32_t t = 0; t < entry.trials; t++) if (entry.sample[t] > best) best = entry.sample[t];
+		printf("%-18s %-8s %5d %10.2f %10.1f%%\n", entry.kernel, entry.dtype, size, best, (roofline.peak > 0) ? 100.0 * best / roofline.peak : 0);
+	}
+	delete_VkGPU(&vkGPU);
+	return res;
+}
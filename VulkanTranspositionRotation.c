@@ -0,0 +1,147 @@
+#include "VulkanTransposition.h"
+
+
+//Image rotation by 90, 180 and 270 degrees and flips (image_rotation.comp) for GRAY16, RGB8 and RGBA8 pixels
+typedef struct {
+	uint32_t localSize[3];
+	uint32_t bytesPerPixel;//2 - GRAY16, 3 - RGB8, 4 - RGBA8
+	uint32_t srcWidth;
+	uint32_t srcHeight;
+	uint32_t srcPitch;     //bytes between source rows, multiple of 4
+	uint32_t dstPitch;     //bytes between destination rows, multiple of 4
+	uint32_t transform;    //bit 0 - swap x and y, bit 1 - mirror source x, bit 2 - mirror source y
+} VkRotationSpecializationConstantsLayout;//specialization constants of image_rotation.comp
+
+
+uint32_t
+get_RotationTransform(uint32_t rotation, uint32_t flip)
+{
+	//clockwise rotation by 0, 90, 180 or 270 degrees followed by an optional horizontal flip of the result,
+	//expressed as the source coordinate transform of image_rotation.comp
+	static const uint32_t transform[2][4] = { { 0, 5, 6, 3 },  //rotation: identity, (y, H-1-x), (W-1-x, H-1-y), (W-1-y, x)
+	                                          { 2, 1, 4, 7 } };//rotation and flip: mirror x, transpose, mirror y, anti-transpose
+	return transform[flip != 0][(rotation / 90) & 3];
+}
+
+
+void
+rotate_Image_CPU(const uint8_t* src, uint8_t* dst, uint32_t srcWidth, uint32_t srcHeight, uint32_t srcPitch, uint32_t dstPitch,
+                 uint32_t bytesPerPixel, uint32_t transform)
+{
+	//reference of image_rotation.comp, leaves the row padding of dst untouched
+	uint32_t dstWidth  = (transform & 1) ? srcHeight : srcWidth;
+	uint32_t dstHeight = (transform & 1) ? srcWidth : srcHeight;
+	for (uint32_t y = 0; y < dstHeight; y++) {
+		for (uint32_t x = 0; x < dstWidth; x++) {
+			uint32_t sx = (transform & 1) ? y : x;
+			uint32_t sy = (transform & 1) ? x : y;
+			if (transform & 2) sx = srcWidth - 1 - sx;
+			if (transform & 4) sy = srcHeight - 1 - sy;
+			memcpy(dst + (uint64_t) y * dstPitch + x * bytesPerPixel, src + (uint64_t) sy * srcPitch + sx * bytesPerPixel, bytesPerPixel);
+		}
+	}
+}
+
+
+VkResult
+Example_VulkanRotation(uint32_t deviceID,
+                       uint32_t width,
+                       uint32_t height)
+{
+	//rotation by 0/90/180/270 degrees with and without a flip of width x height GRAY16, RGB8 and RGBA8 images.
+	//Source rows are padded to 256 bytes, destination rows to 4 bytes, the result is compared with rotate_Image_CPU
+	VkGPU vkGPU = { 0 };
+	vkGPU.device_id = deviceID;
+	VkResult res = VK_SUCCESS;
+	res = create_VkGPU(&vkGPU);
+	if (res != VK_SUCCESS) return res;
+	uint32_t tile = 16;
+	uint32_t localSizeY = tile;
+	while (tile * localSizeY > vkGPU.physicalDeviceProperties.limits.maxComputeWorkGroupInvocations) localSizeY /= 2;
+
+	//largest pitch is the source pitch of RGBA8 or the destination pitch of a rotated RGBA8 image
+	uint32_t maxSide = (width > height) ? width : height;
+	VkDeviceSize bufferSize = (VkDeviceSize) ((4 * maxSide + 255) / 256 * 256) * maxSide;
+	VkBuffer inputBuffer = { 0 }, outputBuffer = { 0 };
+	VkDeviceMemory inputBufferDeviceMemory = { 0 }, outputBufferDeviceMemory = { 0 };
+	res = allocate_Buffer_DeviceMemory(vkGPU.physicalDevice, vkGPU.device,
+                                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                           &vkGPU.physicalDeviceMemoryProperties, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                           bufferSize, &inputBuffer, &inputBufferDeviceMemory);
+	if (res != VK_SUCCESS) {
+		printf("Input buffer allocation failed, error code: %d\n", res);
+		return res;
+	}
+	res = allocate_Buffer_DeviceMemory(vkGPU.physicalDevice, vkGPU.device,
+                                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                           &vkGPU.physicalDeviceMemoryProperties, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                           bufferSize, &outputBuffer, &outputBufferDeviceMemory);
+	if (res != VK_SUCCESS) {
+		printf("Output buffer allocation failed, error code: %d\n", res);
+		return res;
+	}
+	uint8_t* buffer_input  = (uint8_t*) malloc(bufferSize);
+	uint8_t* buffer_output = (uint8_t*) malloc(bufferSize);
+	uint8_t* buffer_ref    = (uint8_t*) malloc(bufferSize);
+	for (VkDeviceSize i = 0; i < bufferSize; i++) buffer_input[i] = (uint8_t) (i * 13 + i / 509);
+	res = upload_Data(vkGPU.physicalDevice, vkGPU.device, buffer_input, &vkGPU.physicalDeviceMemoryProperties,
+                          vkGPU.commandPool, vkGPU.queue, &vkGPU.fence, &inputBuffer, bufferSize);
+	if (res != VK_SUCCESS) return res;
+
+	printf("Image size: %dx%d\nTile: %dx%d\n", width, height, tile, tile);
+	const char* formats[5] = { "", "", "GRAY16", "RGB8", "RGBA8" };
+	for (uint32_t bytesPerPixel = 2; bytesPerPixel <= 4; bytesPerPixel++) {
+		for (uint32_t flip = 0; flip < 2; flip++) {
+			for (uint32_t rotation = 0; rotation < 360; rotation += 90) {
+				uint32_t transform = get_RotationTransform(rotation, flip);
+				uint32_t dstWidth  = (transform & 1) ? height : width;
+				uint32_t dstHeight = (transform & 1) ? width : height;
+				uint32_t srcPitch = (width * bytesPerPixel + 255) / 256 * 256;
+				uint32_t dstPitch = (dstWidth * bytesPerPixel + 3) / 4 * 4;
+				//row padding of the destination is filled with a marker, it has to survive the rotation
+				memset(buffer_ref, 0xA5, bufferSize);
+				res = upload_Data(vkGPU.physicalDevice, vkGPU.device, buffer_ref, &vkGPU.physicalDeviceMemoryProperties,
+				                  vkGPU.commandPool, vkGPU.queue, &vkGPU.fence, &outputBuffer, bufferSize);
+				if (res != VK_SUCCESS) break;
+
+				VkApplication app = { 0 };
+				VkRotationSpecializationConstantsLayout specializationConstants = { { tile, localSizeY, 1 }, bytesPerPixel, width, height, srcPitch, dstPitch, transform };
+				res = create_SpecializedApp(&vkGPU, &app, &specializationConstants, 9, &inputBuffer, &outputBuffer, bufferSize, "image_rotation.spv");
+				if (res != VK_SUCCESS) {
+					printf("Rotation application creation failed, error code: %d\n", res);
+					break;
+				}
+				double time = 0;
+				uint32_t groupCount[3] = { (dstWidth + tile - 1) / tile, (dstHeight + tile - 1) / tile, 1 };
+				res = run_App(vkGPU.device, vkGPU.commandPool, app.pipeline, app.pipelineLayout, &app.descriptorSet,
+				              groupCount, vkGPU.queue, &vkGPU.fence, 100, &time);
+				deleteApp(&vkGPU, &app);
+				if (res != VK_SUCCESS) {
+					printf("Rotation application run failed, error code: %d\n", res);
+					break;
+				}
+				res = download_Data(vkGPU.physicalDevice, vkGPU.device, vkGPU.commandPool, &vkGPU.physicalDeviceMemoryProperties,
+				                    vkGPU.queue, &vkGPU.fence, buffer_output, &outputBuffer, bufferSize);
+				if (res != VK_SUCCESS) break;
+				rotate_Image_CPU(buffer_input, buffer_ref, width, height, srcPitch, dstPitch, bytesPerPixel, transform);
+				uint32_t passed = (memcmp(buffer_output, buffer_ref, (VkDeviceSize) dstPitch * dstHeight) == 0);
+				VkDeviceSize imageSize = (VkDeviceSize) width * height * bytesPerPixel;
+				printf("%-6s rotation %3d%s: %.3f ms (%.1f GB/s), verification %s\n",
+				       formats[bytesPerPixel], rotation, flip ? " + flip" : "       ", time, 2 * imageSize / 1024.0 / 1024.0 / 1024.0 / (time / 1000), passed ? "passed" : "FAILED");
+				if (!passed) res = VK_ERROR_FORMAT_NOT_SUPPORTED;
+			}
+			if (res != VK_SUCCESS && res != VK_ERROR_FORMAT_NOT_SUPPORTED) break;
+		}
+		if (res != VK_SUCCESS && res != VK_ERROR_FORMAT_NOT_SUPPORTED) break;
+	}
+
+	free(buffer_input);
+	free(buffer_output);
+	free(buffer_ref);
+	vkDestroyBuffer(vkGPU.device, inputBuffer, NULL);
+	vkFreeMemory(vkGPU.device, inputBufferDeviceMemory, NULL);
+	vkDestroyBuffer(vkGPU.device, outputBuffer, NULL);
+	vkFreeMemory(vkGPU.device, outputBufferDeviceMemory, NULL);
+	delete_VkGPU(&vkGPU);
+	return res;
+}
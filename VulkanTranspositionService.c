@@ -0,0 +1,723 @@
+#include "VulkanTransposition.h"
+
+
+#ifndef _WIN32
+//Transposition daemon: keeps VkGPU, pipelines and buffers alive between requests. Clients connect over a Unix domain socket
+//(see VulkanTranspositionService.h and VulkanTranspositionClient.c), matrices are read from and written to the shared memory of the client
+#define VKT_SERVICE_MAX_CLIENTS 64
+#define VKT_SERVICE_MAX_PENDING 4096
+#define VKT_SERVICE_POOL_SIZE   16   //number of cached buffer sets and pipelines, also the maximal number of requests in one batch
+#define VKT_SERVICE_LATENCY_LOG 65536//number of latencies kept for the percentiles report
+#define VKT_SERVICE_MAX_FDS     4    //descriptors accepted with one message, the first one is kept
+
+typedef struct {
+	uint32_t size[3];
+	VkDeviceSize bufferSize;//0 - the entry is not used
+	VkBuffer inputBuffer;
+	VkDeviceMemory inputBufferDeviceMemory;
+	VkBuffer outputBuffer;
+	VkDeviceMemory outputBufferDeviceMemory;
+	//host visible buffer, first half - input of the request, second half - output
+	VkBuffer stagingBuffer;
+	VkDeviceMemory stagingBufferDeviceMemory;
+	void* stagingData;
+	VkApplication app;
+	uint64_t lastUse;//id of the last batch that used the entry, for LRU eviction
+} VkServicePoolEntry;//buffers and transposition pipeline for one system size
+
+typedef struct {
+	int socket;//-1 - the slot is free, non-blocking
+	void* shmData;
+	uint64_t shmSize;
+	uint32_t connection;//number of the connection, for the trace
+	//partially received request and the shared memory descriptor that came with it
+	VkTranspositionRequest request;
+	uint32_t receivedSize;
+	int requestFd;//-1 - none
+	//replies that the socket did not take yet, sent when poll reports POLLOUT
+	VkTranspositionReply replies[VKT_SERVICE_MAX_IN_FLIGHT];
+	uint32_t replyHead;
+	uint32_t replyCount;
+	uint32_t replySent;//bytes of the first queued reply already sent
+	uint32_t outstanding;//received requests without a sent reply, the client is not read while it reaches VKT_SERVICE_MAX_IN_FLIGHT
+	uint32_t broken;//sending failed, the client is closed by the poll loop
+} VkServiceClient;
+
+typedef struct {
+	uint32_t client;
+	VkTranspositionRequest request;
+	double arrivalTime;
+	uint64_t sequence;
+} VkServiceJob;
+
+typedef struct {
+	VkGPU* vkGPU;
+	uint32_t coalescedMemory;
+	uint32_t maxBatch;
+	uint32_t verbose;
+
+	int listenSocket;
+	VkServiceClient clients[VKT_SERVICE_MAX_CLIENTS];
+
+	VkServiceJob pending[VKT_SERVICE_MAX_PENDING];
+	uint32_t pendingCount;
+	uint64_t sequence;
+
+	VkServicePoolEntry pool[VKT_SERVICE_POOL_SIZE];
+	VkCommandBuffer commandBuffer;
+	uint64_t batchID;
+
+	double latency[VKT_SERVICE_LATENCY_LOG];
+	uint64_t completed;
+	uint64_t failed;
+	uint64_t batches;
+
+	FILE* trace;//workload capture, NULL - off
+	double traceStart;
+	uint64_t traced;
+	uint32_t connections;
+} VkTranspositionService;
+
+static volatile sig_atomic_t serviceStop = 0;
+
+static void
+stop_TranspositionService(int signal)
+{
+	serviceStop = 1;
+}
+
+
+void
+delete_ServicePoolEntry(VkGPU* vkGPU, VkServicePoolEntry* entry)
+{
+	//also used to release a partially created entry, Vulkan ignores VK_NULL_HANDLE in destroy calls
+	if (entry->stagingData != NULL) vkUnmapMemory(vkGPU->device, entry->stagingBufferDeviceMemory);
+	vkDestroyBuffer(vkGPU->device, entry->stagingBuffer, NULL);
+	vkFreeMemory(vkGPU->device, entry->stagingBufferDeviceMemory, NULL);
+	vkDestroyBuffer(vkGPU->device, entry->inputBuffer, NULL);
+	vkFreeMemory(vkGPU->device, entry->inputBufferDeviceMemory, NULL);
+	vkDestroyBuffer(vkGPU->device, entry->outputBuffer, NULL);
+	vkFreeMemory(vkGPU->device, entry->outputBufferDeviceMemory, NULL);
+	deleteApp(vkGPU, &entry->app);
+	memset(entry, 0, sizeof(VkServicePoolEntry));
+}
+
+
+VkResult
+create_ServicePoolEntry(VkTranspositionService* service,
+                        VkServicePoolEntry* entry,
+                        const uint32_t* size)
+{
+	//allocate device buffers, a persistently mapped staging buffer and the transposition pipeline for one system size
+	VkGPU* vkGPU = service->vkGPU;
+	VkResult res = VK_SUCCESS;
+	memset(entry, 0, sizeof(VkServicePoolEntry));
+	VkDeviceSize bufferSize = sizeof(float) * (VkDeviceSize) size[0] * size[1] * size[2];
+
+	res = allocate_Buffer_DeviceMemory(vkGPU->physicalDevice, vkGPU->device,
+                                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                           &vkGPU->physicalDeviceMemoryProperties,
+                                           VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                           bufferSize, &entry->inputBuffer, &entry->inputBufferDeviceMemory);
+	if (res != VK_SUCCESS) return res;
+	res = allocate_Buffer_DeviceMemory(vkGPU->physicalDevice, vkGPU->device,
+                                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                           &vkGPU->physicalDeviceMemoryProperties,
+                                           VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                           bufferSize, &entry->outputBuffer, &entry->outputBufferDeviceMemory);
+	if (res != VK_SUCCESS) return res;
+	res = allocate_Buffer_DeviceMemory(vkGPU->physicalDevice, vkGPU->device,
+                                           VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                           &vkGPU->physicalDeviceMemoryProperties,
+                                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                           2 * bufferSize, &entry->stagingBuffer, &entry->stagingBufferDeviceMemory);
+	if (res != VK_SUCCESS) return res;
+	res = vkMapMemory(vkGPU->device, entry->stagingBufferDeviceMemory, 0, 2 * bufferSize, 0, &entry->stagingData);
+	if (res != VK_SUCCESS) return res;
+
+	entry->app.size[0] = size[0];
+	entry->app.size[1] = size[1];
+	entry->app.size[2] = size[2];
+	entry->app.coalescedMemory = service->coalescedMemory;
+	VkBuffer*    buffer[2]     = { &entry->inputBuffer, &entry->outputBuffer };
+	VkDeviceSize bufferSizes[2] = { bufferSize, bufferSize };
+	char shaderPath[256];
+	sprintf(shaderPath, "%stransposition_no_bank_conflicts.spv", SHADER_DIR);
+	res = create_App(vkGPU->device,
+                         &entry->app.specializationConstants,
+                         entry->app.coalescedMemory,
+                         buffer,
+                         bufferSizes,
+                         entry->app.size,
+                         &entry->app.descriptorPool,
+                         &entry->app.descriptorSetLayout,
+                         &entry->app.descriptorSet,
+                         (const char*) shaderPath,
+                         &entry->app.pipelineLayout,
+                         &entry->app.pipeline);
+	if (res != VK_SUCCESS) return res;
+	entry->bufferSize = bufferSize;
+	return res;
+}
+
+
+VkResult
+get_ServicePoolEntry(VkTranspositionService* service,
+                     const uint32_t* size,
+                     VkServicePoolEntry** entry)
+{
+	//find cached buffers and pipeline for the size that are not used by the current batch, create them if needed
+	VkServicePoolEntry* victim = NULL;
+	for (uint32_t i = 0; i < VKT_SERVICE_POOL_SIZE; i++) {
+		VkServicePoolEntry* candidate = &service->pool[i];
+		if (candidate->bufferSize != 0 && candidate->lastUse == service->batchID) continue;
+		if (candidate->bufferSize != 0 && candidate->size[0] == size[0] && candidate->size[1] == size[1] && candidate->size[2] == size[2]) {
+			*entry = candidate;
+			return VK_SUCCESS;
+		}
+		if (victim == NULL || candidate->bufferSize == 0 || (victim->bufferSize != 0 && candidate->lastUse < victim->lastUse)) victim = candidate;
+	}
+	//all entries are taken by the current batch
+	if (victim == NULL) return VK_NOT_READY;
+
+	delete_ServicePoolEntry(service->vkGPU, victim);
+	VkResult res = create_ServicePoolEntry(service, victim, size);
+	if (res != VK_SUCCESS) {
+		//release whatever was allocated before the failure
+		delete_ServicePoolEntry(service->vkGPU, victim);
+		return res;
+	}
+	*entry = victim;
+	return res;
+}
+
+
+void
+write_ServiceTrace(VkTranspositionService* service, VkServiceJob* job, VkTranspositionReply* reply)
+{
+	//one record per transposition request, buffered by stdio and flushed when the daemon stops
+	VkTranspositionTraceRecord record = { 0 };
+	record.arrival      = job->arrivalTime - service->traceStart;
+	record.queueTime    = (float) reply->queueTime;
+	record.runTime      = (float) reply->runTime;
+	record.latency      = (float) reply->latency;
+	record.connection   = service->clients[job->client].connection;
+	record.size[0]      = job->request.size[0];
+	record.size[1]      = job->request.size[1];
+	record.size[2]      = job->request.size[2];
+	record.priority     = job->request.priority;
+	record.dtype        = VKT_TRACE_DTYPE_FLOAT32;
+	record.kernel       = VKT_TRACE_KERNEL_NO_BANK_CONFLICTS;
+	record.batchSize    = reply->batchSize;
+	record.result       = reply->result;
+	record.inputOffset  = job->request.inputOffset;
+	record.outputOffset = job->request.outputOffset;
+	if (fwrite(&record, sizeof(record), 1, service->trace) == 1) service->traced++;
+}
+
+
+VkResult
+open_ServiceTrace(VkTranspositionService* service, const char* tracePath)
+{
+	service->trace = fopen(tracePath, "wb");
+	if (service->trace == NULL) {
+		printf("Could not open the trace %s: %s\n", tracePath, strerror(errno));
+		return VK_ERROR_INITIALIZATION_FAILED;
+	}
+	VkTranspositionTraceHeader header = { 0 };
+	header.magic           = VKT_TRACE_MAGIC;
+	header.version         = VKT_TRACE_VERSION;
+	header.recordSize      = sizeof(VkTranspositionTraceRecord);
+	header.coalescedMemory = service->coalescedMemory;
+	header.maxBatch        = service->maxBatch;
+	snprintf(header.device, sizeof(header.device), "%s", service->vkGPU->physicalDeviceProperties.deviceName);
+	if (fwrite(&header, sizeof(header), 1, service->trace) != 1) {
+		fclose(service->trace);
+		service->trace = NULL;
+		return VK_ERROR_INITIALIZATION_FAILED;
+	}
+	service->traceStart = get_TimeMs();
+	return VK_SUCCESS;
+}
+
+
+int
+flush_ServiceClient(VkServiceClient* client)
+{
+	//send queued replies until the socket would block, -1 - the client is gone
+	while (client->replyCount > 0) {
+		const char* ptr = (const char*) &client->replies[client->replyHead] + client->replySent;
+		ssize_t sent = send(client->socket, ptr, sizeof(VkTranspositionReply) - client->replySent, MSG_NOSIGNAL);
+		if (sent < 0 && errno == EINTR) continue;
+		if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return 0;
+		if (sent <= 0) return -1;
+		client->replySent += (uint32_t) sent;
+		if (client->replySent < sizeof(VkTranspositionReply)) continue;
+		client->replySent = 0;
+		client->replyHead = (client->replyHead + 1) % VKT_SERVICE_MAX_IN_FLIGHT;
+		client->replyCount--;
+		if (client->outstanding > 0) client->outstanding--;
+	}
+	return 0;
+}
+
+
+void
+send_ServiceReply(VkTranspositionService* service,
+                  VkServiceJob* job,
+                  VkResult result,
+                  uint32_t batchSize,
+                  double batchStart,
+                  double batchEnd)
+{
+	VkServiceClient* client = &service->clients[job->client];
+	double time = get_TimeMs();
+	VkTranspositionReply reply = { 0 };
+	reply.magic     = VKT_SERVICE_MAGIC;
+	reply.requestID = job->request.requestID;
+	reply.result    = result;
+	reply.batchSize = batchSize;
+	reply.queueTime = (batchSize > 0) ? batchStart - job->arrivalTime : 0;
+	reply.runTime   = (batchSize > 0) ? batchEnd - batchStart : 0;
+	reply.latency   = time - job->arrivalTime;
+	if (job->request.type == VKT_MESSAGE_TRANSPOSE) {
+		if (result == VK_SUCCESS) {
+			service->latency[service->completed % VKT_SERVICE_LATENCY_LOG] = reply.latency;
+			service->completed++;
+		}
+		else {
+			service->failed++;
+		}
+		if (service->trace != NULL) write_ServiceTrace(service, job, &reply);
+		if (service->verbose)
+			printf("Request %d of client %d: size %dx%dx%d, priority %d, result %d, batch %d, queue %.3f ms, run %.3f ms, latency %.3f ms\n",
+			       reply.requestID, job->client, job->request.size[0], job->request.size[1], job->request.size[2], job->request.priority,
+			       result, batchSize, reply.queueTime, reply.runTime, reply.latency);
+	}
+	if (client->socket < 0 || client->broken) return;
+	//the daemon never blocks on a slow client, the reply waits in its queue
+	if (client->replyCount == VKT_SERVICE_MAX_IN_FLIGHT) {
+		client->broken = 1;
+		return;
+	}
+	client->replies[(client->replyHead + client->replyCount) % VKT_SERVICE_MAX_IN_FLIGHT] = reply;
+	client->replyCount++;
+	if (flush_ServiceClient(client) != 0) client->broken = 1;
+}
+
+
+void
+close_ServiceClient(VkTranspositionService* service, uint32_t clientID)
+{
+	VkServiceClient* client = &service->clients[clientID];
+	if (client->shmData != NULL) munmap(client->shmData, client->shmSize);
+	if (client->requestFd >= 0) close(client->requestFd);
+	close(client->socket);
+	memset(client, 0, sizeof(VkServiceClient));
+	client->socket = -1;
+	client->requestFd = -1;
+	//drop requests that nobody waits for
+	for (uint32_t i = 0; i < service->pendingCount;) {
+		if (service->pending[i].client == clientID) service->pending[i] = service->pending[--service->pendingCount];
+		else i++;
+	}
+}
+
+
+VkResult
+check_ServiceRequest(VkTranspositionService* service, VkServiceJob* job)
+{
+	//the transposition kernel supports square matrices with sizes divisible by the tile
+	VkServiceClient* client = &service->clients[job->client];
+	VkTranspositionRequest* request = &job->request;
+	uint32_t tile = service->coalescedMemory / sizeof(float);
+	if (client->shmData == NULL) return VK_ERROR_INITIALIZATION_FAILED;
+	if (request->size[0] == 0 || request->size[2] == 0 || request->size[0] != request->size[1] || request->size[0] % tile != 0)
+		return VK_ERROR_FORMAT_NOT_SUPPORTED;
+	uint64_t bufferSize = sizeof(float) * (uint64_t) request->size[0] * request->size[1] * request->size[2];
+	if (bufferSize > client->shmSize || request->inputOffset > client->shmSize - bufferSize || request->outputOffset > client->shmSize - bufferSize)
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+	return VK_SUCCESS;
+}
+
+
+uint32_t
+check_ServiceRange(VkServiceClient* client, uint64_t offset, uint64_t size)
+{
+	//the shared memory of the client may have been replaced or detached since the request was queued
+	return (client->shmData != NULL && size <= client->shmSize && offset <= client->shmSize - size);
+}
+
+
+int
+check_ServiceSharedMemory(int fd, uint64_t shmSize)
+{
+	//the daemon touches every byte the client declares, so the file has to be at least that large and must not shrink later:
+	//an access past the end of a mapped file is SIGBUS. Files that support seals (Linux memfds and shmem files) are required to be
+	//sealed against shrinking and growing, files without seal support (EINVAL) and systems without seals only get the size check
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size < 0 || (uint64_t) st.st_size < shmSize) return -1;
+#ifdef F_GET_SEALS
+	int seals = fcntl(fd, F_GET_SEALS);
+	if (seals < 0 && errno != EINVAL) return -1;
+	if (seals >= 0 && (seals & (F_SEAL_SHRINK | F_SEAL_GROW)) != (F_SEAL_SHRINK | F_SEAL_GROW)) return -1;
+#endif
+	return 0;
+}
+
+
+void
+receive_ServiceMessage(VkTranspositionService* service, uint32_t clientID)
+{
+	//called once per POLLIN, a partially received request is kept in the client until the rest arrives
+	VkServiceClient* client = &service->clients[clientID];
+
+	//the message may carry a shared memory file descriptor
+	char control[CMSG_SPACE(sizeof(int) * VKT_SERVICE_MAX_FDS)];
+	struct iovec iov = { (char*) &client->request + client->receivedSize, sizeof(VkTranspositionRequest) - client->receivedSize };
+	struct msghdr message = { 0 };
+	message.msg_iov        = &iov;
+	message.msg_iovlen     = 1;
+	message.msg_control    = control;
+	message.msg_controllen = sizeof(control);
+	ssize_t received = recvmsg(client->socket, &message, 0);
+	if (received < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)) return;
+	if (received <= 0) {
+		close_ServiceClient(service, clientID);
+		return;
+	}
+	//keep the first descriptor, every other one would stay open in the daemon
+	for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&message); cmsg != NULL; cmsg = CMSG_NXTHDR(&message, cmsg)) {
+		if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) continue;
+		size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+		for (size_t i = 0; i < count; i++) {
+			int fd;
+			memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+			if (client->requestFd < 0) client->requestFd = fd;
+			else close(fd);
+		}
+	}
+	client->receivedSize += (uint32_t) received;
+	if (client->receivedSize < sizeof(VkTranspositionRequest)) return;
+
+	VkServiceJob job = { 0 };
+	job.client = clientID;
+	job.request = client->request;
+	int fd = client->requestFd;
+	client->receivedSize = 0;
+	client->requestFd = -1;
+	//every complete request gets exactly one reply
+	client->outstanding++;
+	job.arrivalTime = get_TimeMs();
+	job.sequence = service->sequence++;
+	if (job.request.magic != VKT_SERVICE_MAGIC) {
+		if (fd >= 0) close(fd);
+		close_ServiceClient(service, clientID);
+		return;
+	}
+
+	if (job.request.type == VKT_MESSAGE_ATTACH) {
+		VkResult res = VK_SUCCESS;
+		//queued requests were validated against the old mapping, fail them before it is released
+		for (uint32_t i = 0; i < service->pendingCount;) {
+			if (service->pending[i].client == clientID) {
+				VkServiceJob dropped = service->pending[i];
+				service->pending[i] = service->pending[--service->pendingCount];
+				send_ServiceReply(service, &dropped, VK_ERROR_INITIALIZATION_FAILED, 0, 0, 0);
+			}
+			else i++;
+		}
+		if (client->shmData != NULL) munmap(client->shmData, client->shmSize);
+		client->shmData = NULL;
+		client->shmSize = 0;
+		if (fd < 0 || job.request.shmSize == 0 || check_ServiceSharedMemory(fd, job.request.shmSize) != 0) {
+			res = VK_ERROR_INITIALIZATION_FAILED;
+		}
+		else {
+			void* data = mmap(NULL, job.request.shmSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			if (data == MAP_FAILED) {
+				res = VK_ERROR_OUT_OF_HOST_MEMORY;
+			}
+			else {
+				client->shmData = data;
+				client->shmSize = job.request.shmSize;
+			}
+		}
+		if (fd >= 0) close(fd);
+		send_ServiceReply(service, &job, res, 0, 0, 0);
+		return;
+	}
+	if (fd >= 0) close(fd);
+
+	VkResult res = (job.request.type == VKT_MESSAGE_TRANSPOSE) ? check_ServiceRequest(service, &job) : VK_ERROR_FEATURE_NOT_PRESENT;
+	if (res == VK_SUCCESS && service->pendingCount == VKT_SERVICE_MAX_PENDING) res = VK_ERROR_TOO_MANY_OBJECTS;
+	if (res != VK_SUCCESS) {
+		send_ServiceReply(service, &job, res, 0, 0, 0);
+		return;
+	}
+	service->pending[service->pendingCount++] = job;
+}
+
+
+VkResult
+run_ServiceBatch(VkTranspositionService* service)
+{
+	//take up to maxBatch pending requests by priority and arrival, record all of them in one command buffer and submit it once.
+	//Failures are reported to the clients of the batch and returned
+	VkGPU* vkGPU = service->vkGPU;
+	VkResult res = VK_SUCCESS;
+	VkServiceJob batch[VKT_SERVICE_POOL_SIZE];
+	VkServicePoolEntry* entries[VKT_SERVICE_POOL_SIZE];
+	uint32_t batchSize = 0;
+	double batchStart = get_TimeMs();
+	service->batchID++;
+
+	while (batchSize < service->maxBatch && service->pendingCount > 0) {
+		uint32_t best = 0;
+		for (uint32_t i = 1; i < service->pendingCount; i++) {
+			VkServiceJob* job = &service->pending[i];
+			if ((job->request.priority > service->pending[best].request.priority) ||
+			    (job->request.priority == service->pending[best].request.priority && job->sequence < service->pending[best].sequence)) best = i;
+		}
+		VkServicePoolEntry* entry = NULL;
+		res = get_ServicePoolEntry(service, service->pending[best].request.size, &entry);
+		if (res == VK_NOT_READY) break;
+		VkServiceJob job = service->pending[best];
+		service->pending[best] = service->pending[--service->pendingCount];
+		if (res == VK_SUCCESS && !check_ServiceRange(&service->clients[job.client], job.request.inputOffset, entry->bufferSize))
+			res = VK_ERROR_INITIALIZATION_FAILED;
+		if (res != VK_SUCCESS) {
+			send_ServiceReply(service, &job, res, 0, 0, 0);
+			res = VK_SUCCESS;
+			continue;
+		}
+		entry->lastUse = service->batchID;
+		memcpy(entry->stagingData, (char*) service->clients[job.client].shmData + job.request.inputOffset, entry->bufferSize);
+		batch[batchSize] = job;
+		entries[batchSize] = entry;
+		batchSize++;
+	}
+	if (batchSize == 0) return VK_SUCCESS;
+
+	VkCommandBufferBeginInfo commandBufferBeginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+                                     (const void*) NULL,
+                                     (VkCommandBufferUsageFlags) VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+                                     (const VkCommandBufferInheritanceInfo*) NULL };
+	res = vkBeginCommandBuffer(service->commandBuffer, &commandBufferBeginInfo);
+	for (uint32_t i = 0; i < batchSize && res == VK_SUCCESS; i++) {
+		VkServicePoolEntry* entry = entries[i];
+		VkBufferCopy copyRegion = { 0, 0, entry->bufferSize };
+		vkCmdCopyBuffer(service->commandBuffer, entry->stagingBuffer, entry->inputBuffer, 1, &copyRegion);
+		VkMemoryBarrier memoryBarrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                                    (const void*) NULL,
+                                    (VkAccessFlags) VK_ACCESS_TRANSFER_WRITE_BIT,
+                                    (VkAccessFlags) VK_ACCESS_SHADER_READ_BIT };
+		vkCmdPipelineBarrier(service->commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &memoryBarrier, 0, NULL, 0, NULL);
+
+		VkAppPushConstantsLayout pushConstants = { 0 };
+		uint32_t groupCount[3] = { entry->app.size[0] / entry->app.specializationConstants.localSize[0],
+                                           entry->app.size[1] / entry->app.specializationConstants.localSize[1],
+                                           entry->app.size[2] / entry->app.specializationConstants.localSize[2] };
+		vkCmdPushConstants(service->commandBuffer, entry->app.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(VkAppPushConstantsLayout), &pushConstants);
+		vkCmdBindPipeline(service->commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, entry->app.pipeline);
+		vkCmdBindDescriptorSets(service->commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, entry->app.pipelineLayout, 0, 1, &entry->app.descriptorSet, 0, NULL);
+		vkCmdDispatch(service->commandBuffer, groupCount[0], groupCount[1], groupCount[2]);
+
+		memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		memoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		vkCmdPipelineBarrier(service->commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &memoryBarrier, 0, NULL, 0, NULL);
+		copyRegion.dstOffset = entry->bufferSize;
+		vkCmdCopyBuffer(service->commandBuffer, entry->outputBuffer, entry->stagingBuffer, 1, &copyRegion);
+	}
+	//make the staging buffers visible to the host
+	VkMemoryBarrier hostBarrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                              (const void*) NULL,
+                              (VkAccessFlags) VK_ACCESS_TRANSFER_WRITE_BIT,
+                              (VkAccessFlags) VK_ACCESS_HOST_READ_BIT };
+	if (res == VK_SUCCESS) {
+		vkCmdPipelineBarrier(service->commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &hostBarrier, 0, NULL, 0, NULL);
+		res = vkEndCommandBuffer(service->commandBuffer);
+	}
+
+	VkSubmitInfo submitInfo = { VK_STRUCTURE_TYPE_SUBMIT_INFO,
+                         (const void*) NULL,
+                         (uint32_t) 0,
+                         (const VkSemaphore*) NULL,
+                         (const VkPipelineStageFlags*) NULL,
+                         (uint32_t) 1,
+                         (const VkCommandBuffer*) &service->commandBuffer,
+                         (uint32_t) 0,
+                         (const VkSemaphore*) NULL };
+	if (res == VK_SUCCESS) res = vkQueueSubmit(vkGPU->queue, 1, &submitInfo, vkGPU->fence);
+	if (res == VK_SUCCESS) res = vkWaitForFences(vkGPU->device, 1, &vkGPU->fence, VK_TRUE, 100000000000);
+	if (res == VK_SUCCESS) res = vkResetFences(vkGPU->device, 1, &vkGPU->fence);
+
+	//every request of the batch gets a reply, also when recording or submission failed
+	for (uint32_t i = 0; i < batchSize; i++) {
+		VkServiceClient* client = &service->clients[batch[i].client];
+		VkResult jobResult = res;
+		if (jobResult == VK_SUCCESS && client->socket >= 0) {
+			if (check_ServiceRange(client, batch[i].request.outputOffset, entries[i]->bufferSize))
+				memcpy((char*) client->shmData + batch[i].request.outputOffset, (char*) entries[i]->stagingData + entries[i]->bufferSize, entries[i]->bufferSize);
+			else
+				jobResult = VK_ERROR_INITIALIZATION_FAILED;
+		}
+		send_ServiceReply(service, &batch[i], jobResult, batchSize, batchStart, get_TimeMs());
+	}
+	service->batches++;
+	return res;
+}
+
+
+void
+print_ServiceStatistics(VkTranspositionService* service)
+{
+	uint64_t count = (service->completed < VKT_SERVICE_LATENCY_LOG) ? service->completed : VKT_SERVICE_LATENCY_LOG;
+	printf("\nRequests: %llu completed, %llu failed, %llu batches\n",
+	       (unsigned long long) service->completed, (unsigned long long) service->failed, (unsigned long long) service->batches);
+	if (count == 0) return;
+	double* latency = (double*) malloc(sizeof(double) * count);
+	if (latency == NULL) return;
+	memcpy(latency, service->latency, sizeof(double) * count);
+	qsort(latency, count, sizeof(double), compare_Double);
+	printf("Latency of the last %llu requests: p50 %.3f ms, p90 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+	       (unsigned long long) count,
+	       latency[(uint64_t) (0.50 * (count - 1))],
+	       latency[(uint64_t) (0.90 * (count - 1))],
+	       latency[(uint64_t) (0.99 * (count - 1))],
+	       latency[count - 1]);
+	free(latency);
+}
+
+
+VkResult
+run_TranspositionService(uint32_t deviceID,
+                         uint32_t coalescedMemory,
+                         const char* socketPath,
+                         uint32_t maxBatch,
+                         uint32_t verbose,
+                         const char* tracePath)
+{
+	VkGPU vkGPU = { 0 };
+	vkGPU.device_id = deviceID;
+	VkResult res = create_VkGPU(&vkGPU);
+	if (res != VK_SUCCESS) return res;
+
+	VkTranspositionService* service = (VkTranspositionService*) calloc(1, sizeof(VkTranspositionService));
+	if (service == NULL) {
+		delete_VkGPU(&vkGPU);
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+	}
+	service->vkGPU           = &vkGPU;
+	service->coalescedMemory = get_CoalescedMemory(&vkGPU, coalescedMemory);
+	service->maxBatch        = (maxBatch == 0 || maxBatch > VKT_SERVICE_POOL_SIZE) ? VKT_SERVICE_POOL_SIZE : maxBatch;
+	service->verbose         = verbose;
+	service->listenSocket    = -1;
+	for (uint32_t i = 0; i < VKT_SERVICE_MAX_CLIENTS; i++) {
+		service->clients[i].socket = -1;
+		service->clients[i].requestFd = -1;
+	}
+	if (tracePath != NULL) {
+		res = open_ServiceTrace(service, tracePath);
+		if (res != VK_SUCCESS) goto cleanup;
+	}
+
+	//one command buffer, re-recorded for every batch
+	VkCommandBufferAllocateInfo commandBufferAllocateInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+                                        (const void*) NULL,
+                                        (VkCommandPool) vkGPU.commandPool,
+                                        (VkCommandBufferLevel) VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+                                        (uint32_t) 1 };
+	res = vkAllocateCommandBuffers(vkGPU.device, &commandBufferAllocateInfo, &service->commandBuffer);
+	if (res != VK_SUCCESS) goto cleanup;
+
+	struct sockaddr_un address = { 0 };
+	address.sun_family = AF_UNIX;
+	if (strlen(socketPath) >= sizeof(address.sun_path)) {
+		printf("Socket path is too long: %s\n", socketPath);
+		res = VK_ERROR_INITIALIZATION_FAILED;
+		goto cleanup;
+	}
+	strcpy(address.sun_path, socketPath);
+	unlink(socketPath);
+	service->listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (service->listenSocket < 0 || bind(service->listenSocket, (struct sockaddr*) &address, sizeof(address)) != 0 || listen(service->listenSocket, VKT_SERVICE_MAX_CLIENTS) != 0) {
+		printf("Could not listen on %s: %s\n", socketPath, strerror(errno));
+		res = VK_ERROR_INITIALIZATION_FAILED;
+		goto cleanup;
+	}
+	signal(SIGINT, stop_TranspositionService);
+	signal(SIGTERM, stop_TranspositionService);
+	signal(SIGPIPE, SIG_IGN);
+	printf("\nTransposition service is listening on %s, coalesced memory: %d bytes, batch: %d\n", socketPath, service->coalescedMemory, service->maxBatch);
+
+	struct pollfd fds[VKT_SERVICE_MAX_CLIENTS + 1];
+	uint32_t fdClient[VKT_SERVICE_MAX_CLIENTS + 1];
+	while (!serviceStop) {
+		uint32_t fdCount = 0;
+		fds[fdCount].fd = service->listenSocket;
+		fds[fdCount].events = POLLIN;
+		fdCount++;
+		for (uint32_t i = 0; i < VKT_SERVICE_MAX_CLIENTS; i++) {
+			VkServiceClient* client = &service->clients[i];
+			if (client->socket >= 0 && client->broken) close_ServiceClient(service, i);
+			if (client->socket < 0) continue;
+			//a client that does not read its replies is not read either
+			fds[fdCount].fd = client->socket;
+			fds[fdCount].events = (client->outstanding < VKT_SERVICE_MAX_IN_FLIGHT) ? POLLIN : 0;
+			if (client->replyCount > 0) fds[fdCount].events |= POLLOUT;
+			fdClient[fdCount] = i;
+			fdCount++;
+		}
+		//requests that arrive while a batch runs on the GPU are collected by the next poll and form the next batch
+		int ready = poll(fds, fdCount, (service->pendingCount > 0) ? 0 : 1000);
+		if (ready < 0 && errno != EINTR) break;
+		if (ready > 0) {
+			for (uint32_t i = 1; i < fdCount; i++) {
+				VkServiceClient* client = &service->clients[fdClient[i]];
+				if ((fds[i].revents & POLLOUT) && flush_ServiceClient(client) != 0) {
+					close_ServiceClient(service, fdClient[i]);
+					continue;
+				}
+				if (!client->broken && (fds[i].revents & (POLLIN | POLLHUP | POLLERR))) receive_ServiceMessage(service, fdClient[i]);
+			}
+			if (fds[0].revents & POLLIN) {
+				int clientSocket = accept(service->listenSocket, NULL, NULL);
+				uint32_t i = 0;
+				while (i < VKT_SERVICE_MAX_CLIENTS && service->clients[i].socket >= 0) i++;
+				if (clientSocket >= 0 && (i == VKT_SERVICE_MAX_CLIENTS || fcntl(clientSocket, F_SETFL, fcntl(clientSocket, F_GETFL) | O_NONBLOCK) != 0)) {
+					close(clientSocket);
+				}
+				else if (clientSocket >= 0) {
+					service->clients[i].socket = clientSocket;
+					service->clients[i].connection = service->connections++;
+				}
+			}
+		}
+		if (service->pendingCount > 0) {
+			//the clients of a failed batch got the error, the daemon keeps serving unless the device itself is gone
+			res = run_ServiceBatch(service);
+			if (res != VK_SUCCESS) printf("Batch execution failed, error code: %d\n", res);
+			if (res == VK_ERROR_DEVICE_LOST || res == VK_TIMEOUT) break;
+			res = VK_SUCCESS;
+		}
+	}
+	print_ServiceStatistics(service);
+	if (service->trace != NULL) printf("Trace: %llu requests captured\n", (unsigned long long) service->traced);
+
+cleanup:
+	if (service->trace != NULL) fclose(service->trace);
+	for (uint32_t i = 0; i < VKT_SERVICE_MAX_CLIENTS; i++) {
+		if (service->clients[i].socket >= 0) close_ServiceClient(service, i);
+	}
+	if (service->listenSocket >= 0) {
+		close(service->listenSocket);
+		unlink(socketPath);
+	}
+	if (service->commandBuffer != VK_NULL_HANDLE) vkFreeCommandBuffers(vkGPU.device, vkGPU.commandPool, 1, &service->commandBuffer);
+	for (uint32_t i = 0; i < VKT_SERVICE_POOL_SIZE; i++) delete_ServicePoolEntry(&vkGPU, &service->pool[i]);
+	free(service);
+	delete_VkGPU(&vkGPU);
+	return res;
+}
+#endif
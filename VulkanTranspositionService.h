@@ -0,0 +1,83 @@
+#ifndef VULKAN_TRANSPOSITION_SERVICE_H
+#define VULKAN_TRANSPOSITION_SERVICE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+//wire protocol of the transposition daemon (VulkanTransposition --daemon <socket>).
+//Messages are fixed-size structures sent over a Unix domain stream socket. Matrix data never goes through the socket:
+//the client passes a shared memory file descriptor once (VKT_MESSAGE_ATTACH) and then only refers to byte offsets in it.
+#define VKT_SERVICE_MAGIC 0x50544B56 //"VKTP"
+//requests of one connection without a received reply. The daemon stops reading a connection at this limit until the client
+//reads replies, so a client that keeps more in flight must not block in send while replies are waiting
+#define VKT_SERVICE_MAX_IN_FLIGHT 256
+
+#define VKT_MESSAGE_ATTACH    1 //attach shared memory, the file descriptor is sent as SCM_RIGHTS ancillary data
+#define VKT_MESSAGE_TRANSPOSE 2 //transpose size[0] x size[1] x size[2] floats from inputOffset into outputOffset
+
+typedef struct {
+	uint32_t magic;
+	uint32_t type;        //VKT_MESSAGE_*
+	uint32_t requestID;   //chosen by the client, returned in the reply
+	uint32_t priority;    //requests with higher priority are scheduled first
+	uint32_t size[3];     //system size for transposition, same meaning as VkApplication.size
+	uint32_t reserved;
+	uint64_t inputOffset; //byte offset of the input matrix in the shared memory
+	uint64_t outputOffset;//byte offset of the output matrix in the shared memory, may be equal to inputOffset
+	uint64_t shmSize;     //VKT_MESSAGE_ATTACH only: size of the shared memory in bytes
+} VkTranspositionRequest;
+
+typedef struct {
+	uint32_t magic;
+	uint32_t requestID;
+	int32_t  result;      //VkResult of the request, 0 - success
+	uint32_t batchSize;   //number of requests recorded in the same command buffer
+	double   queueTime;   //ms from the arrival of the request to the start of its batch
+	double   runTime;     //ms spent in the batch: staging copies, submit and fence wait
+	double   latency;     //ms from the arrival of the request to the reply
+} VkTranspositionReply;
+
+//workload trace of the daemon (VulkanTransposition --daemon <socket> --capture <file>), replayed by
+//VulkanTranspositionLoadgen --replay <file>. A header followed by one fixed-size record per transposition request,
+//written when its reply is sent, so records are in completion order and replay sorts them by arrival
+#define VKT_TRACE_MAGIC   0x52544B56 //"VKTR"
+#define VKT_TRACE_VERSION 1
+
+#define VKT_TRACE_DTYPE_FLOAT32 0
+
+#define VKT_TRACE_KERNEL_NO_BANK_CONFLICTS 0 //transposition_no_bank_conflicts.comp
+
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t recordSize;     //sizeof(VkTranspositionTraceRecord) of the writer
+	uint32_t coalescedMemory;
+	uint32_t maxBatch;
+	uint32_t reserved;
+	char     device[256];    //name of the physical device of the daemon
+} VkTranspositionTraceHeader;
+
+typedef struct {
+	double   arrival;     //ms from the start of the capture to the arrival of the request, gaps are the differences
+	float    queueTime;   //ms, as in VkTranspositionReply
+	float    runTime;
+	float    latency;
+	uint32_t connection;  //number of the client connection since the start of the daemon
+	uint32_t size[3];
+	uint32_t priority;
+	uint32_t dtype;       //VKT_TRACE_DTYPE_*
+	uint32_t kernel;      //VKT_TRACE_KERNEL_*
+	uint32_t batchSize;
+	int32_t  result;
+	uint64_t inputOffset; //byte offsets in the shared memory of the client, equal offsets are reused buffers
+	uint64_t outputOffset;
+} VkTranspositionTraceRecord;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,441 @@
+#include "VulkanTransposition.h"
+
+
+//Sharded transposition: the n x n matrix is split into row panels of p = n / D rows over D logical devices. Device d
+//transposes the p x p blocks of its panel in place (block e at columns e * p), then block e goes to device e, where it
+//becomes block d of the output panel. Off-diagonal blocks are exchanged through host staging: hugepage host memory
+//imported by all devices, so each block is written by one device and read by another with no host copy, or per device
+//mapped staging with the blocks copied between them by the host copy pool. Devices may share a physical device
+typedef struct {
+	VkGPU* vkGPU;
+	uint32_t index;            //panel of the device, rows index * p .. (index + 1) * p - 1
+	uint32_t devices;          //D
+	uint32_t size;             //n
+	uint32_t panelSize;        //p
+	VkApplication app;         //transposition of the D blocks of the panel, one block per workgroup z
+	VkBuffer input;            //p x n row-major panel of the matrix
+	VkDeviceMemory inputMemory;
+	VkBuffer output;           //p x n row-major panel of the transposed matrix
+	VkDeviceMemory outputMemory;
+	VkHostStaging staging;
+	uint32_t sharedStaging;    //one host allocation imported by all devices, owned by the staging of device 0
+	VkCommandBuffer commandBuffer[2];//0 - transposition and outgoing blocks, 1 - incoming blocks
+} VkShard;
+
+
+VkDeviceSize
+get_ShardStagingOffset(VkShard* shard, uint32_t from, uint32_t to, uint32_t incoming)
+{
+	//offset of the block sent by device from to device to in the staging of shard. Shared staging has a slot for every
+	//pair, own staging has the outgoing blocks followed by the incoming ones
+	VkDeviceSize block = sizeof(float) * (VkDeviceSize) shard->panelSize * shard->panelSize;
+	if (shard->sharedStaging) return block * ((VkDeviceSize) from * shard->devices + to);
+	return incoming ? block * (shard->devices + from) : block * to;
+}
+
+
+void
+record_ShardCopy(VkShard* shard, VkCommandBuffer commandBuffer, VkBufferCopy* regions, uint32_t incoming)
+{
+	//rows of the off-diagonal blocks between the output panel and the staging, one region per row of a block
+	uint32_t n = shard->size, p = shard->panelSize, regionCount = 0;
+	for (uint32_t e = 0; e < shard->devices; e++) {
+		if (e == shard->index) continue;
+		VkDeviceSize stagingOffset = incoming ? get_ShardStagingOffset(shard, e, shard->index, 1) : get_ShardStagingOffset(shard, shard->index, e, 0);
+		for (uint32_t r = 0; r < p; r++) {
+			VkDeviceSize panelOffset = sizeof(float) * ((VkDeviceSize) r * n + (VkDeviceSize) e * p);
+			regions[regionCount].srcOffset = incoming ? stagingOffset + sizeof(float) * (VkDeviceSize) r * p : panelOffset;
+			regions[regionCount].dstOffset = incoming ? panelOffset : stagingOffset + sizeof(float) * (VkDeviceSize) r * p;
+			regions[regionCount].size = sizeof(float) * p;
+			regionCount++;
+		}
+	}
+	if (regionCount == 0) return;
+	if (incoming) vkCmdCopyBuffer(commandBuffer, shard->staging.buffer, shard->output, regionCount, regions);
+	else vkCmdCopyBuffer(commandBuffer, shard->output, shard->staging.buffer, regionCount, regions);
+}
+
+
+VkResult
+create_Shard(VkShard* shard, VkGPU* vkGPU, uint32_t index, uint32_t devices, uint32_t size, uint32_t coalescedMemory)
+{
+	//panel buffers and transposition pipeline of device index. The staging is created by create_ShardStaging
+	memset(shard, 0, sizeof(VkShard));
+	shard->vkGPU = vkGPU;
+	shard->index = index;
+	shard->devices = devices;
+	shard->size = size;
+	shard->panelSize = size / devices;
+	VkDeviceSize panelBytes = sizeof(float) * (VkDeviceSize) shard->panelSize * size;
+	VkResult res = allocate_Buffer_DeviceMemory(vkGPU->physicalDevice, vkGPU->device,
+	                                            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+	                                            &vkGPU->physicalDeviceMemoryProperties, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+	                                            panelBytes, &shard->input, &shard->inputMemory);
+	if (res != VK_SUCCESS) return res;
+	res = allocate_Buffer_DeviceMemory(vkGPU->physicalDevice, vkGPU->device,
+	                                   VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+	                                   &vkGPU->physicalDeviceMemoryProperties, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+	                                   panelBytes, &shard->output, &shard->outputMemory);
+	if (res != VK_SUCCESS) return res;
+
+	//block (x, y) of block z of the panel is at x + y * n + z * p
+	uint32_t tile = coalescedMemory / sizeof(float);
+	VkAppSpecializationConstantsLayout* constants = &shard->app.specializationConstants;
+	constants->localSize[0] = tile;
+	constants->localSize[1] = tile;
+	constants->localSize[2] = 1;
+	constants->inputStride[0] = 1;
+	constants->inputStride[1] = size;
+	constants->inputStride[2] = shard->panelSize;
+	VkSpecializationMapEntry specializationMapEntries[8] = { 0 };
+	for (uint32_t kk = 0; kk < 8; kk++) {
+		specializationMapEntries[kk].constantID = kk + 1;
+		specializationMapEntries[kk].size = sizeof(uint32_t);
+		specializationMapEntries[kk].offset = kk * sizeof(uint32_t);
+	}
+	VkSpecializationInfo specializationInfo = { (uint32_t) 8,
+                                                    (const VkSpecializationMapEntry*) specializationMapEntries,
+                                                    (size_t) 8 * sizeof(uint32_t),
+                                                    (const void*) constants };
+	VkBuffer*    appBuffer[2]   = { &shard->input, &shard->output };
+	VkDeviceSize bufferSizes[2] = { panelBytes, panelBytes };
+	char shaderPath[256];
+	sprintf(shaderPath, "%stransposition_no_bank_conflicts.spv", SHADER_DIR);
+	res = create_ComputeApp(vkGPU->device, 2, appBuffer, bufferSizes, &specializationInfo, &shard->app.descriptorPool, &shard->app.descriptorSetLayout,
+	                        &shard->app.descriptorSet, (const char*) shaderPath, &shard->app.pipelineLayout, &shard->app.pipeline);
+	if (res != VK_SUCCESS) return res;
+	VkCommandBufferAllocateInfo commandBufferAllocateInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+                                        (const void*) NULL,
+                                        (VkCommandPool) vkGPU->commandPool,
+                                        (VkCommandBufferLevel) VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+                                        (uint32_t) 2 };
+	return vkAllocateCommandBuffers(vkGPU->device, &commandBufferAllocateInfo, shard->commandBuffer);
+}
+
+
+void
+delete_ShardStaging(VkShard* shard)
+{
+	//shared host memory is freed with the staging of device 0
+	if (shard->vkGPU == NULL) return;
+	if (shard->sharedStaging && shard->index != 0) {
+		vkDestroyBuffer(shard->vkGPU->device, shard->staging.buffer, NULL);
+		vkFreeMemory(shard->vkGPU->device, shard->staging.memory, NULL);
+	}
+	else delete_HostStaging(shard->vkGPU, &shard->staging);
+	memset(&shard->staging, 0, sizeof(VkHostStaging));
+	shard->sharedStaging = 0;
+}
+
+
+VkResult
+create_ShardStaging(VkShard* shard, uint32_t devices, uint32_t* shared)
+{
+	//host memory imported by every device if all of them support it, own staging of every device otherwise
+	VkDeviceSize block = sizeof(float) * (VkDeviceSize) shard[0].panelSize * shard[0].panelSize;
+	VkResult res = VK_SUCCESS;
+	shared[0] = (devices > 1);
+	for (uint32_t d = 0; d < devices; d++)
+		if (!shard[d].vkGPU->externalMemoryHostSupported) shared[0] = 0;
+	if (shared[0]) {
+		res = create_HostStaging(shard[0].vkGPU, block * devices * devices, &shard[0].staging);
+		if (res != VK_SUCCESS || !shard[0].staging.imported) shared[0] = 0;
+		shard[0].sharedStaging = shared[0];
+		for (uint32_t d = 1; d < devices && shared[0]; d++) {
+			shard[d].staging = shard[0].staging;
+			shard[d].staging.buffer = VK_NULL_HANDLE;
+			shard[d].staging.memory = VK_NULL_HANDLE;
+			shard[d].sharedStaging = 1;
+			if (import_HostStaging(shard[d].vkGPU, &shard[d].staging) != VK_SUCCESS) shared[0] = 0;
+		}
+		if (!shared[0]) {
+			//the owner goes last
+			for (uint32_t d = devices; d > 0; d--)
+				if (shard[d - 1].sharedStaging || d == 1) delete_ShardStaging(&shard[d - 1]);
+		}
+		res = VK_SUCCESS;
+	}
+	for (uint32_t d = 0; d < devices && !shared[0] && res == VK_SUCCESS; d++)
+		res = create_HostStaging(shard[d].vkGPU, block * 2 * devices, &shard[d].staging);
+	return res;
+}
+
+
+VkResult
+record_Shard(VkShard* shard)
+{
+	//command buffer 0: transposition of the blocks and the outgoing blocks into the staging, 1: incoming blocks into the
+	//output panel. Both are recorded once and submitted for every run
+	VkBufferCopy* regions = (VkBufferCopy*) malloc(sizeof(VkBufferCopy) * shard->panelSize * shard->devices);
+	if (regions == NULL) return VK_ERROR_OUT_OF_HOST_MEMORY;
+	VkResult res = VK_SUCCESS;
+	uint32_t tile = shard->app.specializationConstants.localSize[0];
+	for (uint32_t k = 0; k < 2 && res == VK_SUCCESS; k++) {
+		VkCommandBufferBeginInfo commandBufferBeginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+                                             (const void*) NULL,
+                                             (VkCommandBufferUsageFlags) 0,
+                                             (const VkCommandBufferInheritanceInfo*) NULL };
+		res = vkBeginCommandBuffer(shard->commandBuffer[k], &commandBufferBeginInfo);
+		if (res != VK_SUCCESS) break;
+		if (k == 0) {
+			VkAppPushConstantsLayout pushConstants = { 0 };
+			vkCmdPushConstants(shard->commandBuffer[k], shard->app.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(VkAppPushConstantsLayout), &pushConstants);
+			vkCmdBindPipeline(shard->commandBuffer[k], VK_PIPELINE_BIND_POINT_COMPUTE, shard->app.pipeline);
+			vkCmdBindDescriptorSets(shard->commandBuffer[k], VK_PIPELINE_BIND_POINT_COMPUTE, shard->app.pipelineLayout, 0, 1, &shard->app.descriptorSet, 0, NULL);
+			vkCmdDispatch(shard->commandBuffer[k], shard->panelSize / tile, shard->panelSize / tile, shard->devices);
+			VkMemoryBarrier memoryBarrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                                            (const void*) NULL,
+                                            (VkAccessFlags) VK_ACCESS_SHADER_WRITE_BIT,
+                                            (VkAccessFlags) VK_ACCESS_TRANSFER_READ_BIT };
+			vkCmdPipelineBarrier(shard->commandBuffer[k], VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &memoryBarrier, 0, NULL, 0, NULL);
+			record_ShardCopy(shard, shard->commandBuffer[k], regions, 0);
+			//the blocks are read by the host or by the other devices after the fence
+			memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			memoryBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+			vkCmdPipelineBarrier(shard->commandBuffer[k], VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &memoryBarrier, 0, NULL, 0, NULL);
+		}
+		else {
+			record_ShardCopy(shard, shard->commandBuffer[k], regions, 1);
+			//the next transposition overwrites the output panel
+			VkMemoryBarrier memoryBarrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                                            (const void*) NULL,
+                                            (VkAccessFlags) VK_ACCESS_TRANSFER_WRITE_BIT,
+                                            (VkAccessFlags) (VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_READ_BIT) };
+			vkCmdPipelineBarrier(shard->commandBuffer[k], VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+			                     0, 1, &memoryBarrier, 0, NULL, 0, NULL);
+		}
+		res = vkEndCommandBuffer(shard->commandBuffer[k]);
+	}
+	free(regions);
+	return res;
+}
+
+
+VkResult
+submit_Shards(VkShard* shard, uint32_t devices, uint32_t k)
+{
+	//command buffer k on every device at once, then wait for all of them
+	VkResult res = VK_SUCCESS;
+	uint32_t submitted = 0;
+	for (; submitted < devices && res == VK_SUCCESS; submitted++) {
+		VkSubmitInfo submitInfo = { VK_STRUCTURE_TYPE_SUBMIT_INFO,
+                                 (const void*) NULL,
+                                 (uint32_t) 0,
+                                 (const VkSemaphore*) NULL,
+                                 (const VkPipelineStageFlags*) NULL,
+                                 (uint32_t) 1,
+                                 (const VkCommandBuffer*) &shard[submitted].commandBuffer[k],
+                                 (uint32_t) 0,
+                                 (const VkSemaphore*) NULL };
+		res = vkQueueSubmit(shard[submitted].vkGPU->queue, 1, &submitInfo, shard[submitted].vkGPU->fence);
+		if (res != VK_SUCCESS) break;
+	}
+	for (uint32_t d = 0; d < submitted; d++) {
+		VkResult waitRes = vkWaitForFences(shard[d].vkGPU->device, 1, &shard[d].vkGPU->fence, VK_TRUE, 100000000000);
+		if (waitRes == VK_SUCCESS) waitRes = vkResetFences(shard[d].vkGPU->device, 1, &shard[d].vkGPU->fence);
+		if (res == VK_SUCCESS) res = waitRes;
+	}
+	return res;
+}
+
+
+typedef struct {
+	VkShard* shard;
+	uint32_t devices;
+} VkShardExchange;
+
+
+void
+run_ShardExchange(void* arg, uint32_t worker, uint32_t workers)
+{
+	//worker copies its share of the off-diagonal blocks from the staging of the sender to the staging of the receiver
+	VkShardExchange* exchange = (VkShardExchange*) arg;
+	uint32_t devices = exchange->devices;
+	VkDeviceSize block = sizeof(float) * (VkDeviceSize) exchange->shard[0].panelSize * exchange->shard[0].panelSize;
+	uint32_t pairs = devices * devices;
+	for (uint32_t pair = pairs * worker / workers; pair < pairs * (worker + 1) / workers; pair++) {
+		uint32_t from = pair / devices, to = pair % devices;
+		if (from == to) continue;
+		VkShard* sender = &exchange->shard[from];
+		VkShard* receiver = &exchange->shard[to];
+		copy_NonTemporal((uint8_t*) receiver->staging.data + get_ShardStagingOffset(receiver, from, to, 1),
+		                 (const uint8_t*) sender->staging.data + get_ShardStagingOffset(sender, from, to, 0), (size_t) block);
+	}
+}
+
+
+VkResult
+run_Shards(VkShard* shard, uint32_t devices, uint32_t shared, VkCopyPool* pool, double* time)
+{
+	//one sharded transposition. time: 0 - transposition and outgoing blocks, 1 - host exchange, 2 - incoming blocks, in ms
+	double t = get_TimeMs();
+	VkResult res = submit_Shards(shard, devices, 0);
+	if (res != VK_SUCCESS) return res;
+	time[0] = get_TimeMs() - t;
+	t = get_TimeMs();
+	if (devices > 1 && !shared) {
+		VkShardExchange exchange = { shard, devices };
+		run_CopyPool(pool, run_ShardExchange, &exchange);
+	}
+	time[1] = get_TimeMs() - t;
+	t = get_TimeMs();
+	if (devices > 1) res = submit_Shards(shard, devices, 1);
+	time[2] = get_TimeMs() - t;
+	return res;
+}
+
+
+void
+delete_Shard(VkShard* shard)
+{
+	VkGPU* vkGPU = shard->vkGPU;
+	if (vkGPU == NULL) return;
+	if (shard->commandBuffer[0] != VK_NULL_HANDLE) vkFreeCommandBuffers(vkGPU->device, vkGPU->commandPool, 2, shard->commandBuffer);
+	if (shard->app.pipeline != VK_NULL_HANDLE) deleteApp(vkGPU, &shard->app);
+	vkDestroyBuffer(vkGPU->device, shard->input, NULL);
+	vkFreeMemory(vkGPU->device, shard->inputMemory, NULL);
+	vkDestroyBuffer(vkGPU->device, shard->output, NULL);
+	vkFreeMemory(vkGPU->device, shard->outputMemory, NULL);
+}
+
+
+VkResult
+Example_VulkanShard(uint32_t deviceID,
+                    uint32_t coalescedMemory,
+                    uint32_t size,
+                    uint32_t devices,
+                    const uint32_t* deviceIDs,
+                    uint32_t threads)
+{
+	//size x size transposition sharded over devices logical devices. deviceIDs - physical device of every logical
+	//device, NULL - deviceID, deviceID + 1, ... wrapping around the physical devices, so several logical devices share a
+	//physical device when there are fewer of them. Reports the time of every phase and the scaling efficiency against
+	//the same transposition on the first device alone
+	if (devices == 0 || devices > VKT_SHARD_MAX_DEVICES) {
+		printf("Number of devices %d is not in 1..%d\n", devices, VKT_SHARD_MAX_DEVICES);
+		return VK_ERROR_INITIALIZATION_FAILED;
+	}
+	VkGPU vkGPU[VKT_SHARD_MAX_DEVICES];
+	VkShard shard[VKT_SHARD_MAX_DEVICES];
+	VkShard single;
+	memset(vkGPU, 0, sizeof(vkGPU));
+	memset(shard, 0, sizeof(shard));
+	memset(&single, 0, sizeof(single));
+	VkCopyPool pool;
+	uint32_t poolCreated = 0, shared = 0, created = 0;
+	VkResult res = VK_SUCCESS;
+
+	for (; created < devices && res == VK_SUCCESS; created++) {
+		vkGPU[created].device_id = (deviceIDs != NULL) ? deviceIDs[created] : deviceID;
+		if (deviceIDs == NULL && created > 0) {
+			uint32_t physicalDeviceCount = 0;
+			res = vkEnumeratePhysicalDevices(vkGPU[0].instance, &physicalDeviceCount, NULL);
+			if (res != VK_SUCCESS || physicalDeviceCount == 0) break;
+			vkGPU[created].device_id = (deviceID + created) % physicalDeviceCount;
+		}
+		res = create_VkGPU(&vkGPU[created]);
+		if (res != VK_SUCCESS) break;
+	}
+	if (res != VK_SUCCESS) {
+		printf("Device %d creation failed, error code: %d\n", created, res);
+		for (uint32_t d = 0; d < created; d++) delete_VkGPU(&vkGPU[d]);
+		return res;
+	}
+	coalescedMemory = get_CoalescedMemory(&vkGPU[0], coalescedMemory);
+	uint32_t tile = coalescedMemory / sizeof(float);
+	if (size % (devices * tile) != 0) {
+		printf("System size %d is not a multiple of %d devices x tile size %d\n", size, devices, tile);
+		for (uint32_t d = 0; d < devices; d++) delete_VkGPU(&vkGPU[d]);
+		return VK_ERROR_FORMAT_NOT_SUPPORTED;
+	}
+
+	//device groups of the physical devices, peer memory would need one logical device created over the whole group
+	uint32_t groupCount = 0, groupSize = 1;
+	if (vkGPU[0].physicalDeviceProperties.apiVersion >= VK_API_VERSION_1_1 &&
+	    vkEnumeratePhysicalDeviceGroups(vkGPU[0].instance, &groupCount, NULL) == VK_SUCCESS && groupCount > 0) {
+		VkPhysicalDeviceGroupProperties* groups = (VkPhysicalDeviceGroupProperties*) calloc(groupCount, sizeof(VkPhysicalDeviceGroupProperties));
+		for (uint32_t g = 0; g < groupCount; g++) groups[g].sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GROUP_PROPERTIES;
+		if (vkEnumeratePhysicalDeviceGroups(vkGPU[0].instance, &groupCount, groups) == VK_SUCCESS) {
+			for (uint32_t g = 0; g < groupCount; g++)
+				if (groups[g].physicalDeviceCount > groupSize) groupSize = groups[g].physicalDeviceCount;
+		}
+		free(groups);
+	}
+
+	for (uint32_t d = 0; d < devices && res == VK_SUCCESS; d++)
+		res = create_Shard(&shard[d], &vkGPU[d], d, devices, size, coalescedMemory);
+	if (res == VK_SUCCESS) res = create_Shard(&single, &vkGPU[0], 0, 1, size, coalescedMemory);
+	if (res == VK_SUCCESS && devices > 1) res = create_ShardStaging(shard, devices, &shared);
+	if (res == VK_SUCCESS) {
+		res = create_CopyPool(&pool, threads, get_DeviceNumaNode(&vkGPU[0]));
+		poolCreated = (res == VK_SUCCESS);
+	}
+	for (uint32_t d = 0; d < devices && res == VK_SUCCESS; d++) res = record_Shard(&shard[d]);
+	if (res == VK_SUCCESS) res = record_Shard(&single);
+
+	//element (i, j) of the matrix is i * n + j, exact in float for n up to 4096
+	uint32_t p = size / devices;
+	float* panel = (float*) malloc(sizeof(float) * (size_t) size * size);
+	if (res == VK_SUCCESS && panel == NULL) res = VK_ERROR_OUT_OF_HOST_MEMORY;
+	if (res == VK_SUCCESS) {
+		for (uint32_t i = 0; i < size; i++)
+			for (uint32_t j = 0; j < size; j++) panel[(size_t) i * size + j] = (float) ((size_t) i * size + j);
+		res = upload_Data(vkGPU[0].physicalDevice, vkGPU[0].device, panel, &vkGPU[0].physicalDeviceMemoryProperties, vkGPU[0].commandPool,
+		                  vkGPU[0].queue, &vkGPU[0].fence, &single.input, sizeof(float) * (VkDeviceSize) size * size);
+		for (uint32_t d = 0; d < devices && res == VK_SUCCESS; d++)
+			res = upload_Data(vkGPU[d].physicalDevice, vkGPU[d].device, panel + (size_t) d * p * size, &vkGPU[d].physicalDeviceMemoryProperties,
+			                  vkGPU[d].commandPool, vkGPU[d].queue, &vkGPU[d].fence, &shard[d].input, sizeof(float) * (VkDeviceSize) p * size);
+	}
+
+	uint32_t runs = 10;
+	double time_single = 0, time_sharded = 0, time_phase[3] = { 0, 0, 0 };
+	for (uint32_t r = 0; r <= runs && res == VK_SUCCESS; r++) {
+		//the first run warms up
+		double time[3];
+		res = run_Shards(&single, 1, 0, &pool, time);
+		if (res != VK_SUCCESS) break;
+		if (r > 0) time_single += time[0] + time[1] + time[2];
+		res = run_Shards(shard, devices, shared, &pool, time);
+		if (res != VK_SUCCESS) break;
+		if (r > 0) {
+			time_sharded += time[0] + time[1] + time[2];
+			for (uint32_t k = 0; k < 3; k++) time_phase[k] += time[k];
+		}
+	}
+
+	//every panel of the output against the transposed matrix
+	uint32_t errors = 0;
+	for (uint32_t d = 0; d < devices && res == VK_SUCCESS; d++) {
+		res = download_Data(vkGPU[d].physicalDevice, vkGPU[d].device, vkGPU[d].commandPool, &vkGPU[d].physicalDeviceMemoryProperties,
+		                    vkGPU[d].queue, &vkGPU[d].fence, panel, &shard[d].output, sizeof(float) * (VkDeviceSize) p * size);
+		for (uint32_t r = 0; r < p && res == VK_SUCCESS; r++)
+			for (uint32_t j = 0; j < size; j++)
+				if (panel[(size_t) r * size + j] != (float) ((size_t) j * size + d * p + r)) errors++;
+	}
+
+	if (res == VK_SUCCESS) {
+		time_single /= runs;
+		time_sharded /= runs;
+		double gb = 2.0 * sizeof(float) * size * size / 1024.0 / 1024.0 / 1024.0;
+		printf("\nSharded transposition of %dx%d over %d devices (physical devices:", size, size, devices);
+		for (uint32_t d = 0; d < devices; d++) printf(" %d", vkGPU[d].device_id);
+		printf("), panels of %d rows\n", p);
+		printf("Exchange: %s, largest device group: %d physical devices, %d host copy threads\n",
+		       (devices == 1) ? "none" : (shared ? "host memory imported by all devices" : "own staging of every device, host copies"), groupSize, pool.threads);
+		printf("Single device: %.3f ms, %.2f GB/s\n", time_single, gb / time_single * 1000);
+		printf("Sharded:       %.3f ms, %.2f GB/s (transposition and outgoing blocks %.3f ms, host exchange %.3f ms, incoming blocks %.3f ms)\n",
+		       time_sharded, gb / time_sharded * 1000, time_phase[0] / runs, time_phase[1] / runs, time_phase[2] / runs);
+		printf("Speedup: %.2f, scaling efficiency: %.1f%%\n", time_single / time_sharded, 100.0 * time_single / time_sharded / devices);
+		printf("Verification %s, %d wrong elements\n", errors ? "FAILED" : "passed", errors);
+		if (errors) res = VK_ERROR_FORMAT_NOT_SUPPORTED;
+	}
+	else printf("Sharded transposition failed, error code: %d\n", res);
+
+	free(panel);
+	if (poolCreated) delete_CopyPool(&pool);
+	for (uint32_t d = devices; d > 0; d--) delete_ShardStaging(&shard[d - 1]);
+	delete_Shard(&single);
+	for (uint32_t d = 0; d < devices; d++) delete_Shard(&shard[d]);
+	for (uint32_t d = 0; d < devices; d++) delete_VkGPU(&vkGPU[d]);
+	return res;
+}
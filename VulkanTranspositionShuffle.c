@@ -0,0 +1,277 @@
+#include "VulkanTransposition.h"
+
+
+//Byte and bit shuffle (byte_shuffle.comp, bit_shuffle.comp and bit_shuffle_ballot.comp): the bytes or bits of every element
+//are transposed, which groups similar bytes before compression. SSE2 CPU references
+typedef struct {
+	uint32_t localSize[3];
+	uint32_t elementSize;  //bytes per element
+	uint32_t numElements;
+	uint32_t inverse;      //0 - shuffle, 1 - unshuffle
+	uint32_t groupElements;//elements staged in shared memory by one workgroup
+} VkShuffleSpecializationConstantsLayout;//specialization constants of byte_shuffle.comp, bit_shuffle.comp and bit_shuffle_ballot.comp
+
+
+void
+shuffle_Bytes_CPU(const uint8_t* input,
+                  uint8_t* output,
+                  uint64_t numElements,
+                  uint32_t elementSize,
+                  uint32_t inverse)
+{
+	//reference byte shuffle: byte j of element i is moved to position j*numElements+i, inverse moves it back
+	uint64_t i = 0;
+#ifdef VKT_SSE2
+	if (elementSize == 4 && inverse == 0) {
+		//16 elements per iteration: three rounds of byte interleaving turn four vectors of records into byte planes
+		for (; i + 16 <= numElements; i += 16) {
+			__m128i a0 = _mm_loadu_si128((const __m128i*) (input + 4 * i));
+			__m128i a1 = _mm_loadu_si128((const __m128i*) (input + 4 * i + 16));
+			__m128i a2 = _mm_loadu_si128((const __m128i*) (input + 4 * i + 32));
+			__m128i a3 = _mm_loadu_si128((const __m128i*) (input + 4 * i + 48));
+			__m128i t0 = _mm_unpacklo_epi8(a0, a1), t1 = _mm_unpackhi_epi8(a0, a1);
+			__m128i t2 = _mm_unpacklo_epi8(a2, a3), t3 = _mm_unpackhi_epi8(a2, a3);
+			__m128i u0 = _mm_unpacklo_epi8(t0, t1), u1 = _mm_unpackhi_epi8(t0, t1);
+			__m128i u2 = _mm_unpacklo_epi8(t2, t3), u3 = _mm_unpackhi_epi8(t2, t3);
+			__m128i v0 = _mm_unpacklo_epi8(u0, u1), v1 = _mm_unpackhi_epi8(u0, u1);
+			__m128i v2 = _mm_unpacklo_epi8(u2, u3), v3 = _mm_unpackhi_epi8(u2, u3);
+			_mm_storeu_si128((__m128i*) (output + i), _mm_unpacklo_epi64(v0, v2));
+			_mm_storeu_si128((__m128i*) (output + numElements + i), _mm_unpackhi_epi64(v0, v2));
+			_mm_storeu_si128((__m128i*) (output + 2 * numElements + i), _mm_unpacklo_epi64(v1, v3));
+			_mm_storeu_si128((__m128i*) (output + 3 * numElements + i), _mm_unpackhi_epi64(v1, v3));
+		}
+	}
+	if (elementSize == 4 && inverse == 1) {
+		for (; i + 16 <= numElements; i += 16) {
+			__m128i p0 = _mm_loadu_si128((const __m128i*) (input + i));
+			__m128i p1 = _mm_loadu_si128((const __m128i*) (input + numElements + i));
+			__m128i p2 = _mm_loadu_si128((const __m128i*) (input + 2 * numElements + i));
+			__m128i p3 = _mm_loadu_si128((const __m128i*) (input + 3 * numElements + i));
+			__m128i r0 = _mm_unpacklo_epi8(p0, p1), r1 = _mm_unpackhi_epi8(p0, p1);
+			__m128i s0 = _mm_unpacklo_epi8(p2, p3), s1 = _mm_unpackhi_epi8(p2, p3);
+			_mm_storeu_si128((__m128i*) (output + 4 * i), _mm_unpacklo_epi16(r0, s0));
+			_mm_storeu_si128((__m128i*) (output + 4 * i + 16), _mm_unpackhi_epi16(r0, s0));
+			_mm_storeu_si128((__m128i*) (output + 4 * i + 32), _mm_unpacklo_epi16(r1, s1));
+			_mm_storeu_si128((__m128i*) (output + 4 * i + 48), _mm_unpackhi_epi16(r1, s1));
+		}
+	}
+#endif
+	for (; i < numElements; i++) {
+		for (uint32_t j = 0; j < elementSize; j++) {
+			if (inverse == 0) output[j * numElements + i] = input[i * elementSize + j];
+			else output[i * elementSize + j] = input[j * numElements + i];
+		}
+	}
+}
+
+
+void
+shuffle_Bits_CPU(const uint8_t* input,
+                 uint8_t* output,
+                 uint8_t* temp,
+                 uint64_t numElements,
+                 uint32_t elementSize,
+                 uint32_t inverse)
+{
+	//reference bit shuffle, numElements is a multiple of 8: byte shuffle followed by an 8x8 bit transposition of every
+	//8 bytes of a byte plane. Bit row 8*j+b is numElements/8 bytes long, element i is bit i%8 of byte i/8. temp has the size of the data
+	uint64_t rowSize = numElements / 8;
+	if (inverse == 0) shuffle_Bytes_CPU(input, temp, numElements, elementSize, 0);
+	for (uint32_t j = 0; j < elementSize; j++) {
+		uint8_t* plane = temp + j * numElements;
+		uint8_t* rows = ((inverse == 0) ? output : (uint8_t*) input) + 8 * j * rowSize;
+		uint64_t c = 0;
+		if (inverse == 0) {
+#ifdef VKT_SSE2
+			//movemask collects the most significant bits of 16 bytes, shifting left moves the next bit there
+			for (; c + 2 <= rowSize; c += 2) {
+				__m128i v = _mm_loadu_si128((const __m128i*) (plane + 8 * c));
+				for (int b = 7; b >= 0; b--) {
+					uint16_t mask = (uint16_t) _mm_movemask_epi8(v);
+					memcpy(rows + b * rowSize + c, &mask, sizeof(uint16_t));
+					v = _mm_slli_epi16(v, 1);
+				}
+			}
+#endif
+			for (; c < rowSize; c++) {
+				for (uint32_t b = 0; b < 8; b++) {
+					uint8_t bits = 0;
+					for (uint32_t k = 0; k < 8; k++) bits |= ((plane[8 * c + k] >> b) & 1) << k;
+					rows[b * rowSize + c] = bits;
+				}
+			}
+		}
+		else {
+			for (; c < rowSize; c++) {
+				for (uint32_t k = 0; k < 8; k++) {
+					uint8_t byte = 0;
+					for (uint32_t b = 0; b < 8; b++) byte |= ((rows[b * rowSize + c] >> k) & 1) << b;
+					plane[8 * c + k] = byte;
+				}
+			}
+		}
+	}
+	if (inverse == 1) shuffle_Bytes_CPU(temp, output, numElements, elementSize, 1);
+}
+
+
+VkResult
+Example_VulkanShuffle(uint32_t deviceID,
+                      uint32_t elementSize,
+                      uint32_t size)
+{
+	//byte and bit shuffle of size x size floats worth of elementSize-byte elements, verified against the CPU reference
+	VkGPU vkGPU = { 0 };
+	vkGPU.device_id = deviceID;
+	VkResult res = VK_SUCCESS;
+	res = create_VkGPU(&vkGPU);
+	if (res != VK_SUCCESS) return res;
+
+	uint64_t numElements = ((uint64_t) sizeof(float) * size * size / elementSize) / 32 * 32;
+	VkDeviceSize bufferSize = numElements * elementSize;
+	if (elementSize == 0 || numElements == 0 || numElements > 0xFFFFFFFF) {
+		printf("Unsupported element size %d for system size %dx%d\n", elementSize, size, size);
+		delete_VkGPU(&vkGPU);
+		return VK_ERROR_FORMAT_NOT_SUPPORTED;
+	}
+
+	//workgroup stages groupElements records, so that the portable bit shuffle has one 32-element task per thread
+	uint32_t localSize = 256;
+	if (localSize > vkGPU.physicalDeviceProperties.limits.maxComputeWorkGroupInvocations) localSize = vkGPU.physicalDeviceProperties.limits.maxComputeWorkGroupInvocations;
+	uint32_t groupElements = 8 * localSize;
+	while (groupElements > 32 && groupElements * elementSize > vkGPU.physicalDeviceProperties.limits.maxComputeSharedMemorySize) groupElements /= 2;
+	if (groupElements * elementSize > vkGPU.physicalDeviceProperties.limits.maxComputeSharedMemorySize) {
+		printf("Element size %d does not fit in shared memory\n", elementSize);
+		delete_VkGPU(&vkGPU);
+		return VK_ERROR_FORMAT_NOT_SUPPORTED;
+	}
+	//ballots give bit rows directly if every subgroup covers whole 32-element words. The reported size is only a hint: the
+	//shader checks gl_SubgroupSize of the dispatch and assembles the words in shared memory if the subgroups are smaller
+	VkPhysicalDeviceSubgroupProperties* subgroup = &vkGPU.physicalDeviceSubgroupProperties;
+	uint32_t useBallot = (subgroup->subgroupSize >= 32) && (subgroup->subgroupSize % 32 == 0) && (localSize % subgroup->subgroupSize == 0) &&
+	                     (subgroup->supportedStages & VK_SHADER_STAGE_COMPUTE_BIT) && (subgroup->supportedOperations & VK_SUBGROUP_FEATURE_BALLOT_BIT) &&
+	                     (elementSize % 4 == 0);
+
+	VkBuffer inputBuffer = { 0 }, outputBuffer = { 0 };
+	VkDeviceMemory inputBufferDeviceMemory = { 0 }, outputBufferDeviceMemory = { 0 };
+	uint8_t* buffer_input = NULL;
+	uint8_t* buffer_output = NULL;
+	uint8_t* buffer_ref = NULL;
+	uint8_t* buffer_temp = NULL;
+	uint8_t* buffer_cpu = NULL;
+	VkApplication app[2][2];
+	memset(app, 0, sizeof(app));
+	res = allocate_Buffer_DeviceMemory(vkGPU.physicalDevice, vkGPU.device,
+                                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                           &vkGPU.physicalDeviceMemoryProperties, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                           bufferSize, &inputBuffer, &inputBufferDeviceMemory);
+	if (res != VK_SUCCESS) {
+		printf("Input buffer allocation failed, error code: %d\n", res);
+		goto cleanup;
+	}
+	res = allocate_Buffer_DeviceMemory(vkGPU.physicalDevice, vkGPU.device,
+                                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                           &vkGPU.physicalDeviceMemoryProperties, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                           bufferSize, &outputBuffer, &outputBufferDeviceMemory);
+	if (res != VK_SUCCESS) {
+		printf("Output buffer allocation failed, error code: %d\n", res);
+		goto cleanup;
+	}
+
+	//pseudo random input, so that every bit plane is different
+	buffer_input  = (uint8_t*) malloc(bufferSize);
+	buffer_output = (uint8_t*) malloc(bufferSize);
+	buffer_ref    = (uint8_t*) malloc(bufferSize);
+	buffer_temp   = (uint8_t*) malloc(bufferSize);
+	buffer_cpu    = (uint8_t*) malloc(bufferSize);
+	if (buffer_input == NULL || buffer_output == NULL || buffer_ref == NULL || buffer_temp == NULL || buffer_cpu == NULL) {
+		res = VK_ERROR_OUT_OF_HOST_MEMORY;
+		goto cleanup;
+	}
+	uint32_t seed = 0x12345678;
+	for (VkDeviceSize i = 0; i < bufferSize; i++) {
+		seed ^= seed << 13;
+		seed ^= seed >> 17;
+		seed ^= seed << 5;
+		buffer_input[i] = (uint8_t) seed;
+	}
+	res = upload_Data(vkGPU.physicalDevice, vkGPU.device, buffer_input, &vkGPU.physicalDeviceMemoryProperties,
+                          vkGPU.commandPool, vkGPU.queue, &vkGPU.fence, &inputBuffer, bufferSize);
+	if (res != VK_SUCCESS) goto cleanup;
+
+	//shuffle reads the input buffer and writes the output buffer, unshuffle goes back
+	const char* shaderNames[2] = { "byte_shuffle.spv", useBallot ? "bit_shuffle_ballot.spv" : "bit_shuffle.spv" };
+	const char* names[2] = { "Byte shuffle", "Bit shuffle" };
+	double time[2][2] = { { 0 } };
+	double timeCPU[2][2] = { { 0 } };
+	uint32_t passed[2][2] = { { 0 } };
+	for (uint32_t kind = 0; kind < 2; kind++) {
+		for (uint32_t inverse = 0; inverse < 2; inverse++) {
+			VkShuffleSpecializationConstantsLayout specializationConstants = { { localSize, 1, 1 }, elementSize, (uint32_t) numElements, inverse, groupElements };
+			res = create_SpecializedApp(&vkGPU, &app[kind][inverse], &specializationConstants, 7,
+                                                    inverse ? &outputBuffer : &inputBuffer, inverse ? &inputBuffer : &outputBuffer,
+                                                    bufferSize, shaderNames[kind]);
+			if (res != VK_SUCCESS) {
+				printf("%s application creation failed, error code: %d\n", names[kind], res);
+				goto cleanup;
+			}
+			//the shaders walk the elements with a grid stride, so the grid is clamped to the device limit
+			uint32_t elementsPerGroup = (kind == 1 && useBallot) ? localSize : groupElements;
+			uint64_t groups = (numElements + elementsPerGroup - 1) / elementsPerGroup;
+			uint32_t maxGroups = vkGPU.physicalDeviceProperties.limits.maxComputeWorkGroupCount[0];
+			uint32_t groupCount[3] = { (groups < maxGroups) ? (uint32_t) groups : maxGroups, 1, 1 };
+			res = run_App(vkGPU.device, vkGPU.commandPool, app[kind][inverse].pipeline, app[kind][inverse].pipelineLayout,
+                                      &app[kind][inverse].descriptorSet, groupCount, vkGPU.queue, &vkGPU.fence, 100, &time[kind][inverse]);
+			if (res != VK_SUCCESS) {
+				printf("%s application run failed, error code: %d\n", names[kind], res);
+				goto cleanup;
+			}
+			res = download_Data(vkGPU.physicalDevice, vkGPU.device, vkGPU.commandPool, &vkGPU.physicalDeviceMemoryProperties,
+                                            vkGPU.queue, &vkGPU.fence, buffer_output, inverse ? &inputBuffer : &outputBuffer, bufferSize);
+			if (res != VK_SUCCESS) goto cleanup;
+
+			//forward result is compared with the CPU reference, inverse result with the original data
+			double t = get_TimeMs();
+			if (inverse == 0) {
+				if (kind == 0) shuffle_Bytes_CPU(buffer_input, buffer_ref, numElements, elementSize, 0);
+				else shuffle_Bits_CPU(buffer_input, buffer_ref, buffer_temp, numElements, elementSize, 0);
+			}
+			else {
+				if (kind == 0) shuffle_Bytes_CPU(buffer_ref, buffer_cpu, numElements, elementSize, 1);
+				else shuffle_Bits_CPU(buffer_ref, buffer_cpu, buffer_temp, numElements, elementSize, 1);
+			}
+			timeCPU[kind][inverse] = get_TimeMs() - t;
+			passed[kind][inverse] = (memcmp(buffer_output, inverse ? buffer_input : buffer_ref, bufferSize) == 0);
+			if (inverse == 1) passed[kind][inverse] &= (memcmp(buffer_cpu, buffer_input, bufferSize) == 0);
+		}
+	}
+
+	printf("Element size: %d bytes\nElements: %llu\nBuffer size: %d KB\nBit shuffle kernel: %s\n",
+	       elementSize, (unsigned long long) numElements, (int) (bufferSize / 1024), useBallot ? "subgroup ballot" : "shared memory bit-matrix transposition");
+	for (uint32_t kind = 0; kind < 2; kind++) {
+		for (uint32_t inverse = 0; inverse < 2; inverse++) {
+			printf("%s%s: GPU %.3f ms (%.1f GB/s), CPU %.3f ms (%.1f GB/s), verification %s\n",
+			       names[kind], inverse ? " inverse" : "",
+			       time[kind][inverse], 2 * bufferSize / 1024.0 / 1024.0 / 1024.0 / (time[kind][inverse] / 1000),
+			       timeCPU[kind][inverse], 2 * bufferSize / 1024.0 / 1024.0 / 1024.0 / (timeCPU[kind][inverse] / 1000),
+			       passed[kind][inverse] ? "passed" : "FAILED");
+			if (!passed[kind][inverse]) res = VK_ERROR_FORMAT_NOT_SUPPORTED;
+		}
+	}
+
+cleanup:
+	free(buffer_input);
+	free(buffer_output);
+	free(buffer_ref);
+	free(buffer_temp);
+	free(buffer_cpu);
+	for (uint32_t kind = 0; kind < 2; kind++) {
+		for (uint32_t inverse = 0; inverse < 2; inverse++) deleteApp(&vkGPU, &app[kind][inverse]);
+	}
+	vkDestroyBuffer(vkGPU.device, inputBuffer, NULL);
+	vkFreeMemory(vkGPU.device, inputBufferDeviceMemory, NULL);
+	vkDestroyBuffer(vkGPU.device, outputBuffer, NULL);
+	vkFreeMemory(vkGPU.device, outputBufferDeviceMemory, NULL);
+	delete_VkGPU(&vkGPU);
+	return res;
+}
@@ -0,0 +1,452 @@
+#include "VulkanTransposition.h"
+
+
+//CSR -> CSC conversion (sparse transposition). Buffers of VkSparseTransposition.buffer
+#define VKT_SPARSE_ROW_PTR    0 //rows+1 row pointers of the CSR input
+#define VKT_SPARSE_COL_IDX    1 //nnz column indices of the CSR input
+#define VKT_SPARSE_VALUES     2 //nnz values of the CSR input
+#define VKT_SPARSE_COL_PTR    3 //cols+1 column pointers of the CSC output
+#define VKT_SPARSE_CURSOR     4 //next free slot of every column, used by the scatter pass
+#define VKT_SPARSE_ROW_IDX    5 //nnz row indices of the CSC output
+#define VKT_SPARSE_VALUES_OUT 6 //nnz values of the CSC output
+#define VKT_SPARSE_PERM       7 //source index of every output slot, stable mode only
+#define VKT_SPARSE_PERM_TEMP  8 //ping-pong buffer of the merge sort
+#define VKT_SPARSE_BLOCK_SUMS 9 //block sums of the prefix scan
+#define VKT_SPARSE_BUFFERS    10
+
+typedef struct {
+	uint32_t localSize[3];
+	uint32_t constants[4];//kernel specific, constant_id 4..7 - see the header of every sparse_*.comp shader
+} VkSparseSpecializationConstantsLayout;
+
+typedef struct {
+	uint32_t rows;
+	uint32_t cols;
+	uint32_t nnz;
+	uint32_t valueSize;      //bytes per value, 4 or 8. Values are copied as raw words, so the result is bit-exact for any type
+	uint32_t sorted;         //1 - keep the row order inside the columns (segmented sort), 0 - arbitrary order
+	uint32_t maxColumnLength;//upper bound of nonzeros in one column if known by the caller, 0 - nnz. Defines the number of sort passes
+	uint32_t localSize;
+	uint32_t groupCount;     //workgroups of the grid-stride passes
+	uint32_t scanBlocks;     //workgroups of the first and the last scan pass
+	uint32_t sortLevels;
+	VkBuffer       buffer[VKT_SPARSE_BUFFERS];
+	VkDeviceMemory bufferDeviceMemory[VKT_SPARSE_BUFFERS];
+	VkDeviceSize   bufferSize[VKT_SPARSE_BUFFERS];
+	VkApplication histogram;
+	VkApplication scan[3];
+	VkApplication scatter;
+	VkApplication sort[2];   //perm -> permTemp and permTemp -> perm
+	VkApplication gather;
+} VkSparseTransposition;
+
+
+void
+transpose_Sparse_CPU(uint32_t rows,
+                     uint32_t cols,
+                     const uint32_t* rowPtr,
+                     const uint32_t* colIdx,
+                     const uint8_t* values,
+                     uint32_t valueSize,
+                     uint32_t* colPtr,
+                     uint32_t* rowIdx,
+                     uint8_t* valuesOut)
+{
+	//reference CSR -> CSC conversion: counting sort by column, rows are visited in order so every column stays sorted by row
+	memset(colPtr, 0, sizeof(uint32_t) * (cols + 1));
+	for (uint32_t k = 0; k < rowPtr[rows]; k++) colPtr[colIdx[k] + 1]++;
+	for (uint32_t c = 0; c < cols; c++) colPtr[c + 1] += colPtr[c];
+	uint32_t* cursor = (uint32_t*) malloc(sizeof(uint32_t) * (cols + 1));
+	memcpy(cursor, colPtr, sizeof(uint32_t) * (cols + 1));
+	for (uint32_t r = 0; r < rows; r++) {
+		for (uint32_t k = rowPtr[r]; k < rowPtr[r + 1]; k++) {
+			uint32_t dst = cursor[colIdx[k]]++;
+			rowIdx[dst] = r;
+			memcpy(valuesOut + (uint64_t) dst * valueSize, values + (uint64_t) k * valueSize, valueSize);
+		}
+	}
+	free(cursor);
+}
+
+
+VkResult
+create_SparseApp(VkGPU* vkGPU,
+                 VkSparseTransposition* sparse,
+                 VkApplication* app,
+                 const char* shaderName,
+                 uint32_t bufferCount,
+                 const uint32_t* bufferIDs,
+                 uint32_t constant4,
+                 uint32_t constant5,
+                 uint32_t constant6,
+                 uint32_t constant7)
+{
+	//create one pass of the sparse transposition, binding i of the shader is sparse->buffer[bufferIDs[i]]
+	VkSparseSpecializationConstantsLayout specializationConstants = { { sparse->localSize, 1, 1 }, { constant4, constant5, constant6, constant7 } };
+	VkSpecializationMapEntry specializationMapEntries[7] = { 0 };
+	for (uint32_t kk = 0; kk < 7; kk++) {
+		specializationMapEntries[kk].constantID = kk + 1;
+		specializationMapEntries[kk].size = sizeof(uint32_t);
+		specializationMapEntries[kk].offset = kk * sizeof(uint32_t);
+	}
+	VkSpecializationInfo specializationInfo = { (uint32_t) 7,
+                                                    (const VkSpecializationMapEntry*) specializationMapEntries,
+                                                    (size_t) 7 * sizeof(uint32_t),
+                                                    (const void*) &specializationConstants };
+	VkBuffer*    buffer[VKT_SPARSE_BUFFERS];
+	VkDeviceSize bufferSize[VKT_SPARSE_BUFFERS];
+	for (uint32_t i = 0; i < bufferCount; i++) {
+		buffer[i] = &sparse->buffer[bufferIDs[i]];
+		bufferSize[i] = sparse->bufferSize[bufferIDs[i]];
+	}
+	char shaderPath[256];
+	sprintf(shaderPath, "%s%s", SHADER_DIR, shaderName);
+	return create_ComputeApp(vkGPU->device,
+                                 bufferCount,
+                                 buffer,
+                                 bufferSize,
+                                 &specializationInfo,
+                                 &app->descriptorPool,
+                                 &app->descriptorSetLayout,
+                                 &app->descriptorSet,
+                                 (const char*) shaderPath,
+                                 &app->pipelineLayout,
+                                 &app->pipeline);
+}
+
+
+VkResult
+create_SparseTransposition(VkGPU* vkGPU, VkSparseTransposition* sparse)
+{
+	//allocate device buffers and create all passes for the matrix described by rows, cols, nnz, valueSize and sorted
+	VkResult res = VK_SUCCESS;
+	uint32_t valueWords = sparse->valueSize / 4;
+	if (sparse->rows == 0 || sparse->cols == 0 || sparse->nnz == 0 || (sparse->valueSize != 4 && sparse->valueSize != 8) ||
+	    (uint64_t) sparse->nnz * valueWords > 0x7FFFFFFF) {
+		printf("Unsupported sparse matrix: %dx%d, %d nonzeros, %d-byte values\n", sparse->rows, sparse->cols, sparse->nnz, sparse->valueSize);
+		return VK_ERROR_FORMAT_NOT_SUPPORTED;
+	}
+	uint32_t maxGroups = vkGPU->physicalDeviceProperties.limits.maxComputeWorkGroupCount[0];
+	sparse->localSize = 256;
+	if (sparse->localSize > vkGPU->physicalDeviceProperties.limits.maxComputeWorkGroupInvocations) sparse->localSize = vkGPU->physicalDeviceProperties.limits.maxComputeWorkGroupInvocations;
+	sparse->groupCount = (sparse->nnz + sparse->localSize - 1) / sparse->localSize;
+	if (sparse->groupCount > maxGroups) sparse->groupCount = maxGroups;
+	//every scan workgroup covers 4*localSize column counts (see sparse_scan.comp)
+	sparse->scanBlocks = (sparse->cols + 1 + 4 * sparse->localSize - 1) / (4 * sparse->localSize);
+	if (sparse->scanBlocks > maxGroups) {
+		printf("Too many columns for the prefix scan: %d\n", sparse->cols);
+		return VK_ERROR_FORMAT_NOT_SUPPORTED;
+	}
+	//merge passes double the sorted run width until it covers the longest column. An even number of passes leaves the result in perm
+	uint32_t maxColumnLength = (sparse->maxColumnLength != 0) ? sparse->maxColumnLength : sparse->nnz;
+	sparse->sortLevels = 0;
+	for (uint64_t width = 1; width < maxColumnLength; width *= 2) sparse->sortLevels++;
+	sparse->sortLevels += sparse->sortLevels % 2;
+
+	sparse->bufferSize[VKT_SPARSE_ROW_PTR]    = sizeof(uint32_t) * ((VkDeviceSize) sparse->rows + 1);
+	sparse->bufferSize[VKT_SPARSE_COL_IDX]    = sizeof(uint32_t) * (VkDeviceSize) sparse->nnz;
+	sparse->bufferSize[VKT_SPARSE_VALUES]     = (VkDeviceSize) sparse->valueSize * sparse->nnz;
+	sparse->bufferSize[VKT_SPARSE_COL_PTR]    = sizeof(uint32_t) * ((VkDeviceSize) sparse->cols + 1);
+	sparse->bufferSize[VKT_SPARSE_CURSOR]     = sizeof(uint32_t) * ((VkDeviceSize) sparse->cols + 1);
+	sparse->bufferSize[VKT_SPARSE_ROW_IDX]    = sizeof(uint32_t) * (VkDeviceSize) sparse->nnz;
+	sparse->bufferSize[VKT_SPARSE_VALUES_OUT] = (VkDeviceSize) sparse->valueSize * sparse->nnz;
+	sparse->bufferSize[VKT_SPARSE_PERM]       = sizeof(uint32_t) * (VkDeviceSize) sparse->nnz;
+	sparse->bufferSize[VKT_SPARSE_PERM_TEMP]  = sizeof(uint32_t) * (VkDeviceSize) sparse->nnz;
+	sparse->bufferSize[VKT_SPARSE_BLOCK_SUMS] = sizeof(uint32_t) * (VkDeviceSize) sparse->scanBlocks;
+	for (uint32_t i = 0; i < VKT_SPARSE_BUFFERS; i++) {
+		res = allocate_Buffer_DeviceMemory(vkGPU->physicalDevice, vkGPU->device,
+                                                   VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                   &vkGPU->physicalDeviceMemoryProperties, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                                   sparse->bufferSize[i], &sparse->buffer[i], &sparse->bufferDeviceMemory[i]);
+		if (res != VK_SUCCESS) {
+			printf("Sparse buffer %d allocation failed, error code: %d\n", i, res);
+			return res;
+		}
+	}
+
+	const uint32_t histogramBuffers[2] = { VKT_SPARSE_COL_IDX, VKT_SPARSE_COL_PTR };
+	const uint32_t scanBuffers[2]      = { VKT_SPARSE_COL_PTR, VKT_SPARSE_BLOCK_SUMS };
+	const uint32_t scatterBuffers[7]   = { VKT_SPARSE_ROW_PTR, VKT_SPARSE_COL_IDX, VKT_SPARSE_VALUES, VKT_SPARSE_CURSOR,
+	                                       VKT_SPARSE_ROW_IDX, VKT_SPARSE_VALUES_OUT, VKT_SPARSE_PERM };
+	const uint32_t sortBuffers[2][3]   = { { VKT_SPARSE_COL_PTR, VKT_SPARSE_PERM, VKT_SPARSE_PERM_TEMP },
+	                                       { VKT_SPARSE_COL_PTR, VKT_SPARSE_PERM_TEMP, VKT_SPARSE_PERM } };
+	const uint32_t gatherBuffers[5]    = { VKT_SPARSE_ROW_PTR, VKT_SPARSE_VALUES, VKT_SPARSE_PERM, VKT_SPARSE_ROW_IDX, VKT_SPARSE_VALUES_OUT };
+
+	res = create_SparseApp(vkGPU, sparse, &sparse->histogram, "sparse_histogram.spv", 2, histogramBuffers, sparse->nnz, 0, 0, 0);
+	if (res != VK_SUCCESS) return res;
+	for (uint32_t pass = 0; pass < 3; pass++) {
+		res = create_SparseApp(vkGPU, sparse, &sparse->scan[pass], "sparse_scan.spv", 2, scanBuffers, sparse->cols + 1, pass, 0, 0);
+		if (res != VK_SUCCESS) return res;
+	}
+	res = create_SparseApp(vkGPU, sparse, &sparse->scatter, "sparse_scatter.spv", 7, scatterBuffers, sparse->nnz, sparse->rows, valueWords, sparse->sorted);
+	if (res != VK_SUCCESS) return res;
+	if (sparse->sorted) {
+		for (uint32_t i = 0; i < 2; i++) {
+			res = create_SparseApp(vkGPU, sparse, &sparse->sort[i], "sparse_sort.spv", 3, sortBuffers[i], sparse->nnz, sparse->cols, 0, 0);
+			if (res != VK_SUCCESS) return res;
+		}
+		res = create_SparseApp(vkGPU, sparse, &sparse->gather, "sparse_gather.spv", 5, gatherBuffers, sparse->nnz, sparse->rows, valueWords, 0);
+		if (res != VK_SUCCESS) return res;
+	}
+	return res;
+}
+
+
+void
+append_SparseBarrier(VkCommandBuffer commandBuffer)
+{
+	//passes alternate between compute shaders and transfer commands on the same buffers, so one barrier covers both
+	VkMemoryBarrier memoryBarrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                            (const void*) NULL,
+                            (VkAccessFlags) (VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT),
+                            (VkAccessFlags) (VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT) };
+	vkCmdPipelineBarrier(commandBuffer,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             0, 1, &memoryBarrier, 0, NULL, 0, NULL);
+}
+
+
+void
+append_SparseDispatch(VkCommandBuffer commandBuffer, VkApplication* app, uint32_t groupCount, uint32_t pushID)
+{
+	vkCmdPushConstants(commandBuffer, app->pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uint32_t), &pushID);
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, app->pipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, app->pipelineLayout, 0, 1, &app->descriptorSet, 0, NULL);
+	vkCmdDispatch(commandBuffer, groupCount, 1, 1);
+	append_SparseBarrier(commandBuffer);
+}
+
+
+void
+record_SparseTransposition(VkSparseTransposition* sparse, VkCommandBuffer commandBuffer)
+{
+	//column histogram -> exclusive scan -> scatter [-> segmented merge sort -> gather]
+	vkCmdFillBuffer(commandBuffer, sparse->buffer[VKT_SPARSE_COL_PTR], 0, sparse->bufferSize[VKT_SPARSE_COL_PTR], 0);
+	append_SparseBarrier(commandBuffer);
+	append_SparseDispatch(commandBuffer, &sparse->histogram, sparse->groupCount, 0);
+	append_SparseDispatch(commandBuffer, &sparse->scan[0], sparse->scanBlocks, 0);
+	append_SparseDispatch(commandBuffer, &sparse->scan[1], 1, 0);
+	append_SparseDispatch(commandBuffer, &sparse->scan[2], sparse->scanBlocks, 0);
+	VkBufferCopy copyRegion = { 0, 0, sparse->bufferSize[VKT_SPARSE_COL_PTR] };
+	vkCmdCopyBuffer(commandBuffer, sparse->buffer[VKT_SPARSE_COL_PTR], sparse->buffer[VKT_SPARSE_CURSOR], 1, &copyRegion);
+	append_SparseBarrier(commandBuffer);
+	append_SparseDispatch(commandBuffer, &sparse->scatter, sparse->groupCount, 0);
+	if (sparse->sorted) {
+		for (uint32_t level = 0; level < sparse->sortLevels; level++)
+			append_SparseDispatch(commandBuffer, &sparse->sort[level % 2], sparse->groupCount, 1u << level);
+		append_SparseDispatch(commandBuffer, &sparse->gather, sparse->groupCount, 0);
+	}
+}
+
+
+VkResult
+run_SparseTransposition(VkGPU* vkGPU, VkSparseTransposition* sparse, uint32_t batch, double* time)
+{
+	//record batch conversions into one command buffer and measure the average wall time of one, in ms
+	VkResult res = VK_SUCCESS;
+	VkCommandBuffer commandBuffer = { 0 };
+	VkCommandBufferAllocateInfo commandBufferAllocateInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+                                        (const void*) NULL,
+                                        (VkCommandPool) vkGPU->commandPool,
+                                        (VkCommandBufferLevel) VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+                                        (uint32_t) 1 };
+	res = vkAllocateCommandBuffers(vkGPU->device, &commandBufferAllocateInfo, &commandBuffer);
+	if (res != VK_SUCCESS) return res;
+	VkCommandBufferBeginInfo commandBufferBeginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+                                     (const void*) NULL,
+                                     (VkCommandBufferUsageFlags) VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+                                     (const VkCommandBufferInheritanceInfo*) NULL };
+	res = vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo);
+	if (res != VK_SUCCESS) return res;
+	for (uint32_t i = 0; i < batch; i++) record_SparseTransposition(sparse, commandBuffer);
+	res = vkEndCommandBuffer(commandBuffer);
+	if (res != VK_SUCCESS) return res;
+
+	VkSubmitInfo submitInfo = { VK_STRUCTURE_TYPE_SUBMIT_INFO,
+                         (const void*) NULL,
+                         (uint32_t) 0,
+                         (const VkSemaphore*) NULL,
+                         (const VkPipelineStageFlags*) NULL,
+                         (uint32_t) 1,
+                         (const VkCommandBuffer*) &commandBuffer,
+                         (uint32_t) 0,
+                         (const VkSemaphore*) NULL };
+	double t = get_TimeMs();
+	res = vkQueueSubmit(vkGPU->queue, 1, &submitInfo, vkGPU->fence);
+	if (res != VK_SUCCESS) return res;
+	res = vkWaitForFences(vkGPU->device, 1, &vkGPU->fence, VK_TRUE, 100000000000);
+	if (res != VK_SUCCESS) return res;
+	time[0] = (get_TimeMs() - t) / batch;
+	res = vkResetFences(vkGPU->device, 1, &vkGPU->fence);
+	if (res != VK_SUCCESS) return res;
+	vkFreeCommandBuffers(vkGPU->device, vkGPU->commandPool, 1, &commandBuffer);
+	return res;
+}
+
+
+void
+delete_SparseTransposition(VkGPU* vkGPU, VkSparseTransposition* sparse)
+{
+	//destroy calls accept null handles, so a partially created structure can be deleted too
+	deleteApp(vkGPU, &sparse->histogram);
+	for (uint32_t pass = 0; pass < 3; pass++) deleteApp(vkGPU, &sparse->scan[pass]);
+	deleteApp(vkGPU, &sparse->scatter);
+	for (uint32_t i = 0; i < 2; i++) deleteApp(vkGPU, &sparse->sort[i]);
+	deleteApp(vkGPU, &sparse->gather);
+	for (uint32_t i = 0; i < VKT_SPARSE_BUFFERS; i++) {
+		vkDestroyBuffer(vkGPU->device, sparse->buffer[i], NULL);
+		vkFreeMemory(vkGPU->device, sparse->bufferDeviceMemory[i], NULL);
+	}
+}
+
+
+int
+compare_Uint64(const void* a, const void* b)
+{
+	uint64_t x = *(const uint64_t*) a;
+	uint64_t y = *(const uint64_t*) b;
+	return (x > y) - (x < y);
+}
+
+
+VkResult
+Example_VulkanSparseTransposition(uint32_t deviceID,
+                                  uint32_t size,
+                                  uint32_t nnzPerRow,
+                                  uint32_t valueSize)
+{
+	//CSR -> CSC conversion of a size x size random sparse matrix, unordered and stable, verified against the CPU reference
+	VkGPU vkGPU = { 0 };
+	vkGPU.device_id = deviceID;
+	VkResult res = VK_SUCCESS;
+	res = create_VkGPU(&vkGPU);
+	if (res != VK_SUCCESS) return res;
+
+	//random columns with an average of nnzPerRow nonzeros per row. Column 0 is dense, so the sort also sees one long column
+	uint32_t rows = size, cols = size;
+	uint32_t step = (nnzPerRow > 1) ? 2 * cols / nnzPerRow : cols;
+	if (step < 1) step = 1;
+	uint32_t* rowPtr = (uint32_t*) malloc(sizeof(uint32_t) * ((uint64_t) rows + 1));
+	uint64_t capacity = (uint64_t) rows * (2 * (uint64_t) nnzPerRow + 1) + 1024;
+	uint32_t* colIdx = (uint32_t*) malloc(sizeof(uint32_t) * capacity);
+	uint32_t seed = 0x12345678;
+	uint64_t nnz = 0;
+	rowPtr[0] = 0;
+	for (uint32_t r = 0; r < rows; r++) {
+		for (uint64_t c = 0; c < cols && nnz < capacity; ) {
+			colIdx[nnz++] = (uint32_t) c;
+			seed ^= seed << 13;
+			seed ^= seed >> 17;
+			seed ^= seed << 5;
+			c += 1 + seed % step;
+		}
+		rowPtr[r + 1] = (uint32_t) nnz;
+	}
+	if (nnz > 0x7FFFFFFF / (valueSize / 4 + 1) || (valueSize != 4 && valueSize != 8)) {
+		printf("Unsupported sparse matrix: %dx%d, %llu nonzeros, %d-byte values\n", rows, cols, (unsigned long long) nnz, valueSize);
+		free(rowPtr);
+		free(colIdx);
+		delete_VkGPU(&vkGPU);
+		return VK_ERROR_FORMAT_NOT_SUPPORTED;
+	}
+	uint8_t* values = (uint8_t*) malloc(nnz * valueSize);
+	for (uint64_t k = 0; k < nnz; k++) {
+		if (valueSize == 8) {
+			double v = (double) k * 0.5 - 1.0;
+			memcpy(values + k * 8, &v, 8);
+		}
+		else {
+			float v = (float) k * 0.5f - 1.0f;
+			memcpy(values + k * 4, &v, 4);
+		}
+	}
+
+	uint32_t* colPtr_ref = (uint32_t*) malloc(sizeof(uint32_t) * ((uint64_t) cols + 1));
+	uint32_t* rowIdx_ref = (uint32_t*) malloc(sizeof(uint32_t) * (nnz + 1));
+	uint8_t* values_ref  = (uint8_t*) malloc(nnz * valueSize + 1);
+	double t = get_TimeMs();
+	transpose_Sparse_CPU(rows, cols, rowPtr, colIdx, values, valueSize, colPtr_ref, rowIdx_ref, values_ref);
+	double timeCPU = get_TimeMs() - t;
+	uint32_t maxColumnLength = 0;
+	for (uint32_t c = 0; c < cols; c++)
+		if (colPtr_ref[c + 1] - colPtr_ref[c] > maxColumnLength) maxColumnLength = colPtr_ref[c + 1] - colPtr_ref[c];
+
+	uint32_t* colPtr = (uint32_t*) malloc(sizeof(uint32_t) * ((uint64_t) cols + 1));
+	uint32_t* rowIdx = (uint32_t*) malloc(sizeof(uint32_t) * (nnz + 1));
+	uint8_t* valuesOut = (uint8_t*) malloc(nnz * valueSize + 1);
+	uint64_t* keys = (uint64_t*) malloc(sizeof(uint64_t) * (nnz + 1));
+	printf("Sparse matrix: %dx%d, %llu nonzeros, %d-byte values, longest column: %d\nCPU reference: %.3f ms (%.1f Mnnz/s)\n",
+	       rows, cols, (unsigned long long) nnz, valueSize, maxColumnLength, timeCPU, nnz / 1000.0 / timeCPU);
+
+	for (uint32_t sorted = 0; sorted < 2; sorted++) {
+		VkSparseTransposition sparse;
+		memset(&sparse, 0, sizeof(sparse));
+		sparse.rows            = rows;
+		sparse.cols            = cols;
+		sparse.nnz             = (uint32_t) nnz;
+		sparse.valueSize       = valueSize;
+		sparse.sorted          = sorted;
+		sparse.maxColumnLength = maxColumnLength;
+		res = create_SparseTransposition(&vkGPU, &sparse);
+		if (res != VK_SUCCESS) {
+			printf("Sparse transposition creation failed, error code: %d\n", res);
+			delete_SparseTransposition(&vkGPU, &sparse);
+			break;
+		}
+		res = upload_Data(vkGPU.physicalDevice, vkGPU.device, rowPtr, &vkGPU.physicalDeviceMemoryProperties, vkGPU.commandPool, vkGPU.queue, &vkGPU.fence,
+		                  &sparse.buffer[VKT_SPARSE_ROW_PTR], sparse.bufferSize[VKT_SPARSE_ROW_PTR]);
+		if (res == VK_SUCCESS)
+			res = upload_Data(vkGPU.physicalDevice, vkGPU.device, colIdx, &vkGPU.physicalDeviceMemoryProperties, vkGPU.commandPool, vkGPU.queue, &vkGPU.fence,
+			                  &sparse.buffer[VKT_SPARSE_COL_IDX], sparse.bufferSize[VKT_SPARSE_COL_IDX]);
+		if (res == VK_SUCCESS)
+			res = upload_Data(vkGPU.physicalDevice, vkGPU.device, values, &vkGPU.physicalDeviceMemoryProperties, vkGPU.commandPool, vkGPU.queue, &vkGPU.fence,
+			                  &sparse.buffer[VKT_SPARSE_VALUES], sparse.bufferSize[VKT_SPARSE_VALUES]);
+		double time = 0;
+		if (res == VK_SUCCESS) res = run_SparseTransposition(&vkGPU, &sparse, 10, &time);
+		if (res == VK_SUCCESS)
+			res = download_Data(vkGPU.physicalDevice, vkGPU.device, vkGPU.commandPool, &vkGPU.physicalDeviceMemoryProperties, vkGPU.queue, &vkGPU.fence,
+			                    colPtr, &sparse.buffer[VKT_SPARSE_COL_PTR], sparse.bufferSize[VKT_SPARSE_COL_PTR]);
+		if (res == VK_SUCCESS)
+			res = download_Data(vkGPU.physicalDevice, vkGPU.device, vkGPU.commandPool, &vkGPU.physicalDeviceMemoryProperties, vkGPU.queue, &vkGPU.fence,
+			                    rowIdx, &sparse.buffer[VKT_SPARSE_ROW_IDX], sparse.bufferSize[VKT_SPARSE_ROW_IDX]);
+		if (res == VK_SUCCESS)
+			res = download_Data(vkGPU.physicalDevice, vkGPU.device, vkGPU.commandPool, &vkGPU.physicalDeviceMemoryProperties, vkGPU.queue, &vkGPU.fence,
+			                    valuesOut, &sparse.buffer[VKT_SPARSE_VALUES_OUT], sparse.bufferSize[VKT_SPARSE_VALUES_OUT]);
+		delete_SparseTransposition(&vkGPU, &sparse);
+		if (res != VK_SUCCESS) {
+			printf("Sparse transposition run failed, error code: %d\n", res);
+			break;
+		}
+
+		uint32_t passed = (memcmp(colPtr, colPtr_ref, sizeof(uint32_t) * ((uint64_t) cols + 1)) == 0);
+		if (passed && !sorted) {
+			//the order inside a column is arbitrary: sort every column by row on the host before the comparison
+			for (uint64_t i = 0; i < nnz; i++) keys[i] = ((uint64_t) rowIdx[i] << 32) | i;
+			for (uint32_t c = 0; c < cols; c++) qsort(keys + colPtr[c], colPtr[c + 1] - colPtr[c], sizeof(uint64_t), compare_Uint64);
+			for (uint64_t i = 0; i < nnz && passed; i++) {
+				uint64_t src = keys[i] & 0xFFFFFFFF;
+				passed = ((keys[i] >> 32) == rowIdx_ref[i]) && (memcmp(valuesOut + src * valueSize, values_ref + i * valueSize, valueSize) == 0);
+			}
+		}
+		else if (passed) {
+			passed = (memcmp(rowIdx, rowIdx_ref, sizeof(uint32_t) * nnz) == 0) && (memcmp(valuesOut, values_ref, nnz * valueSize) == 0);
+		}
+		printf("%s: %.3f ms (%.1f Mnnz/s), %s\n", sorted ? "Stable (segmented merge sort)" : "Unordered", time, nnz / 1000.0 / time,
+		       passed ? "bit-exact with the CPU reference" : "verification FAILED");
+		if (!passed) res = VK_ERROR_FORMAT_NOT_SUPPORTED;
+	}
+
+	free(rowPtr);
+	free(colIdx);
+	free(values);
+	free(colPtr_ref);
+	free(rowIdx_ref);
+	free(values_ref);
+	free(colPtr);
+	free(rowIdx);
+	free(valuesOut);
+	free(keys);
+	delete_VkGPU(&vkGPU);
+	return res;
+}
@@ -0,0 +1,550 @@
+#include "VulkanTransposition.h"
+
+
+//Host staging: persistent staging memory allocated from hugepages on the NUMA node of the device and imported with
+//VK_EXT_external_memory_host, so the device reads and writes it directly. Host copies into and out of the staging are
+//split over a pool of threads pinned to that node and use non-temporal stores, which do not pull the destination into
+//the caches. Without the extension the staging is mapped host visible device memory and only the copies are parallel
+#define VKT_HUGEPAGE_SIZE         (2 * 1024 * 1024)
+
+int32_t
+get_DeviceNumaNode(VkGPU* vkGPU)
+{
+	//NUMA node of the PCI slot of the device, -1 if unknown
+	int32_t node = -1;
+#ifdef __linux__
+	if (vkGPU->pciBusInfoSupported) {
+		char path[256];
+		sprintf(path, "/sys/bus/pci/devices/%04x:%02x:%02x.%x/numa_node", vkGPU->physicalDevicePCIBusInfo.pciDomain, vkGPU->physicalDevicePCIBusInfo.pciBus,
+		        vkGPU->physicalDevicePCIBusInfo.pciDevice, vkGPU->physicalDevicePCIBusInfo.pciFunction);
+		FILE* fp = fopen(path, "r");
+		if (fp != NULL) {
+			if (fscanf(fp, "%d", &node) != 1) node = -1;
+			fclose(fp);
+		}
+	}
+#endif
+	return node;
+}
+
+
+void*
+allocate_HostMemory(size_t size, int32_t numaNode, uint32_t* hugepages)
+{
+	//page aligned host memory, rounded up to whole hugepages. hugepages: 2 - hugetlbfs pages, 1 - transparent hugepages
+	//advised, 0 - regular pages. Pages are placed on numaNode (if >= 0) when they are first touched
+	void* data = NULL;
+	hugepages[0] = 0;
+#ifdef _WIN32
+	data = _aligned_malloc(size, 4096);
+#else
+	size = (size + VKT_HUGEPAGE_SIZE - 1) / VKT_HUGEPAGE_SIZE * VKT_HUGEPAGE_SIZE;
+#ifdef MAP_HUGETLB
+	data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if (data != MAP_FAILED) hugepages[0] = 2;
+	else
+#endif
+	data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (data == MAP_FAILED) return NULL;
+#ifdef MADV_HUGEPAGE
+	if (hugepages[0] == 0 && madvise(data, size, MADV_HUGEPAGE) == 0) hugepages[0] = 1;
+#endif
+#if defined(__linux__) && defined(SYS_mbind)
+	if (numaNode >= 0 && numaNode < 64) {
+		//MPOL_PREFERRED, so the allocation still succeeds if the node is full
+		unsigned long nodeMask = 1ul << numaNode;
+		syscall(SYS_mbind, data, size, 1, &nodeMask, (unsigned long) (sizeof(nodeMask) * 8), 0);
+	}
+#endif
+#endif
+	return data;
+}
+
+
+void
+free_HostMemory(void* data, size_t size)
+{
+#ifdef _WIN32
+	_aligned_free(data);
+#else
+	size = (size + VKT_HUGEPAGE_SIZE - 1) / VKT_HUGEPAGE_SIZE * VKT_HUGEPAGE_SIZE;
+	if (data != NULL) munmap(data, size);
+#endif
+}
+
+
+void
+copy_NonTemporal(void* dst, const void* src, size_t size)
+{
+	//memcpy with streaming stores for the 16 byte aligned part of the destination
+#ifdef VKT_SSE2
+	uint8_t* d = (uint8_t*) dst;
+	const uint8_t* s = (const uint8_t*) src;
+	size_t head = (16 - ((uintptr_t) d & 15)) & 15;
+	if (head > size) head = size;
+	memcpy(d, s, head);
+	d += head;
+	s += head;
+	size -= head;
+	size_t blocks = size / 64;
+	for (size_t i = 0; i < blocks; i++) {
+		__m128i a = _mm_loadu_si128((const __m128i*) (s + 0));
+		__m128i b = _mm_loadu_si128((const __m128i*) (s + 16));
+		__m128i c = _mm_loadu_si128((const __m128i*) (s + 32));
+		__m128i e = _mm_loadu_si128((const __m128i*) (s + 48));
+		_mm_stream_si128((__m128i*) (d + 0), a);
+		_mm_stream_si128((__m128i*) (d + 16), b);
+		_mm_stream_si128((__m128i*) (d + 32), c);
+		_mm_stream_si128((__m128i*) (d + 48), e);
+		d += 64;
+		s += 64;
+	}
+	memcpy(d, s, size - blocks * 64);
+	//streaming stores are weakly ordered, make them visible before the device reads the memory
+	_mm_sfence();
+#else
+	memcpy(dst, src, size);
+#endif
+}
+
+
+#ifndef _WIN32
+void*
+run_CopyPoolWorker(void* arg)
+{
+	VkCopyPoolWorker* worker = (VkCopyPoolWorker*) arg;
+	VkCopyPool* pool = (VkCopyPool*) worker->pool;
+	uint64_t generation = 0;
+	pthread_mutex_lock(&pool->mutex);
+	while (1) {
+		while (!pool->stop && pool->generation == generation) pthread_cond_wait(&pool->start, &pool->mutex);
+		if (pool->stop) break;
+		generation = pool->generation;
+		VkCopyPoolTask task = pool->task;
+		void* taskArg = pool->arg;
+		pthread_mutex_unlock(&pool->mutex);
+		task(taskArg, worker->index, pool->threads);
+		pthread_mutex_lock(&pool->mutex);
+		if (--pool->pending == 0) pthread_cond_signal(&pool->done);
+	}
+	pthread_mutex_unlock(&pool->mutex);
+	return NULL;
+}
+#endif
+
+
+void
+pin_CopyPoolWorker(VkCopyPool* pool, uint32_t index)
+{
+	//pin worker index to the index-th CPU of the NUMA node
+#ifdef __linux__
+	if (pool->numaNode < 0) return;
+	char path[256];
+	sprintf(path, "/sys/devices/system/node/node%d/cpulist", pool->numaNode);
+	FILE* fp = fopen(path, "r");
+	if (fp == NULL) return;
+	//cpulist is a comma separated list of ranges, like 0-15,32-47
+	uint32_t cpus[1024];
+	uint32_t cpuCount = 0;
+	int first, last;
+	while (fscanf(fp, "%d", &first) == 1) {
+		last = first;
+		int c = fgetc(fp);
+		if (c == '-') {
+			if (fscanf(fp, "%d", &last) != 1) break;
+			c = fgetc(fp);
+		}
+		for (int cpu = first; cpu <= last && cpuCount < 1024; cpu++) cpus[cpuCount++] = cpu;
+		if (c != ',') break;
+	}
+	fclose(fp);
+	if (cpuCount == 0) return;
+	cpu_set_t cpuSet;
+	CPU_ZERO(&cpuSet);
+	CPU_SET(cpus[index % cpuCount], &cpuSet);
+	if (pthread_setaffinity_np(pool->thread[index], sizeof(cpu_set_t), &cpuSet) == 0) pool->pinned++;
+#endif
+}
+
+
+VkResult
+create_CopyPool(VkCopyPool* pool, uint32_t threads, int32_t numaNode)
+{
+	memset(pool, 0, sizeof(VkCopyPool));
+	if (threads == 0) threads = 1;
+	if (threads > VKT_COPY_POOL_MAX_THREADS) threads = VKT_COPY_POOL_MAX_THREADS;
+	pool->numaNode = numaNode;
+#ifdef _WIN32
+	//tasks run on the calling thread
+	pool->threads = 1;
+#else
+	pool->threads = threads;
+	pthread_mutex_init(&pool->mutex, NULL);
+	pthread_cond_init(&pool->start, NULL);
+	pthread_cond_init(&pool->done, NULL);
+	for (uint32_t i = 0; i < threads; i++) {
+		pool->worker[i].pool = pool;
+		pool->worker[i].index = i;
+		if (pthread_create(&pool->thread[i], NULL, run_CopyPoolWorker, &pool->worker[i]) != 0) {
+			pool->threads = i;
+			break;
+		}
+		pool->started++;
+		pin_CopyPoolWorker(pool, i);
+	}
+	if (pool->threads == 0) return VK_ERROR_INITIALIZATION_FAILED;
+#endif
+	return VK_SUCCESS;
+}
+
+
+void
+run_CopyPool(VkCopyPool* pool, VkCopyPoolTask task, void* arg)
+{
+	//run the task on every worker and wait for all of them
+#ifdef _WIN32
+	task(arg, 0, 1);
+#else
+	pthread_mutex_lock(&pool->mutex);
+	pool->task = task;
+	pool->arg = arg;
+	pool->pending = pool->threads;
+	pool->generation++;
+	pthread_cond_broadcast(&pool->start);
+	while (pool->pending > 0) pthread_cond_wait(&pool->done, &pool->mutex);
+	pthread_mutex_unlock(&pool->mutex);
+#endif
+}
+
+
+void
+delete_CopyPool(VkCopyPool* pool)
+{
+#ifndef _WIN32
+	pthread_mutex_lock(&pool->mutex);
+	pool->stop = 1;
+	pthread_cond_broadcast(&pool->start);
+	pthread_mutex_unlock(&pool->mutex);
+	for (uint32_t i = 0; i < pool->started; i++) pthread_join(pool->thread[i], NULL);
+	pthread_cond_destroy(&pool->done);
+	pthread_cond_destroy(&pool->start);
+	pthread_mutex_destroy(&pool->mutex);
+#endif
+}
+
+
+typedef struct {
+	void* dst;
+	const void* src;
+	size_t size;
+	uint32_t nonTemporal;
+} VkCopyPoolCopy;
+
+
+void
+run_CopyPoolCopy(void* arg, uint32_t worker, uint32_t workers)
+{
+	//worker copies its slice, slices start at 4 KB boundaries
+	VkCopyPoolCopy* copy = (VkCopyPoolCopy*) arg;
+	size_t pages = (copy->size + 4095) / 4096;
+	size_t begin = pages * worker / workers * 4096;
+	size_t end = pages * (worker + 1) / workers * 4096;
+	if (end > copy->size) end = copy->size;
+	if (begin >= end) return;
+	if (copy->nonTemporal) copy_NonTemporal((uint8_t*) copy->dst + begin, (const uint8_t*) copy->src + begin, end - begin);
+	else memcpy((uint8_t*) copy->dst + begin, (const uint8_t*) copy->src + begin, end - begin);
+}
+
+
+void
+copy_CopyPool(VkCopyPool* pool, void* dst, const void* src, size_t size, uint32_t nonTemporal)
+{
+	VkCopyPoolCopy copy = { dst, src, size, nonTemporal };
+	run_CopyPool(pool, run_CopyPoolCopy, &copy);
+}
+
+
+VkResult
+import_HostStaging(VkGPU* vkGPU, VkHostStaging* staging)
+{
+	//import staging->data as the memory of staging->buffer
+	PFN_vkGetMemoryHostPointerPropertiesEXT getMemoryHostPointerProperties =
+		(PFN_vkGetMemoryHostPointerPropertiesEXT) vkGetDeviceProcAddr(vkGPU->device, "vkGetMemoryHostPointerPropertiesEXT");
+	if (getMemoryHostPointerProperties == NULL) return VK_ERROR_EXTENSION_NOT_PRESENT;
+	VkMemoryHostPointerPropertiesEXT hostPointerProperties = { VK_STRUCTURE_TYPE_MEMORY_HOST_POINTER_PROPERTIES_EXT };
+	VkResult res = getMemoryHostPointerProperties(vkGPU->device, VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT, staging->data, &hostPointerProperties);
+	if (res != VK_SUCCESS) return res;
+
+	VkExternalMemoryBufferCreateInfo externalMemoryBufferCreateInfo = { VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_BUFFER_CREATE_INFO,
+                                          (const void*) NULL,
+                                          (VkExternalMemoryHandleTypeFlags) VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT };
+	VkBufferCreateInfo bufferCreateInfo = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+                               (const void*) &externalMemoryBufferCreateInfo,
+                               (VkBufferCreateFlags) 0,
+                               (VkDeviceSize) staging->size,
+                               (VkBufferUsageFlags) (VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT),
+                               (VkSharingMode) VK_SHARING_MODE_EXCLUSIVE,
+                               (uint32_t) 0,
+                               (const uint32_t*) NULL };
+	res = vkCreateBuffer(vkGPU->device, &bufferCreateInfo, NULL, &staging->buffer);
+	if (res != VK_SUCCESS) return res;
+	VkMemoryRequirements memoryRequirements = { 0 };
+	vkGetBufferMemoryRequirements(vkGPU->device, staging->buffer, &memoryRequirements);
+	//prefer coherent memory types, so downloads need no invalidation
+	uint32_t memoryTypeBits = memoryRequirements.memoryTypeBits & hostPointerProperties.memoryTypeBits;
+	uint32_t memoryTypeIndex = 0xFFFFFFFF;
+	for (uint32_t i = 0; i < vkGPU->physicalDeviceMemoryProperties.memoryTypeCount; i++) {
+		if ((memoryTypeBits & (1 << i)) == 0) continue;
+		if (memoryTypeIndex == 0xFFFFFFFF || (vkGPU->physicalDeviceMemoryProperties.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) memoryTypeIndex = i;
+		if (vkGPU->physicalDeviceMemoryProperties.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) break;
+	}
+	if (memoryTypeIndex == 0xFFFFFFFF) return VK_ERROR_FORMAT_NOT_SUPPORTED;
+	VkImportMemoryHostPointerInfoEXT importMemoryHostPointerInfo = { VK_STRUCTURE_TYPE_IMPORT_MEMORY_HOST_POINTER_INFO_EXT,
+                                          (const void*) NULL,
+                                          (VkExternalMemoryHandleTypeFlagBits) VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT,
+                                          (void*) staging->data };
+	VkMemoryAllocateInfo memoryAllocateInfo = { VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+                                 (const void*) &importMemoryHostPointerInfo,
+                                 (VkDeviceSize) staging->size,
+                                 (uint32_t) memoryTypeIndex };
+	res = vkAllocateMemory(vkGPU->device, &memoryAllocateInfo, NULL, &staging->memory);
+	if (res != VK_SUCCESS) return res;
+	return vkBindBufferMemory(vkGPU->device, staging->buffer, staging->memory, 0);
+}
+
+
+VkResult
+create_HostStaging(VkGPU* vkGPU, VkDeviceSize size, VkHostStaging* staging)
+{
+	//hugepage staging on the node of the device if it can be imported, persistently mapped host visible memory otherwise
+	memset(staging, 0, sizeof(VkHostStaging));
+	staging->numaNode = get_DeviceNumaNode(vkGPU);
+	VkResult res = VK_ERROR_EXTENSION_NOT_PRESENT;
+	if (vkGPU->externalMemoryHostSupported) {
+		//imported memory is a multiple of the import alignment, which hugepages satisfy
+		VkDeviceSize alignment = vkGPU->physicalDeviceExternalMemoryHostProperties.minImportedHostPointerAlignment;
+		if (alignment < VKT_HUGEPAGE_SIZE) alignment = VKT_HUGEPAGE_SIZE;
+		staging->size = (size + alignment - 1) / alignment * alignment;
+		staging->data = allocate_HostMemory((size_t) staging->size, staging->numaNode, &staging->hugepages);
+		if (staging->data != NULL) {
+			//first touch places the pages
+			memset(staging->data, 0, (size_t) staging->size);
+			res = import_HostStaging(vkGPU, staging);
+			if (res == VK_SUCCESS) staging->imported = 1;
+		}
+		if (res != VK_SUCCESS) {
+			vkDestroyBuffer(vkGPU->device, staging->buffer, NULL);
+			vkFreeMemory(vkGPU->device, staging->memory, NULL);
+			free_HostMemory(staging->data, (size_t) staging->size);
+			staging->buffer = VK_NULL_HANDLE;
+			staging->memory = VK_NULL_HANDLE;
+			staging->data = NULL;
+			staging->hugepages = 0;
+		}
+	}
+	if (!staging->imported) {
+		staging->size = size;
+		res = allocate_Buffer_DeviceMemory(vkGPU->physicalDevice, vkGPU->device, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		                                   &vkGPU->physicalDeviceMemoryProperties, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		                                   size, &staging->buffer, &staging->memory);
+		if (res != VK_SUCCESS) return res;
+		res = vkMapMemory(vkGPU->device, staging->memory, 0, size, 0, &staging->data);
+	}
+	return res;
+}
+
+
+VkResult
+transfer_HostStaging(VkGPU* vkGPU, VkHostStaging* staging, VkBuffer* deviceBuffer, VkDeviceSize size, uint32_t download, double* time)
+{
+	//copy between the staging and the device buffer, time - ms of the transfer only
+	VkCommandBufferAllocateInfo commandBufferAllocateInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+                                        (const void*) NULL,
+                                        (VkCommandPool) vkGPU->commandPool,
+                                        (VkCommandBufferLevel) VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+                                        (uint32_t) 1 };
+	VkCommandBuffer commandBuffer = { 0 };
+	VkResult res = vkAllocateCommandBuffers(vkGPU->device, &commandBufferAllocateInfo, &commandBuffer);
+	if (res != VK_SUCCESS) return res;
+	VkCommandBufferBeginInfo commandBufferBeginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+                                     (const void*) NULL,
+                                     (VkCommandBufferUsageFlags) VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+                                     (const VkCommandBufferInheritanceInfo*) NULL };
+	res = vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo);
+	if (res != VK_SUCCESS) return res;
+	VkBufferCopy copyRegion = { 0, 0, size };
+	if (download) vkCmdCopyBuffer(commandBuffer, deviceBuffer[0], staging->buffer, 1, &copyRegion);
+	else vkCmdCopyBuffer(commandBuffer, staging->buffer, deviceBuffer[0], 1, &copyRegion);
+	//make the download visible to the host
+	VkMemoryBarrier memoryBarrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                                    (const void*) NULL,
+                                    (VkAccessFlags) VK_ACCESS_TRANSFER_WRITE_BIT,
+                                    (VkAccessFlags) VK_ACCESS_HOST_READ_BIT };
+	if (download) vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &memoryBarrier, 0, NULL, 0, NULL);
+	res = vkEndCommandBuffer(commandBuffer);
+	if (res != VK_SUCCESS) return res;
+	VkSubmitInfo submitInfo = { VK_STRUCTURE_TYPE_SUBMIT_INFO,
+                         (const void*) NULL,
+                         (uint32_t) 0,
+                         (const VkSemaphore*) NULL,
+                         (const VkPipelineStageFlags*) NULL,
+                         (uint32_t) 1,
+                         (const VkCommandBuffer*) &commandBuffer,
+                         (uint32_t) 0,
+                         (const VkSemaphore*) NULL };
+	double t = get_TimeMs();
+	res = vkQueueSubmit(vkGPU->queue, 1, &submitInfo, vkGPU->fence);
+	if (res != VK_SUCCESS) return res;
+	res = vkWaitForFences(vkGPU->device, 1, &vkGPU->fence, VK_TRUE, 100000000000);
+	if (res != VK_SUCCESS) return res;
+	time[0] = get_TimeMs() - t;
+	res = vkResetFences(vkGPU->device, 1, &vkGPU->fence);
+	vkFreeCommandBuffers(vkGPU->device, vkGPU->commandPool, 1, &commandBuffer);
+	return res;
+}
+
+
+void
+delete_HostStaging(VkGPU* vkGPU, VkHostStaging* staging)
+{
+	if (!staging->imported && staging->memory != VK_NULL_HANDLE) vkUnmapMemory(vkGPU->device, staging->memory);
+	vkDestroyBuffer(vkGPU->device, staging->buffer, NULL);
+	vkFreeMemory(vkGPU->device, staging->memory, NULL);
+	if (staging->imported) free_HostMemory(staging->data, (size_t) staging->size);
+}
+
+
+typedef struct {
+	uint32_t* data;
+	size_t count;
+} VkCopyPoolFill;
+
+
+void
+run_CopyPoolFill(void* arg, uint32_t worker, uint32_t workers)
+{
+	//index pattern, filled in parallel so the pages of the slices are touched by their workers
+	VkCopyPoolFill* fill = (VkCopyPoolFill*) arg;
+	size_t begin = fill->count * worker / workers;
+	size_t end = fill->count * (worker + 1) / workers;
+	for (size_t i = begin; i < end; i++) fill->data[i] = (uint32_t) (i * 2654435761u);
+}
+
+
+VkResult
+Example_VulkanStaging(uint32_t deviceID,
+                      uint32_t sizeMB,
+                      uint32_t threads)
+{
+	//upload and download of sizeMB through upload_Data/download_Data (staging allocated per call, one memcpy), through
+	//persistent staging with one memcpy and through persistent staging with the pinned pool and non-temporal stores.
+	//Host copy and transfer are timed separately, best of 5 runs
+	VkGPU vkGPU = { 0 };
+	vkGPU.device_id = deviceID;
+	VkResult res = create_VkGPU(&vkGPU);
+	if (res != VK_SUCCESS) return res;
+	VkDeviceSize size = (VkDeviceSize) sizeMB << 20;
+
+	VkHostStaging staging;
+	VkCopyPool pool;
+	VkBuffer buffer = { 0 };
+	VkDeviceMemory bufferDeviceMemory = { 0 };
+	res = create_HostStaging(&vkGPU, size, &staging);
+	if (res != VK_SUCCESS) {
+		printf("Staging creation failed, error code: %d\n", res);
+		delete_VkGPU(&vkGPU);
+		return res;
+	}
+	res = create_CopyPool(&pool, threads, staging.numaNode);
+	if (res != VK_SUCCESS) {
+		printf("Copy pool creation failed, error code: %d\n", res);
+		delete_HostStaging(&vkGPU, &staging);
+		delete_VkGPU(&vkGPU);
+		return res;
+	}
+	res = allocate_Buffer_DeviceMemory(vkGPU.physicalDevice, vkGPU.device, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+	                                   &vkGPU.physicalDeviceMemoryProperties, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, size, &buffer, &bufferDeviceMemory);
+	static const char* hugepageNames[3] = { "regular pages", "transparent hugepages", "hugetlb pages" };
+	printf("Staging: %d MB, %s, %s, NUMA node %d\nCopy pool: %d threads, %d pinned\n", sizeMB,
+	       staging.imported ? "imported host memory" : "mapped device memory", staging.imported ? hugepageNames[staging.hugepages] : "driver pages",
+	       staging.numaNode, pool.threads, pool.pinned);
+
+	uint32_t* input  = (uint32_t*) malloc((size_t) size);
+	uint32_t* output = (uint32_t*) malloc((size_t) size);
+	VkCopyPoolFill fill = { input, (size_t) (size / sizeof(uint32_t)) };
+	double t = get_TimeMs();
+	run_CopyPool(&pool, run_CopyPoolFill, &fill);
+	double time_fill = get_TimeMs() - t;
+
+	//[path][0 - upload, 1 - download][0 - host copy, 1 - transfer]; path 0 has no separate host copy time
+	double best[3][2][2];
+	for (uint32_t path = 0; path < 3; path++) {
+		for (uint32_t d = 0; d < 2; d++) best[path][d][0] = best[path][d][1] = 1e30;
+	}
+	uint32_t passed = 1;
+	for (uint32_t run = 0; run < 5 && res == VK_SUCCESS; run++) {
+		for (uint32_t path = 0; path < 3 && res == VK_SUCCESS; path++) {
+			double time_copy[2] = { 0 }, time_transfer[2] = { 0 };
+			memset(output, 0, (size_t) size);
+			if (path == 0) {
+				t = get_TimeMs();
+				res = upload_Data(vkGPU.physicalDevice, vkGPU.device, input, &vkGPU.physicalDeviceMemoryProperties, vkGPU.commandPool, vkGPU.queue, &vkGPU.fence, &buffer, size);
+				time_transfer[0] = get_TimeMs() - t;
+				if (res != VK_SUCCESS) break;
+				t = get_TimeMs();
+				res = download_Data(vkGPU.physicalDevice, vkGPU.device, vkGPU.commandPool, &vkGPU.physicalDeviceMemoryProperties, vkGPU.queue, &vkGPU.fence, output, &buffer, size);
+				time_transfer[1] = get_TimeMs() - t;
+			}
+			else {
+				t = get_TimeMs();
+				if (path == 1) memcpy(staging.data, input, (size_t) size);
+				else copy_CopyPool(&pool, staging.data, input, (size_t) size, 1);
+				time_copy[0] = get_TimeMs() - t;
+				res = transfer_HostStaging(&vkGPU, &staging, &buffer, size, 0, &time_transfer[0]);
+				if (res != VK_SUCCESS) break;
+				memset(staging.data, 0, (size_t) size);
+				res = transfer_HostStaging(&vkGPU, &staging, &buffer, size, 1, &time_transfer[1]);
+				if (res != VK_SUCCESS) break;
+				t = get_TimeMs();
+				if (path == 1) memcpy(output, staging.data, (size_t) size);
+				else copy_CopyPool(&pool, output, staging.data, (size_t) size, 1);
+				time_copy[1] = get_TimeMs() - t;
+			}
+			passed = passed && (memcmp(input, output, (size_t) size) == 0);
+			for (uint32_t d = 0; d < 2; d++) {
+				if (time_copy[d] + time_transfer[d] < best[path][d][0] + best[path][d][1]) {
+					best[path][d][0] = time_copy[d];
+					best[path][d][1] = time_transfer[d];
+				}
+			}
+		}
+	}
+	if (res == VK_SUCCESS) {
+		static const char* pathNames[3] = { "upload_Data/download_Data", "staging, 1 thread memcpy", "staging, pool, non-temporal" };
+		double gb = size / 1024.0 / 1024.0 / 1024.0;
+		printf("Parallel fill of the input: %.2f GB/s\n\n", gb / time_fill * 1000);
+		printf("%-28s %27s %27s\n", "", "upload GB/s", "download GB/s");
+		printf("%-28s %9s %8s %8s %9s %8s %8s\n", "path", "host copy", "transfer", "total", "host copy", "transfer", "total");
+		for (uint32_t path = 0; path < 3; path++) {
+			printf("%-28s", pathNames[path]);
+			for (uint32_t d = 0; d < 2; d++) {
+				if (path == 0) printf(" %9s", "-");
+				else printf(" %9.2f", gb / best[path][d][0] * 1000);
+				printf(" %8.2f %8.2f", gb / best[path][d][1] * 1000, gb / (best[path][d][0] + best[path][d][1]) * 1000);
+			}
+			printf("\n");
+		}
+		printf("upload_Data/download_Data transfer includes the staging allocation and the copy\nVerification %s\n", passed ? "passed" : "FAILED");
+		if (!passed) res = VK_ERROR_FORMAT_NOT_SUPPORTED;
+	}
+	else printf("Staging run failed, error code: %d\n", res);
+
+	free(input);
+	free(output);
+	vkDestroyBuffer(vkGPU.device, buffer, NULL);
+	vkFreeMemory(vkGPU.device, bufferDeviceMemory, NULL);
+	delete_CopyPool(&pool);
+	delete_HostStaging(&vkGPU, &staging);
+	delete_VkGPU(&vkGPU);
+	return res;
+}
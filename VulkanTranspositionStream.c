@@ -0,0 +1,322 @@
+#include "VulkanTransposition.h"
+
+
+//Frame stream (corner turn): a ring of slots, each with its own staging and device buffers, a command buffer recorded once
+//and a fence. While the device transposes the frame of one slot, the host fills the staging buffer of the next slot and
+//reads the result of the previous one
+#define VKT_STREAM_MAX_SLOTS 16
+
+typedef struct {
+	VkApplication app;//transposition of inputBuffer into outputBuffer
+	VkBuffer inputBuffer;
+	VkDeviceMemory inputBufferDeviceMemory;
+	VkBuffer outputBuffer;
+	VkDeviceMemory outputBufferDeviceMemory;
+	VkBuffer stagingBuffer;//host-visible, input frame followed by output frame
+	VkDeviceMemory stagingBufferDeviceMemory;
+	void* stagingData;
+	VkCommandBuffer commandBuffer;//upload, transposition and download of one frame
+	VkFence fence;
+	uint64_t frame;    //frame in flight in this slot
+	double arrivalTime;//time the source produced the frame, ms
+} VkStreamSlot;
+
+typedef struct {
+	VkGPU* vkGPU;
+	uint32_t size;
+	VkDeviceSize frameSize;
+	uint32_t slotCount;
+	VkStreamSlot slot[VKT_STREAM_MAX_SLOTS];
+	uint32_t head;    //oldest slot in flight
+	uint32_t inFlight;
+	double deadline;  //end-to-end latency after which a frame is late, ms. 0 - no deadline
+	const float* source;//frame produced by the source, element 0 is replaced by the frame number
+	uint32_t verify;  //compare the next completed frame with the transposed source
+	uint64_t completed;
+	uint64_t dropped; //frames produced while all slots were in flight
+	uint64_t late;
+	uint64_t failed;
+	double* latency;  //end-to-end latency of every completed frame, ms
+} VkFrameStream;
+
+
+VkResult
+record_StreamSlot(VkFrameStream* stream, VkStreamSlot* slot)
+{
+	//the command buffer is submitted once per frame of this slot, so it is recorded without the one time submit flag
+	VkGPU* vkGPU = stream->vkGPU;
+	VkCommandBufferAllocateInfo commandBufferAllocateInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+                                        (const void*) NULL,
+                                        (VkCommandPool) vkGPU->commandPool,
+                                        (VkCommandBufferLevel) VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+                                        (uint32_t) 1 };
+	VkResult res = vkAllocateCommandBuffers(vkGPU->device, &commandBufferAllocateInfo, &slot->commandBuffer);
+	if (res != VK_SUCCESS) return res;
+	VkCommandBufferBeginInfo commandBufferBeginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+                                     (const void*) NULL,
+                                     (VkCommandBufferUsageFlags) 0,
+                                     (const VkCommandBufferInheritanceInfo*) NULL };
+	res = vkBeginCommandBuffer(slot->commandBuffer, &commandBufferBeginInfo);
+	if (res != VK_SUCCESS) return res;
+
+	VkBufferCopy copyRegion = { 0, 0, stream->frameSize };
+	vkCmdCopyBuffer(slot->commandBuffer, slot->stagingBuffer, slot->inputBuffer, 1, &copyRegion);
+	VkMemoryBarrier memoryBarrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                                    (const void*) NULL,
+                                    (VkAccessFlags) VK_ACCESS_TRANSFER_WRITE_BIT,
+                                    (VkAccessFlags) VK_ACCESS_SHADER_READ_BIT };
+	vkCmdPipelineBarrier(slot->commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &memoryBarrier, 0, NULL, 0, NULL);
+
+	uint32_t groupCount[3] = { stream->size / slot->app.specializationConstants.localSize[0], stream->size / slot->app.specializationConstants.localSize[1], 1 };
+	vkCmdPushConstants(slot->commandBuffer, slot->app.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(VkAppPushConstantsLayout), &slot->app.pushConstants);
+	vkCmdBindPipeline(slot->commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, slot->app.pipeline);
+	vkCmdBindDescriptorSets(slot->commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, slot->app.pipelineLayout, 0, 1, &slot->app.descriptorSet, 0, NULL);
+	vkCmdDispatch(slot->commandBuffer, groupCount[0], groupCount[1], groupCount[2]);
+
+	memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	memoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	vkCmdPipelineBarrier(slot->commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &memoryBarrier, 0, NULL, 0, NULL);
+	copyRegion.dstOffset = stream->frameSize;
+	vkCmdCopyBuffer(slot->commandBuffer, slot->outputBuffer, slot->stagingBuffer, 1, &copyRegion);
+	//make the staging buffer visible to the host
+	memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	memoryBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	vkCmdPipelineBarrier(slot->commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &memoryBarrier, 0, NULL, 0, NULL);
+	return vkEndCommandBuffer(slot->commandBuffer);
+}
+
+
+VkResult
+create_FrameStream(VkGPU* vkGPU,
+                   uint32_t coalescedMemory,
+                   uint32_t size,
+                   uint32_t slotCount,
+                   uint64_t maxFrames,
+                   VkFrameStream* stream)
+{
+	VkResult res = VK_SUCCESS;
+	memset(stream, 0, sizeof(VkFrameStream));
+	stream->vkGPU = vkGPU;
+	stream->size = size;
+	stream->frameSize = sizeof(float) * (VkDeviceSize) size * size;
+	stream->slotCount = slotCount;
+	stream->latency = (double*) malloc(sizeof(double) * (maxFrames + 1));
+	if (stream->latency == NULL) return VK_ERROR_OUT_OF_HOST_MEMORY;
+	char shaderPath[256];
+	sprintf(shaderPath, "%stransposition_no_bank_conflicts.spv", SHADER_DIR);
+
+	for (uint32_t i = 0; i < slotCount; i++) {
+		VkStreamSlot* slot = &stream->slot[i];
+		res = allocate_Buffer_DeviceMemory(vkGPU->physicalDevice, vkGPU->device,
+                                                   VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                   &vkGPU->physicalDeviceMemoryProperties, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                                   stream->frameSize, &slot->inputBuffer, &slot->inputBufferDeviceMemory);
+		if (res != VK_SUCCESS) return res;
+		res = allocate_Buffer_DeviceMemory(vkGPU->physicalDevice, vkGPU->device,
+                                                   VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                                   &vkGPU->physicalDeviceMemoryProperties, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                                   stream->frameSize, &slot->outputBuffer, &slot->outputBufferDeviceMemory);
+		if (res != VK_SUCCESS) return res;
+		res = allocate_Buffer_DeviceMemory(vkGPU->physicalDevice, vkGPU->device,
+                                                   VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                   &vkGPU->physicalDeviceMemoryProperties, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                                   2 * stream->frameSize, &slot->stagingBuffer, &slot->stagingBufferDeviceMemory);
+		if (res != VK_SUCCESS) return res;
+		//staging memory stays mapped for the lifetime of the stream
+		res = vkMapMemory(vkGPU->device, slot->stagingBufferDeviceMemory, 0, 2 * stream->frameSize, 0, &slot->stagingData);
+		if (res != VK_SUCCESS) return res;
+
+		VkBuffer*    buffer[2]      = { &slot->inputBuffer, &slot->outputBuffer };
+		VkDeviceSize bufferSizes[2] = { stream->frameSize, stream->frameSize };
+		slot->app.size[0] = size;
+		slot->app.size[1] = size;
+		slot->app.size[2] = 1;
+		slot->app.coalescedMemory = coalescedMemory;
+		res = create_App(vkGPU->device, &slot->app.specializationConstants, coalescedMemory, buffer, bufferSizes, slot->app.size,
+		                 &slot->app.descriptorPool, &slot->app.descriptorSetLayout, &slot->app.descriptorSet,
+		                 (const char*) shaderPath, &slot->app.pipelineLayout, &slot->app.pipeline);
+		if (res != VK_SUCCESS) return res;
+		res = record_StreamSlot(stream, slot);
+		if (res != VK_SUCCESS) return res;
+		VkFenceCreateInfo fenceCreateInfo = { VK_STRUCTURE_TYPE_FENCE_CREATE_INFO, (const void*) NULL, (VkFenceCreateFlags) 0 };
+		res = vkCreateFence(vkGPU->device, &fenceCreateInfo, NULL, &slot->fence);
+		if (res != VK_SUCCESS) return res;
+	}
+	return res;
+}
+
+
+VkResult
+retire_StreamSlot(VkFrameStream* stream, uint32_t wait)
+{
+	//complete the oldest frame in flight. Returns VK_NOT_READY if wait is 0 and the device has not finished it yet
+	VkGPU* vkGPU = stream->vkGPU;
+	VkStreamSlot* slot = &stream->slot[stream->head];
+	VkResult res = wait ? vkWaitForFences(vkGPU->device, 1, &slot->fence, VK_TRUE, 100000000000) : vkGetFenceStatus(vkGPU->device, slot->fence);
+	if (res != VK_SUCCESS) return res;
+	res = vkResetFences(vkGPU->device, 1, &slot->fence);
+	if (res != VK_SUCCESS) return res;
+
+	//frame number travels in element 0, which stays in place after the transposition
+	const float* output = (const float*) ((char*) slot->stagingData + stream->frameSize);
+	uint32_t passed = (output[0] == (float) slot->frame);
+	if (passed && stream->verify) {
+		for (uint64_t j = 0; j < stream->size && passed; j++) {
+			for (uint64_t i = (j == 0); i < stream->size && passed; i++) {
+				passed = (output[i + j * stream->size] == stream->source[j + i * stream->size]);
+			}
+		}
+		stream->verify = 0;
+	}
+	double latency = get_TimeMs() - slot->arrivalTime;
+	if (!passed) stream->failed++;
+	if (stream->deadline > 0 && latency > stream->deadline) stream->late++;
+	stream->latency[stream->completed++] = latency;
+	stream->head = (stream->head + 1) % stream->slotCount;
+	stream->inFlight--;
+	return VK_SUCCESS;
+}
+
+
+VkResult
+run_FrameStream(VkFrameStream* stream, uint64_t frames, double period)
+{
+	//the source produces a frame every period ms (0 - as fast as the stream accepts them). A frame that finds every slot
+	//in flight is dropped, as a real-time source cannot wait
+	VkGPU* vkGPU = stream->vkGPU;
+	VkResult res = VK_SUCCESS;
+	double start = get_TimeMs();
+	for (uint64_t frame = 0; frame < frames; frame++) {
+		double arrivalTime = start + frame * period;
+		while (get_TimeMs() < arrivalTime) {
+			//retire finished frames while waiting for the next one
+			if (stream->inFlight > 0) {
+				res = retire_StreamSlot(stream, 0);
+				if (res != VK_SUCCESS && res != VK_NOT_READY) return res;
+			}
+		}
+		if (period == 0) arrivalTime = get_TimeMs();
+		while (stream->inFlight > 0) {
+			res = retire_StreamSlot(stream, (period == 0) && (stream->inFlight == stream->slotCount));
+			if (res == VK_NOT_READY) break;
+			if (res != VK_SUCCESS) return res;
+		}
+		if (stream->inFlight == stream->slotCount) {
+			stream->dropped++;
+			continue;
+		}
+
+		VkStreamSlot* slot = &stream->slot[(stream->head + stream->inFlight) % stream->slotCount];
+		memcpy(slot->stagingData, stream->source, stream->frameSize);
+		((float*) slot->stagingData)[0] = (float) frame;
+		slot->frame = frame;
+		slot->arrivalTime = arrivalTime;
+		VkSubmitInfo submitInfo = { VK_STRUCTURE_TYPE_SUBMIT_INFO,
+                                 (const void*) NULL,
+                                 (uint32_t) 0,
+                                 (const VkSemaphore*) NULL,
+                                 (const VkPipelineStageFlags*) NULL,
+                                 (uint32_t) 1,
+                                 (const VkCommandBuffer*) &slot->commandBuffer,
+                                 (uint32_t) 0,
+                                 (const VkSemaphore*) NULL };
+		res = vkQueueSubmit(vkGPU->queue, 1, &submitInfo, slot->fence);
+		if (res != VK_SUCCESS) return res;
+		stream->inFlight++;
+	}
+	while (stream->inFlight > 0) {
+		res = retire_StreamSlot(stream, 1);
+		if (res != VK_SUCCESS) return res;
+	}
+	return res;
+}
+
+
+void
+delete_FrameStream(VkFrameStream* stream)
+{
+	VkGPU* vkGPU = stream->vkGPU;
+	for (uint32_t i = 0; i < stream->slotCount; i++) {
+		VkStreamSlot* slot = &stream->slot[i];
+		if (slot->fence != VK_NULL_HANDLE) vkDestroyFence(vkGPU->device, slot->fence, NULL);
+		if (slot->commandBuffer != VK_NULL_HANDLE) vkFreeCommandBuffers(vkGPU->device, vkGPU->commandPool, 1, &slot->commandBuffer);
+		if (slot->app.pipeline != VK_NULL_HANDLE) deleteApp(vkGPU, &slot->app);
+		if (slot->stagingData != NULL) vkUnmapMemory(vkGPU->device, slot->stagingBufferDeviceMemory);
+		vkDestroyBuffer(vkGPU->device, slot->stagingBuffer, NULL);
+		vkFreeMemory(vkGPU->device, slot->stagingBufferDeviceMemory, NULL);
+		vkDestroyBuffer(vkGPU->device, slot->inputBuffer, NULL);
+		vkFreeMemory(vkGPU->device, slot->inputBufferDeviceMemory, NULL);
+		vkDestroyBuffer(vkGPU->device, slot->outputBuffer, NULL);
+		vkFreeMemory(vkGPU->device, slot->outputBufferDeviceMemory, NULL);
+	}
+	free(stream->latency);
+	memset(stream, 0, sizeof(VkFrameStream));
+}
+
+
+VkResult
+Example_VulkanStream(uint32_t deviceID,
+                     uint32_t coalescedMemory,
+                     uint32_t size,
+                     uint32_t slotCount,
+                     uint32_t frames,
+                     double period,
+                     double deadline)
+{
+	//corner turn of a stream of size x size frames through a ring of slotCount slots
+	VkGPU vkGPU = { 0 };
+	vkGPU.device_id = deviceID;
+	VkResult res = VK_SUCCESS;
+	if (slotCount == 0 || slotCount > VKT_STREAM_MAX_SLOTS) {
+		printf("Unsupported number of slots %d, use 1..%d\n", slotCount, VKT_STREAM_MAX_SLOTS);
+		return VK_ERROR_TOO_MANY_OBJECTS;
+	}
+	res = create_VkGPU(&vkGPU);
+	if (res != VK_SUCCESS) return res;
+	coalescedMemory = get_CoalescedMemory(&vkGPU, coalescedMemory);
+	uint32_t tile = coalescedMemory / sizeof(float);
+	if (size % tile != 0) {
+		printf("System size %d is not a multiple of the tile size %d\n", size, tile);
+		delete_VkGPU(&vkGPU);
+		return VK_ERROR_FORMAT_NOT_SUPPORTED;
+	}
+
+	VkFrameStream stream;
+	res = create_FrameStream(&vkGPU, coalescedMemory, size, slotCount, frames, &stream);
+	if (res != VK_SUCCESS) {
+		printf("Frame stream creation failed, error code: %d\n", res);
+		delete_FrameStream(&stream);
+		delete_VkGPU(&vkGPU);
+		return res;
+	}
+	float* source = (float*) malloc(stream.frameSize);
+	for (uint64_t i = 0; i < (uint64_t) size * size; i++) source[i] = (float) i;
+	stream.source = source;
+	stream.verify = 1;
+	stream.deadline = deadline;
+
+	double t = get_TimeMs();
+	res = run_FrameStream(&stream, frames, period);
+	t = get_TimeMs() - t;
+	if (res != VK_SUCCESS) printf("Frame stream failed, error code: %d\n", res);
+
+	printf("Frame size: %dx%d (%d KB)\nSlots: %d\nFrame period: %.3f ms, deadline: %.3f ms\n", size, size, (int) (stream.frameSize / 1024), slotCount, period, deadline);
+	printf("Frames: %llu completed, %llu dropped, %llu late, %llu failed verification\nThroughput: %.1f frames/s, %.3f GB/s\n",
+	       (unsigned long long) stream.completed, (unsigned long long) stream.dropped, (unsigned long long) stream.late, (unsigned long long) stream.failed,
+	       stream.completed / (t / 1000.0), 2.0 * stream.completed * stream.frameSize / 1024.0 / 1024.0 / 1024.0 / (t / 1000.0));
+	if (stream.completed > 0) {
+		uint64_t count = stream.completed;
+		qsort(stream.latency, count, sizeof(double), compare_Double);
+		printf("End-to-end latency: p50 %.3f ms, p90 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+		       stream.latency[(uint64_t) (0.50 * (count - 1))],
+		       stream.latency[(uint64_t) (0.90 * (count - 1))],
+		       stream.latency[(uint64_t) (0.99 * (count - 1))],
+		       stream.latency[count - 1]);
+	}
+	if (res == VK_SUCCESS && stream.failed != 0) res = VK_ERROR_FORMAT_NOT_SUPPORTED;
+
+	free(source);
+	delete_FrameStream(&stream);
+	delete_VkGPU(&vkGPU);
+	return res;
+}
@@ -0,0 +1,239 @@
+#include "VulkanTransposition.h"
+
+
+//Sub-matrix views: every transposition kernel reads size[1] rows of size[0] elements lda elements apart starting at
+//inputOffset, and writes the transposed rows ldb elements apart starting at outputOffset, as BLAS routines take lda and
+//ldb. Leading dimensions are specialization constants, offsets are push constants, so one pipeline serves every block of a
+//matrix and the offsets are not bound by the descriptor offset alignment. A block of a larger matrix needs no pack and
+//unpack copies around the transposition
+VkResult
+check_SubmatrixView(uint64_t elements, uint32_t rows, uint32_t cols, uint32_t ld, uint32_t offset)
+{
+	//rows x cols elements, rows ld elements apart from offset, inside a buffer of elements
+	if (rows == 0 || cols == 0 || ld < cols) return VK_ERROR_FORMAT_NOT_SUPPORTED;
+	if ((uint64_t) offset + (uint64_t) (rows - 1) * ld + cols > elements) return VK_ERROR_FORMAT_NOT_SUPPORTED;
+	if ((uint64_t) offset + (uint64_t) (rows - 1) * ld + cols > 0xFFFFFFFFull) return VK_ERROR_FORMAT_NOT_SUPPORTED;
+	return VK_SUCCESS;
+}
+
+
+uint64_t
+check_SubmatrixOutput(const uint32_t* input, const uint32_t* output, uint64_t elements, uint32_t size,
+                      uint32_t lda, uint32_t inputOffset, uint32_t ldb, uint32_t outputOffset, uint32_t sentinel)
+{
+	//wrong words of the transposed size x size block, and words outside the block that are not the sentinel any more
+	uint64_t errors = 0;
+	for (uint64_t i = 0; i < elements; i++) {
+		uint64_t e = i - outputOffset;
+		uint64_t row = e / ldb, col = e % ldb;
+		if (i >= outputOffset && row < size && col < size) errors += (output[i] != input[inputOffset + col * lda + row]);
+		else errors += (output[i] != sentinel);
+	}
+	return errors;
+}
+
+
+VkResult
+run_SubmatrixPacked(VkGPU* vkGPU, VkApplication* app, uint32_t* groupCount, VkBuffer* input, VkBuffer* packedInput,
+                    VkBuffer* packedOutput, VkBuffer* output, uint32_t size, uint32_t lda, uint32_t inputOffset, uint32_t ldb,
+                    uint32_t outputOffset, uint32_t batch, double* time)
+{
+	//the transposition without views: copy the block rows into a packed buffer, transpose it and copy the rows out
+	VkBufferCopy* packRegions = (VkBufferCopy*) malloc(size * sizeof(VkBufferCopy));
+	VkBufferCopy* unpackRegions = (VkBufferCopy*) malloc(size * sizeof(VkBufferCopy));
+	if (packRegions == NULL || unpackRegions == NULL) {
+		free(packRegions);
+		free(unpackRegions);
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
+	}
+	for (uint32_t r = 0; r < size; r++) {
+		packRegions[r].srcOffset = ((VkDeviceSize) inputOffset + (VkDeviceSize) r * lda) * sizeof(float);
+		packRegions[r].dstOffset = (VkDeviceSize) r * size * sizeof(float);
+		packRegions[r].size = (VkDeviceSize) size * sizeof(float);
+		unpackRegions[r].srcOffset = (VkDeviceSize) r * size * sizeof(float);
+		unpackRegions[r].dstOffset = ((VkDeviceSize) outputOffset + (VkDeviceSize) r * ldb) * sizeof(float);
+		unpackRegions[r].size = (VkDeviceSize) size * sizeof(float);
+	}
+	VkCommandBuffer commandBuffer = { 0 };
+	VkCommandBufferAllocateInfo commandBufferAllocateInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+                                        (const void*) NULL,
+                                        (VkCommandPool) vkGPU->commandPool,
+                                        (VkCommandBufferLevel) VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+                                        (uint32_t) 1 };
+	VkResult res = vkAllocateCommandBuffers(vkGPU->device, &commandBufferAllocateInfo, &commandBuffer);
+	if (res != VK_SUCCESS) {
+		free(packRegions);
+		free(unpackRegions);
+		return res;
+	}
+	VkCommandBufferBeginInfo commandBufferBeginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+                                     (const void*) NULL,
+                                     (VkCommandBufferUsageFlags) VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+                                     (const VkCommandBufferInheritanceInfo*) NULL };
+	res = vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo);
+	if (res == VK_SUCCESS) {
+		VkAppPushConstantsLayout pushConstants = { 0 };
+		for (uint32_t i = 0; i < batch; i++) {
+			vkCmdCopyBuffer(commandBuffer, input[0], packedInput[0], size, packRegions);
+			append_SparseBarrier(commandBuffer);
+			vkCmdPushConstants(commandBuffer, app->pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(VkAppPushConstantsLayout), &pushConstants);
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, app->pipeline);
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, app->pipelineLayout, 0, 1, &app->descriptorSet, 0, NULL);
+			vkCmdDispatch(commandBuffer, groupCount[0], groupCount[1], groupCount[2]);
+			append_SparseBarrier(commandBuffer);
+			vkCmdCopyBuffer(commandBuffer, packedOutput[0], output[0], size, unpackRegions);
+			append_SparseBarrier(commandBuffer);
+		}
+		res = vkEndCommandBuffer(commandBuffer);
+	}
+	if (res == VK_SUCCESS) {
+		VkSubmitInfo submitInfo = { VK_STRUCTURE_TYPE_SUBMIT_INFO, NULL, 0, NULL, NULL, 1, &commandBuffer, 0, NULL };
+		double t = get_TimeMs();
+		res = vkQueueSubmit(vkGPU->queue, 1, &submitInfo, vkGPU->fence);
+		if (res == VK_SUCCESS) res = vkWaitForFences(vkGPU->device, 1, &vkGPU->fence, VK_TRUE, 100000000000);
+		time[0] = (get_TimeMs() - t) / batch;
+		if (res == VK_SUCCESS) res = vkResetFences(vkGPU->device, 1, &vkGPU->fence);
+	}
+	vkFreeCommandBuffers(vkGPU->device, vkGPU->commandPool, 1, &commandBuffer);
+	free(packRegions);
+	free(unpackRegions);
+	return res;
+}
+
+
+VkResult
+Example_VulkanSubmatrix(uint32_t deviceID,
+                        uint32_t coalescedMemory,
+                        uint32_t size)
+{
+	//transposition of a size x size float block at an unaligned offset of a larger matrix into a block of another one, with
+	//every kernel on the views and with pack, transpose and unpack. Words around the output block must stay untouched
+	VkGPU vkGPU = { 0 };
+	vkGPU.device_id = deviceID;
+	VkResult res = create_VkGPU(&vkGPU);
+	if (res != VK_SUCCESS) return res;
+	coalescedMemory = get_CoalescedMemory(&vkGPU, coalescedMemory);
+	uint32_t tile = coalescedMemory / sizeof(float);
+	if (size % tile != 0) {
+		printf("Size %d is not a multiple of the tile %d\n", size, tile);
+		delete_VkGPU(&vkGPU);
+		return VK_ERROR_FORMAT_NOT_SUPPORTED;
+	}
+	//leading dimensions and offsets that are not multiples of the tile or of any alignment
+	uint32_t lda = size + 3 * tile + 5, ldb = size + tile + 7;
+	uint32_t inputOffset = 5 * lda + 11, outputOffset = 3 * ldb + 17;
+	uint64_t inputElements = (uint64_t) lda * (size + 9), outputElements = (uint64_t) ldb * (size + 6);
+	if (check_SubmatrixView(inputElements, size, size, lda, inputOffset) != VK_SUCCESS ||
+	    check_SubmatrixView(outputElements, size, size, ldb, outputOffset) != VK_SUCCESS) {
+		printf("Size %d does not fit 32-bit indices of the views\n", size);
+		delete_VkGPU(&vkGPU);
+		return VK_ERROR_FORMAT_NOT_SUPPORTED;
+	}
+	uint64_t elements = (inputElements > outputElements) ? inputElements : outputElements;
+	VkDeviceSize bufferSize = elements * sizeof(float);
+	VkDeviceSize packedSize = (VkDeviceSize) size * size * sizeof(float);
+	//input, output, packed input and packed output
+	VkBuffer buffer[4] = { 0 };
+	VkDeviceMemory bufferDeviceMemory[4] = { 0 };
+	for (uint32_t k = 0; k < 4 && res == VK_SUCCESS; k++) {
+		res = allocate_Buffer_DeviceMemory(vkGPU.physicalDevice, vkGPU.device,
+		                                   VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		                                   &vkGPU.physicalDeviceMemoryProperties, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		                                   (k < 2) ? bufferSize : packedSize, &buffer[k], &bufferDeviceMemory[k]);
+	}
+	uint32_t* input = (uint32_t*) malloc((size_t) bufferSize);
+	uint32_t* output = (uint32_t*) malloc((size_t) bufferSize);
+	uint32_t* blank = (uint32_t*) malloc((size_t) bufferSize);
+	if (res == VK_SUCCESS && (input == NULL || output == NULL || blank == NULL)) res = VK_ERROR_OUT_OF_HOST_MEMORY;
+	float sentinelValue = -1.0f;
+	uint32_t sentinel = 0;
+	memcpy(&sentinel, &sentinelValue, sizeof(float));
+	if (res == VK_SUCCESS) {
+		for (uint64_t i = 0; i < elements; i++) {
+			float f = (float) i;
+			memcpy(&input[i], &f, sizeof(float));
+			blank[i] = sentinel;
+		}
+		res = upload_Data(vkGPU.physicalDevice, vkGPU.device, input, &vkGPU.physicalDeviceMemoryProperties, vkGPU.commandPool,
+		                  vkGPU.queue, &vkGPU.fence, &buffer[0], bufferSize);
+	}
+
+	uint32_t batch = 100, failed = 0;
+	VkAppPushConstantsLayout pushConstants = { 0, inputOffset, outputOffset };
+	uint32_t groupCount[3] = { size / tile, size / tile, 1 };
+	const char* names[5] = { "no_bank_conflicts", "bank_conflicts", "swizzle", "generated", "pack + transpose + unpack" };
+	if (res == VK_SUCCESS)
+		printf("Block %dx%d, input lda %d offset %d, output ldb %d offset %d\n%-26s %10s %10s %s\n", size, size, lda, inputOffset,
+		       ldb, outputOffset, "kernel", "time, ms", "GB/s", "result");
+	for (uint32_t kernel = 0; kernel < 5 && res == VK_SUCCESS; kernel++) {
+		VkApplication app = { 0 };
+		uint32_t kernelGroupCount[3] = { groupCount[0], groupCount[1], groupCount[2] };
+		double time = 0;
+		res = upload_Data(vkGPU.physicalDevice, vkGPU.device, blank, &vkGPU.physicalDeviceMemoryProperties, vkGPU.commandPool,
+		                  vkGPU.queue, &vkGPU.fence, &buffer[1], bufferSize);
+		if (res != VK_SUCCESS) break;
+		if (kernel < 2 || kernel == 4) {
+			char shaderPath[256];
+			sprintf(shaderPath, "%s%s", SHADER_DIR, (kernel == 1) ? "transposition_bank_conflicts.spv" : "transposition_no_bank_conflicts.spv");
+			uint32_t systemSize[3] = { size, size, 1 };
+			VkBuffer*    appBuffer[2]   = { &buffer[0], &buffer[1] };
+			VkDeviceSize bufferSizes[2] = { bufferSize, bufferSize };
+			if (kernel == 4) {
+				appBuffer[0] = &buffer[2];
+				appBuffer[1] = &buffer[3];
+				bufferSizes[0] = bufferSizes[1] = packedSize;
+				res = create_App(vkGPU.device, &app.specializationConstants, coalescedMemory, appBuffer, bufferSizes, systemSize,
+				                 &app.descriptorPool, &app.descriptorSetLayout, &app.descriptorSet, (const char*) shaderPath, &app.pipelineLayout, &app.pipeline);
+			}
+			else res = create_SubmatrixApp(vkGPU.device, &app.specializationConstants, coalescedMemory, appBuffer, bufferSizes, systemSize, lda, ldb,
+			                               &app.descriptorPool, &app.descriptorSetLayout, &app.descriptorSet, (const char*) shaderPath, &app.pipelineLayout, &app.pipeline);
+		}
+		else if (kernel == 2) {
+			uint32_t localSizeY = tile;
+			while (tile * localSizeY > vkGPU.physicalDeviceProperties.limits.maxComputeWorkGroupInvocations) localSizeY /= 2;
+			VkSwizzleSpecializationConstantsLayout specializationConstants = { { tile, localSizeY, 1 }, size, tile, 1, 2, get_SwizzleMask(tile, 1), lda, ldb };
+			res = create_SpecializedApp(&vkGPU, &app, &specializationConstants, 10, &buffer[0], &buffer[1], bufferSize, "transposition_swizzle.spv");
+		}
+		else {
+			VkKernelConfig config = { 2, { size, size }, { 1, 0 }, 4, VKT_DTYPE_FLOAT, 32, 8, VKT_EPILOGUE_NONE, 1.0f, { 1, lda }, { 1, ldb } };
+			uint32_t cacheHit = 0;
+			double time_compile = 0;
+			res = create_KernelApp(&vkGPU, &config, &buffer[0], &buffer[1], bufferSize, &app, kernelGroupCount, &cacheHit, &time_compile);
+		}
+		if (res != VK_SUCCESS) {
+			printf("%-26s creation failed, error code: %d\n", names[kernel], res);
+			break;
+		}
+		if (kernel == 4)
+			res = run_SubmatrixPacked(&vkGPU, &app, kernelGroupCount, &buffer[0], &buffer[2], &buffer[3], &buffer[1], size, lda, inputOffset,
+			                          ldb, outputOffset, batch, &time);
+		else
+			res = run_AppPushConstants(vkGPU.device, vkGPU.commandPool, app.pipeline, app.pipelineLayout, &app.descriptorSet, kernelGroupCount,
+			                           vkGPU.queue, &vkGPU.fence, batch, &pushConstants, &time);
+		deleteApp(&vkGPU, &app);
+		if (res == VK_SUCCESS)
+			res = download_Data(vkGPU.physicalDevice, vkGPU.device, vkGPU.commandPool, &vkGPU.physicalDeviceMemoryProperties,
+			                    vkGPU.queue, &vkGPU.fence, output, &buffer[1], bufferSize);
+		if (res != VK_SUCCESS) {
+			printf("%-26s run failed, error code: %d\n", names[kernel], res);
+			break;
+		}
+		uint64_t errors = check_SubmatrixOutput(input, output, outputElements, size, lda, inputOffset, ldb, outputOffset, sentinel);
+		printf("%-26s %10.3f %10.2f %s\n", names[kernel], time, 2.0 * packedSize / 1024.0 / 1024.0 / 1024.0 / time * 1000,
+		       errors ? "FAILED" : "passed");
+		failed += (errors != 0);
+	}
+	if (res == VK_SUCCESS) {
+		printf("Verification %s\n", failed ? "FAILED" : "passed");
+		if (failed) res = VK_ERROR_FORMAT_NOT_SUPPORTED;
+	}
+	free(input);
+	free(output);
+	free(blank);
+	for (uint32_t k = 0; k < 4; k++) {
+		vkDestroyBuffer(vkGPU.device, buffer[k], NULL);
+		vkFreeMemory(vkGPU.device, bufferDeviceMemory[k], NULL);
+	}
+	delete_VkGPU(&vkGPU);
+	return res;
+}
@@ -0,0 +1,118 @@
+#include "VulkanTransposition.h"
+
+
+//XOR-swizzled shared memory (transposition_swizzle.comp) against the +1 padding and the conflicted tile
+
+
+uint32_t
+get_SwizzleMask(uint32_t tile, uint32_t elementWords)
+{
+	//a row of the swizzled tile is flipped within groups of elements that fit into one pass over all banks:
+	//consecutive rows of a column then start in different banks. tile is a power of two
+	uint32_t elementsPerBankPass = VKT_SHARED_MEMORY_BANKS / elementWords;
+	if (elementsPerBankPass == 0) elementsPerBankPass = 1;
+	return ((tile < elementsPerBankPass) ? tile : elementsPerBankPass) - 1;
+}
+
+
+VkResult
+Example_VulkanSwizzle(uint32_t deviceID,
+                      uint32_t size,
+                      uint32_t elementSize)
+{
+	//transposition of size x size elements of elementSize bytes with conflicted, padded and swizzled shared memory for all tile sizes
+	VkGPU vkGPU = { 0 };
+	vkGPU.device_id = deviceID;
+	VkResult res = VK_SUCCESS;
+	if (elementSize != 4 && elementSize != 8 && elementSize != 16) {
+		printf("Unsupported element size %d, use 4, 8 or 16 bytes\n", elementSize);
+		return VK_ERROR_FORMAT_NOT_SUPPORTED;
+	}
+	res = create_VkGPU(&vkGPU);
+	if (res != VK_SUCCESS) return res;
+	uint32_t elementWords = elementSize / 4;
+	VkPhysicalDeviceLimits* limits = &vkGPU.physicalDeviceProperties.limits;
+
+	VkDeviceSize bufferSize = (VkDeviceSize) elementSize * size * size;
+	VkBuffer inputBuffer = { 0 }, outputBuffer = { 0 };
+	VkDeviceMemory inputBufferDeviceMemory = { 0 }, outputBufferDeviceMemory = { 0 };
+	res = allocate_Buffer_DeviceMemory(vkGPU.physicalDevice, vkGPU.device,
+                                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                           &vkGPU.physicalDeviceMemoryProperties, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                           bufferSize, &inputBuffer, &inputBufferDeviceMemory);
+	if (res != VK_SUCCESS) {
+		printf("Input buffer allocation failed, error code: %d\n", res);
+		return res;
+	}
+	res = allocate_Buffer_DeviceMemory(vkGPU.physicalDevice, vkGPU.device,
+                                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                           &vkGPU.physicalDeviceMemoryProperties, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                           bufferSize, &outputBuffer, &outputBufferDeviceMemory);
+	if (res != VK_SUCCESS) {
+		printf("Output buffer allocation failed, error code: %d\n", res);
+		return res;
+	}
+	uint32_t* buffer_input  = (uint32_t*) malloc(bufferSize);
+	uint32_t* buffer_output = (uint32_t*) malloc(bufferSize);
+	for (uint64_t i = 0; i < bufferSize / 4; i++) buffer_input[i] = (uint32_t) i;
+	res = upload_Data(vkGPU.physicalDevice, vkGPU.device, buffer_input, &vkGPU.physicalDeviceMemoryProperties,
+                          vkGPU.commandPool, vkGPU.queue, &vkGPU.fence, &inputBuffer, bufferSize);
+	if (res != VK_SUCCESS) return res;
+
+	printf("System size: %dx%d\nElement size: %d bytes\nShared memory: %d bytes\n", size, size, elementSize, limits->maxComputeSharedMemorySize);
+	const char* modes[3] = { "conflicted", "padded", "swizzled" };
+	for (uint32_t tile = 8; tile <= 64; tile *= 2) {
+		for (uint32_t mode = 0; mode < 3; mode++) {
+			uint32_t sharedSize = tile * (tile + (mode & 1)) * elementSize;
+			if (size % tile != 0) {
+				printf("Tile %2dx%-2d %-10s: skipped, size is not a multiple of the tile\n", tile, tile, modes[mode]);
+				continue;
+			}
+			if (sharedSize > limits->maxComputeSharedMemorySize) {
+				printf("Tile %2dx%-2d %-10s: %6d bytes of shared memory, does not fit\n", tile, tile, modes[mode], sharedSize);
+				continue;
+			}
+			//threads of a column loop over the rows of the tile if tile x tile invocations are not available
+			uint32_t localSizeY = tile;
+			while (tile * localSizeY > limits->maxComputeWorkGroupInvocations) localSizeY /= 2;
+			VkApplication app = { 0 };
+			VkSwizzleSpecializationConstantsLayout specializationConstants = { { tile, localSizeY, 1 }, size, tile, elementWords, mode, get_SwizzleMask(tile, elementWords) };
+			res = create_SpecializedApp(&vkGPU, &app, &specializationConstants, 8, &inputBuffer, &outputBuffer, bufferSize, "transposition_swizzle.spv");
+			if (res != VK_SUCCESS) {
+				printf("Swizzle application creation failed, error code: %d\n", res);
+				break;
+			}
+			double time = 0;
+			uint32_t groupCount[3] = { size / tile, size / tile, 1 };
+			res = run_App(vkGPU.device, vkGPU.commandPool, app.pipeline, app.pipelineLayout, &app.descriptorSet,
+			              groupCount, vkGPU.queue, &vkGPU.fence, 100, &time);
+			deleteApp(&vkGPU, &app);
+			if (res != VK_SUCCESS) {
+				printf("Swizzle application run failed, error code: %d\n", res);
+				break;
+			}
+			res = download_Data(vkGPU.physicalDevice, vkGPU.device, vkGPU.commandPool, &vkGPU.physicalDeviceMemoryProperties,
+			                    vkGPU.queue, &vkGPU.fence, buffer_output, &outputBuffer, bufferSize);
+			if (res != VK_SUCCESS) break;
+			uint32_t passed = 1;
+			for (uint64_t j = 0; j < size && passed; j++) {
+				for (uint64_t i = 0; i < size && passed; i++) {
+					passed = (memcmp(buffer_output + (j * size + i) * elementWords, buffer_input + (i * size + j) * elementWords, elementSize) == 0);
+				}
+			}
+			printf("Tile %2dx%-2d %-10s: %6d bytes of shared memory, %.3f ms (%.1f GB/s), verification %s\n",
+			       tile, tile, modes[mode], sharedSize, time, 2 * bufferSize / 1024.0 / 1024.0 / 1024.0 / (time / 1000), passed ? "passed" : "FAILED");
+			if (!passed) res = VK_ERROR_FORMAT_NOT_SUPPORTED;
+		}
+		if (res != VK_SUCCESS && res != VK_ERROR_FORMAT_NOT_SUPPORTED) break;
+	}
+
+	free(buffer_input);
+	free(buffer_output);
+	vkDestroyBuffer(vkGPU.device, inputBuffer, NULL);
+	vkFreeMemory(vkGPU.device, inputBufferDeviceMemory, NULL);
+	vkDestroyBuffer(vkGPU.device, outputBuffer, NULL);
+	vkFreeMemory(vkGPU.device, outputBufferDeviceMemory, NULL);
+	delete_VkGPU(&vkGPU);
+	return res;
+}